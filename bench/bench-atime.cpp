@@ -0,0 +1,143 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// 32 threads read one hot file through their own handles, under each atime policy.
+// the read route just fills the buffer, so the cost is fskit's own per-read bookkeeping.
+// usage: bench-atime [reads per thread]
+
+#include "common.h"
+
+#define NUM_THREADS 32
+#define READ_SIZE 4096
+
+struct atime_mode {
+   char const* name;
+   int policy;
+   int flags;
+};
+
+static struct atime_mode modes[] = {
+   { "strictatime", FSKIT_ATIME_STRICT, 0 },
+   { "strictatime,coarse", FSKIT_ATIME_STRICT, FSKIT_TIME_COARSE },
+   { "relatime", FSKIT_ATIME_RELATIME, 0 },
+   { "noatime", FSKIT_ATIME_NOATIME, 0 },
+   { "lazytime", FSKIT_ATIME_LAZYTIME, 0 },
+   { "lazytime,coarse", FSKIT_ATIME_LAZYTIME, FSKIT_TIME_COARSE },
+   { NULL, 0, 0 }
+};
+
+struct atime_bench_args {
+
+   struct fskit_core* core;
+   struct fskit_file_handle* fh[NUM_THREADS];
+   uint64_t iterations;
+};
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   memset( buf, 0, buflen );
+   return buflen;
+}
+
+static void read_thread_main( int thread_id, void* arg ) {
+
+   struct atime_bench_args* args = (struct atime_bench_args*)arg;
+   char buf[READ_SIZE];
+   ssize_t rc = 0;
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      rc = fskit_read( args->core, args->fh[thread_id], buf, sizeof(buf), 0 );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_read rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct atime_bench_args args;
+   struct fskit_file_handle* fh = NULL;
+   char name[100];
+   double elapsed = 0;
+   int rc = 0;
+
+   memset( &args, 0, sizeof(args) );
+   args.iterations = 50000;
+
+   if( argc > 1 ) {
+      args.iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   for( int m = 0; modes[m].name != NULL; m++ ) {
+
+      struct fskit_core* core = NULL;
+
+      rc = fskit_bench_begin( &core, NULL );
+      if( rc != 0 ) {
+         exit(1);
+      }
+
+      rc = fskit_core_atime_policy( core, modes[m].policy, modes[m].flags );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_atime_policy rc = %d\n", rc );
+         exit(1);
+      }
+
+      fskit_route_read( core, "/([^/]+)", read_cb, FSKIT_CONCURRENT );
+
+      fh = fskit_create( core, "/hot", 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('/hot') rc = %d\n", rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+
+      for( int i = 0; i < NUM_THREADS; i++ ) {
+
+         args.fh[i] = fskit_open( core, "/hot", 0, 0, O_RDONLY, 0, &rc );
+         if( args.fh[i] == NULL ) {
+            fskit_error("fskit_open('/hot') rc = %d\n", rc );
+            exit(1);
+         }
+      }
+
+      args.core = core;
+
+      elapsed = fskit_bench_run_threads( NUM_THREADS, read_thread_main, &args );
+      if( elapsed < 0 ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "read %s threads=%d", modes[m].name, NUM_THREADS );
+      fskit_bench_report( name, args.iterations * NUM_THREADS, elapsed );
+
+      for( int i = 0; i < NUM_THREADS; i++ ) {
+         fskit_close( core, args.fh[i] );
+      }
+
+      fskit_bench_end( core, NULL );
+   }
+
+   return 0;
+}
@@ -0,0 +1,131 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// compare path resolution with and without the dentry cache, at several depths.
+// usage: bench-dcache [iterations]
+
+#include "common.h"
+
+static int depths[] = { 1, 4, 8, 12, 16, 32, -1 };
+
+// stat the file at the bottom of a directory chain, repeatedly
+static int bench_stat( struct fskit_core* core, char const* name, char const* path, uint64_t iterations ) {
+
+   struct stat sb;
+   int rc = 0;
+   double start = 0, end = 0;
+
+   start = fskit_bench_now();
+
+   for( uint64_t i = 0; i < iterations; i++ ) {
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+         return rc;
+      }
+   }
+
+   end = fskit_bench_now();
+
+   fskit_bench_report( name, iterations, end - start );
+   return 0;
+}
+
+// set up a core with a file at the given depth
+static char* setup( struct fskit_core* core, int depth ) {
+
+   int rc = 0;
+   char* dir_path = fskit_bench_mkdir_chain( core, depth );
+   if( dir_path == NULL ) {
+      return NULL;
+   }
+
+   char* file_path = fskit_fullpath( dir_path, "f", NULL );
+   free( dir_path );
+
+   struct fskit_file_handle* fh = fskit_create( core, file_path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", file_path, rc );
+      free( file_path );
+      return NULL;
+   }
+
+   fskit_close( core, fh );
+   return file_path;
+}
+
+int main( int argc, char** argv ) {
+
+   uint64_t iterations = 200000;
+   char name[100];
+   int rc = 0;
+
+   if( argc > 1 ) {
+      iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   for( int i = 0; depths[i] >= 0; i++ ) {
+
+      struct fskit_core* uncached = NULL;
+      struct fskit_core* cached = NULL;
+
+      rc = fskit_bench_begin( &uncached, NULL );
+      if( rc != 0 ) {
+         exit(1);
+      }
+
+      rc = fskit_bench_begin( &cached, NULL );
+      if( rc != 0 ) {
+         exit(1);
+      }
+
+      rc = fskit_core_dcache_enable( cached, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_dcache_enable rc = %d\n", rc );
+         exit(1);
+      }
+
+      char* path = setup( uncached, depths[i] );
+      char* path2 = setup( cached, depths[i] );
+      if( path == NULL || path2 == NULL ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "stat depth=%d uncached", depths[i] );
+      if( bench_stat( uncached, name, path, iterations ) != 0 ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "stat depth=%d cached", depths[i] );
+      if( bench_stat( cached, name, path2, iterations ) != 0 ) {
+         exit(1);
+      }
+
+      free( path );
+      free( path2 );
+
+      fskit_bench_end( uncached, NULL );
+      fskit_bench_end( cached, NULL );
+   }
+
+   return 0;
+}
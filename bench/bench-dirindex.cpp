@@ -0,0 +1,136 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// compare directory entry set insert and lookup, with and without the hash index, at several sizes.
+// usage: bench-dirindex [lookups]
+
+#include "common.h"
+
+static int sizes[] = { 1000, 100000, 1000000, -1 };
+
+// make the names of a directory's children
+static char** make_names( int count ) {
+
+   char** names = (char**)calloc( count, sizeof(char*) );
+   if( names == NULL ) {
+      return NULL;
+   }
+
+   for( int i = 0; i < count; i++ ) {
+
+      names[i] = (char*)calloc( 32, 1 );
+      if( names[i] == NULL ) {
+         return NULL;
+      }
+
+      snprintf( names[i], 32, "file-%08x", (unsigned int)(i * 2654435761U) );
+   }
+
+   return names;
+}
+
+// fill a set, then look up random children in it
+static int bench_set( char const* mode, unsigned int threshold, char** names, int count, uint64_t lookups ) {
+
+   char name[100];
+   int rc = 0;
+   double start = 0, end = 0;
+
+   fskit_entry_set* set = fskit_entry_set_new( NULL, NULL );
+   if( set == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_entry_set_hash_threshold( set, threshold );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   start = fskit_bench_now();
+
+   for( int i = 0; i < count; i++ ) {
+
+      rc = fskit_entry_set_insert( &set, names[i], NULL );
+      if( rc != 0 ) {
+         fskit_error("fskit_entry_set_insert rc = %d\n", rc );
+         return rc;
+      }
+   }
+
+   end = fskit_bench_now();
+
+   snprintf( name, sizeof(name), "insert n=%d %s", count, mode );
+   fskit_bench_report( name, count, end - start );
+
+   start = fskit_bench_now();
+
+   for( uint64_t i = 0; i < lookups; i++ ) {
+
+      char const* child_name = names[ (i * 7919) % count ];
+
+      if( fskit_entry_set_find_itr( set, child_name ) == NULL ) {
+         fskit_error("missing child '%s'\n", child_name );
+         return -ENOENT;
+      }
+   }
+
+   end = fskit_bench_now();
+
+   snprintf( name, sizeof(name), "lookup n=%d %s", count, mode );
+   fskit_bench_report( name, lookups, end - start );
+
+   fskit_entry_set_free( set );
+   return 0;
+}
+
+int main( int argc, char** argv ) {
+
+   uint64_t lookups = 1000000;
+
+   if( argc > 1 ) {
+      lookups = strtoull( argv[1], NULL, 10 );
+   }
+
+   fskit_set_debug_level( 0 );
+
+   for( int i = 0; sizes[i] >= 0; i++ ) {
+
+      char** names = make_names( sizes[i] );
+      if( names == NULL ) {
+         exit(1);
+      }
+
+      if( bench_set( "tree", FSKIT_ENTRY_SET_HASH_NEVER, names, sizes[i], lookups ) != 0 ) {
+         exit(1);
+      }
+
+      if( bench_set( "hashed", 0, names, sizes[i], lookups ) != 0 ) {
+         exit(1);
+      }
+
+      for( int j = 0; j < sizes[i]; j++ ) {
+         free( names[j] );
+      }
+      free( names );
+   }
+
+   return 0;
+}
@@ -0,0 +1,143 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// resolve one deep path from many threads at once, with and without optimistic lookups.
+// usage: bench-epoch [lookups per thread]
+
+#include "common.h"
+
+static int thread_counts[] = { 1, 2, 4, 8, 16, 32, 64, -1 };
+
+struct epoch_bench_args {
+
+   struct fskit_core* core;
+   char const* path;
+   uint64_t iterations;
+};
+
+static void resolve_thread_main( int thread_id, void* arg ) {
+
+   struct epoch_bench_args* args = (struct epoch_bench_args*)arg;
+   struct fskit_entry* fent = NULL;
+   int rc = 0;
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      fent = fskit_entry_resolve_path( args->core, args->path, 0, 0, false, &rc );
+      if( fent == NULL ) {
+         fskit_error("fskit_entry_resolve_path('%s') rc = %d\n", args->path, rc );
+         exit(1);
+      }
+
+      fskit_entry_unlock( fent );
+   }
+}
+
+// time lookups on a fresh core at every thread count
+static int run_bench( char const* mode, bool optimistic, uint64_t iterations ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct epoch_bench_args args;
+   struct fskit_epoch_stats stats;
+   char name[100];
+   double elapsed = 0;
+   int rc = 0;
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   if( optimistic ) {
+
+      rc = fskit_core_epoch_enable( core );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_epoch_enable rc = %d\n", rc );
+         return rc;
+      }
+   }
+
+   char* dir_path = fskit_bench_mkdir_chain( core, 4 );
+   if( dir_path == NULL ) {
+      return -ENOMEM;
+   }
+
+   char* path = fskit_fullpath( dir_path, "f", NULL );
+   free( dir_path );
+
+   fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      return rc;
+   }
+
+   fskit_close( core, fh );
+
+   memset( &args, 0, sizeof(args) );
+   args.core = core;
+   args.path = path;
+   args.iterations = iterations;
+
+   for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+      elapsed = fskit_bench_run_threads( thread_counts[i], resolve_thread_main, &args );
+      if( elapsed < 0 ) {
+         return -EIO;
+      }
+
+      snprintf( name, sizeof(name), "resolve %s threads=%d", mode, thread_counts[i] );
+      fskit_bench_report( name, args.iterations * thread_counts[i], elapsed );
+   }
+
+   if( optimistic ) {
+
+      fskit_core_epoch_stats( core, &stats );
+      printf("optimistic lookups: %" PRIu64 ", fallbacks: %" PRIu64 "\n", stats.lookups, stats.fallbacks );
+   }
+
+   free( path );
+   fskit_bench_end( core, NULL );
+
+   return 0;
+}
+
+int main( int argc, char** argv ) {
+
+   uint64_t iterations = 100000;
+   int rc = 0;
+
+   if( argc > 1 ) {
+      iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   rc = run_bench( "locked", false, iterations );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = run_bench( "optimistic", true, iterations );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   return 0;
+}
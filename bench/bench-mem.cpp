@@ -0,0 +1,148 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// measure heap bytes per inode, for files spread over directories and for directories.
+// usage: bench-mem [num_inodes]
+
+#include "common.h"
+
+#include <malloc.h>
+
+#define FILES_PER_DIR 1000
+
+// bytes currently allocated from the heap
+static size_t heap_in_use(void) {
+
+   struct mallinfo2 mi = mallinfo2();
+   return mi.uordblks + mi.hblkhd;
+}
+
+// report heap growth per inode
+static void report( char const* name, uint64_t num_inodes, size_t before, size_t after ) {
+
+   printf("%-40s %10" PRIu64 " inodes %12zu bytes %10.1f bytes/inode\n", name, num_inodes, after - before, (double)(after - before) / num_inodes );
+}
+
+// make num_files files, FILES_PER_DIR to a directory
+static int make_files( struct fskit_core* core, uint64_t num_files ) {
+
+   int rc = 0;
+   char path[PATH_MAX];
+   struct fskit_file_handle* fh = NULL;
+
+   for( uint64_t i = 0; i < num_files; i++ ) {
+
+      if( i % FILES_PER_DIR == 0 ) {
+
+         snprintf( path, PATH_MAX, "/d%" PRIu64, i / FILES_PER_DIR );
+
+         rc = fskit_mkdir( core, path, 0755, 0, 0 );
+         if( rc != 0 ) {
+            fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+            return rc;
+         }
+      }
+
+      snprintf( path, PATH_MAX, "/d%" PRIu64 "/file-%" PRIu64, i / FILES_PER_DIR, i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         return rc;
+      }
+
+      fskit_close( core, fh );
+   }
+
+   return 0;
+}
+
+// make num_dirs empty directories, FILES_PER_DIR to a parent
+static int make_dirs( struct fskit_core* core, uint64_t num_dirs ) {
+
+   int rc = 0;
+   char path[PATH_MAX];
+
+   for( uint64_t i = 0; i < num_dirs; i++ ) {
+
+      if( i % FILES_PER_DIR == 0 ) {
+
+         snprintf( path, PATH_MAX, "/p%" PRIu64, i / FILES_PER_DIR );
+
+         rc = fskit_mkdir( core, path, 0755, 0, 0 );
+         if( rc != 0 ) {
+            fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+            return rc;
+         }
+      }
+
+      snprintf( path, PATH_MAX, "/p%" PRIu64 "/dir-%" PRIu64, i / FILES_PER_DIR, i );
+
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         return rc;
+      }
+   }
+
+   return 0;
+}
+
+int main( int argc, char** argv ) {
+
+   uint64_t num_inodes = 1000000;
+   struct fskit_core* core = NULL;
+   size_t before = 0, after = 0;
+   int rc = 0;
+
+   if( argc > 1 ) {
+      num_inodes = strtoull( argv[1], NULL, 10 );
+   }
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   before = heap_in_use();
+
+   rc = make_files( core, num_inodes );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   after = heap_in_use();
+   report( "files", num_inodes + num_inodes / FILES_PER_DIR, before, after );
+
+   before = heap_in_use();
+
+   rc = make_dirs( core, num_inodes );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   after = heap_in_use();
+   report( "directories", num_inodes + num_inodes / FILES_PER_DIR, before, after );
+
+   fskit_bench_end( core, NULL );
+
+   return 0;
+}
@@ -0,0 +1,244 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// N threads read blocks of one shared file, chosen from a Zipfian distribution, with the page cache
+// disabled and under each eviction policy.  The cache holds a tenth of the file.
+// the read route sleeps to stand in for a backend with some latency.
+// usage: bench-pcache [reads per thread] [route latency in microseconds] [zipf theta]
+
+#include "common.h"
+
+#include <math.h>
+
+#define MAX_THREADS 16
+#define BLOCK_SIZE 4096
+#define FILE_BLOCKS 16384
+#define CACHE_BYTES (FILE_BLOCKS / 10 * BLOCK_SIZE)
+
+static int thread_counts[] = { 1, 4, 16, -1 };
+
+static int policies[] = { 0, FSKIT_PCACHE_CLOCK, FSKIT_PCACHE_ARC, -1 };
+static char const* policy_names[] = { "uncached", "clock", "arc" };
+
+static useconds_t route_latency = 20;
+
+// Zipfian generator over [0, n), after Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+struct zipf {
+   uint64_t n;
+   double theta;
+   double alpha;
+   double zetan;
+   double eta;
+};
+
+static double zeta( uint64_t n, double theta ) {
+
+   double sum = 0;
+
+   for( uint64_t i = 1; i <= n; i++ ) {
+      sum += 1.0 / pow( (double)i, theta );
+   }
+
+   return sum;
+}
+
+static void zipf_init( struct zipf* z, uint64_t n, double theta ) {
+
+   z->n = n;
+   z->theta = theta;
+   z->alpha = 1.0 / (1.0 - theta);
+   z->zetan = zeta( n, theta );
+   z->eta = (1.0 - pow( 2.0 / n, 1.0 - theta )) / (1.0 - zeta( 2, theta ) / z->zetan);
+}
+
+static uint64_t zipf_next( struct zipf* z, unsigned int* seed ) {
+
+   double u = (double)rand_r( seed ) / ((double)RAND_MAX + 1.0);
+   double uz = u * z->zetan;
+
+   if( uz < 1.0 ) {
+      return 0;
+   }
+
+   if( uz < 1.0 + pow( 0.5, z->theta ) ) {
+      return 1;
+   }
+
+   return (uint64_t)(z->n * pow( z->eta * u - z->eta + 1.0, z->alpha )) % z->n;
+}
+
+struct pcache_bench_args {
+
+   struct fskit_core* core;
+   struct fskit_file_handle* fh[MAX_THREADS];
+   uint64_t iterations;
+   struct zipf zipf;
+};
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   if( route_latency > 0 ) {
+      usleep( route_latency );
+   }
+
+   memset( buf, (int)(offset / BLOCK_SIZE), buflen );
+   return buflen;
+}
+
+static void read_thread_main( int thread_id, void* arg ) {
+
+   struct pcache_bench_args* args = (struct pcache_bench_args*)arg;
+   unsigned int seed = thread_id + 1;
+   char buf[BLOCK_SIZE];
+   ssize_t rc = 0;
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      // scatter the popular blocks over the file
+      uint64_t block = (zipf_next( &args->zipf, &seed ) * 2654435761ULL) % FILE_BLOCKS;
+
+      rc = fskit_read( args->core, args->fh[thread_id], buf, sizeof(buf), block * BLOCK_SIZE );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_read rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+}
+
+// make a core with one read route and the given cache policy (0 for none), and open the shared file once per thread
+static struct fskit_core* setup( int policy, struct pcache_bench_args* args ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   int rc = 0;
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      return NULL;
+   }
+
+   if( policy != 0 ) {
+
+      rc = fskit_core_pcache_enable( core, BLOCK_SIZE, CACHE_BYTES, policy );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_pcache_enable rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   rc = fskit_route_read( core, "/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      return NULL;
+   }
+
+   fh = fskit_create( core, "/shared", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/shared') rc = %d\n", rc );
+      return NULL;
+   }
+
+   fskit_close( core, fh );
+
+   for( int i = 0; i < MAX_THREADS; i++ ) {
+
+      args->fh[i] = fskit_open( core, "/shared", 0, 0, O_RDONLY, 0, &rc );
+      if( args->fh[i] == NULL ) {
+         fskit_error("fskit_open('/shared') rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   args->core = core;
+   return core;
+}
+
+int main( int argc, char** argv ) {
+
+   struct pcache_bench_args args;
+   struct fskit_pcache_stats before;
+   struct fskit_pcache_stats after;
+   char name[100];
+   double elapsed = 0;
+   double theta = 0.99;
+
+   memset( &args, 0, sizeof(args) );
+   args.iterations = 20000;
+
+   if( argc > 1 ) {
+      args.iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   if( argc > 2 ) {
+      route_latency = strtoul( argv[2], NULL, 10 );
+   }
+
+   if( argc > 3 ) {
+      theta = strtod( argv[3], NULL );
+   }
+
+   zipf_init( &args.zipf, FILE_BLOCKS, theta );
+
+   for( int p = 0; policies[p] >= 0; p++ ) {
+
+      struct fskit_core* core = setup( policies[p], &args );
+      if( core == NULL ) {
+         exit(1);
+      }
+
+      for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+         memset( &before, 0, sizeof(before) );
+         memset( &after, 0, sizeof(after) );
+
+         fskit_core_pcache_stats( core, &before );
+
+         elapsed = fskit_bench_run_threads( thread_counts[i], read_thread_main, &args );
+         if( elapsed < 0 ) {
+            exit(1);
+         }
+
+         fskit_core_pcache_stats( core, &after );
+
+         snprintf( name, sizeof(name), "read %s threads=%d", policy_names[p], thread_counts[i] );
+         fskit_bench_report( name, args.iterations * thread_counts[i], elapsed );
+
+         if( policies[p] != 0 ) {
+
+            uint64_t hits = after.hits - before.hits;
+            uint64_t misses = after.misses - before.misses;
+
+            printf("   hit rate %.1f%%, mean hit %.0fns, mean miss %.0fns\n",
+                   100.0 * hits / (hits + misses + (hits + misses == 0)),
+                   (double)(after.hit_ns - before.hit_ns) / (hits + (hits == 0)),
+                   (double)(after.miss_ns - before.miss_ns) / (misses + (misses == 0)) );
+         }
+      }
+
+      for( int i = 0; i < MAX_THREADS; i++ ) {
+         fskit_close( core, args.fh[i] );
+      }
+
+      fskit_bench_end( core, NULL );
+   }
+
+   return 0;
+}
@@ -0,0 +1,158 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// N threads write disjoint regions of one shared file through one write route, under each
+// consistency discipline that serializes writes to the same bytes.
+// the write route sleeps to stand in for a backend with some latency.
+// usage: bench-range [writes per thread] [route latency in microseconds]
+
+#include "common.h"
+
+#define MAX_THREADS 16
+#define REGION_SIZE 4096
+
+static int thread_counts[] = { 1, 2, 4, 8, 16, -1 };
+
+static int disciplines[] = { FSKIT_SEQUENTIAL, FSKIT_INODE_SEQUENTIAL, FSKIT_INODE_STRIPED, FSKIT_RANGE_SEQUENTIAL, -1 };
+static char const* discipline_names[] = { "sequential", "inode-sequential", "inode-striped", "range-sequential" };
+
+static useconds_t route_latency = 20;
+
+struct range_bench_args {
+
+   struct fskit_core* core;
+   struct fskit_file_handle* fh[MAX_THREADS];
+   uint64_t iterations;
+};
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   if( route_latency > 0 ) {
+      usleep( route_latency );
+   }
+
+   return buflen;
+}
+
+static void write_thread_main( int thread_id, void* arg ) {
+
+   struct range_bench_args* args = (struct range_bench_args*)arg;
+   char buf[512];
+   ssize_t rc = 0;
+
+   memset( buf, thread_id, sizeof(buf) );
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      // each thread stays within its own region of the file
+      off_t offset = (off_t)thread_id * REGION_SIZE + (i % (REGION_SIZE / sizeof(buf))) * sizeof(buf);
+
+      rc = fskit_write( args->core, args->fh[thread_id], buf, sizeof(buf), offset );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+}
+
+// make a core with one write route under the given discipline, and open the shared file once per thread
+static struct fskit_core* setup( int discipline, struct range_bench_args* args ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   int rc = 0;
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      return NULL;
+   }
+
+   rc = fskit_route_write( core, "/([^/]+)", write_cb, discipline );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      return NULL;
+   }
+
+   fh = fskit_create( core, "/shared", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/shared') rc = %d\n", rc );
+      return NULL;
+   }
+
+   fskit_close( core, fh );
+
+   for( int i = 0; i < MAX_THREADS; i++ ) {
+
+      args->fh[i] = fskit_open( core, "/shared", 0, 0, O_WRONLY, 0, &rc );
+      if( args->fh[i] == NULL ) {
+         fskit_error("fskit_open('/shared') rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   args->core = core;
+   return core;
+}
+
+int main( int argc, char** argv ) {
+
+   struct range_bench_args args;
+   char name[100];
+   double elapsed = 0;
+
+   memset( &args, 0, sizeof(args) );
+   args.iterations = 2000;
+
+   if( argc > 1 ) {
+      args.iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   if( argc > 2 ) {
+      route_latency = strtoul( argv[2], NULL, 10 );
+   }
+
+   for( int d = 0; disciplines[d] >= 0; d++ ) {
+
+      struct fskit_core* core = setup( disciplines[d], &args );
+      if( core == NULL ) {
+         exit(1);
+      }
+
+      for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+         elapsed = fskit_bench_run_threads( thread_counts[i], write_thread_main, &args );
+         if( elapsed < 0 ) {
+            exit(1);
+         }
+
+         snprintf( name, sizeof(name), "write %s threads=%d", discipline_names[d], thread_counts[i] );
+         fskit_bench_report( name, args.iterations * thread_counts[i], elapsed );
+      }
+
+      for( int i = 0; i < MAX_THREADS; i++ ) {
+         fskit_close( core, args.fh[i] );
+      }
+
+      fskit_bench_end( core, NULL );
+   }
+
+   return 0;
+}
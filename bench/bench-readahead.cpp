@@ -0,0 +1,192 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// N threads each stream their own file with sequential 4K reads: uncached, through the page cache,
+// and through the page cache with readahead.
+// the read route sleeps once per call to stand in for a backend with a per-request round trip.
+// usage: bench-readahead [file size in KB] [route latency in microseconds]
+
+#include "common.h"
+
+#define MAX_THREADS 16
+#define READ_SIZE 4096
+
+static int thread_counts[] = { 1, 4, 16, -1 };
+
+static char const* config_names[] = { "uncached", "pcache", "pcache+readahead" };
+#define NUM_CONFIGS 3
+
+static useconds_t route_latency = 100;
+static uint64_t num_route_reads = 0;
+
+struct readahead_bench_args {
+
+   struct fskit_core* core;
+   struct fskit_file_handle* fh[MAX_THREADS];
+   off_t file_size;
+};
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_fetch_add( &num_route_reads, 1, __ATOMIC_RELAXED );
+
+   if( route_latency > 0 ) {
+      usleep( route_latency );
+   }
+
+   memset( buf, (int)(offset / READ_SIZE), buflen );
+   return buflen;
+}
+
+static int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+   return 0;
+}
+
+static void read_thread_main( int thread_id, void* arg ) {
+
+   struct readahead_bench_args* args = (struct readahead_bench_args*)arg;
+   char buf[READ_SIZE];
+   ssize_t rc = 0;
+
+   for( off_t off = 0; off < args->file_size; off += READ_SIZE ) {
+
+      rc = fskit_read( args->core, args->fh[thread_id], buf, sizeof(buf), off );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_read rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+}
+
+// make a core with the given configuration, and give each thread a file
+static struct fskit_core* setup( int config, struct readahead_bench_args* args ) {
+
+   struct fskit_core* core = NULL;
+   char path[100];
+   int rc = 0;
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      return NULL;
+   }
+
+   if( config >= 1 ) {
+
+      // big enough to hold every thread's file, so each run starts cold only because the files are new
+      rc = fskit_core_pcache_enable( core, READ_SIZE, 2 * MAX_THREADS * args->file_size, FSKIT_PCACHE_CLOCK );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_pcache_enable rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   if( config >= 2 ) {
+
+      rc = fskit_core_readahead_enable( core, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_readahead_enable rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   fskit_route_read( core, "/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   fskit_route_trunc( core, "/([^/]+)", trunc_cb, FSKIT_CONCURRENT );
+
+   for( int i = 0; i < MAX_THREADS; i++ ) {
+
+      snprintf( path, sizeof(path), "/file-%d", i );
+
+      args->fh[i] = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( args->fh[i] == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         return NULL;
+      }
+
+      rc = fskit_ftrunc( core, args->fh[i], args->file_size );
+      if( rc != 0 ) {
+         fskit_error("fskit_ftrunc('%s') rc = %d\n", path, rc );
+         return NULL;
+      }
+
+      fskit_close( core, args->fh[i] );
+
+      args->fh[i] = fskit_open( core, path, 0, 0, O_RDONLY, 0, &rc );
+      if( args->fh[i] == NULL ) {
+         fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+         return NULL;
+      }
+   }
+
+   args->core = core;
+   return core;
+}
+
+int main( int argc, char** argv ) {
+
+   struct readahead_bench_args args;
+   char name[100];
+   double elapsed = 0;
+
+   memset( &args, 0, sizeof(args) );
+   args.file_size = 4 * 1024 * 1024;
+
+   if( argc > 1 ) {
+      args.file_size = strtoll( argv[1], NULL, 10 ) * 1024;
+   }
+
+   if( argc > 2 ) {
+      route_latency = strtoul( argv[2], NULL, 10 );
+   }
+
+   for( int c = 0; c < NUM_CONFIGS; c++ ) {
+
+      for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+         // fresh files (and a cold cache) for each run
+         struct fskit_core* core = setup( c, &args );
+         if( core == NULL ) {
+            exit(1);
+         }
+
+         uint64_t before = __atomic_load_n( &num_route_reads, __ATOMIC_RELAXED );
+         uint64_t ops = (args.file_size / READ_SIZE) * thread_counts[i];
+
+         elapsed = fskit_bench_run_threads( thread_counts[i], read_thread_main, &args );
+         if( elapsed < 0 ) {
+            exit(1);
+         }
+
+         snprintf( name, sizeof(name), "read %s threads=%d", config_names[c], thread_counts[i] );
+         fskit_bench_report( name, ops, elapsed );
+
+         printf("   %.1f reads per route call, %.1f MB/s\n", (double)ops / (__atomic_load_n( &num_route_reads, __ATOMIC_RELAXED ) - before),
+                (double)ops * READ_SIZE / elapsed / (1024.0 * 1024.0) );
+
+         for( int j = 0; j < MAX_THREADS; j++ ) {
+            fskit_close( core, args.fh[j] );
+         }
+
+         fskit_bench_end( core, NULL );
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,159 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// compare route dispatch overhead with and without the per-inode route match cache,
+// with 1, 10 and 100 registered read routes (only the last of which matches).
+// usage: bench-route [iterations]
+
+#include "common.h"
+
+static int num_routes[] = { 1, 10, 100, -1 };
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   return 0;
+}
+
+// read a file repeatedly through its route
+static int bench_read( struct fskit_core* core, char const* name, struct fskit_file_handle* fh, uint64_t iterations ) {
+
+   char buf[1];
+   ssize_t rc = 0;
+   double start = 0, end = 0;
+
+   start = fskit_bench_now();
+
+   for( uint64_t i = 0; i < iterations; i++ ) {
+
+      rc = fskit_read( core, fh, buf, sizeof(buf), 0 );
+      if( rc < 0 ) {
+         fskit_error("fskit_read rc = %zd\n", rc );
+         return (int)rc;
+      }
+   }
+
+   end = fskit_bench_now();
+
+   fskit_bench_report( name, iterations, end - start );
+   return 0;
+}
+
+// declare n read routes, where only the last one matches the benchmark file, and open it
+static struct fskit_file_handle* setup( struct fskit_core* core, int n ) {
+
+   int rc = 0;
+   char regex[100];
+   struct fskit_file_handle* fh = NULL;
+
+   for( int i = 0; i < n - 1; i++ ) {
+
+      snprintf( regex, sizeof(regex), "/other-%d/([^/]+)", i );
+      rc = fskit_route_read( core, regex, read_cb, FSKIT_CONCURRENT );
+      if( rc < 0 ) {
+         fskit_error("fskit_route_read('%s') rc = %d\n", regex, rc );
+         return NULL;
+      }
+   }
+
+   rc = fskit_route_read( core, "/bench/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      return NULL;
+   }
+
+   rc = fskit_mkdir( core, "/bench", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/bench') rc = %d\n", rc );
+      return NULL;
+   }
+
+   fh = fskit_create( core, "/bench/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/bench/f') rc = %d\n", rc );
+      return NULL;
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/bench/f", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/bench/f') rc = %d\n", rc );
+      return NULL;
+   }
+
+   return fh;
+}
+
+int main( int argc, char** argv ) {
+
+   uint64_t iterations = 200000;
+   char name[100];
+   int rc = 0;
+
+   if( argc > 1 ) {
+      iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   for( int i = 0; num_routes[i] >= 0; i++ ) {
+
+      struct fskit_core* uncached = NULL;
+      struct fskit_core* cached = NULL;
+
+      rc = fskit_bench_begin( &uncached, NULL );
+      if( rc != 0 ) {
+         exit(1);
+      }
+
+      rc = fskit_bench_begin( &cached, NULL );
+      if( rc != 0 ) {
+         exit(1);
+      }
+
+      rc = fskit_core_route_cache_enable( cached );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_route_cache_enable rc = %d\n", rc );
+         exit(1);
+      }
+
+      struct fskit_file_handle* fh = setup( uncached, num_routes[i] );
+      struct fskit_file_handle* fh2 = setup( cached, num_routes[i] );
+      if( fh == NULL || fh2 == NULL ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "read routes=%d uncached", num_routes[i] );
+      if( bench_read( uncached, name, fh, iterations ) != 0 ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "read routes=%d cached", num_routes[i] );
+      if( bench_read( cached, name, fh2, iterations ) != 0 ) {
+         exit(1);
+      }
+
+      fskit_close( uncached, fh );
+      fskit_close( cached, fh2 );
+
+      fskit_bench_end( uncached, NULL );
+      fskit_bench_end( cached, NULL );
+   }
+
+   return 0;
+}
@@ -0,0 +1,107 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// stat one hot file from many threads at once.
+// usage: bench-stat [stats per thread]
+
+#include "common.h"
+
+static int thread_counts[] = { 1, 2, 4, 8, 16, 32, -1 };
+
+struct stat_bench_args {
+
+   struct fskit_core* core;
+   char const* path;
+   uint64_t iterations;
+};
+
+static void stat_thread_main( int thread_id, void* arg ) {
+
+   struct stat_bench_args* args = (struct stat_bench_args*)arg;
+   struct stat sb;
+   int rc = 0;
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      rc = fskit_stat( args->core, args->path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", args->path, rc );
+         exit(1);
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct stat_bench_args args;
+   char name[100];
+   double elapsed = 0;
+   int rc = 0;
+
+   memset( &args, 0, sizeof(args) );
+   args.iterations = 100000;
+
+   if( argc > 1 ) {
+      args.iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   char* dir_path = fskit_bench_mkdir_chain( core, 4 );
+   if( dir_path == NULL ) {
+      exit(1);
+   }
+
+   char* path = fskit_fullpath( dir_path, "f", NULL );
+   free( dir_path );
+
+   fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   args.core = core;
+   args.path = path;
+
+   for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+      elapsed = fskit_bench_run_threads( thread_counts[i], stat_thread_main, &args );
+      if( elapsed < 0 ) {
+         exit(1);
+      }
+
+      snprintf( name, sizeof(name), "stat threads=%d", thread_counts[i] );
+      fskit_bench_report( name, args.iterations * thread_counts[i], elapsed );
+   }
+
+   free( path );
+   fskit_bench_end( core, NULL );
+
+   return 0;
+}
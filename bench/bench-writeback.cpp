@@ -0,0 +1,178 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// N threads each append small writes to their own file, with and without write-back buffering.
+// the write route sleeps to stand in for a backend with a per-call cost.
+// usage: bench-writeback [writes per thread] [write size] [route latency in microseconds]
+
+#include "common.h"
+
+#define MAX_THREADS 16
+
+static int thread_counts[] = { 1, 4, 16, -1 };
+
+static size_t buffer_sizes[] = { 0, 64 * 1024, FSKIT_WRITEBACK_DEFAULT_MAX_BYTES, 1024 * 1024, (size_t)-1 };
+
+static useconds_t route_latency = 20;
+static size_t write_size = 4096;
+static uint64_t num_route_writes = 0;
+
+struct writeback_bench_args {
+
+   struct fskit_core* core;
+   struct fskit_file_handle* fh[MAX_THREADS];
+   uint64_t iterations;
+};
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_fetch_add( &num_route_writes, 1, __ATOMIC_RELAXED );
+
+   if( route_latency > 0 ) {
+      usleep( route_latency );
+   }
+
+   return buflen;
+}
+
+static void write_thread_main( int thread_id, void* arg ) {
+
+   struct writeback_bench_args* args = (struct writeback_bench_args*)arg;
+   char* buf = (char*)calloc( write_size, 1 );
+   ssize_t rc = 0;
+
+   if( buf == NULL ) {
+      exit(1);
+   }
+
+   for( uint64_t i = 0; i < args->iterations; i++ ) {
+
+      rc = fskit_write( args->core, args->fh[thread_id], buf, write_size, i * write_size );
+      if( rc != (signed)write_size ) {
+         fskit_error("fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+
+   // the data isn't written until it's flushed
+   rc = fskit_fsync( args->core, args->fh[thread_id] );
+   if( rc != 0 ) {
+      fskit_error("fskit_fsync rc = %zd\n", rc );
+      exit(1);
+   }
+
+   free( buf );
+}
+
+// make a core with one write route and the given write-back buffer size (0 for none), and give each thread a file
+static struct fskit_core* setup( size_t buffer_size, struct writeback_bench_args* args ) {
+
+   struct fskit_core* core = NULL;
+   char path[100];
+   int rc = 0;
+
+   rc = fskit_bench_begin( &core, NULL );
+   if( rc != 0 ) {
+      return NULL;
+   }
+
+   if( buffer_size != 0 ) {
+
+      rc = fskit_core_writeback_enable( core, buffer_size, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_writeback_enable rc = %d\n", rc );
+         return NULL;
+      }
+   }
+
+   rc = fskit_route_write( core, "/([^/]+)", write_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      return NULL;
+   }
+
+   for( int i = 0; i < MAX_THREADS; i++ ) {
+
+      snprintf( path, sizeof(path), "/file-%d", i );
+
+      args->fh[i] = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( args->fh[i] == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         return NULL;
+      }
+   }
+
+   args->core = core;
+   return core;
+}
+
+int main( int argc, char** argv ) {
+
+   struct writeback_bench_args args;
+   char name[100];
+   double elapsed = 0;
+
+   memset( &args, 0, sizeof(args) );
+   args.iterations = 20000;
+
+   if( argc > 1 ) {
+      args.iterations = strtoull( argv[1], NULL, 10 );
+   }
+
+   if( argc > 2 ) {
+      write_size = strtoul( argv[2], NULL, 10 );
+   }
+
+   if( argc > 3 ) {
+      route_latency = strtoul( argv[3], NULL, 10 );
+   }
+
+   for( int b = 0; buffer_sizes[b] != (size_t)-1; b++ ) {
+
+      struct fskit_core* core = setup( buffer_sizes[b], &args );
+      if( core == NULL ) {
+         exit(1);
+      }
+
+      for( int i = 0; thread_counts[i] > 0; i++ ) {
+
+         uint64_t before = __atomic_load_n( &num_route_writes, __ATOMIC_RELAXED );
+
+         elapsed = fskit_bench_run_threads( thread_counts[i], write_thread_main, &args );
+         if( elapsed < 0 ) {
+            exit(1);
+         }
+
+         snprintf( name, sizeof(name), "write %zuB buffer=%zuK threads=%d", write_size, buffer_sizes[b] / 1024, thread_counts[i] );
+         fskit_bench_report( name, args.iterations * thread_counts[i], elapsed );
+
+         printf("   %.1f writes per route call\n", (double)(args.iterations * thread_counts[i]) / (__atomic_load_n( &num_route_writes, __ATOMIC_RELAXED ) - before) );
+      }
+
+      for( int i = 0; i < MAX_THREADS; i++ ) {
+         fskit_close( core, args.fh[i] );
+      }
+
+      fskit_bench_end( core, NULL );
+   }
+
+   return 0;
+}
@@ -0,0 +1,207 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "common.h"
+
+// monotonic time, in seconds
+double fskit_bench_now(void) {
+
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+
+   return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// print one result line
+void fskit_bench_report( char const* name, uint64_t num_ops, double elapsed ) {
+
+   double ns_per_op = 0;
+   double ops_per_sec = 0;
+
+   if( num_ops > 0 ) {
+      ns_per_op = (elapsed * 1e9) / num_ops;
+   }
+
+   if( elapsed > 0 ) {
+      ops_per_sec = num_ops / elapsed;
+   }
+
+   printf("%-40s %12" PRIu64 " ops %10.3f s %12.1f ns/op %14.1f ops/s\n", name, num_ops, elapsed, ns_per_op, ops_per_sec );
+}
+
+
+// begin a benchmark
+int fskit_bench_begin( struct fskit_core** core, void* bench_data ) {
+
+   int rc = 0;
+
+   // debug logging would dominate the measurements
+   fskit_set_debug_level( 0 );
+
+   rc = fskit_library_init();
+   if( rc != 0 ) {
+      fskit_error("fskit_library_init rc = %d\n", rc );
+      return rc;
+   }
+
+   *core = fskit_core_new();
+   if( *core == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_core_init( *core, bench_data );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_init rc = %d\n", rc );
+   }
+
+   return rc;
+}
+
+
+// end a benchmark
+int fskit_bench_end( struct fskit_core* core, void** bench_data ) {
+
+   int rc = 0;
+
+   rc = fskit_detach_all( core, "/" );
+   if( rc != 0 ) {
+      fskit_error("fskit_detach_all(\"/\") rc = %d\n", rc );
+      return rc;
+   }
+
+   rc = fskit_core_destroy( core, bench_data );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_destroy rc = %d\n", rc );
+      return rc;
+   }
+
+   rc = fskit_library_shutdown();
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   free( core );
+
+   return rc;
+}
+
+
+// per-thread arguments to fskit_bench_run_threads
+struct fskit_bench_thread_args {
+
+   int thread_id;
+   void (*func)( int thread_id, void* arg );
+   void* arg;
+   pthread_barrier_t* barrier;
+};
+
+static void* fskit_bench_thread_main( void* arg ) {
+
+   struct fskit_bench_thread_args* args = (struct fskit_bench_thread_args*)arg;
+
+   pthread_barrier_wait( args->barrier );
+   args->func( args->thread_id, args->arg );
+
+   return NULL;
+}
+
+// run a function in several threads at once, and time them
+// return elapsed seconds on success
+// return negative on error
+double fskit_bench_run_threads( int num_threads, void (*func)( int thread_id, void* arg ), void* arg ) {
+
+   pthread_barrier_t barrier;
+   pthread_t* threads = (pthread_t*)calloc( num_threads, sizeof(pthread_t) );
+   struct fskit_bench_thread_args* args = (struct fskit_bench_thread_args*)calloc( num_threads, sizeof(struct fskit_bench_thread_args) );
+   double start = 0, end = 0;
+   int rc = 0;
+
+   if( threads == NULL || args == NULL ) {
+      free( threads );
+      free( args );
+      return -ENOMEM;
+   }
+
+   // everyone, plus us
+   pthread_barrier_init( &barrier, NULL, num_threads + 1 );
+
+   for( int i = 0; i < num_threads; i++ ) {
+
+      args[i].thread_id = i;
+      args[i].func = func;
+      args[i].arg = arg;
+      args[i].barrier = &barrier;
+
+      rc = pthread_create( &threads[i], NULL, fskit_bench_thread_main, &args[i] );
+      if( rc != 0 ) {
+         fskit_error("pthread_create rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   start = fskit_bench_now();
+   pthread_barrier_wait( &barrier );
+
+   for( int i = 0; i < num_threads; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   end = fskit_bench_now();
+
+   pthread_barrier_destroy( &barrier );
+   free( threads );
+   free( args );
+
+   return end - start;
+}
+
+
+// make /d, /d/d, /d/d/d, ... down to the given depth.
+// return the malloc'ed path to the deepest directory ("/" if depth is 0), or NULL on error
+char* fskit_bench_mkdir_chain( struct fskit_core* core, int depth ) {
+
+   char* path = (char*)calloc( 2 * depth + 2, 1 );
+   int rc = 0;
+
+   if( path == NULL ) {
+      return NULL;
+   }
+
+   if( depth == 0 ) {
+      strcpy( path, "/" );
+      return path;
+   }
+
+   for( int i = 0; i < depth; i++ ) {
+
+      strcat( path, "/d" );
+
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 && rc != -EEXIST ) {
+
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         free( path );
+         return NULL;
+      }
+   }
+
+   return path;
+}
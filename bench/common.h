@@ -0,0 +1,46 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _BENCH_COMMON_H_
+#define _BENCH_COMMON_H_
+
+#include <fskit/fskit.h>
+
+#include <time.h>
+#include <pthread.h>
+
+// seconds since an arbitrary point, for timing
+double fskit_bench_now(void);
+
+// print one result line: name, number of operations, elapsed seconds
+void fskit_bench_report( char const* name, uint64_t num_ops, double elapsed );
+
+int fskit_bench_begin( struct fskit_core** core, void* bench_data );
+int fskit_bench_end( struct fskit_core* core, void** bench_data );
+
+// run func( thread_id, arg ) in num_threads threads, all started at once.
+// return the elapsed wall-clock time in seconds, or negative on error
+double fskit_bench_run_threads( int num_threads, void (*func)( int thread_id, void* arg ), void* arg );
+
+// make a chain of directories /d/d/d/... of the given depth, and return its path
+char* fskit_bench_mkdir_chain( struct fskit_core* core, int depth );
+
+#endif
@@ -0,0 +1,747 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2015  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_PRIVATE_H_
+#define _FSKIT_PRIVATE_H_
+
+#include <fskit/common.h>
+#include <fskit/debug.h>
+#include <fskit/sglib.h>
+#include <fskit/route.h>
+#include <fskit/aio.h>
+
+struct fskit_route_table_row;
+typedef struct fskit_route_table_row fskit_route_table;
+
+// reference-counted, immutable route table
+struct fskit_route_snapshot;
+
+// number of striped route locks per core
+#define FSKIT_ROUTE_LOCK_STRIPES 256
+
+// one striped route lock, padded so neighboring stripes don't share a cache line
+struct fskit_route_lock_stripe {
+   union {
+      pthread_mutex_t lock;
+      char pad[64];
+   } u;
+};
+
+// dentry cache
+struct fskit_dcache;
+
+// page cache
+struct fskit_pcache;
+
+// write-back buffering
+struct fskit_writeback;
+struct fskit_wbuf;
+
+// directory listing cache
+struct fskit_listcache;
+
+// background removal
+struct fskit_deferred;
+
+// background readahead
+struct fskit_readahead_worker;
+
+// epoch-based reclamation, for optimistic path lookups
+struct fskit_epoch;
+struct fskit_epoch_thread;
+typedef void (*fskit_epoch_free_func)( void* cls, void* ptr );
+
+// per-inode route match cache
+struct fskit_route_cache;
+
+// compiled route regexes
+struct fskit_route_segment;
+
+// per-inode byte-range lock, for the FSKIT_RANGE_SEQUENTIAL discipline
+struct fskit_range_lock;
+
+// a range held in a byte-range lock.  owned by the holder (i.e. on its stack).
+struct fskit_range_lock_ent {
+
+   uint64_t start;      // first byte
+   uint64_t end;        // one past the last byte; UINT64_MAX means "to the end of the file, and beyond"
+   bool write;          // if false, other non-write holders may overlap this range
+
+   struct fskit_range_lock_ent* prev;
+   struct fskit_range_lock_ent* next;
+};
+
+// xattrs
+struct fskit_xattr_set_entry;
+typedef struct fskit_xattr_set_entry fskit_xattr_set;
+
+struct fskit_xattr_set_entry {
+   
+   char* name;
+   char* value;
+   size_t value_len;
+   
+   struct fskit_xattr_set_entry* left;
+   struct fskit_xattr_set_entry* right;
+   char color;
+};
+
+// fskit inode structure
+struct fskit_entry {
+   uint64_t file_id;             // inode number
+
+   uint64_t owner;
+   uint64_t group;
+
+   // timestamps are stored atomically, since FSKIT_ATIME_RELATIME checks them without the lock
+   int64_t ctime_sec;
+   int64_t mtime_sec;
+   int64_t atime_sec;
+
+   int32_t ctime_nsec;
+   int32_t mtime_nsec;
+   int32_t atime_nsec;
+
+   mode_t mode;
+
+   // reference counts.  These are atomic, so they can be read and referenced under a read lock.
+   // use FSKIT_ENTRY_OPEN_COUNT and FSKIT_ENTRY_LINK_COUNT to read them.
+   int32_t open_count;
+   int32_t link_count;
+
+   off_t size;          // number of bytes in this file
+
+   // if this is a directory, this is allocated and points to a fskit_entry_set
+   int64_t num_children;
+   fskit_entry_set* children;
+
+   // if this is a directory, this changes whenever a child is added, removed, or renamed
+   // (or .. is repointed).  Values are unique across all directories.  Protected by lock.
+   uint64_t children_gen;
+
+   // application-defined entry data
+   void* app_data;
+
+   // if this is a special file, this is the device major/minor number
+   dev_t dev;
+
+   // lock governing access to the above structure fields
+   pthread_rwlock_t lock;
+
+   // extended attributes
+   fskit_xattr_set* xattrs;
+   
+   // if this is a symlink, this is the target
+   char* symlink_target;
+
+   uint8_t type;                 // type of inode
+
+   bool deletion_in_progress;   // set to true if this node is flagged for garbage-collection.  valid only for directories
+
+   bool from_slab;              // allocated by fskit_entry_new_ex (from the core's slab), not fskit_entry_new
+
+   // sequence counter for optimistic (lockless) readers.  Odd while a writer is changing
+   // the entry's type, permissions, or children; use FSKIT_ENTRY_WRITE_BEGIN/END to change it.
+   uint32_t seq;
+
+   // routes this inode's paths last matched, per route type (NULL until the first cached route call)
+   struct fskit_route_cache* route_cache;
+
+   // byte ranges held by running FSKIT_RANGE_SEQUENTIAL route calls (NULL until the first such call)
+   struct fskit_range_lock* range_lock;
+
+   // page cache: replaced (atomically) after every write or truncate with a value no inode has had before,
+   // so blocks cached before it are never read again, even if the inode number gets reused.
+   // use fskit_entry_bump_data_gen to change it.
+   uint64_t data_gen;
+
+   // FSKIT_ATIME_LAZYTIME: latest read time (ns since the epoch, atomic) not yet folded into atime
+   int64_t atime_pending_ns;
+};
+
+// read an entry's reference counts
+#define FSKIT_ENTRY_OPEN_COUNT( fent ) __atomic_load_n( &(fent)->open_count, __ATOMIC_SEQ_CST )
+#define FSKIT_ENTRY_LINK_COUNT( fent ) __atomic_load_n( &(fent)->link_count, __ATOMIC_SEQ_CST )
+
+// bracket a change that an optimistic reader could observe.  fent must be write-locked.
+#define FSKIT_ENTRY_WRITE_BEGIN( fent ) do { __atomic_add_fetch( &(fent)->seq, 1, __ATOMIC_SEQ_CST ); __atomic_thread_fence( __ATOMIC_SEQ_CST ); } while( 0 )
+#define FSKIT_ENTRY_WRITE_END( fent ) __atomic_add_fetch( &(fent)->seq, 1, __ATOMIC_SEQ_CST )
+
+// read an entry's sequence counter
+#define FSKIT_ENTRY_SEQ( fent ) __atomic_load_n( &(fent)->seq, __ATOMIC_ACQUIRE )
+
+// per-handle sequential readahead state
+struct fskit_readahead {
+
+   pthread_mutex_t lock;
+
+   off_t next_off;              // where the next read starts, if it's sequential
+   off_t start;                 // prefetched range of the current sequential run: [start, end)
+   off_t end;
+   size_t window;               // size of the last window prefetched (0 if there's no sequential run)
+
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t windows;
+   uint64_t bytes;
+
+   // window waiting for the readahead worker, and the worker's queue (protected by the worker's lock, not this one)
+   off_t async_off;
+   size_t async_len;                            // 0 if nothing is queued
+   bool async_busy;                             // set while the worker is prefetching for this handle
+   struct fskit_file_handle* async_next;
+};
+
+// file handle structure
+struct fskit_file_handle {
+
+   struct fskit_entry* fent;
+
+   char* path;
+   int flags;
+   uint64_t file_id;
+
+   // lock governing access to this structure
+   pthread_rwlock_t lock;
+
+   // application-defined data
+   void* app_data;
+
+   // buffered writes not yet routed (NULL until the first write, if write-back is enabled)
+   struct fskit_wbuf* wbuf;
+
+   // sequential access detection
+   struct fskit_readahead ra;
+};
+
+// a position in a directory stream, saved by telldir
+struct fskit_telldir_entry {
+
+   char name[ FSKIT_FILESYSTEM_NAMEMAX+1 ];     // last name read ("" if we haven't begun)
+   uint64_t skip;                               // entries after name that were also read
+   bool eof;
+};
+
+// a seekdir cookie is a telldir position (0 for the beginning), plus the number of entries read past it in the upper bits
+#define FSKIT_DIR_COOKIE_SKIP_SHIFT 40
+#define FSKIT_DIR_COOKIE_SKIP_MAX   ((uint64_t)1 << (63 - FSKIT_DIR_COOKIE_SKIP_SHIFT))
+#define FSKIT_DIR_COOKIE_POS_MASK   (((uint64_t)1 << FSKIT_DIR_COOKIE_SKIP_SHIFT) - 1)
+
+// directory handle structure
+struct fskit_dir_handle {
+
+   struct fskit_entry* dent;
+
+   char* path;
+   uint64_t file_id;
+   
+   // for iteration
+   char curr_name[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
+
+   // number of entries after curr_name to skip before we read again (set by seekdir)
+   uint64_t skip;
+   
+   // for seekdir/telldir: saved positions, indexed by (telldir cookie - 1)
+   struct fskit_telldir_entry* telldir_pos;
+   size_t telldir_count;
+   size_t telldir_cap;
+
+   // lock governing access to this structure
+   pthread_rwlock_t lock;
+
+   // application-defined data
+   void* app_data;
+   
+   // eof?
+   bool eof;
+};
+
+// allocator for fixed-size objects.
+// objects are carved out of large chunks, and freed objects are kept on per-thread free lists.
+struct fskit_slab_cache;
+struct fskit_slab_chunk;
+
+struct fskit_slab {
+
+   size_t obj_size;
+   size_t objs_per_chunk;
+
+   void* free_list;                     // free objects not held by any thread
+   struct fskit_slab_chunk* chunks;
+   uint64_t num_chunks;
+
+   // per-thread free lists
+   bool have_cache_key;
+   pthread_key_t cache_key;
+   struct fskit_slab_cache* caches;
+
+   // lock governing access to the above fields of this structure
+   pthread_mutex_t lock;
+};
+
+// fskit core filesystem structure
+struct fskit_core {
+
+   // root inode
+   struct fskit_entry root;
+
+   // functions to allocate/deallocate inodes
+   fskit_inode_alloc_t fskit_inode_alloc;
+   fskit_inode_free_t fskit_inode_free;
+
+   // application-defined fs-wide data
+   void* app_fs_data;
+
+   // number of files and directories that exist
+   uint64_t num_files;
+
+   // lock governing access to the above fields of this structure
+   pthread_rwlock_t lock;
+
+   /////////////////////////////////////////////////
+
+   // path routes, indexed by FSKIT_ROUTE_MATCH_*.
+   // this is an immutable snapshot; declaring or undeclaring a route swaps in a new one.
+   struct fskit_route_snapshot* routes;
+
+   // lock governing access to the above field.  held only long enough to reference or swap the snapshot.
+   pthread_rwlock_t route_lock;
+
+   // serializes route table updates
+   pthread_mutex_t route_update_lock;
+
+   // route table generation; bumped whenever a route is declared or undeclared.
+   // protected by route_update_lock
+   uint64_t route_gen;
+
+   // locks for the FSKIT_INODE_STRIPED and FSKIT_HANDLE_SEQUENTIAL disciplines, hashed by inode or handle
+   struct fskit_route_lock_stripe route_stripes[FSKIT_ROUTE_LOCK_STRIPES];
+
+   // if true, inodes remember which route their path matched (see fskit_core_route_cache_enable)
+   bool route_cache;
+   uint64_t route_cache_hits;
+   uint64_t route_cache_misses;
+
+   // extra features to enable 
+   uint64_t features;
+
+   // optional path-to-entry cache (NULL if disabled)
+   struct fskit_dcache* dcache;
+
+   // optional cache of file blocks in front of the read route (NULL if disabled)
+   struct fskit_pcache* pcache;
+
+   // optional per-handle write-back buffering in front of the write route (NULL if disabled)
+   struct fskit_writeback* writeback;
+
+   // optional cache of whole-directory listings (NULL if disabled)
+   struct fskit_listcache* listcache;
+
+   // optional background reaper for fskit_deferred_remove and friends (NULL if disabled)
+   struct fskit_deferred* deferred;
+
+   // how I/O updates timestamps (FSKIT_ATIME_*, and FSKIT_TIME_* flags)
+   int atime_policy;
+   int time_flags;
+
+   // readahead window bounds (readahead_max is 0 if disabled), and the thread that prefetches ahead of readers
+   size_t readahead_min;
+   size_t readahead_max;
+   struct fskit_readahead_worker* readahead_worker;
+
+   // optional epoch reclamation for optimistic lookups (NULL if disabled)
+   struct fskit_epoch* epoch;
+
+   // allocators for inodes, directory entries, and file handles
+   struct fskit_slab entry_slab;
+   struct fskit_slab set_slab;
+   struct fskit_slab handle_slab;
+};
+
+// route method type 
+union fskit_route_method {
+   fskit_entry_route_create_callback_t       create_cb;
+   fskit_entry_route_mknod_callback_t        mknod_cb;
+   fskit_entry_route_mkdir_callback_t        mkdir_cb;
+   fskit_entry_route_open_callback_t         open_cb;
+   fskit_entry_route_close_callback_t        close_cb;
+   fskit_entry_route_io_callback_t           io_cb;
+   fskit_entry_route_iov_callback_t          iov_cb;
+   fskit_entry_route_trunc_callback_t        trunc_cb;
+   fskit_entry_route_io_async_callback_t     io_async_cb;
+   fskit_entry_route_trunc_async_callback_t  trunc_async_cb;
+   fskit_entry_route_prefetch_callback_t     prefetch_cb;
+   fskit_entry_route_sync_callback_t         sync_cb;
+   fskit_entry_route_stat_callback_t         stat_cb;
+   fskit_entry_route_readdir_callback_t      readdir_cb;
+   fskit_entry_route_readdir_buf_callback_t  readdir_buf_cb;
+   fskit_entry_route_detach_callback_t       detach_cb;
+   fskit_entry_route_destroy_callback_t      destroy_cb;
+   fskit_entry_route_rename_callback_t       rename_cb;
+   fskit_entry_route_link_callback_t         link_cb;
+   fskit_entry_route_getxattr_callback_t     getxattr_cb;
+   fskit_entry_route_setxattr_callback_t     setxattr_cb;
+   fskit_entry_route_listxattr_callback_t    listxattr_cb;
+   fskit_entry_route_removexattr_callback_t  removexattr_cb;
+};
+
+// metadata about the patch matched to the route
+// TODO: union
+struct fskit_route_metadata {
+   char* path;                  // the path matched
+   int argc;                    // number of matches
+   char** argv;                 // each matched string in the path regex
+   bool argv_on_heap;           // if false, argv is borrowed (from the route call's arena, or the route cache)
+   
+   struct fskit_entry* parent;  // parent entry (creat(), mknod(), mkdir(), rename() only)
+   char* name;
+   
+   struct fskit_entry* new_parent;      // parent entry of the destination (rename(), link())
+   char* new_path;                      // path to rename/link to (rename(), link())
+   
+   bool garbage_collect;        // is this entry being unlinked due to garbage-collection, or due to an explicit command from userspace?
+   void* cls;                   // user-given argument to the method at hand
+
+   char const* xattr_name;
+   char const* xattr_value;
+   size_t xattr_value_len;
+   char* xattr_buf;
+   size_t xattr_buf_len;
+};
+
+// route dispatch arguments
+// TODO: union
+struct fskit_route_dispatch_args {
+
+   int flags;           // open() only
+
+   mode_t mode;         // create(), mknod() only
+   dev_t dev;           // mknod() only
+
+   void* inode_data;    // create(), mkdir(), unlink(), rmdir() only.  In create() and mkdir(), this is an output value.
+   void* handle_data;   // create(), open(), opendir(), close() only.  In open() and opendir(), this is an output value.
+
+   char* iobuf;         // read(), write() only.  In read(), this is an output value.
+   size_t iolen;        // read(), write() only
+   off_t iooff;         // read(), write(), trunc() only
+   fskit_route_io_continuation io_cont;  // read(), write(), trunc() only
+   struct iovec const* iov;             // readv(), writev() only.  iolen is their total length
+   int iovcnt;
+
+   struct fskit_io_token* io_token;     // asynchronous read(), write(), trunc() only
+
+   struct fskit_dir_entry** dents;        // readdir() only
+   uint64_t num_dents;
+   char* dirbuf;                          // readdir() only, when reading packed records (dents is NULL then)
+   size_t dirbuf_len;
+
+   void* handle;        // file or directory handle the call was made through, if any.  read(), write(), trunc(), close() only
+
+   char const* name;
+   struct stat* sb;      // stat() only
+   bool fent_absent;     // stat() only
+   
+   struct fskit_entry* parent;  // create(), mkdir(), mknod(), rename(), link(), rmdir(), unlink() (guaranteed to be write-locked if non-NULL)
+   
+   struct fskit_entry* new_parent;      // rename(), link() (guaranteed to be write-locked)
+   struct fskit_entry* dest;    // rename() only (not locked)
+   char const* new_path;      // rename(), link()
+   
+   bool garbage_collect;        // is this entry being unlinked due to garbage-collection, or due to an explicit command from userspace?
+
+   // for xattrs 
+   char const* xattr_name;
+   char const* xattr_value;
+   size_t xattr_value_len;
+   char* xattr_buf;
+   size_t xattr_buf_len;
+   int xattr_flags;
+
+   void* cls;               // create(), mknod(), mkdir(), only
+};
+
+// an asynchronous I/O operation.
+// owned by the submitter until its route returns FSKIT_IO_PENDING, and by fskit_io_complete() afterwards.
+struct fskit_io_token {
+
+   int type;                                    // FSKIT_ROUTE_MATCH_READ_ASYNC, _WRITE_ASYNC, or _TRUNC_ASYNC
+   struct fskit_core* core;
+   struct fskit_entry* fent;
+
+   struct fskit_path_route* route;              // the route that left the operation pending (ref'ed until completion)
+   struct fskit_route_dispatch_args dargs;
+   struct fskit_range_lock_ent range;           // held until completion under FSKIT_RANGE_SEQUENTIAL
+
+   // where to post the completion
+   struct fskit_io_cq* cq;
+   struct fskit_io_completion completion;
+   struct fskit_io_token* next;
+};
+
+// a path route
+struct fskit_path_route {
+
+   char* path_regex_str;                // string-ified regex
+   int num_expected_matches;            // number of expected match groups (upper bound)
+   regex_t path_regex;                  // compiled regular expression
+
+   // the regex compiled into a simpler matcher, where possible (see fskit_path_route_compile)
+   int prog;                            // FSKIT_ROUTE_PROG_*
+   char const* prefix;                  // literal prefix every matching path starts with (points into path_regex_str)
+   size_t prefix_len;
+   struct fskit_route_segment* segments;        // path components to match, for FSKIT_ROUTE_PROG_SEGMENTS
+   int num_segments;
+
+   int consistency_discipline;          // concurrent or sequential call?
+
+   int route_type;                      // one of FSKIT_ROUTE_MATCH_*
+   union fskit_route_method method;           // which method to call
+
+   pthread_rwlock_t lock;               // lock used to enforce the consistency discipline
+
+   int refcount;                        // one per route table snapshot that contains it
+
+   struct fskit_route_pool* pool;       // if non-NULL, calls run on this worker pool (installed once, by fskit_route_pool_enable)
+};
+
+// a route call waiting for, or running on, a route's worker pool.
+// lives on the caller's stack; the caller waits on it until it's done.
+struct fskit_route_pool_job {
+
+   int (*func)( void* );
+   void* arg;
+
+   int rc;
+   bool done;
+   pthread_cond_t finished;
+
+   struct timespec queued_at;
+   struct fskit_route_pool_job* next;
+};
+
+// worker threads that run a route's callbacks, with a bounded queue of callers
+struct fskit_route_pool {
+
+   int max_concurrency;                 // number of workers
+   int max_queued;                      // callers beyond this wait for room in the queue
+
+   pthread_t* workers;
+   int num_workers;
+
+   struct fskit_route_pool_job* head;
+   struct fskit_route_pool_job* tail;
+   int num_queued;
+   int num_running;
+   bool stopping;
+
+   pthread_mutex_t lock;
+   pthread_cond_t work;                 // a job was queued, or we're stopping
+   pthread_cond_t space;                // a job was dequeued
+
+   struct fskit_route_pool_stats stats;
+};
+
+// garbage collection 
+int fskit_entry_try_garbage_collect( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* child );
+
+// private--needed by closedir()
+int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle, void* handle_data );
+
+// private--needed by open()
+int fskit_run_user_create( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* fent, mode_t mode, void* cls, void** inode_data, void** handle_data );
+int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls, struct fskit_entry** ret_child, void** handle_data );
+struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err );
+
+// resolving paths relative to an open directory (internal API)
+struct fskit_entry* fskit_entry_resolve_path_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* path, uint64_t user, uint64_t group, bool writelock, int* err );
+char* fskit_path_at( struct fskit_dir_handle* dirh, char const* path, struct fskit_entry** dir, char const** dir_path );
+
+// private--needed by opendir()
+int fskit_run_user_open( struct fskit_core* core, char const* path, struct fskit_entry* fent, int flags, void** handle_data );
+
+// private--needed by read
+ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle, void* handle_data );
+
+// private--needed by asynchronous I/O
+ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, char const* buf, size_t buflen, off_t offset, void* handle, void* handle_data );
+int fskit_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t offset, ssize_t num_written );
+int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent, off_t new_size, ssize_t trunc_rc );
+
+// private--needed by any detach logic
+int fskit_run_user_detach( struct fskit_core* core, char const* path, struct fskit_entry* parent, struct fskit_entry* fent );
+
+// routes 
+typedef struct fskit_path_route* fskit_path_route_entry;
+SGLIB_DEFINE_VECTOR_PROTOTYPES( fskit_path_route_entry );
+typedef struct sglib_fskit_path_route_entry_vector fskit_route_list_t;
+
+// route tables
+#define FSKIT_ROUTE_TABLE_ROW_CMP( r1, r2 ) ((r1)->route_type - (r2)->route_type)
+
+SGLIB_DEFINE_RBTREE_PROTOTYPES( fskit_route_table, left, right, color, FSKIT_ROUTE_TABLE_ROW_CMP );
+typedef struct sglib_fskit_route_table_iterator fskit_route_table_itr;
+
+fskit_route_table* fskit_route_table_new(void);
+fskit_route_table* fskit_route_table_dup( fskit_route_table* routes );
+int fskit_route_table_free( fskit_route_table* routes );
+int fskit_route_table_row_free( struct fskit_route_table_row* row );
+int fskit_route_table_insert( fskit_route_table** routes, int route_type, struct fskit_path_route* route );
+struct fskit_route_table_row* fskit_route_table_get_row( fskit_route_table* routes, int route_type );
+struct fskit_path_route* fskit_route_table_find( fskit_route_table* routes, int route_type, int route_id );
+struct fskit_path_route* fskit_route_table_remove( fskit_route_table** route_table, int route_type, int route_id );
+
+// populate route dispatch arguments (internal API)
+int fskit_route_create_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, mode_t mode, void* cls );
+int fskit_route_mknod_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, mode_t mode, dev_t dev, void* cls );
+int fskit_route_mkdir_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, mode_t mode, void* cls );
+int fskit_route_open_args( struct fskit_route_dispatch_args* dargs, char const* name, int flags );
+int fskit_route_close_args( struct fskit_route_dispatch_args* dargs, void* handle_data );
+int fskit_route_readdir_args( struct fskit_route_dispatch_args* dargs, char const* name, struct fskit_dir_entry** dents, uint64_t num_dents );
+int fskit_route_readdir_buf_args( struct fskit_route_dispatch_args* dargs, char const* name, char* dirbuf, size_t dirbuf_len );
+int fskit_route_io_args( struct fskit_route_dispatch_args* dargs, char* iobuf, size_t iolen, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont );
+int fskit_route_iov_args( struct fskit_route_dispatch_args* dargs, struct iovec const* iov, int iovcnt, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont );
+int fskit_route_trunc_args( struct fskit_route_dispatch_args* dargs, char const* name, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont );
+int fskit_route_detach_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, bool garbage_collect, void* inode_data );
+int fskit_route_destroy_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* parent, char const* name, void* inode_data );
+int fskit_route_stat_args( struct fskit_route_dispatch_args* dargs, char const* name, struct stat* sb, bool fent_absent );
+int fskit_route_sync_args( struct fskit_route_dispatch_args* dargs );
+int fskit_route_rename_args( struct fskit_route_dispatch_args* dargs, struct fskit_entry* old_parent, char const* old_name, char const* new_path, struct fskit_entry* new_parent, struct fskit_entry* dest );
+int fskit_route_link_args( struct fskit_route_dispatch_args* dargs, char const* name, char const* new_path, struct fskit_entry* new_parent );
+int fskit_route_getxattr_args( struct fskit_route_dispatch_args* args, char const* xattr_name, char* xattr_buf, size_t xattr_buf_len );
+int fskit_route_setxattr_args( struct fskit_route_dispatch_args* args, char const* xattr_name, char const* xattr_value, size_t xattr_value_len, int flags );
+int fskit_route_listxattr_args( struct fskit_route_dispatch_args* args, char* xattr_buf, size_t xattr_buf_len );
+int fskit_route_removexattr_args( struct fskit_route_dispatch_args* args, char const* xattr_name );
+
+// call user-supplied routes (internal API)
+int fskit_route_call_create( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_mknod( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_mkdir( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_open( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_readdir( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_readdir_buf( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_readv( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_writev( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_prefetch( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_read_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_write_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_trunc_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_io_finish( struct fskit_io_token* token, ssize_t rc );
+int fskit_route_call_detach( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_destroy( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_stat( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_sync( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_rename( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_link( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_getxattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_listxattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_setxattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+int fskit_route_call_removexattr( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc );
+
+// memory management (internal API)
+int fskit_path_route_free( struct fskit_path_route* route );
+int fskit_route_cache_free( struct fskit_route_cache* cache );
+struct fskit_route_snapshot* fskit_route_snapshot_new( fskit_route_table* routes, uint64_t gen );
+void fskit_route_snapshot_unref( struct fskit_route_snapshot* snapshot );
+
+// dentry cache (internal API)
+struct fskit_entry* fskit_dcache_lookup( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, uint64_t* gen );
+int fskit_dcache_insert( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, uint64_t gen, struct fskit_entry* fent );
+int fskit_dcache_free( struct fskit_dcache* dcache );
+
+// page cache (internal API)
+ssize_t fskit_pcache_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle, void* handle_data );
+int fskit_pcache_prefetch( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t offset, size_t len, void* handle, void* handle_data );
+int fskit_pcache_free( struct fskit_pcache* pcache );
+void fskit_entry_bump_data_gen( struct fskit_entry* fent );
+
+// stat routes (internal API)
+int fskit_do_user_stat( struct fskit_core* core, char const* fs_path, struct fskit_entry* fent, struct stat* sb );
+
+// packed readdir records (internal API)
+int fskit_readdir_dispatch_packed( fskit_entry_route_readdir_callback_t readdir_cb, struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen );
+
+// readahead (internal API)
+int fskit_readahead( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len, off_t* ra_off, size_t* ra_len );
+int fskit_readahead_issue( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len );
+int fskit_readahead_queue( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len );
+int fskit_readahead_release( struct fskit_core* core, struct fskit_file_handle* fh );
+int fskit_readahead_free( struct fskit_readahead_worker* worker );
+
+// I/O timestamps (internal API)
+int fskit_core_now( struct fskit_core* core, struct timespec* now );
+int fskit_entry_touch_read( struct fskit_core* core, struct fskit_entry* fent );
+int fskit_entry_touch_write( struct fskit_core* core, struct fskit_entry* fent );
+int fskit_entry_fold_atime( struct fskit_entry* fent );
+
+// write-back buffering (internal API)
+ssize_t fskit_wbuf_write( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset );
+int fskit_wbuf_flush( struct fskit_core* core, struct fskit_file_handle* fh );
+int fskit_wbuf_flush_range( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len );
+int fskit_wbuf_release( struct fskit_core* core, struct fskit_file_handle* fh );
+int fskit_writeback_free( struct fskit_writeback* writeback );
+
+// directory listing cache (internal API)
+void fskit_entry_bump_children_gen( struct fskit_entry* fent );
+struct fskit_dir_snapshot* fskit_dir_snapshot_new( uint64_t file_id, char const* path, uint64_t gen, uint64_t route_gen, char* records, size_t len );
+struct fskit_dir_snapshot* fskit_listcache_lookup( struct fskit_core* core, uint64_t file_id, char const* path, uint64_t gen, uint64_t route_gen );
+int fskit_listcache_insert( struct fskit_core* core, struct fskit_dir_snapshot* snapshot );
+int fskit_listcache_free( struct fskit_listcache* listcache );
+
+// background removal (internal API)
+int fskit_detach_queue_children( struct fskit_detach_ctx* ctx, char const* dir_path, fskit_entry_set** dir_children );
+int fskit_detach_ctx_reap( struct fskit_core* core, struct fskit_detach_ctx* ctx, uint64_t max, uint64_t* num_reaped );
+uint64_t fskit_detach_ctx_size( struct fskit_detach_ctx* ctx );
+int fskit_deferred_free( struct fskit_deferred* deferred );
+
+// slab allocator (internal API)
+int fskit_slab_init( struct fskit_slab* slab, size_t obj_size );
+void* fskit_slab_alloc( struct fskit_slab* slab );
+void fskit_slab_free( struct fskit_slab* slab, void* ptr );
+int fskit_slab_destroy( struct fskit_slab* slab );
+
+// byte-range locks (internal API)
+struct fskit_range_lock* fskit_entry_range_lock( struct fskit_entry* fent );
+int fskit_range_lock( struct fskit_range_lock* rl, struct fskit_range_lock_ent* ent, uint64_t start, uint64_t end, bool write );
+int fskit_range_unlock( struct fskit_range_lock* rl, struct fskit_range_lock_ent* ent );
+int fskit_range_lock_free( struct fskit_range_lock* rl );
+
+// route worker pools (internal API)
+struct fskit_route_pool* fskit_route_pool_new( int max_concurrency, int max_queued, int* err );
+int fskit_route_pool_run( struct fskit_route_pool* pool, int (*func)( void* ), void* arg );
+int fskit_route_pool_get_stats( struct fskit_route_pool* pool, struct fskit_route_pool_stats* stats );
+int fskit_route_pool_free( struct fskit_route_pool* pool );
+
+// epoch reclamation (internal API)
+struct fskit_epoch_thread* fskit_epoch_enter( struct fskit_epoch* epoch );
+void fskit_epoch_exit( struct fskit_epoch_thread* rec, bool fallback );
+void fskit_epoch_defer( struct fskit_epoch* epoch, fskit_epoch_free_func free_func, void* cls, void* ptr );
+void fskit_epoch_synchronize( struct fskit_epoch* epoch );
+int fskit_epoch_free( struct fskit_epoch* epoch );
+struct fskit_entry* fskit_entry_set_find_name_optimistic( fskit_entry_set* set, char const* name, size_t name_len );
+
+// private--needed by open()
+int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle, void* handle_data );
+
+#endif
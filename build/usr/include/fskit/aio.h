@@ -0,0 +1,62 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_AIO_H_
+#define _FSKIT_AIO_H_
+
+#include <fskit/debug.h>
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// returned by an asynchronous I/O route to say that it will call fskit_io_complete() later
+#define FSKIT_IO_PENDING        (-EINPROGRESS)
+
+// an I/O operation started by fskit_read_async(), fskit_write_async() or fskit_ftrunc_async()
+struct fskit_io_token;
+
+// a queue of finished asynchronous I/O operations
+struct fskit_io_cq;
+
+// a finished asynchronous I/O operation
+struct fskit_io_completion {
+   void* user_data;     // as passed to fskit_*_async()
+   ssize_t rc;          // what the synchronous call would have returned
+};
+
+FSKIT_C_LINKAGE_BEGIN
+
+// completion queues
+struct fskit_io_cq* fskit_io_cq_new(void);
+int fskit_io_cq_free( struct fskit_io_cq* cq );
+int fskit_io_cq_fd( struct fskit_io_cq* cq );
+int fskit_io_cq_poll( struct fskit_io_cq* cq, struct fskit_io_completion* completions, int max_completions, int timeout_ms );
+
+// start asynchronous I/O
+int fskit_read_async( struct fskit_core* core, struct fskit_file_handle* fh, char* buf, size_t buflen, off_t offset, struct fskit_io_cq* cq, void* user_data );
+int fskit_write_async( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset, struct fskit_io_cq* cq, void* user_data );
+int fskit_ftrunc_async( struct fskit_core* core, struct fskit_file_handle* fh, off_t new_size, struct fskit_io_cq* cq, void* user_data );
+
+// finish an I/O operation that an asynchronous route left pending
+int fskit_io_complete( struct fskit_io_token* token, ssize_t rc );
+
+FSKIT_C_LINKAGE_END
+
+#endif
@@ -0,0 +1,46 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_DCACHE_H_
+#define _FSKIT_DCACHE_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// default number of slots in a core's dentry cache
+#define FSKIT_DCACHE_DEFAULT_SLOTS 4096
+
+FSKIT_C_LINKAGE_BEGIN
+
+// dentry cache statistics
+struct fskit_dcache_stats {
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t invalidations;
+};
+
+int fskit_core_dcache_enable( struct fskit_core* core, size_t num_slots );
+int fskit_core_dcache_invalidate( struct fskit_core* core );
+int fskit_core_dcache_stats( struct fskit_core* core, struct fskit_dcache_stats* stats );
+
+FSKIT_C_LINKAGE_END
+
+#endif
@@ -0,0 +1,54 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_DEFERRED_H_
+#define _FSKIT_DEFERRED_H_
+
+#include <fskit/common.h>
+#include <fskit/debug.h>
+#include <fskit/entry.h>
+
+// default number of entries the reaper garbage-collects before looking at the next removal
+#define FSKIT_DEFERRED_DEFAULT_BATCH_SIZE 1024
+
+FSKIT_C_LINKAGE_BEGIN
+
+// background removal statistics
+struct fskit_deferred_stats {
+   uint64_t queued;             // removals handed to the reaper
+   uint64_t completed;          // removals fully garbage-collected
+   uint64_t failed;             // removals abandoned after an error
+   uint64_t pending;            // removals queued or in progress right now
+   uint64_t reaped;             // entries unlinked and garbage-collected so far
+   uint64_t batches;            // batches run
+};
+
+int fskit_core_deferred_enable( struct fskit_core* core, size_t batch_size );
+int fskit_core_deferred_drain( struct fskit_core* core );
+int fskit_core_deferred_stats( struct fskit_core* core, struct fskit_deferred_stats* stats );
+
+int fskit_deferred_remove( struct fskit_core* core, char const* child_path, struct fskit_entry* child );
+int fskit_deferred_remove_all( struct fskit_core* core, char const* child_path, struct fskit_entry* child );
+int fskit_deferred_remove_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group );
+
+FSKIT_C_LINKAGE_END
+
+#endif
@@ -0,0 +1,59 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_PCACHE_H_
+#define _FSKIT_PCACHE_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// defaults for fskit_core_pcache_enable
+#define FSKIT_PCACHE_DEFAULT_BLOCK_SIZE 4096
+#define FSKIT_PCACHE_DEFAULT_MAX_BYTES  (64 * 1024 * 1024)
+
+// number of independently-locked shards
+#define FSKIT_PCACHE_SHARDS 16
+
+// eviction policies
+#define FSKIT_PCACHE_CLOCK      1       // second-chance; hits only take a shard's read lock
+#define FSKIT_PCACHE_ARC        2       // adaptive replacement; resists scans, but hits take a shard's write lock
+
+FSKIT_C_LINKAGE_BEGIN
+
+// page cache statistics
+struct fskit_pcache_stats {
+   uint64_t hits;               // blocks read from the cache
+   uint64_t misses;             // blocks read from the read route
+   uint64_t evictions;
+   uint64_t invalidations;      // calls to fskit_core_pcache_invalidate
+   uint64_t hit_ns;             // total time spent copying out cached blocks
+   uint64_t miss_ns;            // total time spent reading missed blocks from the read route
+   uint64_t blocks;             // blocks cached right now
+   uint64_t prefetched;         // blocks read ahead of time on behalf of readahead
+};
+
+int fskit_core_pcache_enable( struct fskit_core* core, size_t block_size, size_t max_bytes, int policy );
+int fskit_core_pcache_invalidate( struct fskit_core* core, uint64_t file_id );
+int fskit_core_pcache_stats( struct fskit_core* core, struct fskit_pcache_stats* stats );
+
+FSKIT_C_LINKAGE_END
+
+#endif
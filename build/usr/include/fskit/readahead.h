@@ -0,0 +1,49 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_READAHEAD_H_
+#define _FSKIT_READAHEAD_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// defaults for fskit_core_readahead_enable
+#define FSKIT_READAHEAD_DEFAULT_MIN_WINDOW      (16 * 1024)
+#define FSKIT_READAHEAD_DEFAULT_MAX_WINDOW      (256 * 1024)
+
+// per-handle readahead statistics
+struct fskit_readahead_stats {
+   uint64_t hits;               // reads that fell entirely within a prefetched range
+   uint64_t misses;             // reads that didn't
+   uint64_t windows;            // prefetches issued
+   uint64_t bytes;              // bytes prefetched
+   size_t window;               // current window size (0 if the handle isn't being read sequentially)
+};
+
+FSKIT_C_LINKAGE_BEGIN
+
+int fskit_core_readahead_enable( struct fskit_core* core, size_t min_window, size_t max_window );
+int fskit_core_readahead_drain( struct fskit_core* core );
+int fskit_readahead_stats( struct fskit_core* core, struct fskit_file_handle* fh, struct fskit_readahead_stats* stats );
+
+FSKIT_C_LINKAGE_END
+
+#endif
@@ -0,0 +1,61 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_UTIME_H_
+#define _FSKIT_UTIME_H_
+
+#include <fskit/debug.h>
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// how reads (and writes) update an inode's atime; see fskit_core_atime_policy
+#define FSKIT_ATIME_STRICT              0       // every read and write sets atime (the default)
+#define FSKIT_ATIME_RELATIME            1       // a read sets atime only if it is not newer than mtime or ctime, or is a day old
+#define FSKIT_ATIME_NOATIME             2       // reads and writes never set atime
+#define FSKIT_ATIME_LAZYTIME            3       // reads record atime without locking the inode; it's folded in on the next inode update
+
+// fskit_core_atime_policy flags
+#define FSKIT_TIME_COARSE               0x1     // take I/O timestamps from CLOCK_REALTIME_COARSE (a few ms of resolution, but cheap)
+
+FSKIT_C_LINKAGE_BEGIN 
+
+#ifndef _UTIME_H
+struct utimbuf {
+   time_t actime;
+   time_t modtime;
+};
+#endif
+
+// time
+int fskit_entry_set_ctime( struct fskit_entry* fent, struct timespec* now );
+int fskit_entry_set_mtime( struct fskit_entry* fent, struct timespec* now );
+int fskit_entry_set_atime( struct fskit_entry* fent, struct timespec* now );
+
+// I/O timestamp policy
+int fskit_core_atime_policy( struct fskit_core* core, int policy, int flags );
+
+// POSIX methods
+int fskit_utime( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, const struct utimbuf* times );
+int fskit_utimes( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, const struct timeval times[2] );
+
+FSKIT_C_LINKAGE_END 
+
+#endif
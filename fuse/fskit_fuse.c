@@ -570,11 +570,13 @@ int fskit_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_
    struct fskit_fuse_file_info* ffi = NULL;
    int rc = 0;
    uint64_t num_read = 0;
+   struct stat* sbs = NULL;
 
    ffi = (struct fskit_fuse_file_info*)((uintptr_t)fi->fh);
    fdh = ffi->handle.dh;
 
-   struct fskit_dir_entry** dirents = fskit_listdir( state->core, fdh, &num_read, &rc );
+   // get the attributes along with the names, so the kernel needn't stat each one
+   struct fskit_dir_entry** dirents = fskit_listdirplus( state->core, fdh, &num_read, &sbs, &rc );
 
    if( dirents == NULL || rc != 0 ) {
       fskit_debug("readdir(%s, %jd, %p, %p) rc = %d\n", path, offset, buf, fi, rc );
@@ -583,7 +585,7 @@ int fskit_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_
    
    for( uint64_t i = 0; i < num_read; i++ ) {
 
-      rc = filler( buf, dirents[i]->name, NULL, 0 );
+      rc = filler( buf, dirents[i]->name, &sbs[i], 0 );
       if( rc != 0 ) {
          rc = -ENOMEM;
          break;
@@ -591,6 +593,7 @@ int fskit_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler, off_
    }
 
    fskit_dir_entry_free_list( dirents );
+   free( sbs );
 
    if( rc > 0 ) {
       rc = 0;
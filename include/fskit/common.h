@@ -55,6 +55,7 @@
 #include <math.h>
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <fcntl.h>
 #include <limits.h>
 
@@ -62,6 +63,7 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <sys/stat.h>
 
 #include <pthread.h>
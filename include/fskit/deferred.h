@@ -26,7 +26,29 @@
 #include <fskit/debug.h>
 #include <fskit/entry.h>
 
+// default number of entries the reaper garbage-collects before looking at the next removal
+#define FSKIT_DEFERRED_DEFAULT_BATCH_SIZE 1024
+
+FSKIT_C_LINKAGE_BEGIN
+
+// background removal statistics
+struct fskit_deferred_stats {
+   uint64_t queued;             // removals handed to the reaper
+   uint64_t completed;          // removals fully garbage-collected
+   uint64_t failed;             // removals abandoned after an error
+   uint64_t pending;            // removals queued or in progress right now
+   uint64_t reaped;             // entries unlinked and garbage-collected so far
+   uint64_t batches;            // batches run
+};
+
+int fskit_core_deferred_enable( struct fskit_core* core, size_t batch_size );
+int fskit_core_deferred_drain( struct fskit_core* core );
+int fskit_core_deferred_stats( struct fskit_core* core, struct fskit_deferred_stats* stats );
+
 int fskit_deferred_remove( struct fskit_core* core, char const* child_path, struct fskit_entry* child );
 int fskit_deferred_remove_all( struct fskit_core* core, char const* child_path, struct fskit_entry* child );
+int fskit_deferred_remove_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group );
+
+FSKIT_C_LINKAGE_END
 
 #endif
@@ -28,6 +28,10 @@
 
 #define FSKIT_FILESYSTEM_NAMEMAX 255
 
+// directories with at least this many entries (including . and ..) get a hash index
+#define FSKIT_ENTRY_SET_HASH_THRESHOLD_DEFAULT 256
+#define FSKIT_ENTRY_SET_HASH_NEVER UINT_MAX
+
 #define FSKIT_ENTRY_SET_ENTRY_CMP( s1, s2 ) (strcmp((s1)->name, (s2)->name))
 #define FSKIT_XATTR_SET_ENTRY_CMP( x1, x2 ) (strcmp((x1)->name, (x2)->name))
 
@@ -73,6 +77,19 @@ struct fskit_dir_entry {
    char name[FSKIT_FILESYSTEM_NAMEMAX+1];          // name of file
 };
 
+// packed dir entry, as filled in by fskit_readdir_buf (laid out like getdents64's records)
+struct fskit_dir_record {
+   uint64_t file_id;    // file ID
+   off_t next;          // cookie for fskit_seekdir, to resume reading after this record
+   uint16_t reclen;     // length of this record, including padding
+   uint16_t namelen;    // length of the name, not counting the null terminator
+   uint8_t type;        // type of file
+   char name[];         // null-terminated name of file
+};
+
+// length of a packed dir entry with a name of the given length
+#define FSKIT_DIR_RECORD_LEN( namelen ) ((offsetof( struct fskit_dir_record, name ) + (namelen) + 1 + 7) & ~((size_t)7))
+
 // type definitions for functions to allocate and free inodes
 typedef uint64_t (*fskit_inode_alloc_t)( struct fskit_entry*, struct fskit_entry*, void* );
 typedef int (*fskit_inode_free_t)( uint64_t, void* );
@@ -102,6 +119,7 @@ uint64_t fskit_core_inode_alloc( struct fskit_core* core, struct fskit_entry* pa
 int fskit_core_inode_free( struct fskit_core* core, uint64_t inode );
 struct fskit_entry* fskit_core_resolve_root( struct fskit_core* core, bool writelock );
 void* fskit_core_get_user_data( struct fskit_core* core );
+int fskit_core_dir_hash_threshold( struct fskit_core* core, unsigned int threshold );
 
 // lookup
 struct fskit_entry* fskit_dir_find_by_name( struct fskit_entry* dir, char const* name );
@@ -111,13 +129,18 @@ SGLIB_DEFINE_RBTREE_PROTOTYPES( fskit_entry_set, left, right, color, FSKIT_ENTRY
 typedef struct sglib_fskit_entry_set_iterator fskit_entry_set_itr;
 
 fskit_entry_set* fskit_entry_set_new( struct fskit_entry* node, struct fskit_entry* parent );
+fskit_entry_set* fskit_entry_set_new_ex( struct fskit_core* core, struct fskit_entry* node, struct fskit_entry* parent );
 int fskit_entry_set_free( fskit_entry_set* set );
 int fskit_entry_set_insert( fskit_entry_set** set, char const* name, struct fskit_entry* child );
 struct fskit_entry* fskit_entry_set_find_name( fskit_entry_set* set, char const* name );
 fskit_entry_set* fskit_entry_set_find_itr( fskit_entry_set* set, char const* name );
+struct fskit_entry* fskit_entry_set_find_name_len( fskit_entry_set* set, char const* name, size_t name_len );
+fskit_entry_set* fskit_entry_set_find_itr_len( fskit_entry_set* set, char const* name, size_t name_len );
 bool fskit_entry_set_remove( fskit_entry_set** set, char const* name );
 bool fskit_entry_set_replace( fskit_entry_set* set, char const* name, struct fskit_entry* replacement );
 unsigned int fskit_entry_set_count( fskit_entry_set* set );
+int fskit_entry_set_hash_threshold( fskit_entry_set* set, unsigned int threshold );
+bool fskit_entry_set_is_hashed( fskit_entry_set* set );
 
 // xattr sets 
 struct fskit_xattr_set_entry;
@@ -143,15 +166,19 @@ fskit_xattr_set* fskit_xattr_set_next( fskit_xattr_set_itr* itr );
 // iteration 
 fskit_entry_set* fskit_entry_set_begin( fskit_entry_set_itr* itr, fskit_entry_set* dirents );
 fskit_entry_set* fskit_entry_set_next( fskit_entry_set_itr* itr );
+fskit_entry_set* fskit_entry_set_seek( fskit_entry_set_itr* itr, fskit_entry_set* dirents, char const* name );
 char const* fskit_entry_set_name_at( fskit_entry_set* dp );
 struct fskit_entry* fskit_entry_set_child_at( fskit_entry_set* dp );
 
 // initialization
 struct fskit_entry* fskit_entry_new(void);
+struct fskit_entry* fskit_entry_new_ex( struct fskit_core* core );
+void fskit_entry_free( struct fskit_core* core, struct fskit_entry* fent );
 int fskit_entry_init_lowlevel( struct fskit_entry* fent, uint8_t type, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_common( struct fskit_entry* fent, uint8_t type, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_file( struct fskit_entry* fent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_dir( struct fskit_entry* fent, struct fskit_entry* parent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
+int fskit_entry_init_dir_ex( struct fskit_core* core, struct fskit_entry* fent, struct fskit_entry* parent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_fifo( struct fskit_entry* fent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_sock( struct fskit_entry* fent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode );
 int fskit_entry_init_chr( struct fskit_entry* fent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode, dev_t dev );
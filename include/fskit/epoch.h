@@ -0,0 +1,43 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_EPOCH_H_
+#define _FSKIT_EPOCH_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+FSKIT_C_LINKAGE_BEGIN
+
+// optimistic lookup and epoch reclamation statistics
+struct fskit_epoch_stats {
+   uint64_t lookups;            // paths resolved without locking intermediate directories
+   uint64_t fallbacks;          // optimistic lookups that had to be retried with locks
+   uint64_t deferred;           // frees deferred until readers were done
+   uint64_t reclaimed;          // deferred frees that have completed
+};
+
+int fskit_core_epoch_enable( struct fskit_core* core );
+int fskit_core_epoch_stats( struct fskit_core* core, struct fskit_epoch_stats* stats );
+
+FSKIT_C_LINKAGE_END
+
+#endif
@@ -29,20 +29,27 @@
 #include <fskit/random.h>
 
 #include <fskit/access.h>
+#include <fskit/aio.h>
 #include <fskit/chmod.h>
 #include <fskit/chown.h>
 #include <fskit/close.h>
 #include <fskit/closedir.h>
 #include <fskit/create.h>
+#include <fskit/dcache.h>
+#include <fskit/deferred.h>
+#include <fskit/epoch.h>
 #include <fskit/getxattr.h>
 #include <fskit/link.h>
+#include <fskit/listcache.h>
 #include <fskit/listxattr.h>
 #include <fskit/mkdir.h>
 #include <fskit/mknod.h>
 #include <fskit/open.h>
 #include <fskit/opendir.h>
 #include <fskit/path.h>
+#include <fskit/pcache.h>
 #include <fskit/read.h>
+#include <fskit/readahead.h>
 #include <fskit/readdir.h>
 #include <fskit/readlink.h>
 #include <fskit/removexattr.h>
@@ -58,6 +65,7 @@
 #include <fskit/unlink.h>
 #include <fskit/utime.h>
 #include <fskit/write.h>
+#include <fskit/writeback.h>
 
 #define FSKIT_FILESYSTEM_TYPE 0x19880119
 
@@ -0,0 +1,48 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#ifndef _FSKIT_LISTCACHE_H_
+#define _FSKIT_LISTCACHE_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// default bound on the memory held by a core's directory listing cache
+#define FSKIT_LISTCACHE_DEFAULT_MAX_BYTES (16 * 1024 * 1024)
+
+FSKIT_C_LINKAGE_BEGIN
+
+// directory listing cache statistics
+struct fskit_listcache_stats {
+   uint64_t hits;               // listings served from a cached snapshot
+   uint64_t misses;             // listings built by walking the directory
+   uint64_t evictions;          // snapshots dropped to stay within the memory bound
+   uint64_t snapshots;          // snapshots cached right now
+   uint64_t bytes;              // bytes of records cached right now
+};
+
+int fskit_core_listcache_enable( struct fskit_core* core, size_t max_bytes );
+int fskit_core_listcache_stats( struct fskit_core* core, struct fskit_listcache_stats* stats );
+
+FSKIT_C_LINKAGE_END
+
+#endif
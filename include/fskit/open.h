@@ -29,6 +29,7 @@
 FSKIT_C_LINKAGE_BEGIN 
 
 struct fskit_file_handle* fskit_open( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err );
+struct fskit_file_handle* fskit_openat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err );
 
 FSKIT_C_LINKAGE_END 
 
@@ -42,6 +42,7 @@ int fskit_path_split( char* path, char*** names );
 // path resolution
 struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls );
 struct fskit_entry* fskit_entry_resolve_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err );
+struct fskit_entry* fskit_entry_resolve_path_at( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, bool writelock, int* err );
 
 // path iteration struct 
 struct fskit_path_iterator;
@@ -28,6 +28,7 @@
 FSKIT_C_LINKAGE_BEGIN 
 
 ssize_t fskit_read( struct fskit_core* core, struct fskit_file_handle* fh, char* buf, size_t buflen, off_t offset );
+ssize_t fskit_readv( struct fskit_core* core, struct fskit_file_handle* fh, struct iovec const* iov, int iovcnt, off_t offset );
 
 FSKIT_C_LINKAGE_END 
 
@@ -27,8 +27,22 @@
 
 FSKIT_C_LINKAGE_BEGIN 
 
+// immutable, shared listing of a whole directory (see fskit_listdir_snapshot)
+struct fskit_dir_snapshot;
+
 struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err );
 struct fskit_dir_entry** fskit_listdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err );
+struct fskit_dir_entry** fskit_readdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, struct stat** ret_sbs, int* err );
+struct fskit_dir_entry** fskit_listdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, struct stat** ret_sbs, int* err );
+ssize_t fskit_readdir_buf( struct fskit_core* core, struct fskit_dir_handle* dirh, char* buf, size_t buflen );
+
+struct fskit_dir_record* fskit_dir_record_next( char* buf, size_t buflen, struct fskit_dir_record* rec );
+int fskit_dir_record_omit( struct fskit_dir_record* rec );
+
+struct fskit_dir_snapshot* fskit_listdir_snapshot( struct fskit_core* core, struct fskit_dir_handle* dirh, int* err );
+struct fskit_dir_record const* fskit_dir_snapshot_next( struct fskit_dir_snapshot const* snapshot, struct fskit_dir_record const* rec );
+uint64_t fskit_dir_snapshot_count( struct fskit_dir_snapshot const* snapshot );
+void fskit_dir_snapshot_unref( struct fskit_dir_snapshot* snapshot );
 
 void fskit_dir_entry_free_list( struct fskit_dir_entry** dir_ents );
 void fskit_dir_entry_free( struct fskit_dir_entry* d_ent );
@@ -30,6 +30,7 @@ FSKIT_C_LINKAGE_BEGIN
 int fskit_entry_rename_in_directory( struct fskit_entry* fent_parent, struct fskit_entry* fent, char const* old_name, char const* new_name );
 
 int fskit_rename( struct fskit_core* core, char const* old_path, char const* new_path, uint64_t user, uint64_t group );
+int fskit_renameat( struct fskit_core* core, struct fskit_dir_handle* old_dirh, char const* old_path, struct fskit_dir_handle* new_dirh, char const* new_path, uint64_t user, uint64_t group );
 
 FSKIT_C_LINKAGE_END 
 
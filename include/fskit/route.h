@@ -31,6 +31,7 @@
 struct fskit_core;
 struct fskit_dir_entry;
 struct fskit_path_route;
+struct fskit_io_token;
 
 // route match methods
 #define FSKIT_ROUTE_MATCH_CREATE                0
@@ -52,13 +53,35 @@ struct fskit_path_route;
 #define FSKIT_ROUTE_MATCH_LISTXATTR             16
 #define FSKIT_ROUTE_MATCH_SETXATTR              17
 #define FSKIT_ROUTE_MATCH_REMOVEXATTR           18
-#define FSKIT_ROUTE_NUM_ROUTE_TYPES             19
+#define FSKIT_ROUTE_MATCH_READV                 19
+#define FSKIT_ROUTE_MATCH_WRITEV                20
+#define FSKIT_ROUTE_MATCH_READ_ASYNC            21
+#define FSKIT_ROUTE_MATCH_WRITE_ASYNC           22
+#define FSKIT_ROUTE_MATCH_TRUNC_ASYNC           23
+#define FSKIT_ROUTE_MATCH_PREFETCH              24
+#define FSKIT_ROUTE_MATCH_READDIR_BUF           25
+#define FSKIT_ROUTE_NUM_ROUTE_TYPES             26
 
 // route consistency disciplines
 #define FSKIT_SEQUENTIAL        1       // route method calls will be serialized
 #define FSKIT_CONCURRENT        2       // route method calls will be concurrent
 #define FSKIT_INODE_SEQUENTIAL  3       // route method calls on the same inode will be serialized
 #define FSKIT_INODE_CONCURRENT  4       // route method calls on the same inode will be concurrent, provided that they only read the inode (i.e. the inode will be read-locked)
+#define FSKIT_INODE_STRIPED     5       // route method calls on the same inode will be serialized, without locking the inode (so metadata readers aren't blocked)
+#define FSKIT_HANDLE_SEQUENTIAL 6       // route method calls through the same file handle will be serialized; calls without a handle are serialized per inode, as with FSKIT_INODE_STRIPED
+#define FSKIT_RANGE_SEQUENTIAL  7       // route method calls on the same inode will be serialized if their byte ranges overlap (reads only conflict with writes).  truncates cover [new size, end of file); other methods cover the whole file
+
+// NOTE: FSKIT_INODE_STRIPED and FSKIT_HANDLE_SEQUENTIAL serialize calls through a fixed table of locks,
+// so unrelated inodes or handles occasionally share a lock.  The locks are recursive, so a callback under one
+// of these disciplines may call back into fskit from its own thread, even on an inode or handle that shares its lock.
+// It must not wait on another thread that makes such a call (e.g. one in a route's worker pool), since the two
+// may need each other's locks.
+
+// NOTE: asynchronous I/O routes (fskit_route_*_async) only support FSKIT_CONCURRENT and FSKIT_RANGE_SEQUENTIAL,
+// since a pending operation's discipline is released by whichever thread calls fskit_io_complete().
+
+// NOTE: a route with a worker pool (fskit_route_pool_enable) runs its callbacks, and enforces its consistency discipline,
+// in the pool's threads while the caller waits.  A pooled callback must not wait on a call to its own route.
 
 // common routes
 #define FSKIT_ROUTE_ANY         "[/]+([^/]+[/]*)*"
@@ -68,6 +91,24 @@ FSKIT_C_LINKAGE_BEGIN
 // metadata about the patch matched to the route
 struct fskit_route_metadata;
 
+// route match cache statistics
+struct fskit_route_cache_stats {
+   uint64_t hits;
+   uint64_t misses;
+};
+
+// route worker pool statistics
+struct fskit_route_pool_stats {
+   uint64_t calls;              // callbacks run on the pool
+   uint64_t blocked;            // calls that had to wait for room in the queue
+   uint64_t queue_wait_ns;      // total time calls spent queued before a worker picked them up
+   uint64_t max_queue_wait_ns;
+   uint64_t service_ns;         // total time spent running callbacks
+   uint64_t max_service_ns;
+   int queued;                  // calls queued right now
+   int running;                 // calls running right now
+};
+
 // a path route
 struct fskit_path_route;
 
@@ -81,10 +122,15 @@ typedef int (*fskit_entry_route_mkdir_callback_t)( struct fskit_core*, struct fs
 typedef int (*fskit_entry_route_open_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, int, void** );         // open() and opendir()
 typedef int (*fskit_entry_route_close_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, void* );              // close() and closedir()
 typedef int (*fskit_entry_route_io_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char*, size_t, off_t, void* );  // read() and write()
+typedef int (*fskit_entry_route_iov_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, struct iovec const*, int, off_t, void* );   // readv() and writev()
 typedef int (*fskit_entry_route_trunc_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, off_t, void* );
+typedef int (*fskit_entry_route_io_async_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char*, size_t, off_t, void*, struct fskit_io_token* );  // read() and write(); may return FSKIT_IO_PENDING
+typedef int (*fskit_entry_route_trunc_async_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, off_t, void*, struct fskit_io_token* );               // may return FSKIT_IO_PENDING
+typedef int (*fskit_entry_route_prefetch_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, size_t, off_t, void* );        // readahead hint; should not wait for the data
 typedef int (*fskit_entry_route_sync_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry* );         // fsync(), fdatasync()
 typedef int (*fskit_entry_route_stat_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, struct stat* );
 typedef int (*fskit_entry_route_readdir_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, struct fskit_dir_entry**, size_t );
+typedef int (*fskit_entry_route_readdir_buf_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char*, size_t );      // packed struct fskit_dir_record records
 typedef int (*fskit_entry_route_detach_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, void* );             // unlink() and rmdir()
 typedef int (*fskit_entry_route_destroy_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, void* );             // unlink() and rmdir()
 typedef int (*fskit_entry_route_rename_callback_t)( struct fskit_core*, struct fskit_route_metadata*, struct fskit_entry*, char const*, struct fskit_entry* );
@@ -104,9 +150,16 @@ int fskit_route_mkdir( struct fskit_core* core, char const* route_regex, fskit_e
 int fskit_route_open( struct fskit_core* core, char const* route_regex, fskit_entry_route_open_callback_t open_cb, int consistency_discipline );
 int fskit_route_close( struct fskit_core* core, char const* route_regex, fskit_entry_route_close_callback_t close_cb, int consistency_discipline );
 int fskit_route_readdir( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_callback_t readdir_cb, int consistency_discipline );
+int fskit_route_readdir_buf( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_buf_callback_t readdir_buf_cb, int consistency_discipline );
 int fskit_route_read( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline );
 int fskit_route_write( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_callback_t io_cb, int consistency_discipline );
+int fskit_route_readv( struct fskit_core* core, char const* route_regex, fskit_entry_route_iov_callback_t iov_cb, int consistency_discipline );
+int fskit_route_writev( struct fskit_core* core, char const* route_regex, fskit_entry_route_iov_callback_t iov_cb, int consistency_discipline );
 int fskit_route_trunc( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_callback_t io_cb, int consistency_discipline );
+int fskit_route_read_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_async_callback_t io_cb, int consistency_discipline );
+int fskit_route_write_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_async_callback_t io_cb, int consistency_discipline );
+int fskit_route_trunc_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_async_callback_t trunc_cb, int consistency_discipline );
+int fskit_route_prefetch( struct fskit_core* core, char const* route_regex, fskit_entry_route_prefetch_callback_t prefetch_cb, int consistency_discipline );
 int fskit_route_detach( struct fskit_core* core, char const* route_regex, fskit_entry_route_detach_callback_t detach_cb, int consistency_discipline );
 int fskit_route_destroy( struct fskit_core* core, char const* route_regex, fskit_entry_route_destroy_callback_t destroy_cb, int consistency_discipline );
 int fskit_route_stat( struct fskit_core* core, char const* route_regex, fskit_entry_route_stat_callback_t stat_cb, int consistency_discipline );
@@ -125,9 +178,16 @@ int fskit_unroute_mkdir( struct fskit_core* core, int route_handle );
 int fskit_unroute_open( struct fskit_core* core, int route_handle );
 int fskit_unroute_close( struct fskit_core* core, int route_handle );
 int fskit_unroute_readdir( struct fskit_core* core, int route_handle );
+int fskit_unroute_readdir_buf( struct fskit_core* core, int route_handle );
 int fskit_unroute_read( struct fskit_core* core, int route_handle );
 int fskit_unroute_write( struct fskit_core* core, int route_handle );
+int fskit_unroute_readv( struct fskit_core* core, int route_handle );
+int fskit_unroute_writev( struct fskit_core* core, int route_handle );
 int fskit_unroute_trunc( struct fskit_core* core, int route_handle );
+int fskit_unroute_read_async( struct fskit_core* core, int route_handle );
+int fskit_unroute_write_async( struct fskit_core* core, int route_handle );
+int fskit_unroute_trunc_async( struct fskit_core* core, int route_handle );
+int fskit_unroute_prefetch( struct fskit_core* core, int route_handle );
 int fskit_unroute_detach( struct fskit_core* core, int route_handle );
 int fskit_unroute_destroy( struct fskit_core* core, int route_handle );
 int fskit_unroute_stat( struct fskit_core* core, int route_handle );
@@ -142,6 +202,14 @@ int fskit_unroute_removexattr( struct fskit_core* core, int route_handle );
 // unroute everything 
 int fskit_unroute_all( struct fskit_core* core );
 
+// per-inode route match caching
+int fskit_core_route_cache_enable( struct fskit_core* core );
+int fskit_core_route_cache_stats( struct fskit_core* core, struct fskit_route_cache_stats* stats );
+
+// running a route's callbacks on a worker pool
+int fskit_route_pool_enable( struct fskit_core* core, int route_type, int route_handle, int max_concurrency, int max_queued );
+int fskit_route_pool_stats( struct fskit_core* core, int route_type, int route_handle, struct fskit_route_pool_stats* stats );
+
 // access route metadata 
 char* fskit_route_metadata_get_path( struct fskit_route_metadata* route_metadata );
 char* fskit_route_metadata_get_name( struct fskit_route_metadata* route_metadata );
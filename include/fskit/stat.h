@@ -32,6 +32,7 @@ FSKIT_C_LINKAGE_BEGIN
 int fskit_entry_fstat( struct fskit_entry* fent, struct stat* sb );
 
 int fskit_stat( struct fskit_core* core, char const* fs_path, uint64_t user, uint64_t group, struct stat* sb );
+int fskit_statat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, struct stat* sb );
 int fskit_fstat( struct fskit_core* core, char const* fs_path, struct fskit_entry* fent, struct stat* sb );
 
 mode_t fskit_fullmode( int fskit_type, mode_t mode );
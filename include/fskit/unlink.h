@@ -28,6 +28,7 @@
 FSKIT_C_LINKAGE_BEGIN 
 
 int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uint64_t group );
+int fskit_unlinkat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t owner, uint64_t group );
 
 FSKIT_C_LINKAGE_END 
 
@@ -26,6 +26,15 @@
 #include <fskit/common.h>
 #include <fskit/entry.h>
 
+// how reads (and writes) update an inode's atime; see fskit_core_atime_policy
+#define FSKIT_ATIME_STRICT              0       // every read and write sets atime (the default)
+#define FSKIT_ATIME_RELATIME            1       // a read sets atime only if it is not newer than mtime or ctime, or is a day old
+#define FSKIT_ATIME_NOATIME             2       // reads and writes never set atime
+#define FSKIT_ATIME_LAZYTIME            3       // reads record atime without locking the inode; it's folded in on the next inode update
+
+// fskit_core_atime_policy flags
+#define FSKIT_TIME_COARSE               0x1     // take I/O timestamps from CLOCK_REALTIME_COARSE (a few ms of resolution, but cheap)
+
 FSKIT_C_LINKAGE_BEGIN 
 
 #ifndef _UTIME_H
@@ -40,6 +49,9 @@ int fskit_entry_set_ctime( struct fskit_entry* fent, struct timespec* now );
 int fskit_entry_set_mtime( struct fskit_entry* fent, struct timespec* now );
 int fskit_entry_set_atime( struct fskit_entry* fent, struct timespec* now );
 
+// I/O timestamp policy
+int fskit_core_atime_policy( struct fskit_core* core, int policy, int flags );
+
 // POSIX methods
 int fskit_utime( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, const struct utimbuf* times );
 int fskit_utimes( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, const struct timeval times[2] );
@@ -29,6 +29,7 @@
 FSKIT_C_LINKAGE_BEGIN 
 
 ssize_t fskit_write( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset );
+ssize_t fskit_writev( struct fskit_core* core, struct fskit_file_handle* fh, struct iovec const* iov, int iovcnt, off_t offset );
 
 FSKIT_C_LINKAGE_END 
 #endif
@@ -0,0 +1,38 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#ifndef _FSKIT_WRITEBACK_H_
+#define _FSKIT_WRITEBACK_H_
+
+#include <fskit/common.h>
+#include <fskit/entry.h>
+
+// defaults for fskit_core_writeback_enable
+#define FSKIT_WRITEBACK_DEFAULT_MAX_BYTES       (128 * 1024)
+#define FSKIT_WRITEBACK_DEFAULT_FLUSH_MS        1000
+
+FSKIT_C_LINKAGE_BEGIN
+
+int fskit_core_writeback_enable( struct fskit_core* core, size_t max_bytes, unsigned int flush_ms );
+
+FSKIT_C_LINKAGE_END
+
+#endif
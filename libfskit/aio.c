@@ -0,0 +1,433 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/aio.h>
+#include <fskit/path.h>
+#include <fskit/route.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+#include <sys/eventfd.h>
+
+// a queue of finished asynchronous I/O operations.
+// the eventfd is readable whenever the queue is non-empty, so callers can poll(2) it alongside their own descriptors.
+struct fskit_io_cq {
+
+   struct fskit_io_token* head;
+   struct fskit_io_token* tail;
+
+   int efd;
+
+   pthread_mutex_t lock;
+   pthread_cond_t ready;
+};
+
+// make a new completion queue
+// return the queue on success
+// return NULL if out of memory, or if we couldn't make the eventfd
+struct fskit_io_cq* fskit_io_cq_new(void) {
+
+   struct fskit_io_cq* cq = CALLOC_LIST( struct fskit_io_cq, 1 );
+   if( cq == NULL ) {
+      return NULL;
+   }
+
+   cq->efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+   if( cq->efd < 0 ) {
+
+      fskit_error("eventfd errno = %d\n", -errno );
+      fskit_safe_free( cq );
+      return NULL;
+   }
+
+   pthread_mutex_init( &cq->lock, NULL );
+   pthread_cond_init( &cq->ready, NULL );
+
+   return cq;
+}
+
+// free a completion queue, and any completions nobody reaped.
+// NOTE: no operations may be pending on it
+// always succeeds
+int fskit_io_cq_free( struct fskit_io_cq* cq ) {
+
+   struct fskit_io_token* token = cq->head;
+   struct fskit_io_token* next = NULL;
+
+   while( token != NULL ) {
+
+      next = token->next;
+      fskit_safe_free( token );
+      token = next;
+   }
+
+   close( cq->efd );
+
+   pthread_mutex_destroy( &cq->lock );
+   pthread_cond_destroy( &cq->ready );
+
+   fskit_safe_free( cq );
+   return 0;
+}
+
+// get the descriptor that becomes readable when the queue has completions.
+// the caller must not read from or close it.
+int fskit_io_cq_fd( struct fskit_io_cq* cq ) {
+   return cq->efd;
+}
+
+// post a finished operation to its completion queue.
+// the queue takes ownership of the token.
+static void fskit_io_cq_post( struct fskit_io_cq* cq, struct fskit_io_token* token ) {
+
+   uint64_t one = 1;
+
+   token->next = NULL;
+
+   pthread_mutex_lock( &cq->lock );
+
+   if( cq->tail == NULL ) {
+      cq->head = token;
+   }
+   else {
+      cq->tail->next = token;
+   }
+
+   cq->tail = token;
+
+   pthread_cond_signal( &cq->ready );
+   pthread_mutex_unlock( &cq->lock );
+
+   // wake up poll(2)-ers.  This only fails if the counter would overflow, in which case it's readable anyway.
+   if( write( cq->efd, &one, sizeof(one) ) < 0 ) {
+      fskit_debug("write(eventfd) errno = %d\n", -errno );
+   }
+}
+
+// reap up to max_completions finished operations into completions.
+// wait up to timeout_ms milliseconds for the first one: 0 means don't wait, and negative means wait forever.
+// return the number of completions reaped (0 on timeout)
+// return -EINVAL if max_completions is not positive
+int fskit_io_cq_poll( struct fskit_io_cq* cq, struct fskit_io_completion* completions, int max_completions, int timeout_ms ) {
+
+   int rc = 0;
+   int num_reaped = 0;
+   uint64_t count = 0;
+   struct timespec deadline;
+   struct fskit_io_token* token = NULL;
+
+   if( max_completions <= 0 ) {
+      return -EINVAL;
+   }
+
+   if( timeout_ms > 0 ) {
+
+      clock_gettime( CLOCK_REALTIME, &deadline );
+
+      deadline.tv_sec += timeout_ms / 1000;
+      deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+
+      if( deadline.tv_nsec >= 1000000000L ) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000L;
+      }
+   }
+
+   pthread_mutex_lock( &cq->lock );
+
+   while( cq->head == NULL && timeout_ms != 0 && rc == 0 ) {
+
+      if( timeout_ms < 0 ) {
+         rc = pthread_cond_wait( &cq->ready, &cq->lock );
+      }
+      else {
+         rc = pthread_cond_timedwait( &cq->ready, &cq->lock, &deadline );
+      }
+   }
+
+   while( cq->head != NULL && num_reaped < max_completions ) {
+
+      token = cq->head;
+      cq->head = token->next;
+
+      completions[ num_reaped ] = token->completion;
+      num_reaped++;
+
+      fskit_safe_free( token );
+   }
+
+   if( cq->head == NULL ) {
+
+      cq->tail = NULL;
+
+      // nothing left to poll(2) for
+      if( read( cq->efd, &count, sizeof(count) ) < 0 && errno != EAGAIN ) {
+         fskit_debug("read(eventfd) errno = %d\n", -errno );
+      }
+   }
+
+   pthread_mutex_unlock( &cq->lock );
+
+   return num_reaped;
+}
+
+// make a token for an operation on fh
+// return NULL if out of memory
+static struct fskit_io_token* fskit_io_token_new( struct fskit_core* core, struct fskit_file_handle* fh, int type, struct fskit_io_cq* cq, void* user_data ) {
+
+   struct fskit_io_token* token = CALLOC_LIST( struct fskit_io_token, 1 );
+   if( token == NULL ) {
+      return NULL;
+   }
+
+   token->type = type;
+   token->core = core;
+   token->fent = fh->fent;
+   token->cq = cq;
+   token->completion.user_data = user_data;
+
+   return token;
+}
+
+// finish an operation: update the inode's metadata the way the synchronous call would, and post the result.
+// NOTE: token->fent must not be locked
+static void fskit_io_token_finish( struct fskit_io_token* token, ssize_t rc ) {
+
+   token->completion.rc = rc;
+
+   if( rc >= 0 && token->type == FSKIT_ROUTE_MATCH_READ_ASYNC ) {
+
+      fskit_entry_touch_read( token->core, token->fent );
+   }
+
+   // (write's and truncate's continuations already updated the inode, by what the route actually did)
+   fskit_io_cq_post( token->cq, token );
+}
+
+// finish an I/O operation that an asynchronous route left pending.
+// rc is what the route would have returned had it finished synchronously.
+// the token is consumed; its completion shows up on the queue it was submitted with.
+// always succeeds
+int fskit_io_complete( struct fskit_io_token* token, ssize_t rc ) {
+
+   fskit_route_io_finish( token, rc );
+   fskit_io_token_finish( token, rc );
+   return 0;
+}
+
+// start reading up to buflen bytes into buf, starting at the given offset in the file.
+// the number of bytes read (or a negative error) gets posted to cq along with user_data.
+// if there is no asynchronous read route, the read route is run synchronously and its result posted.
+// buf, and fh, must remain valid until the completion is reaped.
+// return 0 if the operation was started
+// return -EBADF if fh wasn't opened for reading
+// return -ENOMEM if out of memory
+int fskit_read_async( struct fskit_core* core, struct fskit_file_handle* fh, char* buf, size_t buflen, off_t offset, struct fskit_io_cq* cq, void* user_data ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   ssize_t num_read = 0;
+   struct fskit_io_token* token = fskit_io_token_new( core, fh, FSKIT_ROUTE_MATCH_READ_ASYNC, cq, user_data );
+
+   if( token == NULL ) {
+      return -ENOMEM;
+   }
+
+   fskit_file_handle_rlock( fh );
+
+   // sanity check
+   if( (fh->flags & O_WRONLY) != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_safe_free( token );
+      return -EBADF;
+   }
+
+   // buffered writes must land first
+   rc = fskit_wbuf_flush_range( core, fh, offset, buflen );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_io_token_finish( token, rc );
+      return 0;
+   }
+
+   fskit_route_io_args( &token->dargs, buf, buflen, offset, fh->app_data, NULL );
+   token->dargs.handle = fh;
+   token->dargs.io_token = token;
+
+   rc = fskit_route_call_read_async( core, fh->path, fh->fent, &token->dargs, &cbrc );
+
+   if( rc == 0 && cbrc == FSKIT_IO_PENDING ) {
+
+      // token belongs to the route now
+      fskit_file_handle_unlock( fh );
+      return 0;
+   }
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no asynchronous routes installed
+      num_read = fskit_run_user_read( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+   }
+   else {
+
+      num_read = cbrc;
+   }
+
+   fskit_file_handle_unlock( fh );
+
+   fskit_io_token_finish( token, num_read );
+   return 0;
+}
+
+// start writing buflen bytes from buf, starting at the given offset in the file.
+// the number of bytes written (or a negative error) gets posted to cq along with user_data.
+// if there is no asynchronous write route, the write route is run synchronously and its result posted.
+// buf, and fh, must remain valid until the completion is reaped.
+// return 0 if the operation was started
+// return -EBADF if fh wasn't opened for writing
+// return -ENOMEM if out of memory
+int fskit_write_async( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset, struct fskit_io_cq* cq, void* user_data ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   ssize_t num_written = 0;
+   struct fskit_io_token* token = fskit_io_token_new( core, fh, FSKIT_ROUTE_MATCH_WRITE_ASYNC, cq, user_data );
+
+   if( token == NULL ) {
+      return -ENOMEM;
+   }
+
+   fskit_file_handle_rlock( fh );
+
+   // sanity check
+   if( (fh->flags & (O_RDWR | O_WRONLY)) == 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_safe_free( token );
+      return -EBADF;
+   }
+
+   // buffered writes must land first
+   rc = fskit_wbuf_flush_range( core, fh, offset, buflen );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_io_token_finish( token, rc );
+      return 0;
+   }
+
+   fskit_route_io_args( &token->dargs, (char*)buf, buflen, offset, fh->app_data, fskit_write_cont );
+   token->dargs.handle = fh;
+   token->dargs.io_token = token;
+
+   rc = fskit_route_call_write_async( core, fh->path, fh->fent, &token->dargs, &cbrc );
+
+   if( rc == 0 && cbrc == FSKIT_IO_PENDING ) {
+
+      // token belongs to the route now
+      fskit_file_handle_unlock( fh );
+      return 0;
+   }
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no asynchronous routes installed
+      num_written = fskit_run_user_write( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+   }
+   else {
+
+      num_written = cbrc;
+   }
+
+   fskit_file_handle_unlock( fh );
+
+   fskit_io_token_finish( token, num_written );
+   return 0;
+}
+
+// start truncating the file to new_size.
+// 0 (or a negative error) gets posted to cq along with user_data.
+// if there is no asynchronous truncate route, the truncate route is run synchronously and its result posted.
+// fh must remain valid until the completion is reaped.
+// return 0 if the operation was started
+// return -EBADF if fh wasn't opened for writing
+// return -ENOMEM if out of memory
+int fskit_ftrunc_async( struct fskit_core* core, struct fskit_file_handle* fh, off_t new_size, struct fskit_io_cq* cq, void* user_data ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+   struct fskit_io_token* token = fskit_io_token_new( core, fh, FSKIT_ROUTE_MATCH_TRUNC_ASYNC, cq, user_data );
+
+   if( token == NULL ) {
+      return -ENOMEM;
+   }
+
+   fskit_file_handle_rlock( fh );
+
+   // sanity check
+   if( (fh->flags & (O_RDWR | O_WRONLY)) == 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_safe_free( token );
+      return -EBADF;
+   }
+
+   // buffered writes must land first
+   rc = fskit_wbuf_flush( core, fh );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      fskit_io_token_finish( token, rc );
+      return 0;
+   }
+
+   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+   fskit_basename( fh->path, name );
+
+   // (the name is only needed while the route is being called)
+   fskit_route_trunc_args( &token->dargs, name, new_size, fh->app_data, fskit_trunc_cont );
+   token->dargs.handle = fh;
+   token->dargs.io_token = token;
+
+   rc = fskit_route_call_trunc_async( core, fh->path, fh->fent, &token->dargs, &cbrc );
+
+   if( rc == 0 && cbrc == FSKIT_IO_PENDING ) {
+
+      // token belongs to the route now
+      fskit_file_handle_unlock( fh );
+      return 0;
+   }
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no asynchronous routes installed
+      cbrc = fskit_run_user_trunc( core, fh->path, fh->fent, new_size, fh, fh->app_data );
+   }
+
+   fskit_file_handle_unlock( fh );
+
+   fskit_io_token_finish( token, cbrc );
+   return 0;
+}
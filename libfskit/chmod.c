@@ -21,6 +21,7 @@
 
 #include <fskit/chmod.h>
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 
 #include "fskit_private/private.h"
 
@@ -29,7 +30,9 @@
 // NOTE: fent must be write-locked 
 int fskit_entry_set_mode( struct fskit_entry* fent, mode_t mode ) {
    
+   FSKIT_ENTRY_WRITE_BEGIN( fent );
    fent->mode = mode;
+   FSKIT_ENTRY_WRITE_END( fent );
    return 0;
 }
 
@@ -60,6 +63,11 @@ int fskit_chmod( struct fskit_core* core, char const* path, uint64_t user, uint6
    }
 
    fskit_entry_set_mode( fent, mode );
+
+   if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
+      // search permission may have changed
+      fskit_core_dcache_invalidate( core );
+   }
    
    fskit_entry_unlock( fent );
 
@@ -21,6 +21,7 @@
 
 #include <fskit/chown.h>
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 
 #include "fskit_private/private.h"
 
@@ -29,8 +30,10 @@
 // NOTE: fent must be write-locked 
 int fskit_entry_set_owner_and_group( struct fskit_entry* fent, uint64_t new_user, uint64_t new_group ) {
    
+   FSKIT_ENTRY_WRITE_BEGIN( fent );
    fent->owner = new_user;
    fent->group = new_group;
+   FSKIT_ENTRY_WRITE_END( fent );
    return 0;
 }
 
@@ -39,7 +42,9 @@ int fskit_entry_set_owner_and_group( struct fskit_entry* fent, uint64_t new_user
 // NOTE: fent must be write-locked
 int fskit_entry_set_owner( struct fskit_entry* fent, uint64_t new_user ) {
    
+   FSKIT_ENTRY_WRITE_BEGIN( fent );
    fent->owner = new_user;
+   FSKIT_ENTRY_WRITE_END( fent );
    return 0;
 }
 
@@ -48,7 +53,9 @@ int fskit_entry_set_owner( struct fskit_entry* fent, uint64_t new_user ) {
 // NOTE: fent must be write-locked 
 int fskit_entry_set_group( struct fskit_entry* fent, uint64_t new_group ) {
 
+   FSKIT_ENTRY_WRITE_BEGIN( fent );
    fent->group = new_group;
+   FSKIT_ENTRY_WRITE_END( fent );
    return 0;
 }
 
@@ -82,6 +89,11 @@ int fskit_chown( struct fskit_core* core, char const* path, uint64_t user, uint6
 
    fskit_entry_set_owner_and_group( fent, new_user, new_group );
 
+   if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
+      // search permission may have changed
+      fskit_core_dcache_invalidate( core );
+   }
+
    fskit_entry_unlock( fent );
 
    return err;
@@ -29,7 +29,7 @@
 // the file handle must be write-locked
 // this calls the route for close as well.
 // in all cases, the file handle is destroyed, but this method will return negative if the route callback failed.
-static int fskit_file_handle_destroy( struct fskit_file_handle* fh ) {
+static int fskit_file_handle_destroy( struct fskit_core* core, struct fskit_file_handle* fh ) {
 
    fh->fent = NULL;
 
@@ -39,10 +39,11 @@ static int fskit_file_handle_destroy( struct fskit_file_handle* fh ) {
    }
 
    pthread_rwlock_destroy( &fh->lock );
+   pthread_mutex_destroy( &fh->ra.lock );
 
    memset( fh, 0, sizeof(struct fskit_file_handle) );
 
-   fskit_safe_free( fh );
+   fskit_slab_free( &core->handle_slab, fh );
 
    return 0;
 }
@@ -52,7 +53,7 @@ static int fskit_file_handle_destroy( struct fskit_file_handle* fh ) {
 // return 0 on success, or if there are no routes
 // return negative on callback failure
 // fent *cannot* be locked, but it must have a positive open count
-int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle_data ) {
+int fskit_run_user_close( struct fskit_core* core, char const* path, struct fskit_entry* fent, void* handle, void* handle_data ) {
 
    // route?
    struct fskit_route_dispatch_args dargs;
@@ -60,6 +61,8 @@ int fskit_run_user_close( struct fskit_core* core, char const* path, struct fski
    int cbrc = 0;
 
    fskit_route_close_args( &dargs, handle_data );
+   dargs.handle = handle;
+
    rc = fskit_route_call_close( core, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
@@ -84,9 +87,11 @@ int fskit_run_user_close( struct fskit_core* core, char const* path, struct fski
 // return 0 on success
 // return -EBADF if the handle is invalid
 // return -EDEADLK of there is a bug in the lock handling
+// return negative if buffered writes could not be flushed (the handle is closed regardless)
 int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
 
    int rc = 0;
+   int flush_rc = 0;
 
    rc = fskit_file_handle_wlock( fh );
    if( rc != 0 ) {
@@ -101,8 +106,17 @@ int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
       return -EBADF;
    }
 
+   // the readahead worker must be done with the handle before it goes away
+   fskit_readahead_release( core, fh );
+
+   // buffered writes must land before the close route runs
+   flush_rc = fskit_wbuf_release( core, fh );
+   if( flush_rc != 0 ) {
+      fskit_error("fskit_wbuf_release(%s) rc = %d\n", fh->path, flush_rc );
+   }
+
    // clean up the handle
-   rc = fskit_run_user_close( core, fh->path, fh->fent, fh->app_data );
+   rc = fskit_run_user_close( core, fh->path, fh->fent, fh, fh->app_data );
    if( rc != 0 ) {
       // failed to run user close
       fskit_error("fskit_run_user_close(%s) rc = %d\n", fh->path, rc );
@@ -122,6 +136,9 @@ int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
    // no longer open by this handle
    fh->fent->open_count--;
 
+   // (FSKIT_ATIME_LAZYTIME) settle the access time
+   fskit_entry_fold_atime( fh->fent );
+
    // maybe this entry has been fully unref'ed?
    // this may unlock fh->fent and re-lock it, but only if fent is already fully unlinked
    rc = fskit_entry_try_destroy_and_free( core, fh->path, NULL, fh->fent );
@@ -148,7 +165,11 @@ int fskit_close( struct fskit_core* core, struct fskit_file_handle* fh ) {
 
    // get rid of this handle
    fskit_file_handle_unlock( fh );
-   fskit_file_handle_destroy( fh );
+   fskit_file_handle_destroy( core, fh );
+
+   if( rc == 0 ) {
+      rc = flush_rc;
+   }
 
    return rc;
 }
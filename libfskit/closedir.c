@@ -35,6 +35,8 @@ static void fskit_dir_handle_destroy( struct fskit_dir_handle* dirh ) {
       dirh->path = NULL;
    }
 
+   fskit_safe_free( dirh->telldir_pos );
+
    pthread_rwlock_destroy( &dirh->lock );
 
    memset( dirh, 0, sizeof(struct fskit_dir_handle) );
@@ -68,7 +70,7 @@ int fskit_closedir( struct fskit_core* core, struct fskit_dir_handle* dirh ) {
    }
 
    // run user-given close route.  Note that this may unlock dirh->dent and re-lock it, but only if it is fully unlinked.
-   rc = fskit_run_user_close( core, dirh->path, dirh->dent, dirh->app_data );
+   rc = fskit_run_user_close( core, dirh->path, dirh->dent, dirh, dirh->app_data );
    if( rc != 0 ) {
 
       fskit_error("fskit_run_user_close(%s) rc = %d\n", dirh->path, rc );
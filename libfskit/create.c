@@ -83,7 +83,7 @@ int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char c
    fskit_basename( path, path_basename );
 
    // can create--initialize the child
-   struct fskit_entry* child = CALLOC_LIST( struct fskit_entry, 1 );
+   struct fskit_entry* child = fskit_entry_new_ex( core );
 
    if( child == NULL ) {
       return -ENOMEM;
@@ -95,7 +95,7 @@ int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char c
       fskit_error("fskit_entry_init_file(%s) rc = %d\n", path, rc );
 
       fskit_entry_destroy( core, child, false );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
 
       return rc;
    }
@@ -108,7 +108,7 @@ int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char c
          fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
 
          fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
 
          return -EIO;
       }
@@ -128,7 +128,7 @@ int fskit_do_create( struct fskit_core* core, struct fskit_entry* parent, char c
          fskit_error("fskit_run_user_create(%s) rc = %d\n", path, rc );
 
          fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
 
          return rc;
       }
@@ -0,0 +1,329 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/dcache.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// a single dentry cache slot: a full path and the entry it resolved to
+struct fskit_dcache_slot {
+
+   uint64_t hash;       // hash of path
+   uint64_t gen;        // cache generation at the time the path was resolved
+
+   // credentials the path was resolved with (search permission is per-user)
+   uint64_t user;
+   uint64_t group;
+
+   char* path;
+   size_t path_len;
+
+   struct fskit_entry* fent;
+};
+
+// path-to-entry cache.
+// Any namespace change bumps gen, which invalidates every slot at once.
+// Slots are only dereferenced while lock is read-locked and gen matches, and
+// gen is bumped (under the write lock) before any entry is freed, so a cached
+// pointer is never followed after its entry has been destroyed.
+// NOTE: lookups only *try* to lock entries while holding lock, since invalidators
+// may hold entry locks while waiting for lock.
+struct fskit_dcache {
+
+   struct fskit_dcache_slot* slots;
+   size_t num_slots;    // power of two
+
+   uint64_t gen;
+
+   pthread_rwlock_t lock;
+
+   // statistics (updated atomically)
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t invalidations;
+};
+
+
+// FNV-1a hash of a path
+static uint64_t fskit_dcache_hash( char const* path, size_t* len ) {
+
+   uint64_t hash = 14695981039346656037ULL;
+   size_t i = 0;
+
+   for( i = 0; path[i] != '\0'; i++ ) {
+      hash ^= (unsigned char)path[i];
+      hash *= 1099511628211ULL;
+   }
+
+   *len = i;
+   return hash;
+}
+
+
+// enable the dentry cache on a core, with the given number of slots (rounded up to a power of two).
+// pass 0 for FSKIT_DCACHE_DEFAULT_SLOTS.
+// call this after fskit_core_init, before the core is used.
+// the cache is freed by fskit_core_destroy.
+// return 0 on success
+// return -EEXIST if the cache is already enabled
+// return -ENOMEM on OOM
+int fskit_core_dcache_enable( struct fskit_core* core, size_t num_slots ) {
+
+   size_t n = 1;
+   struct fskit_dcache* dcache = NULL;
+
+   if( num_slots == 0 ) {
+      num_slots = FSKIT_DCACHE_DEFAULT_SLOTS;
+   }
+
+   while( n < num_slots ) {
+      n <<= 1;
+   }
+
+   dcache = CALLOC_LIST( struct fskit_dcache, 1 );
+   if( dcache == NULL ) {
+      return -ENOMEM;
+   }
+
+   dcache->slots = CALLOC_LIST( struct fskit_dcache_slot, n );
+   if( dcache->slots == NULL ) {
+      fskit_safe_free( dcache );
+      return -ENOMEM;
+   }
+
+   dcache->num_slots = n;
+   dcache->gen = 1;
+
+   pthread_rwlock_init( &dcache->lock, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->dcache != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_dcache_free( dcache );
+      return -EEXIST;
+   }
+
+   core->dcache = dcache;
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// free a dentry cache
+// always succeeds
+int fskit_dcache_free( struct fskit_dcache* dcache ) {
+
+   if( dcache == NULL ) {
+      return 0;
+   }
+
+   for( size_t i = 0; i < dcache->num_slots; i++ ) {
+      fskit_safe_free( dcache->slots[i].path );
+   }
+
+   fskit_safe_free( dcache->slots );
+   pthread_rwlock_destroy( &dcache->lock );
+
+   free( dcache );
+   return 0;
+}
+
+
+// invalidate every cached path.
+// fskit calls this itself on rename, unlink, rmdir, detach and chmod/chown; applications
+// that change the namespace or directory permissions through the lowlevel entry API must call it too.
+// the caller may hold entry locks.
+// always succeeds; does nothing if the cache is disabled
+int fskit_core_dcache_invalidate( struct fskit_core* core ) {
+
+   struct fskit_dcache* dcache = core->dcache;
+
+   if( dcache == NULL ) {
+      return 0;
+   }
+
+   pthread_rwlock_wrlock( &dcache->lock );
+
+   dcache->gen++;
+
+   pthread_rwlock_unlock( &dcache->lock );
+
+   __atomic_fetch_add( &dcache->invalidations, 1, __ATOMIC_RELAXED );
+   return 0;
+}
+
+
+// get dentry cache statistics
+// return 0 on success
+// return -ENOSYS if the cache is disabled
+int fskit_core_dcache_stats( struct fskit_core* core, struct fskit_dcache_stats* stats ) {
+
+   struct fskit_dcache* dcache = core->dcache;
+
+   if( dcache == NULL ) {
+      return -ENOSYS;
+   }
+
+   stats->hits = __atomic_load_n( &dcache->hits, __ATOMIC_RELAXED );
+   stats->misses = __atomic_load_n( &dcache->misses, __ATOMIC_RELAXED );
+   stats->invalidations = __atomic_load_n( &dcache->invalidations, __ATOMIC_RELAXED );
+
+   return 0;
+}
+
+
+// look up a path in the dentry cache.
+// on a hit, return the entry, read- or write-locked according to writelock.
+// on a miss (or if the cached entry is busy or no longer linked), return NULL.
+// *gen is set to the generation to pass to fskit_dcache_insert once the path has been resolved by walking it.
+struct fskit_entry* fskit_dcache_lookup( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, uint64_t* gen ) {
+
+   struct fskit_dcache* dcache = core->dcache;
+   struct fskit_dcache_slot* slot = NULL;
+   struct fskit_entry* fent = NULL;
+   size_t path_len = 0;
+   uint64_t hash = 0;
+   int rc = 0;
+
+   *gen = 0;
+
+   if( dcache == NULL ) {
+      return NULL;
+   }
+
+   hash = fskit_dcache_hash( path, &path_len );
+
+   pthread_rwlock_rdlock( &dcache->lock );
+
+   *gen = dcache->gen;
+   slot = &dcache->slots[ hash & (dcache->num_slots - 1) ];
+
+   if( slot->fent != NULL && slot->gen == dcache->gen && slot->hash == hash && slot->user == user && slot->group == group &&
+       slot->path_len == path_len && memcmp( slot->path, path, path_len ) == 0 ) {
+
+      fent = slot->fent;
+
+      // don't block on the entry while holding the cache lock
+      if( writelock ) {
+         rc = pthread_rwlock_trywrlock( &fent->lock );
+      }
+      else {
+         rc = pthread_rwlock_tryrdlock( &fent->lock );
+      }
+
+      if( rc != 0 ) {
+         // busy; walk the path instead
+         fent = NULL;
+      }
+   }
+
+   pthread_rwlock_unlock( &dcache->lock );
+
+   if( fent != NULL ) {
+
+      if( FSKIT_ENTRY_LINK_COUNT( fent ) <= 0 || fent->type == FSKIT_ENTRY_TYPE_DEAD || fent->deletion_in_progress ||
+          (fent->type == FSKIT_ENTRY_TYPE_DIR && !FSKIT_ENTRY_IS_DIR_SEARCHABLE( fent->mode, fent->owner, fent->group, user, group )) ) {
+
+         // let the path walk generate the appropriate error
+         fskit_entry_unlock( fent );
+         fent = NULL;
+      }
+   }
+
+   if( fent != NULL ) {
+      __atomic_fetch_add( &dcache->hits, 1, __ATOMIC_RELAXED );
+   }
+   else {
+      __atomic_fetch_add( &dcache->misses, 1, __ATOMIC_RELAXED );
+   }
+
+   return fent;
+}
+
+
+// remember that path resolved to fent, as of generation gen (from fskit_dcache_lookup).
+// if the cache has been invalidated since, the entry is not inserted.
+// fent must be locked.
+// return 0 on success
+// return -ESTALE if gen is out of date
+// return -ENOMEM on OOM
+int fskit_dcache_insert( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, uint64_t gen, struct fskit_entry* fent ) {
+
+   struct fskit_dcache* dcache = core->dcache;
+   struct fskit_dcache_slot* slot = NULL;
+   size_t path_len = 0;
+   uint64_t hash = 0;
+   int rc = 0;
+
+   if( dcache == NULL ) {
+      return 0;
+   }
+
+   hash = fskit_dcache_hash( path, &path_len );
+
+   pthread_rwlock_wrlock( &dcache->lock );
+
+   if( gen != dcache->gen ) {
+
+      // namespace changed while we were walking
+      pthread_rwlock_unlock( &dcache->lock );
+      return -ESTALE;
+   }
+
+   slot = &dcache->slots[ hash & (dcache->num_slots - 1) ];
+
+   if( slot->path == NULL || slot->path_len < path_len ) {
+
+      char* new_path = (char*)realloc( slot->path, path_len + 1 );
+      if( new_path == NULL ) {
+
+         rc = -ENOMEM;
+      }
+      else {
+
+         slot->path = new_path;
+      }
+   }
+
+   if( rc == 0 ) {
+
+      memcpy( slot->path, path, path_len + 1 );
+      slot->path_len = path_len;
+      slot->hash = hash;
+      slot->gen = gen;
+      slot->user = user;
+      slot->group = group;
+      slot->fent = fent;
+   }
+   else {
+
+      slot->fent = NULL;
+   }
+
+   pthread_rwlock_unlock( &dcache->lock );
+
+   return rc;
+}
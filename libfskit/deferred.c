@@ -0,0 +1,656 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include <fskit/deferred.h>
+#include <fskit/dcache.h>
+#include <fskit/path.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// one removal: an unlinked entry, and whatever was below it
+struct fskit_deferred_job {
+
+   char* path;                          // path the entry was removed from
+   struct fskit_entry* ent;             // the entry itself (referenced, so it outlives its descendants)
+
+   fskit_entry_set* children;           // its old children, if it was a directory (until they're queued)
+   struct fskit_detach_ctx* ctx;        // descendants left to unlink and garbage-collect
+
+   struct fskit_deferred_job* next;
+};
+
+// background reaper state for a core
+struct fskit_deferred {
+
+   uint64_t batch_size;
+
+   pthread_t reaper;
+   bool running;
+
+   // governs running, busy, and the queue
+   pthread_mutex_t lock;
+   pthread_cond_t wake;                 // signaled when there's work, or when the reaper should stop
+   pthread_cond_t idle;                 // broadcast when the queue drains
+
+   struct fskit_deferred_job* head;
+   struct fskit_deferred_job* tail;
+   uint64_t num_pending;                // jobs queued, plus the one being worked on
+   bool busy;                           // reaper is working on a job outside the lock
+
+   // statistics (updated atomically)
+   uint64_t queued;
+   uint64_t completed;
+   uint64_t failed;
+   uint64_t reaped;
+   uint64_t batches;
+};
+
+
+// make a removal job for the entry at path
+// return NULL on OOM
+static struct fskit_deferred_job* fskit_deferred_job_new( char const* path ) {
+
+   struct fskit_deferred_job* job = CALLOC_LIST( struct fskit_deferred_job, 1 );
+   if( job == NULL ) {
+      return NULL;
+   }
+
+   job->path = strdup( path );
+   job->ctx = fskit_detach_ctx_new();
+
+   if( job->path == NULL || job->ctx == NULL ) {
+
+      fskit_safe_free( job->path );
+      fskit_safe_free( job->ctx );
+      free( job );
+      return NULL;
+   }
+
+   return job;
+}
+
+
+// free a removal job.
+// entries it never got to are not freed.
+static void fskit_deferred_job_free( struct fskit_deferred_job* job ) {
+
+   if( job->children != NULL ) {
+      fskit_entry_set_free( job->children );
+   }
+
+   fskit_detach_ctx_free( job->ctx );
+   fskit_safe_free( job->ctx );
+   fskit_safe_free( job->path );
+   free( job );
+}
+
+
+// do up to max entries' worth of a removal: queue the removed directory's old children (if we haven't yet),
+// unlink and garbage-collect its descendants breadth-first, and finally drop our reference to the entry itself,
+// destroying it if nothing else has it open.
+// entries are locked one at a time; the caller must not hold any of them.
+// *num_reaped is incremented by the number of entries handled.
+// return 1 if the removal is done
+// return 0 if there is more to do
+// return negative on error (e.g. -ENOMEM), in which case the rest of the removal is abandoned
+static int fskit_deferred_job_run( struct fskit_core* core, struct fskit_deferred_job* job, uint64_t max, uint64_t* num_reaped ) {
+
+   int rc = 0;
+
+   if( job->children != NULL ) {
+
+      rc = fskit_detach_queue_children( job->ctx, job->path, &job->children );
+      if( rc != 0 ) {
+
+         fskit_error("fskit_detach_queue_children('%s') rc = %d\n", job->path, rc );
+         return rc;
+      }
+
+      fskit_entry_set_free( job->children );
+      job->children = NULL;
+   }
+
+   rc = fskit_detach_ctx_reap( core, job->ctx, max, num_reaped );
+   if( rc != 0 ) {
+
+      fskit_error("fskit_detach_ctx_reap('%s') rc = %d\n", job->path, rc );
+      return rc;
+   }
+
+   if( fskit_detach_ctx_size( job->ctx ) > 0 ) {
+      return 0;
+   }
+
+   // nothing is left below it
+   rc = fskit_entry_unref( core, job->path, job->ent );
+   job->ent = NULL;
+
+   (*num_reaped)++;
+
+   if( rc != 0 ) {
+      fskit_error("WARN: fskit_entry_unref('%s') rc = %d\n", job->path, rc );
+   }
+
+   return 1;
+}
+
+
+// reaper thread: work through the queued removals a batch at a time, round-robin,
+// so one huge tree doesn't hold up the others.  Once told to stop, finish them all first.
+static void* fskit_deferred_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct fskit_deferred* deferred = core->deferred;
+   struct fskit_deferred_job* job = NULL;
+   uint64_t num_reaped = 0;
+   int rc = 0;
+
+   pthread_mutex_lock( &deferred->lock );
+
+   while( true ) {
+
+      while( deferred->head == NULL && deferred->running ) {
+         pthread_cond_wait( &deferred->wake, &deferred->lock );
+      }
+
+      if( deferred->head == NULL ) {
+         // stopped, and nothing left to do
+         break;
+      }
+
+      job = deferred->head;
+      deferred->head = job->next;
+      if( deferred->head == NULL ) {
+         deferred->tail = NULL;
+      }
+
+      job->next = NULL;
+      deferred->busy = true;
+
+      pthread_mutex_unlock( &deferred->lock );
+
+      num_reaped = 0;
+      rc = fskit_deferred_job_run( core, job, deferred->batch_size, &num_reaped );
+
+      __atomic_fetch_add( &deferred->reaped, num_reaped, __ATOMIC_RELAXED );
+      __atomic_fetch_add( &deferred->batches, 1, __ATOMIC_RELAXED );
+
+      if( rc != 0 ) {
+
+         if( rc < 0 ) {
+            __atomic_fetch_add( &deferred->failed, 1, __ATOMIC_RELAXED );
+         }
+         else {
+            __atomic_fetch_add( &deferred->completed, 1, __ATOMIC_RELAXED );
+         }
+
+         fskit_deferred_job_free( job );
+         job = NULL;
+      }
+
+      pthread_mutex_lock( &deferred->lock );
+
+      deferred->busy = false;
+
+      if( job != NULL ) {
+
+         // more to do; get back in line
+         if( deferred->tail != NULL ) {
+            deferred->tail->next = job;
+         }
+         else {
+            deferred->head = job;
+         }
+
+         deferred->tail = job;
+      }
+      else {
+
+         deferred->num_pending--;
+      }
+
+      if( deferred->head == NULL ) {
+         pthread_cond_broadcast( &deferred->idle );
+      }
+   }
+
+   pthread_mutex_unlock( &deferred->lock );
+
+   return NULL;
+}
+
+
+// start the background reaper on this core.  fskit_deferred_remove and friends hand their removals to it,
+// and it garbage-collects up to batch_size (FSKIT_DEFERRED_DEFAULT_BATCH_SIZE if 0) entries of one removal
+// before moving on to the next, so a huge tree doesn't hold up the others.
+// fskit_core_destroy waits for it to finish everything that was queued.
+// call this after fskit_core_init, before the core is used.
+// return 0 on success
+// return -EEXIST if the reaper is already running
+// return -ENOMEM if out of memory
+// return negative if the reaper thread could not be started
+int fskit_core_deferred_enable( struct fskit_core* core, size_t batch_size ) {
+
+   int rc = 0;
+   struct fskit_deferred* deferred = NULL;
+
+   if( batch_size == 0 ) {
+      batch_size = FSKIT_DEFERRED_DEFAULT_BATCH_SIZE;
+   }
+
+   deferred = CALLOC_LIST( struct fskit_deferred, 1 );
+   if( deferred == NULL ) {
+      return -ENOMEM;
+   }
+
+   deferred->batch_size = batch_size;
+
+   pthread_mutex_init( &deferred->lock, NULL );
+   pthread_cond_init( &deferred->wake, NULL );
+   pthread_cond_init( &deferred->idle, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->deferred != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_deferred_free( deferred );
+      return -EEXIST;
+   }
+
+   // the reaper reads core->deferred, so start it once that's set
+   core->deferred = deferred;
+   deferred->running = true;
+
+   rc = pthread_create( &deferred->reaper, NULL, fskit_deferred_main, core );
+   if( rc != 0 ) {
+
+      deferred->running = false;
+      core->deferred = NULL;
+
+      fskit_core_unlock( core );
+
+      fskit_error("pthread_create rc = %d\n", rc );
+      fskit_deferred_free( deferred );
+      return -rc;
+   }
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// stop the reaper, once it has finished every removal queued so far, and free its state.
+// always succeeds
+int fskit_deferred_free( struct fskit_deferred* deferred ) {
+
+   bool running = false;
+
+   if( deferred == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &deferred->lock );
+
+   running = deferred->running;
+   deferred->running = false;
+   pthread_cond_signal( &deferred->wake );
+
+   pthread_mutex_unlock( &deferred->lock );
+
+   if( running ) {
+      pthread_join( deferred->reaper, NULL );
+   }
+
+   pthread_mutex_destroy( &deferred->lock );
+   pthread_cond_destroy( &deferred->wake );
+   pthread_cond_destroy( &deferred->idle );
+
+   fskit_safe_free( deferred );
+
+   return 0;
+}
+
+
+// wait until the reaper has finished every removal queued so far
+// return 0 on success
+// return -ENOSYS if the reaper is disabled
+int fskit_core_deferred_drain( struct fskit_core* core ) {
+
+   struct fskit_deferred* deferred = core->deferred;
+
+   if( deferred == NULL ) {
+      return -ENOSYS;
+   }
+
+   pthread_mutex_lock( &deferred->lock );
+
+   while( deferred->head != NULL || deferred->busy ) {
+      pthread_cond_wait( &deferred->idle, &deferred->lock );
+   }
+
+   pthread_mutex_unlock( &deferred->lock );
+
+   return 0;
+}
+
+
+// get background removal statistics
+// return 0 on success
+// return -ENOSYS if the reaper is disabled
+int fskit_core_deferred_stats( struct fskit_core* core, struct fskit_deferred_stats* stats ) {
+
+   struct fskit_deferred* deferred = core->deferred;
+
+   if( deferred == NULL ) {
+      return -ENOSYS;
+   }
+
+   stats->queued = __atomic_load_n( &deferred->queued, __ATOMIC_RELAXED );
+   stats->completed = __atomic_load_n( &deferred->completed, __ATOMIC_RELAXED );
+   stats->failed = __atomic_load_n( &deferred->failed, __ATOMIC_RELAXED );
+   stats->reaped = __atomic_load_n( &deferred->reaped, __ATOMIC_RELAXED );
+   stats->batches = __atomic_load_n( &deferred->batches, __ATOMIC_RELAXED );
+
+   pthread_mutex_lock( &deferred->lock );
+
+   stats->pending = deferred->num_pending;
+
+   pthread_mutex_unlock( &deferred->lock );
+
+   return 0;
+}
+
+
+// hand a removal to the reaper, taking a reference to the removed entry and unlocking it.
+// if the reaper is disabled, carry out the whole removal before returning (errors are logged).
+// ent must be write-locked
+static void fskit_deferred_submit( struct fskit_core* core, struct fskit_deferred_job* job, struct fskit_entry* ent, fskit_entry_set* children ) {
+
+   uint64_t num_reaped = 0;
+   struct fskit_deferred* deferred = core->deferred;
+
+   fskit_entry_ref_entry( ent );
+   fskit_entry_unlock( ent );
+
+   job->ent = ent;
+   job->children = children;
+
+   if( deferred == NULL ) {
+
+      fskit_deferred_job_run( core, job, UINT64_MAX, &num_reaped );
+      fskit_deferred_job_free( job );
+      return;
+   }
+
+   pthread_mutex_lock( &deferred->lock );
+
+   if( deferred->tail != NULL ) {
+      deferred->tail->next = job;
+   }
+   else {
+      deferred->head = job;
+   }
+
+   deferred->tail = job;
+   deferred->num_pending++;
+
+   pthread_cond_signal( &deferred->wake );
+
+   pthread_mutex_unlock( &deferred->lock );
+
+   __atomic_fetch_add( &deferred->queued, 1, __ATOMIC_RELAXED );
+}
+
+
+// garbage-collect an entry that has already been unlinked (e.g. with fskit_entry_detach_lowlevel),
+// along with everything below it if it is a directory, on the reaper thread (see fskit_core_deferred_enable).
+// the entry is destroyed (running its destroy route) once nothing else has it open; its descendants are
+// unlinked and destroyed in batches, running their detach and destroy routes.
+// if the reaper is disabled, this all happens before returning.
+// errors while garbage-collecting are logged (and counted in fskit_core_deferred_stats); the entries involved are leaked.
+// child must be write-locked.  It is unlocked on success, and must not be used afterwards.
+// return 0 on success
+// return -ENOMEM on OOM, in which case child is left locked and untouched
+int fskit_deferred_remove( struct fskit_core* core, char const* child_path, struct fskit_entry* child ) {
+
+   int rc = 0;
+   fskit_entry_set* children = NULL;
+   struct fskit_deferred_job* job = fskit_deferred_job_new( child_path );
+
+   if( job == NULL ) {
+      return -ENOMEM;
+   }
+
+   if( child->type == FSKIT_ENTRY_TYPE_DIR ) {
+
+      // take its children away in one step; the reaper deals with them
+      rc = fskit_entry_tag_garbage( child, &children );
+      if( rc != 0 ) {
+
+         fskit_error("fskit_entry_tag_garbage('%s') rc = %d\n", child_path, rc );
+         fskit_deferred_job_free( job );
+         return rc;
+      }
+   }
+
+   fskit_deferred_submit( core, job, child, children );
+   return 0;
+}
+
+
+// unlink a directory and everything below it from the filesystem, and garbage-collect them on the reaper thread.
+// the directory's children are swapped out and it is unlinked from its parent right away, no matter how big
+// the tree is, so its path (and every path below it) stops resolving before this returns.
+// the rest happens as in fskit_deferred_remove.
+// child and its parent must be write-locked (parent first, as path resolution does).
+// child is unlocked on success, and must not be used afterwards.  On error, it is left locked.
+// return 0 on success
+// return -ENOMEM on OOM, in which case nothing has changed
+// return -ENOTDIR if child is not a directory
+// return -ENOENT if child is not its parent's entry for the last name in child_path
+// return -EINVAL if child is the root
+int fskit_deferred_remove_all( struct fskit_core* core, char const* child_path, struct fskit_entry* child ) {
+
+   int rc = 0;
+   struct fskit_entry* parent = NULL;
+   fskit_entry_set* children = NULL;
+   struct fskit_deferred_job* job = NULL;
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
+
+   if( child->type != FSKIT_ENTRY_TYPE_DIR ) {
+      return -ENOTDIR;
+   }
+
+   parent = fskit_entry_set_find_name( child->children, ".." );
+   if( parent == NULL || parent == child ) {
+      return -EINVAL;
+   }
+
+   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+   fskit_basename( child_path, name );
+
+   if( fskit_entry_set_find_name( parent->children, name ) != child ) {
+      return -ENOENT;
+   }
+
+   job = fskit_deferred_job_new( child_path );
+   if( job == NULL ) {
+      return -ENOMEM;
+   }
+
+   // take its children away in one step, so it's empty and can be unlinked
+   rc = fskit_entry_tag_garbage( child, &children );
+   if( rc != 0 ) {
+
+      fskit_error("fskit_entry_tag_garbage('%s') rc = %d\n", child_path, rc );
+      fskit_deferred_job_free( job );
+      return rc;
+   }
+
+   // path (and everything below it) will no longer resolve
+   fskit_core_dcache_invalidate( core );
+
+   rc = fskit_entry_detach_lowlevel( parent, name );
+   if( rc != 0 ) {
+
+      // shouldn't happen--we checked that it's there, and it's empty now
+      fskit_error("BUG: fskit_entry_detach_lowlevel('%s') rc = %d\n", child_path, rc );
+
+      job->children = children;
+      fskit_deferred_job_free( job );
+      return rc;
+   }
+
+   fskit_deferred_submit( core, job, child, children );
+   return 0;
+}
+
+
+// remove the file or directory tree at path: unlink it now, and garbage-collect it (and everything below it)
+// on the reaper thread, as fskit_deferred_remove_all does.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -ENAMETOOLONG if the path is too long
+// return -EINVAL if path is the root
+// return -ENOTDIR, -ENOENT, -EACCES, etc. if the path could not be resolved (see path_resolution(7))
+int fskit_deferred_remove_path( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group ) {
+
+   int rc = 0;
+   char path[PATH_MAX];
+   char* path_dirname = NULL;
+   char* path_basename = NULL;
+   struct fskit_entry* parent = NULL;
+   struct fskit_entry* child = NULL;
+
+   if( strlen(_path) >= PATH_MAX ) {
+      return -ENAMETOOLONG;
+   }
+
+   memset( path, 0, PATH_MAX );
+   strncpy( path, _path, PATH_MAX - 1 );
+
+   fskit_sanitize_path( path );
+
+   if( strcmp( path, "/" ) == 0 ) {
+      return -EINVAL;
+   }
+
+   path_dirname = fskit_dirname( path, NULL );
+   path_basename = fskit_basename( path, NULL );
+
+   if( path_dirname == NULL || path_basename == NULL ) {
+
+      fskit_safe_free( path_dirname );
+      fskit_safe_free( path_basename );
+      return -ENOMEM;
+   }
+
+   // look up the parent and write-lock it
+   parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, &rc );
+
+   fskit_safe_free( path_dirname );
+
+   if( parent == NULL ) {
+
+      fskit_safe_free( path_basename );
+      return rc;
+   }
+
+   if( parent->type != FSKIT_ENTRY_TYPE_DIR ) {
+
+      fskit_entry_unlock( parent );
+      fskit_safe_free( path_basename );
+      return -ENOTDIR;
+   }
+
+   child = fskit_entry_set_find_name( parent->children, path_basename );
+   if( child == NULL ) {
+
+      fskit_entry_unlock( parent );
+      fskit_safe_free( path_basename );
+      return -ENOENT;
+   }
+
+   fskit_entry_wlock( child );
+
+   if( child->type == FSKIT_ENTRY_TYPE_DIR ) {
+
+      rc = fskit_deferred_remove_all( core, path, child );
+      if( rc != 0 ) {
+         fskit_entry_unlock( child );
+      }
+   }
+   else {
+
+      // path will no longer resolve to child
+      fskit_core_dcache_invalidate( core );
+
+      rc = fskit_entry_detach_lowlevel( parent, path_basename );
+      if( rc == 0 ) {
+
+         // run the detach route as fskit_unlink does: with child unlocked, but referenced so it can't be destroyed under us
+         fskit_entry_ref_entry( child );
+         fskit_entry_unlock( child );
+
+         rc = fskit_run_user_detach( core, path, parent, child );
+         if( rc < 0 ) {
+            fskit_error("fskit_run_user_detach('%s') rc = %d\n", path, rc );
+         }
+
+         fskit_entry_wlock( child );
+
+         __atomic_sub_fetch( &child->open_count, 1, __ATOMIC_SEQ_CST );
+
+         rc = fskit_deferred_remove( core, path, child );
+         if( rc != 0 ) {
+
+            // can't defer it; do it now
+            rc = fskit_entry_try_destroy_and_free( core, path, parent, child );
+            if( rc > 0 ) {
+
+               // destroyed
+               rc = 0;
+            }
+            else {
+
+               if( rc < 0 ) {
+                  fskit_error("fskit_entry_try_destroy_and_free('%s') rc = %d\n", path, rc );
+               }
+
+               fskit_entry_unlock( child );
+            }
+         }
+      }
+      else {
+
+         fskit_entry_unlock( child );
+      }
+   }
+
+   fskit_entry_unlock( parent );
+   fskit_safe_free( path_basename );
+
+   return rc;
+}
@@ -22,6 +22,7 @@
 
 #include "fskit_private/private.h"
 
+#include <fskit/dcache.h>
 #include <fskit/debug.h>
 #include <fskit/entry.h>
 #include <fskit/path.h>
@@ -29,16 +30,74 @@
 #include <fskit/route.h>
 #include <fskit/util.h>
 
+// hash index slot.  member is NULL if the slot was never used, and FSKIT_ENTRY_SET_HASH_TOMBSTONE if it was vacated
+struct fskit_entry_set_hash_slot {
+
+   uint64_t hash;               // cached hash of member->name
+   struct fskit_entry_set_entry* member;
+};
+
+struct fskit_entry_set_hash_table {
+
+   struct fskit_entry_set_hash_slot* slots;
+   size_t cap;                  // power of two
+   size_t used;                 // slots that are live or tombstones
+};
+
+// open-addressing hash index over a large set.
+// the table grows incrementally: on growth, the current table becomes old, and is
+// drained into the new one a few slots at a time as the set is modified.
+struct fskit_entry_set_hash {
+
+   struct fskit_entry_set_hash_table cur;
+   struct fskit_entry_set_hash_table old;       // slots == NULL unless growing
+   size_t migrate_pos;                          // next slot in old to move
+
+   size_t live;                                 // number of members indexed
+};
+
+// per-set bookkeeping, owned by the set's "." entry (the set handle, which is never removed)
+struct fskit_entry_set_head {
+
+   struct fskit_entry_set_entry* root;          // ordered (red-black) tree of all entries, including . and ..
+   unsigned int count;
+
+   unsigned int hash_threshold;                 // build a hash index once the set has this many entries
+   struct fskit_entry_set_hash* hash;           // NULL if the set is not (yet) indexed
+
+   struct fskit_core* core;                     // where the set's entries come from (NULL for the heap)
+};
+
+// names shorter than this are stored in the entry itself
+#define FSKIT_ENTRY_SET_NAME_INLINE 23
+
 struct fskit_entry_set_entry {
    
-   char* name;
+   char* name;                                  // points to name_buf, if the name is short enough
    struct fskit_entry* dirent;
    
    struct fskit_entry_set_entry* left;
    struct fskit_entry_set_entry* right;
+
+   struct fskit_entry_set_head* head;           // only set on the "." entry
+
    char color;
+   char name_buf[FSKIT_ENTRY_SET_NAME_INLINE];
 };
 
+// marks a vacated hash slot
+static struct fskit_entry_set_entry fskit_entry_set_hash_tombstone;
+#define FSKIT_ENTRY_SET_HASH_TOMBSTONE (&fskit_entry_set_hash_tombstone)
+
+// smallest hash index
+#define FSKIT_ENTRY_SET_HASH_MIN_SLOTS 16
+
+// number of old hash slots to move per insert/remove while growing
+#define FSKIT_ENTRY_SET_HASH_MIGRATE_STEP 64
+
+// number of tree nodes a lockless lookup visits before giving up
+#define FSKIT_ENTRY_SET_OPTIMISTIC_MAX_STEPS 128
+
 // linked list entry for destroying an entry and all of its children
 struct fskit_detach_entry {
    
@@ -65,10 +124,394 @@ SGLIB_DEFINE_RBTREE_FUNCTIONS( fskit_entry_set, left, right, color, FSKIT_ENTRY_
 
 SGLIB_DEFINE_RBTREE_FUNCTIONS( fskit_xattr_set, left, right, color, FSKIT_XATTR_SET_ENTRY_CMP );
 
+// hash a (possibly non-NUL-terminated) name (FNV-1a)
+static uint64_t fskit_entry_set_name_hash( char const* name, size_t name_len ) {
+
+   uint64_t hash = 14695981039346656037ULL;
+
+   for( size_t i = 0; i < name_len; i++ ) {
+      hash ^= (unsigned char)name[i];
+      hash *= 1099511628211ULL;
+   }
+
+   return hash;
+}
+
+
+// compare a length-delimited name to a set member's name, in the same order as strcmp
+static int fskit_entry_set_name_cmp_len( char const* name, size_t name_len, char const* member_name ) {
+
+   int cmp = strncmp( name, member_name, name_len );
+   if( cmp != 0 ) {
+      return cmp;
+   }
+
+   // name is a prefix of member_name, so it sorts first unless they are equal
+   return -(int)(unsigned char)member_name[name_len];
+}
+
+
+// allocate a hash table with the given (power of two) capacity
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_entry_set_hash_table_init( struct fskit_entry_set_hash_table* table, size_t cap ) {
+
+   table->slots = CALLOC_LIST( struct fskit_entry_set_hash_slot, cap );
+   if( table->slots == NULL ) {
+      return -ENOMEM;
+   }
+
+   table->cap = cap;
+   table->used = 0;
+   return 0;
+}
+
+
+// free a hash table's slots
+static void fskit_entry_set_hash_table_free( struct fskit_entry_set_hash_table* table ) {
+
+   fskit_safe_free( table->slots );
+   table->cap = 0;
+   table->used = 0;
+}
+
+
+// find the slot holding a name in a hash table
+// return NULL if not present
+static struct fskit_entry_set_hash_slot* fskit_entry_set_hash_table_find( struct fskit_entry_set_hash_table* table, uint64_t hash, char const* name, size_t name_len ) {
+
+   size_t mask = table->cap - 1;
+
+   if( table->slots == NULL ) {
+      return NULL;
+   }
+
+   for( size_t i = hash & mask; table->slots[i].member != NULL; i = (i + 1) & mask ) {
+
+      struct fskit_entry_set_hash_slot* slot = &table->slots[i];
+
+      if( slot->member != FSKIT_ENTRY_SET_HASH_TOMBSTONE && slot->hash == hash && fskit_entry_set_name_cmp_len( name, name_len, slot->member->name ) == 0 ) {
+         return slot;
+      }
+   }
+
+   return NULL;
+}
+
+
+// find the slot holding a particular member in a hash table
+// return NULL if not present
+static struct fskit_entry_set_hash_slot* fskit_entry_set_hash_table_find_member( struct fskit_entry_set_hash_table* table, uint64_t hash, fskit_entry_set* member ) {
+
+   size_t mask = table->cap - 1;
+
+   if( table->slots == NULL ) {
+      return NULL;
+   }
+
+   for( size_t i = hash & mask; table->slots[i].member != NULL; i = (i + 1) & mask ) {
+
+      if( table->slots[i].member == member ) {
+         return &table->slots[i];
+      }
+   }
+
+   return NULL;
+}
+
+
+// put a member into a hash table.  The table must have a free slot.
+static void fskit_entry_set_hash_table_put( struct fskit_entry_set_hash_table* table, uint64_t hash, fskit_entry_set* member ) {
+
+   size_t mask = table->cap - 1;
+   size_t i = hash & mask;
+
+   while( table->slots[i].member != NULL && table->slots[i].member != FSKIT_ENTRY_SET_HASH_TOMBSTONE ) {
+      i = (i + 1) & mask;
+   }
+
+   if( table->slots[i].member == NULL ) {
+      table->used++;
+   }
+
+   table->slots[i].hash = hash;
+   table->slots[i].member = member;
+}
+
+
+// move up to num_slots slots from the old table into the current one.
+// frees the old table once it has been drained.
+static void fskit_entry_set_hash_migrate( struct fskit_entry_set_hash* index, size_t num_slots ) {
+
+   struct fskit_entry_set_hash_slot* slot = NULL;
+
+   if( index->old.slots == NULL ) {
+      return;
+   }
+
+   for( size_t i = 0; i < num_slots && index->migrate_pos < index->old.cap; i++, index->migrate_pos++ ) {
+
+      slot = &index->old.slots[ index->migrate_pos ];
+
+      if( slot->member != NULL && slot->member != FSKIT_ENTRY_SET_HASH_TOMBSTONE ) {
+
+         fskit_entry_set_hash_table_put( &index->cur, slot->hash, slot->member );
+         slot->member = FSKIT_ENTRY_SET_HASH_TOMBSTONE;
+      }
+   }
+
+   if( index->migrate_pos >= index->old.cap ) {
+
+      // drained
+      fskit_entry_set_hash_table_free( &index->old );
+      index->migrate_pos = 0;
+   }
+}
+
+
+// make room for one more member, growing the table incrementally if it is getting full.
+// the current table becomes the old table, which is drained a few slots at a time on subsequent inserts and removes.
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_entry_set_hash_reserve( struct fskit_entry_set_hash* index ) {
+
+   int rc = 0;
+   size_t new_cap = index->cur.cap;
+   struct fskit_entry_set_hash_table new_table;
+
+   fskit_entry_set_hash_migrate( index, FSKIT_ENTRY_SET_HASH_MIGRATE_STEP );
+
+   if( (index->cur.used + 1) * 4 <= index->cur.cap * 3 ) {
+      // load factor is fine
+      return 0;
+   }
+
+   if( index->old.slots != NULL ) {
+      // still draining the last growth; finish it first
+      fskit_entry_set_hash_migrate( index, index->old.cap );
+   }
+
+   // grow, unless it's mostly tombstones
+   if( index->live * 2 >= index->cur.cap ) {
+      new_cap = index->cur.cap * 2;
+   }
+
+   rc = fskit_entry_set_hash_table_init( &new_table, new_cap );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   index->old = index->cur;
+   index->cur = new_table;
+   index->migrate_pos = 0;
+
+   fskit_entry_set_hash_migrate( index, FSKIT_ENTRY_SET_HASH_MIGRATE_STEP );
+   return 0;
+}
+
+
+// free a set's hash index
+static void fskit_entry_set_hash_free( struct fskit_entry_set_head* head ) {
+
+   if( head->hash == NULL ) {
+      return;
+   }
+
+   fskit_entry_set_hash_table_free( &head->hash->cur );
+   fskit_entry_set_hash_table_free( &head->hash->old );
+   fskit_safe_free( head->hash );
+}
+
+
+// build a hash index over all of a set's members
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_entry_set_hash_build( struct fskit_entry_set_head* head ) {
+
+   int rc = 0;
+   size_t cap = FSKIT_ENTRY_SET_HASH_MIN_SLOTS;
+   fskit_entry_set_itr itr;
+   fskit_entry_set* dp = NULL;
+   struct fskit_entry_set_hash* index = NULL;
+
+   while( cap < (size_t)head->count * 2 ) {
+      cap <<= 1;
+   }
+
+   index = CALLOC_LIST( struct fskit_entry_set_hash, 1 );
+   if( index == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_entry_set_hash_table_init( &index->cur, cap );
+   if( rc != 0 ) {
+      fskit_safe_free( index );
+      return rc;
+   }
+
+   for( dp = sglib_fskit_entry_set_it_init_inorder( &itr, head->root ); dp != NULL; dp = sglib_fskit_entry_set_it_next( &itr ) ) {
+
+      fskit_entry_set_hash_table_put( &index->cur, fskit_entry_set_name_hash( dp->name, strlen(dp->name) ), dp );
+      index->live++;
+   }
+
+   head->hash = index;
+   return 0;
+}
+
+
+// add a new member to a set's hash index, if it has one.
+// the index is an accelerator, so if we run out of memory we simply drop it (lookups fall back to the tree)
+static void fskit_entry_set_hash_add( struct fskit_entry_set_head* head, fskit_entry_set* member ) {
+
+   int rc = 0;
+
+   if( head->hash == NULL ) {
+
+      if( head->count >= head->hash_threshold ) {
+
+         // big enough to be worth indexing (includes the new member)
+         rc = fskit_entry_set_hash_build( head );
+         if( rc != 0 ) {
+            fskit_error("WARN: fskit_entry_set_hash_build rc = %d\n", rc );
+         }
+      }
+
+      return;
+   }
+
+   rc = fskit_entry_set_hash_reserve( head->hash );
+   if( rc != 0 ) {
+
+      fskit_error("WARN: fskit_entry_set_hash_reserve rc = %d; dropping index\n", rc );
+      fskit_entry_set_hash_free( head );
+      return;
+   }
+
+   fskit_entry_set_hash_table_put( &head->hash->cur, fskit_entry_set_name_hash( member->name, strlen(member->name) ), member );
+   head->hash->live++;
+}
+
+
+// remove a member from a set's hash index, if it has one.
+static void fskit_entry_set_hash_remove( struct fskit_entry_set_head* head, fskit_entry_set* member ) {
+
+   struct fskit_entry_set_hash* index = head->hash;
+   struct fskit_entry_set_hash_slot* slot = NULL;
+   uint64_t hash = 0;
+
+   if( index == NULL ) {
+      return;
+   }
+
+   if( head->count < head->hash_threshold / 2 ) {
+
+      // shrunk well below the threshold; the tree will do
+      fskit_entry_set_hash_free( head );
+      return;
+   }
+
+   hash = fskit_entry_set_name_hash( member->name, strlen(member->name) );
+
+   slot = fskit_entry_set_hash_table_find_member( &index->cur, hash, member );
+   if( slot == NULL ) {
+      slot = fskit_entry_set_hash_table_find_member( &index->old, hash, member );
+   }
+
+   if( slot != NULL ) {
+      slot->member = FSKIT_ENTRY_SET_HASH_TOMBSTONE;
+      index->live--;
+   }
+
+   fskit_entry_set_hash_migrate( index, FSKIT_ENTRY_SET_HASH_MIGRATE_STEP );
+}
+
+
+// allocate a set entry with the given name
+// return NULL on OOM
+static fskit_entry_set* fskit_entry_set_entry_new( struct fskit_slab* slab, char const* name, struct fskit_entry* child ) {
+
+   fskit_entry_set* ret = NULL;
+   size_t name_len = strlen( name );
+
+   if( slab != NULL ) {
+      ret = (fskit_entry_set*)fskit_slab_alloc( slab );
+   }
+   else {
+      ret = CALLOC_LIST( fskit_entry_set, 1 );
+   }
+
+   if( ret == NULL ) {
+      return NULL;
+   }
+
+   if( name_len < FSKIT_ENTRY_SET_NAME_INLINE ) {
+
+      memcpy( ret->name_buf, name, name_len + 1 );
+      ret->name = ret->name_buf;
+   }
+   else {
+
+      ret->name = strdup_or_null( name );
+      if( ret->name == NULL ) {
+
+         if( slab != NULL ) {
+            fskit_slab_free( slab, ret );
+         }
+         else {
+            fskit_safe_free( ret );
+         }
+
+         return NULL;
+      }
+   }
+
+   ret->dirent = child;
+   return ret;
+}
+
+
+// free a set entry right away
+static void fskit_entry_set_entry_free_now( void* slab, void* ptr ) {
+
+   fskit_entry_set* dp = (fskit_entry_set*)ptr;
+
+   if( dp->name != dp->name_buf ) {
+      fskit_safe_free( dp->name );
+   }
+
+   dp->name = NULL;
+   dp->dirent = NULL;
+
+   if( slab != NULL ) {
+      fskit_slab_free( (struct fskit_slab*)slab, dp );
+   }
+   else {
+      fskit_safe_free( dp );
+   }
+}
+
+
+// free a set entry that has been removed from its set.
+// if the core has optimistic lookups enabled, a reader may still be looking at it, so wait for them.
+static void fskit_entry_set_entry_free( struct fskit_core* core, fskit_entry_set* dp ) {
+
+   if( core == NULL ) {
+      fskit_entry_set_entry_free_now( NULL, dp );
+   }
+   else if( core->epoch != NULL ) {
+      fskit_epoch_defer( core->epoch, fskit_entry_set_entry_free_now, &core->set_slab, dp );
+   }
+   else {
+      fskit_entry_set_entry_free_now( &core->set_slab, dp );
+   }
+}
+
+
 // start iterating over a set of directory entries 
 fskit_entry_set* fskit_entry_set_begin( fskit_entry_set_itr* itr, fskit_entry_set* dirents ) {
    
-   return sglib_fskit_entry_set_it_init_inorder( itr, dirents );
+   return sglib_fskit_entry_set_it_init_inorder( itr, (dirents != NULL ? dirents->head->root : NULL) );
 }
 
 // get the next entry in a directory entry set 
@@ -77,52 +520,113 @@ fskit_entry_set* fskit_entry_set_next( fskit_entry_set_itr* itr ) {
    return sglib_fskit_entry_set_it_next( itr );
 }
 
+// start iterating over a set of directory entries at the first entry whose name sorts after the given name.
+// the name need not be in the set (e.g. it was removed since it was last read), so this is how a reader resumes.
+// takes O(log n) time, instead of re-walking the set from the beginning.
+// return the first such entry, or NULL if there are none
+fskit_entry_set* fskit_entry_set_seek( fskit_entry_set_itr* itr, fskit_entry_set* dirents, char const* name ) {
+
+   fskit_entry_set* node = (dirents != NULL ? dirents->head->root : NULL);
+
+   // build the in-order iterator's stack directly: it holds every entry we pass on the way down
+   // whose name sorts after the given name, each with its left subtree marked as visited.
+   itr->currentelem = NULL;
+   itr->pathi = 0;
+   itr->order = 1;
+   itr->equalto = NULL;
+   itr->subcomparator = NULL;
+
+   while( node != NULL ) {
+
+      if( strcmp( name, node->name ) < 0 ) {
+
+         itr->path[ itr->pathi ] = node;
+         itr->pass[ itr->pathi ] = 1;
+         itr->pathi++;
+
+         node = node->left;
+      }
+      else {
+
+         node = node->right;
+      }
+   }
+
+   if( itr->pathi > 0 ) {
+      itr->currentelem = itr->path[ itr->pathi - 1 ];
+   }
+
+   return itr->currentelem;
+}
+
+// free up all entries in an fskit_entry_set, as well as the entry set itself, right away
+static void fskit_entry_set_free_now( void* ignored, void* ptr ) {
+
+   fskit_entry_set_itr itr;
+   fskit_entry_set* dp = NULL;
+   fskit_entry_set* old_dp = NULL;
+   struct fskit_entry_set_head* head = ((fskit_entry_set*)ptr)->head;
+   struct fskit_slab* slab = (head->core != NULL ? &head->core->set_slab : NULL);
+
+   fskit_entry_set_hash_free( head );
+
+   for( dp = sglib_fskit_entry_set_it_init_inorder( &itr, head->root ); dp != NULL; ) {
+
+      old_dp = dp;
+      dp = fskit_entry_set_next( &itr );
+      fskit_entry_set_entry_free_now( slab, old_dp );
+   }
+
+   fskit_safe_free( head );
+}
+
 // free up all entries in an fskit_entry_set, as well as the entry set itself.
 // don't free the contained entries
+// if the set's core has optimistic lookups enabled, this happens once no reader can be walking the set.
 int fskit_entry_set_free( fskit_entry_set* dirents ) {
    
    if( dirents == NULL ) {
        return 0;
    }
-   
-   fskit_entry_set_itr itr;   
-   fskit_entry_set* dp = NULL;
-   fskit_entry_set* old_dp = NULL;
 
-   for( dp = fskit_entry_set_begin( &itr, dirents ); dp != NULL; ) {
-      
-      fskit_safe_free( dp->name );
-      dp->dirent = NULL;
-      
-      old_dp = dp;
-      dp = fskit_entry_set_next( &itr );
-      fskit_safe_free( old_dp );
+   if( dirents->head->core != NULL && dirents->head->core->epoch != NULL ) {
+      fskit_epoch_defer( dirents->head->core->epoch, fskit_entry_set_free_now, NULL, dirents );
+   }
+   else {
+      fskit_entry_set_free_now( NULL, dirents );
    }
    
    return 0;
 }
 
-// allocate and initialize an empty fskit_entry_set
+// allocate and initialize an empty fskit_entry_set.
+// if core is not NULL, the set's entries are allocated from it.
+// NOTE: parent is not dereferenced (it may be dead, if node is being garbage-collected)
 // return the set on success
 // return NULL on error (OOM)
-fskit_entry_set* fskit_entry_set_new( struct fskit_entry* node, struct fskit_entry* parent ) {
+fskit_entry_set* fskit_entry_set_new_ex( struct fskit_core* core, struct fskit_entry* node, struct fskit_entry* parent ) {
 
    int rc = 0;
-   fskit_entry_set* ret = CALLOC_LIST( fskit_entry_set, 1 );
-   
-   if( ret == NULL ) {
+   struct fskit_entry_set_head* head = CALLOC_LIST( struct fskit_entry_set_head, 1 );
+   fskit_entry_set* ret = NULL;
+
+   if( head == NULL ) {
       return NULL;
    }
-   
-   char* name_dup = strdup_or_null( "." );
-   if( name_dup == NULL ) {
-       fskit_safe_free( ret );
-       return NULL;
+
+   ret = fskit_entry_set_entry_new( (core != NULL ? &core->set_slab : NULL), ".", node );
+   if( ret == NULL ) {
+      fskit_safe_free( head );
+      return NULL;
    }
-   
-   ret->name = name_dup;
-   ret->dirent = node;
-   
+
+   // "." is the set's handle, and is never removed
+   ret->head = head;
+   head->core = core;
+   head->count = 1;
+   head->hash_threshold = FSKIT_ENTRY_SET_HASH_THRESHOLD_DEFAULT;
+   sglib_fskit_entry_set_add( &head->root, ret );
+
    rc = fskit_entry_set_insert( &ret, "..", parent );
    if( rc != 0 ) {
       
@@ -133,31 +637,33 @@ fskit_entry_set* fskit_entry_set_new( struct fskit_entry* node, struct fskit_ent
    return ret;
 }
 
+// allocate and initialize an empty fskit_entry_set, with its entries on the heap
+// return the set on success
+// return NULL on error (OOM)
+fskit_entry_set* fskit_entry_set_new( struct fskit_entry* node, struct fskit_entry* parent ) {
+   return fskit_entry_set_new_ex( NULL, node, parent );
+}
+
 // insert a child entry into an fskit_entry_set
 // return 0 on success
 // return -ENOMEM on OOM
 int fskit_entry_set_insert( fskit_entry_set** set, char const* name, struct fskit_entry* child ) {
    
    fskit_entry_set* new_entry = NULL;
-   char* name_dup = NULL;
-   int rc = 0;
+   struct fskit_entry_set_head* head = (*set)->head;
    
-   new_entry = CALLOC_LIST( fskit_entry_set, 1 );
+   new_entry = fskit_entry_set_entry_new( (head->core != NULL ? &head->core->set_slab : NULL), name, child );
    if( new_entry == NULL ) {
       return -ENOMEM;
    }
    
-   name_dup = strdup_or_null( name );
-   if( name_dup == NULL ) {
-      
-      fskit_safe_free( new_entry );
-      return -ENOMEM;
-   }
-   
-   new_entry->name = name_dup;
-   new_entry->dirent = child;
-   
-   sglib_fskit_entry_set_add( set, new_entry );
+   // make the new entry's contents visible before lockless readers can reach it
+   __atomic_thread_fence( __ATOMIC_RELEASE );
+
+   sglib_fskit_entry_set_add( &head->root, new_entry );
+   head->count++;
+
+   fskit_entry_set_hash_add( head, new_entry );
    
    return 0;
 }
@@ -167,13 +673,7 @@ int fskit_entry_set_insert( fskit_entry_set** set, char const* name, struct fski
 // return NULL if not found 
 fskit_entry_set* fskit_entry_set_find_itr( fskit_entry_set* set, char const* name ) {
     
-   fskit_entry_set* member = NULL;
-   fskit_entry_set lookup;
-   
-   memset( &lookup, 0, sizeof( fskit_entry_set ) );
-   lookup.name = (char*)name;
-   
-   return sglib_fskit_entry_set_find_member( set, &lookup );
+   return fskit_entry_set_find_itr_len( set, name, strlen(name) );
 }
 
 
@@ -192,14 +692,107 @@ struct fskit_entry* fskit_entry_set_find_name( fskit_entry_set* set, char const*
 }
 
 
+// find a child entry set in a fskit_entry_set, given a name that need not be NUL-terminated.
+// uses the set's hash index if it has one, and its tree otherwise.
+// return NULL if not found
+fskit_entry_set* fskit_entry_set_find_itr_len( fskit_entry_set* set, char const* name, size_t name_len ) {
+
+   fskit_entry_set* node = NULL;
+   struct fskit_entry_set_hash_slot* slot = NULL;
+   uint64_t hash = 0;
+   int cmp = 0;
+
+   if( set == NULL ) {
+      return NULL;
+   }
+
+   if( set->head->hash != NULL ) {
+
+      hash = fskit_entry_set_name_hash( name, name_len );
+
+      slot = fskit_entry_set_hash_table_find( &set->head->hash->cur, hash, name, name_len );
+      if( slot == NULL ) {
+         slot = fskit_entry_set_hash_table_find( &set->head->hash->old, hash, name, name_len );
+      }
+
+      return (slot != NULL ? slot->member : NULL);
+   }
+
+   node = set->head->root;
+   while( node != NULL ) {
+
+      cmp = fskit_entry_set_name_cmp_len( name, name_len, node->name );
+      if( cmp == 0 ) {
+         return node;
+      }
+
+      node = (cmp < 0 ? node->left : node->right);
+   }
+
+   return NULL;
+}
+
+
+// find a child entry in a fskit_entry_set without holding the owner's lock.
+// only the tree is walked, since the hash index is rebuilt in place.
+// the caller must be in an epoch read-side critical section, and must validate the owner's sequence
+// counter afterwards: a concurrent rebalance can hide a member, or send us in circles (so we give up after a while).
+// return NULL if not found, or if we gave up
+struct fskit_entry* fskit_entry_set_find_name_optimistic( fskit_entry_set* set, char const* name, size_t name_len ) {
+
+   fskit_entry_set* node = NULL;
+   struct fskit_entry_set_head* head = NULL;
+   char const* member_name = NULL;
+   int cmp = 0;
+
+   if( set == NULL ) {
+      return NULL;
+   }
+
+   head = __atomic_load_n( &set->head, __ATOMIC_ACQUIRE );
+   node = __atomic_load_n( &head->root, __ATOMIC_ACQUIRE );
+
+   for( int i = 0; node != NULL && i < FSKIT_ENTRY_SET_OPTIMISTIC_MAX_STEPS; i++ ) {
+
+      member_name = __atomic_load_n( &node->name, __ATOMIC_ACQUIRE );
+      if( member_name == NULL ) {
+         // being freed
+         return NULL;
+      }
+
+      cmp = fskit_entry_set_name_cmp_len( name, name_len, member_name );
+      if( cmp == 0 ) {
+         return __atomic_load_n( &node->dirent, __ATOMIC_ACQUIRE );
+      }
+
+      node = __atomic_load_n( (cmp < 0 ? &node->left : &node->right), __ATOMIC_ACQUIRE );
+   }
+
+   return NULL;
+}
+
+
+// find a child entry in a fskit_entry_set, given a name that need not be NUL-terminated
+// return NULL if not found
+struct fskit_entry* fskit_entry_set_find_name_len( fskit_entry_set* set, char const* name, size_t name_len ) {
+
+   fskit_entry_set* member = fskit_entry_set_find_itr_len( set, name, name_len );
+
+   if( member == NULL ) {
+      return NULL;
+   }
+   else {
+      return member->dirent;
+   }
+}
+
+
 // remove a child entry from an fskit_entry_set.  Note that it does *NOT* free the fskit_entry contained within.
 // return true if removed; false if not
 bool fskit_entry_set_remove( fskit_entry_set** set, char const* name ) {
    
-   int rc = 0;
-   int size = 0;
-   fskit_entry_set lookup;
    fskit_entry_set* member = NULL;
+   struct fskit_entry_set_head* head = (*set)->head;
    
    // cannot remove . or .. 
    if( strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ) {
@@ -208,14 +801,15 @@ bool fskit_entry_set_remove( fskit_entry_set** set, char const* name ) {
       return false;
    }
    
-   memset( &lookup, 0, sizeof( fskit_entry_set ) );
-   lookup.name = (char*)name;
-   
-   sglib_fskit_entry_set_delete_if_member( set, &lookup, &member );
+   member = fskit_entry_set_find_itr( *set, name );
    if( member != NULL ) {
       
-      fskit_safe_free( member->name );
-      fskit_safe_free( member );
+      sglib_fskit_entry_set_delete( &head->root, member );
+      head->count--;
+
+      fskit_entry_set_hash_remove( head, member );
+
+      fskit_entry_set_entry_free( head->core, member );
       
       return true;
    }
@@ -229,14 +823,9 @@ bool fskit_entry_set_remove( fskit_entry_set** set, char const* name ) {
 // return true if replaced; false if not
 bool fskit_entry_set_replace( fskit_entry_set* set, char const* name, struct fskit_entry* replacement ) {
    
-   int rc = 0;
    fskit_entry_set* member = NULL;
-   fskit_entry_set lookup;
-   
-   memset( &lookup, 0, sizeof( fskit_entry_set ) );
-   lookup.name = (char*)name;
    
-   member = sglib_fskit_entry_set_find_member( set, &lookup );
+   member = fskit_entry_set_find_itr( set, name );
    if( member != NULL ) {
       
       member->dirent = replacement;
@@ -249,11 +838,44 @@ bool fskit_entry_set_replace( fskit_entry_set* set, char const* name, struct fsk
 }
 
 
-// count the number of slots available in an fskit_entry_set
-// not to be confused with the number of children, which is the number of non-NULL slots
+// count the number of entries in an fskit_entry_set (including . and ..)
 unsigned int fskit_entry_set_count( fskit_entry_set* set ) {
    
-   return sglib_fskit_entry_set_len( set );
+   if( set == NULL ) {
+      return 0;
+   }
+
+   return set->head->count;
+}
+
+
+// set the number of entries at which a set gets a hash index.
+// builds or drops the index as needed.
+// pass FSKIT_ENTRY_SET_HASH_NEVER to always use the tree.
+// the set's owner must be write-locked.
+// return 0 on success
+// return -ENOMEM on OOM
+int fskit_entry_set_hash_threshold( fskit_entry_set* set, unsigned int threshold ) {
+
+   struct fskit_entry_set_head* head = set->head;
+
+   head->hash_threshold = threshold;
+
+   if( head->count >= threshold && head->hash == NULL ) {
+      return fskit_entry_set_hash_build( head );
+   }
+   else if( head->count < threshold && head->hash != NULL ) {
+      fskit_entry_set_hash_free( head );
+   }
+
+   return 0;
+}
+
+
+// does this set have a hash index?
+bool fskit_entry_set_is_hashed( fskit_entry_set* set ) {
+
+   return (set != NULL && set->head->hash != NULL);
 }
 
 // get the child (or NULL if the request is off the end of the set)
@@ -300,8 +922,10 @@ struct fskit_entry* fskit_dir_find_by_name( struct fskit_entry* dir, char const*
 // NOTE: parent must be write-locked, as well as fent
 int fskit_entry_attach_lowlevel( struct fskit_entry* parent, struct fskit_entry* fent, char const* name ) {
 
+   int rc = 0;
+
    if( parent != fent ) {
-      fent->link_count++;
+      __atomic_add_fetch( &fent->link_count, 1, __ATOMIC_SEQ_CST );
    }
    
    parent->num_children++;
@@ -314,10 +938,18 @@ int fskit_entry_attach_lowlevel( struct fskit_entry* parent, struct fskit_entry*
    // if this is a directory, then set .. to point to the parent 
    if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
        
+       FSKIT_ENTRY_WRITE_BEGIN( fent );
        fskit_entry_set_replace( fent->children, "..", parent );
+       fskit_entry_bump_children_gen( fent );
+       FSKIT_ENTRY_WRITE_END( fent );
    }
 
-   return fskit_entry_set_insert( &parent->children, name, fent );
+   FSKIT_ENTRY_WRITE_BEGIN( parent );
+   rc = fskit_entry_set_insert( &parent->children, name, fent );
+   fskit_entry_bump_children_gen( parent );
+   FSKIT_ENTRY_WRITE_END( parent );
+
+   return rc;
 }
 
 
@@ -348,7 +980,11 @@ static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char cons
    }
 
    // unlink
+   FSKIT_ENTRY_WRITE_BEGIN( parent );
    bool rc = fskit_entry_set_remove( &parent->children, child_name );
+   fskit_entry_bump_children_gen( parent );
+   FSKIT_ENTRY_WRITE_END( parent );
+
    if( !rc ) {
       
       fskit_error("fskit_entry_set_remove(%" PRIX64 ", '%s') rc = false\n", parent->file_id, child_name );
@@ -363,12 +999,13 @@ static int fskit_entry_detach_lowlevel_ex( struct fskit_entry* parent, char cons
 
    if( parent != child ) {
       
-      child->link_count--;
+      // NOTE: child may only be read-locked by someone else
+      int32_t link_count = __atomic_sub_fetch( &child->link_count, 1, __ATOMIC_SEQ_CST );
 
       // should *never* happen
-      if( child->link_count < 0 ) {
+      if( link_count < 0 ) {
          fskit_error("BUG: negative link count on %" PRIX64 " ('%s')\n", child->file_id, child_name );
-         child->link_count = 0;
+         __atomic_store_n( &child->link_count, 0, __ATOMIC_SEQ_CST );
       }
    }
 
@@ -417,16 +1054,30 @@ int fskit_core_init( struct fskit_core* core, void* app_fs_data ) {
 
    int rc = 0;
 
-   fskit_route_table* routes = fskit_route_table_new();
+   fskit_route_table* route_table = fskit_route_table_new();
+   if( route_table == NULL ) {
+      return -ENOMEM;
+   }
+
+   struct fskit_route_snapshot* routes = fskit_route_snapshot_new( route_table, 0 );
    if( routes == NULL ) {
+      fskit_route_table_free( route_table );
       return -ENOMEM;
    }
 
-   rc = fskit_entry_init_dir( &core->root, &core->root, 0, 0, 0, 0755 );
+   fskit_slab_init( &core->entry_slab, sizeof(struct fskit_entry) );
+   fskit_slab_init( &core->set_slab, sizeof(fskit_entry_set) );
+   fskit_slab_init( &core->handle_slab, sizeof(struct fskit_file_handle) );
+
+   rc = fskit_entry_init_dir_ex( core, &core->root, &core->root, 0, 0, 0, 0755 );
    if( rc != 0 ) {
       fskit_error("fskit_entry_init_dir(/) rc = %d\n", rc );
 
-      fskit_safe_free( routes );
+      fskit_slab_destroy( &core->entry_slab );
+      fskit_slab_destroy( &core->set_slab );
+      fskit_slab_destroy( &core->handle_slab );
+
+      fskit_route_snapshot_unref( routes );
       return rc;
    }
 
@@ -440,6 +1091,18 @@ int fskit_core_init( struct fskit_core* core, void* app_fs_data ) {
 
    pthread_rwlock_init( &core->lock, NULL );
    pthread_rwlock_init( &core->route_lock, NULL );
+   pthread_mutex_init( &core->route_update_lock, NULL );
+
+   // stripes are recursive: a striped callback may call back into fskit on another inode that hashes to its own stripe
+   pthread_mutexattr_t stripe_attr;
+   pthread_mutexattr_init( &stripe_attr );
+   pthread_mutexattr_settype( &stripe_attr, PTHREAD_MUTEX_RECURSIVE );
+
+   for( int i = 0; i < FSKIT_ROUTE_LOCK_STRIPES; i++ ) {
+      pthread_mutex_init( &core->route_stripes[i].u.lock, &stripe_attr );
+   }
+
+   pthread_mutexattr_destroy( &stripe_attr );
 
    return 0;
 }
@@ -451,13 +1114,27 @@ int fskit_core_init( struct fskit_core* core, void* app_fs_data ) {
 int fskit_core_destroy( struct fskit_core* core, void** app_fs_data ) {
 
    void* fs_data = NULL;
+
+   // stop background flushes before the routes go away
+   fskit_writeback_free( core->writeback );
+   core->writeback = NULL;
+
+   // stop background prefetches, for the same reason
+   fskit_readahead_free( core->readahead_worker );
+   core->readahead_worker = NULL;
+
+   // finish background removals while the tree and routes are still around
+   fskit_deferred_free( core->deferred );
+   core->deferred = NULL;
    
    fskit_entry_wlock( &core->root );
    
    // forcibly detach core->root 
+   FSKIT_ENTRY_WRITE_BEGIN( &core->root );
    core->root.open_count = 1;   // for referencing
    core->root.link_count = 0;
    core->root.deletion_in_progress = true;
+   FSKIT_ENTRY_WRITE_END( &core->root );
    
    fskit_entry_unlock( &core->root );
    
@@ -466,13 +1143,43 @@ int fskit_core_destroy( struct fskit_core* core, void** app_fs_data ) {
    
    fskit_entry_destroy( core, &core->root, true );
 
-   fskit_route_table_free( core->routes );
+   fskit_route_snapshot_unref( core->routes );
+   core->routes = NULL;
+
+   fskit_dcache_free( core->dcache );
+   core->dcache = NULL;
+
+   fskit_pcache_free( core->pcache );
+   core->pcache = NULL;
+
+   fskit_listcache_free( core->listcache );
+   core->listcache = NULL;
+
+   if( core->epoch != NULL ) {
+
+      // run all deferred frees; there are no readers left.
+      // fskit_entry_destroy left the root's lock for us.
+      fskit_epoch_free( core->epoch );
+      core->epoch = NULL;
+
+      pthread_rwlock_destroy( &core->root.lock );
+   }
    
+   // NOTE: this frees any entries and handles that are still allocated
+   fskit_slab_destroy( &core->entry_slab );
+   fskit_slab_destroy( &core->set_slab );
+   fskit_slab_destroy( &core->handle_slab );
+
    fs_data = core->app_fs_data;
    core->app_fs_data = NULL;
 
    pthread_rwlock_destroy( &core->lock );
    pthread_rwlock_destroy( &core->route_lock );
+   pthread_mutex_destroy( &core->route_update_lock );
+
+   for( int i = 0; i < FSKIT_ROUTE_LOCK_STRIPES; i++ ) {
+      pthread_mutex_destroy( &core->route_stripes[i].u.lock );
+   }
 
    if( app_fs_data != NULL ) {
       *app_fs_data = fs_data;
@@ -607,7 +1314,6 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
    // here to avoid deadlock.
 
    int rc = 0;
-   int cbrc = 0;
 
    // queue immediate children for destruction
    if( dir_children != NULL ) {
@@ -619,7 +1325,22 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
       }
    }
 
-   while( ctx->size > 0 && rc == 0 ) {
+   // if all went well, then ctx's queues will be empty
+   return fskit_detach_ctx_reap( core, ctx, UINT64_MAX, NULL );
+}
+
+
+// unlink and garbage-collect up to max of the entries queued in ctx, in the order they were queued
+// (their children get queued behind them).  Same rules and errors as fskit_detach_all_ex.
+// if num_reaped is not NULL, add the number of entries processed to it.
+// return 0 on success, even if entries remain queued
+int fskit_detach_ctx_reap( struct fskit_core* core, struct fskit_detach_ctx* ctx, uint64_t max, uint64_t* num_reaped ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   uint64_t count = 0;
+
+   while( ctx->size > 0 && rc == 0 && count < max ) {
 
       // reap unlinked children
       struct fskit_detach_entry* next = ctx->head;
@@ -658,10 +1379,12 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
       
       // mark this entry for garbage-collection.
       // it was detached from exactly one parent by this method.
-      fent->link_count--;
+      __atomic_sub_fetch( &fent->link_count, 1, __ATOMIC_SEQ_CST );
       
       if( fent->type == FSKIT_ENTRY_TYPE_DIR ) {
+         FSKIT_ENTRY_WRITE_BEGIN( fent );
          fent->deletion_in_progress = true;
+         FSKIT_ENTRY_WRITE_END( fent );
       }
       
       // maybe this entry is fully unref'ed...
@@ -694,16 +1417,30 @@ int fskit_detach_all_ex( struct fskit_core* core, char const* dir_path, fskit_en
       // consumed!
       ctx->head = ctx->head->next;
       ctx->size--;
+      count++;
+
+      if( ctx->head == NULL ) {
+         ctx->tail = NULL;
+      }
       
       fskit_safe_free( next->path );
       fskit_safe_free( next );
    }
 
-   // if all went well, then ctx's queues will be empty
+   if( num_reaped != NULL ) {
+      *num_reaped += count;
+   }
+
    return rc;
 }
 
 
+// how many entries are still queued in a detach context?
+uint64_t fskit_detach_ctx_size( struct fskit_detach_ctx* ctx ) {
+   return ctx->size;
+}
+
+
 // create a detach context 
 struct fskit_detach_ctx* fskit_detach_ctx_new() {
    return CALLOC_LIST( struct fskit_detach_ctx, 1 );
@@ -769,6 +1506,9 @@ int fskit_detach_all( struct fskit_core* core, char const* root_path ) {
        fskit_detach_ctx_free( &ctx );
        return rc;
    }
+
+   // everything below root_path is about to go away
+   fskit_core_dcache_invalidate( core );
    
    // swap out the children, and mark this directory as garbage-collectable
    rc = fskit_entry_tag_garbage( dent, &dir_children );
@@ -895,19 +1635,90 @@ struct fskit_entry* fskit_core_resolve_root( struct fskit_core* core, bool write
    }
 }
 
-// allocate an fskit entry 
+// set the number of children at which the root directory's child set gets a hash index.
+// directories created afterwards inherit the threshold from their parent.
+// pass FSKIT_ENTRY_SET_HASH_NEVER to never index.
+// return 0 on success
+// return -ENOENT if the root is deleted
+// return -ENOMEM on OOM
+int fskit_core_dir_hash_threshold( struct fskit_core* core, unsigned int threshold ) {
+
+   int rc = 0;
+   struct fskit_entry* root = fskit_core_resolve_root( core, true );
+
+   if( root == NULL ) {
+      return -ENOENT;
+   }
+
+   rc = fskit_entry_set_hash_threshold( root->children, threshold );
+
+   fskit_entry_unlock( root );
+   return rc;
+}
+
+// allocate an fskit entry on the heap
+// it must be freed with fskit_entry_free
 struct fskit_entry* fskit_entry_new(void) {
    return CALLOC_LIST( struct fskit_entry, 1 );
 }
 
+// allocate a zeroed fskit entry from the core's slab.
+// it must be freed with fskit_entry_free
+struct fskit_entry* fskit_entry_new_ex( struct fskit_core* core ) {
+
+   struct fskit_entry* fent = (struct fskit_entry*)fskit_slab_alloc( &core->entry_slab );
+   if( fent != NULL ) {
+      fent->from_slab = true;
+   }
+
+   return fent;
+}
+
+// free a destroyed entry once optimistic readers are done with it
+static void fskit_entry_free_deferred( void* slab, void* ptr ) {
+
+   struct fskit_entry* fent = (struct fskit_entry*)ptr;
+
+   // fskit_entry_destroy left this for us, since readers may have been about to lock it
+   pthread_rwlock_destroy( &fent->lock );
+
+   if( fent->from_slab ) {
+      fskit_slab_free( (struct fskit_slab*)slab, fent );
+   }
+   else {
+      fskit_safe_free( fent );
+   }
+}
+
+// free an fskit entry allocated with fskit_entry_new or fskit_entry_new_ex.
+// it must have been destroyed already.
+// if optimistic lookups are enabled, this happens once no reader can be looking at it.
+void fskit_entry_free( struct fskit_core* core, struct fskit_entry* fent ) {
+
+   if( core->epoch != NULL ) {
+      fskit_epoch_defer( core->epoch, fskit_entry_free_deferred, &core->entry_slab, fent );
+   }
+   else if( fent->from_slab ) {
+      fskit_slab_free( &core->entry_slab, fent );
+   }
+   else {
+      fskit_safe_free( fent );
+   }
+}
+
 // initialize an fskit entry
 // this method does not fail.
 int fskit_entry_init_lowlevel( struct fskit_entry* fent, uint8_t type, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode ) {
 
    int rc = 0;
+   bool from_slab = fent->from_slab;
 
    memset( fent, 0, sizeof(struct fskit_entry) );
 
+   // keep track of where it came from, so fskit_entry_free can release it
+   fent->from_slab = from_slab;
+   fskit_entry_bump_data_gen( fent );
+
    fent->type = type;
    fent->file_id = file_id;
    fent->owner = owner;
@@ -962,14 +1773,15 @@ int fskit_entry_init_file( struct fskit_entry* fent, uint64_t file_id, uint64_t
 }
 
 
-// high-level initializer: make a directory
+// high-level initializer: make a directory whose children's directory entries come from core's slab
+// (or from the heap, if core is NULL)
 // return 0 on success
 // return -ENOMEM on OOM
-int fskit_entry_init_dir( struct fskit_entry* fent, struct fskit_entry* parent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode ) {
+int fskit_entry_init_dir_ex( struct fskit_core* core, struct fskit_entry* fent, struct fskit_entry* parent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode ) {
 
    int rc = 0;
    
-   fskit_entry_set* children = fskit_entry_set_new( fent, parent );
+   fskit_entry_set* children = fskit_entry_set_new_ex( core, fent, parent );
    if( children == NULL ) {
       return -ENOMEM;
    }
@@ -977,14 +1789,27 @@ int fskit_entry_init_dir( struct fskit_entry* fent, struct fskit_entry* parent,
    rc = fskit_entry_init_common( fent, FSKIT_ENTRY_TYPE_DIR, file_id, owner, group, mode );
    if( rc != 0 ) {
       fskit_error("fskit_entry_init_common(%" PRIX64 ") rc = %d\n", file_id, rc );
-      fskit_safe_free( children );
+      fskit_entry_set_free( children );
       return rc;
    }
 
+   // inherit the parent's indexing policy
+   if( parent != fent && parent->children != NULL ) {
+      fskit_entry_set_hash_threshold( children, parent->children->head->hash_threshold );
+   }
+
    fent->children = children;
+   fskit_entry_bump_children_gen( fent );
    return 0;
 }
 
+// high-level initializer: make a directory
+// return 0 on success
+// return -ENOMEM on OOM
+int fskit_entry_init_dir( struct fskit_entry* fent, struct fskit_entry* parent, uint64_t file_id, uint64_t owner, uint64_t group, mode_t mode ) {
+   return fskit_entry_init_dir_ex( NULL, fent, parent, file_id, owner, group, mode );
+}
+
 // high-level initializer: make a fifo
 // return 0 on success
 // return -ENOMEM on OOM
@@ -1176,6 +2001,8 @@ int fskit_entry_destroy( struct fskit_core* core, struct fskit_entry* fent, bool
       fskit_entry_wlock( fent );
    }
 
+   FSKIT_ENTRY_WRITE_BEGIN( fent );
+
    fent->type = FSKIT_ENTRY_TYPE_DEAD;      // next thread to hold this lock knows this is a dead entry
 
    // free common fields
@@ -1184,6 +2011,8 @@ int fskit_entry_destroy( struct fskit_core* core, struct fskit_entry* fent, bool
       fent->children = NULL;
    }
 
+   FSKIT_ENTRY_WRITE_END( fent );
+
    if( fent->symlink_target != NULL ) {
       fskit_safe_free( fent->symlink_target );
       fent->symlink_target = NULL;
@@ -1193,13 +2022,27 @@ int fskit_entry_destroy( struct fskit_core* core, struct fskit_entry* fent, bool
       fskit_xattr_set_free( fent->xattrs );
       fent->xattrs = NULL;
    }
-   
+
+   if( fent->route_cache != NULL ) {
+      fskit_route_cache_free( fent->route_cache );
+      fent->route_cache = NULL;
+   }
+
+   if( fent->range_lock != NULL ) {
+      fskit_range_lock_free( fent->range_lock );
+      fent->range_lock = NULL;
+   }
+
    (*core->fskit_inode_free)( fent->file_id, core->app_fs_data );
   
    if( needlock ) { 
        fskit_entry_unlock( fent );
    }
-   pthread_rwlock_destroy( &fent->lock );
+
+   // with optimistic lookups, a reader may be about to lock this entry; fskit_entry_free destroys the lock instead
+   if( core->epoch == NULL ) {
+      pthread_rwlock_destroy( &fent->lock );
+   }
 
    return 0;
 }
@@ -1216,7 +2059,7 @@ static int fskit_entry_try_destroy( struct fskit_core* core, char const* fs_path
    int rc = 0;
    uint64_t file_id = 0;
 
-   if( fent->link_count <= 0 && fent->open_count <= 0 ) {
+   if( FSKIT_ENTRY_LINK_COUNT( fent ) <= 0 && FSKIT_ENTRY_OPEN_COUNT( fent ) <= 0 ) {
 
       if( fent->link_count < 0 ) {
          fskit_error("BUG: entry %p has a negative link count (%d)\n", fent, fent->link_count );
@@ -1231,6 +2074,10 @@ static int fskit_entry_try_destroy( struct fskit_core* core, char const* fs_path
       // do the detach--nothing references it anymore
       // but, we should ref it ourselves, so this method won't succeed in another thread.
       fent->open_count++;
+
+      // make sure no cached path can lead to fent once we unlock it
+      fskit_core_dcache_invalidate( core );
+
       file_id = fent->file_id;
       fskit_entry_unlock( fent );
      
@@ -1262,7 +2109,7 @@ int fskit_entry_try_destroy_and_free_ex( struct fskit_core* core, char const* fs
    if( rc > 0 ) {
       
       // fent was unlocked and destroyed
-      fskit_safe_free( fent );
+      fskit_entry_free( core, fent );
    }
 
    return rc;
@@ -1503,10 +2350,32 @@ void fskit_entry_set_file_id( struct fskit_entry* ent, uint64_t file_id ) {
    ent->file_id = file_id;
 }
 
+// source of directory children generations, shared by all directories so that
+// a generation never repeats, even if a directory's inode number gets reused.
+static uint64_t fskit_children_gen = 0;
+
+// note that a directory's children have changed, so listings taken before now are stale
+// ent must be write-locked (or not yet visible)
+void fskit_entry_bump_children_gen( struct fskit_entry* ent ) {
+   ent->children_gen = __atomic_add_fetch( &fskit_children_gen, 1, __ATOMIC_RELAXED );
+}
+
+// source of data generations, shared by all inodes so that a generation never repeats,
+// even if an inode number gets reused (so the page cache never needs to drop a destroyed inode's blocks).
+static uint64_t fskit_data_gen = 0;
+
+// note that a file's data has changed, so blocks cached before now are stale
+void fskit_entry_bump_data_gen( struct fskit_entry* ent ) {
+   __atomic_store_n( &ent->data_gen, __atomic_add_fetch( &fskit_data_gen, 1, __ATOMIC_RELAXED ), __ATOMIC_RELEASE );
+}
+
 // put a new set of children in place 
 fskit_entry_set* fskit_entry_swap_children( struct fskit_entry* ent, fskit_entry_set* new_children ) {
    fskit_entry_set* old_children = ent->children;
+   FSKIT_ENTRY_WRITE_BEGIN( ent );
    ent->children = new_children;
+   fskit_entry_bump_children_gen( ent );
+   FSKIT_ENTRY_WRITE_END( ent );
    return old_children;
 }
 
@@ -1564,18 +2433,24 @@ int fskit_entry_tag_garbage( struct fskit_entry* ent, fskit_entry_set** children
             return -EIO;
         }
         
-        fskit_entry_set* empty_children = fskit_entry_set_new( ent, parent );
+        fskit_entry_set* empty_children = fskit_entry_set_new_ex( ent->children->head->core, ent, parent );
         if( empty_children == NULL ) {
             
             // OOM 
             return -ENOMEM;
         }
         
+        // keep the directory's indexing policy
+        fskit_entry_set_hash_threshold( empty_children, ent->children->head->hash_threshold );
+        
         // do the swap 
+        FSKIT_ENTRY_WRITE_BEGIN( ent );
         *children = ent->children;
         ent->children = empty_children;
         ent->num_children = 0;
         ent->deletion_in_progress = true;
+        fskit_entry_bump_children_gen( ent );
+        FSKIT_ENTRY_WRITE_END( ent );
     }
     return 0;
 }
@@ -1650,10 +2525,18 @@ uint64_t fskit_entry_get_group( struct fskit_entry* ent ) {
    return ent->group;
 }
  
-// get atime (ent must be read-locked)
+// get atime, including any read time not yet folded in (ent must be read-locked)
 void fskit_entry_get_atime( struct fskit_entry* ent, int64_t* atime_sec, int32_t* atime_nsec ) {
+
+   int64_t pending = __atomic_load_n( &ent->atime_pending_ns, __ATOMIC_RELAXED );
+
    *atime_sec = ent->atime_sec;
    *atime_nsec = ent->atime_nsec;
+
+   if( pending > *atime_sec * 1000000000LL + *atime_nsec ) {
+      *atime_sec = pending / 1000000000LL;
+      *atime_nsec = (int32_t)(pending % 1000000000LL);
+   }
 }
  
 // get mtime (ent must be read-locked)
@@ -1685,7 +2568,7 @@ mode_t fskit_entry_get_mode( struct fskit_entry* ent ) {
 
 // get link count 
 int32_t fskit_entry_get_link_count( struct fskit_entry* ent ) {
-   return ent->link_count;
+   return FSKIT_ENTRY_LINK_COUNT( ent );
 }
 
 // get number of children.  if this is not a directory, return -1
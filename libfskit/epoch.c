@@ -0,0 +1,425 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/epoch.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// number of pending frees at which we try to advance the epoch and reclaim
+#define FSKIT_EPOCH_RECLAIM_BATCH 64
+
+// a thread's view of the epoch.
+// state is (epoch << 1) | 1 while the thread is in a read-side critical section, and 0 otherwise.
+struct fskit_epoch_thread {
+
+   uint64_t state;
+   bool in_use;                 // false once the thread has exited; the record can be reused
+
+   // only written by the owning thread
+   uint64_t lookups;
+   uint64_t fallbacks;
+
+   struct fskit_epoch_thread* next;
+};
+
+// a free that is waiting for readers to finish
+struct fskit_epoch_deferred {
+
+   uint64_t epoch;              // global epoch when the object was retired
+   fskit_epoch_free_func free_func;
+   void* cls;
+   void* ptr;
+
+   struct fskit_epoch_deferred* next;
+};
+
+// epoch-based reclamation.
+// Readers announce the global epoch when they start walking lockless, and clear it when done.
+// The global epoch only advances once every active reader has seen the current one,
+// so an object retired in epoch e cannot be reachable by any reader once the global epoch is e + 2.
+struct fskit_epoch {
+
+   uint64_t global;
+
+   pthread_key_t thread_key;
+   struct fskit_epoch_thread* threads;          // all thread records ever registered (reused on thread exit)
+
+   // oldest first
+   struct fskit_epoch_deferred* deferred_head;
+   struct fskit_epoch_deferred* deferred_tail;
+   uint64_t num_deferred;
+
+   // statistics
+   uint64_t deferred;
+   uint64_t reclaimed;
+
+   // statistics from records of threads that have exited
+   uint64_t exited_lookups;
+   uint64_t exited_fallbacks;
+
+   // lock governing access to the above fields, except global (which is atomic)
+   pthread_mutex_t lock;
+};
+
+
+// release a thread's record when it exits
+static void fskit_epoch_thread_release( void* arg ) {
+
+   struct fskit_epoch_thread* rec = (struct fskit_epoch_thread*)arg;
+
+   __atomic_store_n( &rec->state, 0, __ATOMIC_SEQ_CST );
+   __atomic_store_n( &rec->in_use, false, __ATOMIC_SEQ_CST );
+}
+
+
+// get the calling thread's record, registering it if need be
+// return NULL on OOM
+static struct fskit_epoch_thread* fskit_epoch_thread_get( struct fskit_epoch* epoch ) {
+
+   struct fskit_epoch_thread* rec = (struct fskit_epoch_thread*)pthread_getspecific( epoch->thread_key );
+   bool expected = false;
+
+   if( rec != NULL ) {
+      return rec;
+   }
+
+   pthread_mutex_lock( &epoch->lock );
+
+   // reuse an exited thread's record
+   for( rec = epoch->threads; rec != NULL; rec = rec->next ) {
+
+      expected = false;
+      if( __atomic_compare_exchange_n( &rec->in_use, &expected, true, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) {
+
+         // fold its counts into the totals
+         epoch->exited_lookups += rec->lookups;
+         epoch->exited_fallbacks += rec->fallbacks;
+         rec->lookups = 0;
+         rec->fallbacks = 0;
+         break;
+      }
+   }
+
+   if( rec == NULL ) {
+
+      rec = CALLOC_LIST( struct fskit_epoch_thread, 1 );
+      if( rec == NULL ) {
+         pthread_mutex_unlock( &epoch->lock );
+         return NULL;
+      }
+
+      rec->in_use = true;
+      rec->next = epoch->threads;
+      __atomic_store_n( &epoch->threads, rec, __ATOMIC_SEQ_CST );
+   }
+
+   pthread_mutex_unlock( &epoch->lock );
+
+   pthread_setspecific( epoch->thread_key, rec );
+   return rec;
+}
+
+
+// enable optimistic (lockless) path lookups on a core.
+// intermediate directories are walked without locks, using per-entry sequence counters to
+// detect concurrent changes; on conflict, the lookup falls back to hand-over-hand locking.
+// once enabled, inodes and directory entries are freed only after all lockless readers are done with them.
+// call this after fskit_core_init, before the core is used.
+// return 0 on success
+// return -EEXIST if already enabled
+// return -ENOMEM on OOM
+// return -EAGAIN if we're out of thread-specific data keys
+int fskit_core_epoch_enable( struct fskit_core* core ) {
+
+   int rc = 0;
+   struct fskit_epoch* epoch = CALLOC_LIST( struct fskit_epoch, 1 );
+
+   if( epoch == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = pthread_key_create( &epoch->thread_key, fskit_epoch_thread_release );
+   if( rc != 0 ) {
+      fskit_safe_free( epoch );
+      return -EAGAIN;
+   }
+
+   epoch->global = 1;
+   pthread_mutex_init( &epoch->lock, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->epoch != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_epoch_free( epoch );
+      return -EEXIST;
+   }
+
+   __atomic_store_n( &core->epoch, epoch, __ATOMIC_SEQ_CST );
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// get optimistic lookup statistics
+// return 0 on success
+// return -ENOSYS if optimistic lookups are not enabled
+int fskit_core_epoch_stats( struct fskit_core* core, struct fskit_epoch_stats* stats ) {
+
+   struct fskit_epoch* epoch = core->epoch;
+   struct fskit_epoch_thread* rec = NULL;
+
+   if( epoch == NULL ) {
+      return -ENOSYS;
+   }
+
+   memset( stats, 0, sizeof(struct fskit_epoch_stats) );
+
+   pthread_mutex_lock( &epoch->lock );
+
+   stats->lookups = epoch->exited_lookups;
+   stats->fallbacks = epoch->exited_fallbacks;
+
+   for( rec = epoch->threads; rec != NULL; rec = rec->next ) {
+      stats->lookups += __atomic_load_n( &rec->lookups, __ATOMIC_RELAXED );
+      stats->fallbacks += __atomic_load_n( &rec->fallbacks, __ATOMIC_RELAXED );
+   }
+
+   stats->deferred = epoch->deferred;
+   stats->reclaimed = epoch->reclaimed;
+
+   pthread_mutex_unlock( &epoch->lock );
+
+   return 0;
+}
+
+
+// enter a read-side critical section: nothing retired from now on will be freed until we leave.
+// return the thread's record on success (pass it to fskit_epoch_exit)
+// return NULL on OOM
+struct fskit_epoch_thread* fskit_epoch_enter( struct fskit_epoch* epoch ) {
+
+   struct fskit_epoch_thread* rec = fskit_epoch_thread_get( epoch );
+   uint64_t global = 0;
+
+   if( rec == NULL ) {
+      return NULL;
+   }
+
+   global = __atomic_load_n( &epoch->global, __ATOMIC_SEQ_CST );
+   __atomic_store_n( &rec->state, (global << 1) | 1, __ATOMIC_SEQ_CST );
+
+   // our announcement must be visible before we read anything shared
+   __atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+   return rec;
+}
+
+
+// leave a read-side critical section, and record whether or not the lookup succeeded
+void fskit_epoch_exit( struct fskit_epoch_thread* rec, bool fallback ) {
+
+   if( fallback ) {
+      __atomic_store_n( &rec->fallbacks, rec->fallbacks + 1, __ATOMIC_RELAXED );
+   }
+   else {
+      __atomic_store_n( &rec->lookups, rec->lookups + 1, __ATOMIC_RELAXED );
+   }
+
+   __atomic_store_n( &rec->state, 0, __ATOMIC_RELEASE );
+}
+
+
+// try to advance the global epoch, and detach the list of frees that are now safe.
+// epoch must be locked
+// return the list of safe frees (oldest first), which the caller must run
+static struct fskit_epoch_deferred* fskit_epoch_collect( struct fskit_epoch* epoch ) {
+
+   uint64_t global = __atomic_load_n( &epoch->global, __ATOMIC_SEQ_CST );
+   uint64_t state = 0;
+   bool can_advance = true;
+   struct fskit_epoch_thread* rec = NULL;
+   struct fskit_epoch_deferred* ret = NULL;
+   struct fskit_epoch_deferred* last = NULL;
+
+   for( rec = epoch->threads; rec != NULL; rec = rec->next ) {
+
+      state = __atomic_load_n( &rec->state, __ATOMIC_SEQ_CST );
+      if( (state & 1) && (state >> 1) != global ) {
+
+         // someone is still in an older epoch
+         can_advance = false;
+         break;
+      }
+   }
+
+   if( can_advance ) {
+      global++;
+      __atomic_store_n( &epoch->global, global, __ATOMIC_SEQ_CST );
+   }
+
+   // everything retired two or more epochs ago is unreachable
+   while( epoch->deferred_head != NULL && epoch->deferred_head->epoch + 2 <= global ) {
+
+      if( ret == NULL ) {
+         ret = epoch->deferred_head;
+      }
+
+      last = epoch->deferred_head;
+      epoch->deferred_head = last->next;
+      epoch->num_deferred--;
+      epoch->reclaimed++;
+   }
+
+   if( last != NULL ) {
+      last->next = NULL;
+   }
+
+   if( epoch->deferred_head == NULL ) {
+      epoch->deferred_tail = NULL;
+   }
+
+   return ret;
+}
+
+
+// run and free a list of deferred frees
+static void fskit_epoch_run( struct fskit_epoch_deferred* list ) {
+
+   struct fskit_epoch_deferred* next = NULL;
+
+   while( list != NULL ) {
+
+      next = list->next;
+      (*list->free_func)( list->cls, list->ptr );
+      fskit_safe_free( list );
+      list = next;
+   }
+}
+
+
+// free ptr with free_func( cls, ptr ) once no lockless reader can be looking at it.
+// the caller must have already made ptr unreachable.
+// NOTE: the caller must not be in a read-side critical section
+void fskit_epoch_defer( struct fskit_epoch* epoch, fskit_epoch_free_func free_func, void* cls, void* ptr ) {
+
+   struct fskit_epoch_deferred* def = CALLOC_LIST( struct fskit_epoch_deferred, 1 );
+   struct fskit_epoch_deferred* ready = NULL;
+
+   if( def == NULL ) {
+
+      // out of memory--wait for readers instead
+      fskit_epoch_synchronize( epoch );
+      (*free_func)( cls, ptr );
+      return;
+   }
+
+   def->free_func = free_func;
+   def->cls = cls;
+   def->ptr = ptr;
+
+   pthread_mutex_lock( &epoch->lock );
+
+   def->epoch = __atomic_load_n( &epoch->global, __ATOMIC_SEQ_CST );
+
+   if( epoch->deferred_tail != NULL ) {
+      epoch->deferred_tail->next = def;
+   }
+   else {
+      epoch->deferred_head = def;
+   }
+
+   epoch->deferred_tail = def;
+   epoch->num_deferred++;
+   epoch->deferred++;
+
+   if( epoch->num_deferred >= FSKIT_EPOCH_RECLAIM_BATCH ) {
+      ready = fskit_epoch_collect( epoch );
+   }
+
+   pthread_mutex_unlock( &epoch->lock );
+
+   fskit_epoch_run( ready );
+}
+
+
+// wait until every reader that is currently in a read-side critical section has left it,
+// and run all frees that were deferred before this call.
+// NOTE: the caller must not be in a read-side critical section
+void fskit_epoch_synchronize( struct fskit_epoch* epoch ) {
+
+   struct fskit_epoch_deferred* ready = NULL;
+   uint64_t target = __atomic_load_n( &epoch->global, __ATOMIC_SEQ_CST ) + 2;
+
+   while( true ) {
+
+      pthread_mutex_lock( &epoch->lock );
+
+      ready = fskit_epoch_collect( epoch );
+
+      if( __atomic_load_n( &epoch->global, __ATOMIC_SEQ_CST ) >= target && epoch->deferred_head == NULL ) {
+
+         pthread_mutex_unlock( &epoch->lock );
+         fskit_epoch_run( ready );
+         break;
+      }
+
+      pthread_mutex_unlock( &epoch->lock );
+
+      fskit_epoch_run( ready );
+      sched_yield();
+   }
+}
+
+
+// free an epoch reclaimer, running all pending frees.
+// NOTE: there can be no readers
+int fskit_epoch_free( struct fskit_epoch* epoch ) {
+
+   struct fskit_epoch_thread* rec = NULL;
+
+   if( epoch == NULL ) {
+      return 0;
+   }
+
+   // no readers, so everything pending is safe
+   fskit_epoch_run( epoch->deferred_head );
+   epoch->deferred_head = NULL;
+   epoch->deferred_tail = NULL;
+
+   pthread_key_delete( epoch->thread_key );
+
+   while( epoch->threads != NULL ) {
+
+      rec = epoch->threads;
+      epoch->threads = rec->next;
+      fskit_safe_free( rec );
+   }
+
+   pthread_mutex_destroy( &epoch->lock );
+   fskit_safe_free( epoch );
+
+   return 0;
+}
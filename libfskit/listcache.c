@@ -0,0 +1,436 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include <fskit/listcache.h>
+#include <fskit/readdir.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// number of hash buckets in a listing cache (power of two)
+#define FSKIT_LISTCACHE_BUCKETS 1024
+
+// an immutable listing of a whole directory, as packed records.
+// shared by the cache and by every reader that got it; freed when the last reference goes away.
+struct fskit_dir_snapshot {
+
+   uint64_t file_id;            // directory's inode number
+   char* path;                  // path the directory was listed at (routes match paths)
+   uint64_t gen;                // directory's children generation when the listing was taken
+   uint64_t route_gen;          // route table generation when the listing was taken
+
+   char* records;               // packed struct fskit_dir_record records, with next set to 0
+   size_t len;
+   uint64_t count;
+
+   int32_t refcount;            // atomic
+
+   // cache linkage (protected by the cache's lock)
+   struct fskit_dir_snapshot* hash_next;
+   struct fskit_dir_snapshot* lru_prev;
+   struct fskit_dir_snapshot* lru_next;
+};
+
+// cache of directory listings, with at most one snapshot per directory.
+// a snapshot is only served while its directory's children generation, the route table
+// generation, and the directory's path are the ones it was taken at, so it never needs to be invalidated;
+// stale ones are dropped when found, or aged out by the LRU.
+struct fskit_listcache {
+
+   struct fskit_dir_snapshot* buckets[ FSKIT_LISTCACHE_BUCKETS ];
+
+   // most recently used at the head
+   struct fskit_dir_snapshot* lru_head;
+   struct fskit_dir_snapshot* lru_tail;
+
+   size_t max_bytes;
+   size_t bytes;
+   uint64_t num_snapshots;
+
+   // lock governing access to the above fields (hits reorder the LRU, so there are no readers)
+   pthread_mutex_t lock;
+
+   // statistics (updated atomically)
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t evictions;
+};
+
+
+// bytes a snapshot counts against the cache's bound
+static size_t fskit_dir_snapshot_size( struct fskit_dir_snapshot* snapshot ) {
+   return sizeof(struct fskit_dir_snapshot) + strlen( snapshot->path ) + 1 + snapshot->len;
+}
+
+// hash bucket for a directory
+static struct fskit_dir_snapshot** fskit_listcache_bucket( struct fskit_listcache* listcache, uint64_t file_id ) {
+   return &listcache->buckets[ (file_id * 0x9E3779B97F4A7C15ULL) >> 54 ];
+}
+
+
+// make a snapshot of a directory's listing, which takes ownership of records (malloc'ed).
+// the caller gets the only reference.
+// return the snapshot on success
+// return NULL on OOM, in which case records is freed
+struct fskit_dir_snapshot* fskit_dir_snapshot_new( uint64_t file_id, char const* path, uint64_t gen, uint64_t route_gen, char* records, size_t len ) {
+
+   struct fskit_dir_record* rec = NULL;
+   struct fskit_dir_snapshot* snapshot = CALLOC_LIST( struct fskit_dir_snapshot, 1 );
+
+   if( snapshot == NULL ) {
+      fskit_safe_free( records );
+      return NULL;
+   }
+
+   snapshot->path = strdup( path );
+   if( snapshot->path == NULL ) {
+
+      fskit_safe_free( records );
+      free( snapshot );
+      return NULL;
+   }
+
+   snapshot->file_id = file_id;
+   snapshot->gen = gen;
+   snapshot->route_gen = route_gen;
+   snapshot->records = records;
+   snapshot->len = len;
+   snapshot->refcount = 1;
+
+   for( rec = fskit_dir_record_next( records, len, NULL ); rec != NULL; rec = fskit_dir_record_next( records, len, rec ) ) {
+      snapshot->count++;
+   }
+
+   return snapshot;
+}
+
+
+// release a reference to a directory listing snapshot, freeing it if it was the last one
+void fskit_dir_snapshot_unref( struct fskit_dir_snapshot* snapshot ) {
+
+   if( snapshot == NULL ) {
+      return;
+   }
+
+   if( __atomic_sub_fetch( &snapshot->refcount, 1, __ATOMIC_ACQ_REL ) > 0 ) {
+      return;
+   }
+
+   fskit_safe_free( snapshot->records );
+   fskit_safe_free( snapshot->path );
+   free( snapshot );
+}
+
+
+// iterate over a snapshot's records, in the order fskit_readdir would return them.
+// pass NULL for rec to get the first record.
+// the records must not be modified; their next cookies are 0.
+// return the record after rec, or NULL if there are no more
+struct fskit_dir_record const* fskit_dir_snapshot_next( struct fskit_dir_snapshot const* snapshot, struct fskit_dir_record const* rec ) {
+   return fskit_dir_record_next( snapshot->records, snapshot->len, (struct fskit_dir_record*)rec );
+}
+
+
+// how many records are in a snapshot?
+uint64_t fskit_dir_snapshot_count( struct fskit_dir_snapshot const* snapshot ) {
+   return snapshot->count;
+}
+
+
+// unlink a snapshot from the cache, and drop the cache's reference to it
+// listcache must be locked
+static void fskit_listcache_remove( struct fskit_listcache* listcache, struct fskit_dir_snapshot* snapshot ) {
+
+   struct fskit_dir_snapshot** pp = fskit_listcache_bucket( listcache, snapshot->file_id );
+
+   while( *pp != snapshot ) {
+      pp = &(*pp)->hash_next;
+   }
+
+   *pp = snapshot->hash_next;
+
+   if( snapshot->lru_prev != NULL ) {
+      snapshot->lru_prev->lru_next = snapshot->lru_next;
+   }
+   else {
+      listcache->lru_head = snapshot->lru_next;
+   }
+
+   if( snapshot->lru_next != NULL ) {
+      snapshot->lru_next->lru_prev = snapshot->lru_prev;
+   }
+   else {
+      listcache->lru_tail = snapshot->lru_prev;
+   }
+
+   snapshot->hash_next = NULL;
+   snapshot->lru_prev = NULL;
+   snapshot->lru_next = NULL;
+
+   listcache->bytes -= fskit_dir_snapshot_size( snapshot );
+   listcache->num_snapshots--;
+
+   fskit_dir_snapshot_unref( snapshot );
+}
+
+
+// put a cached snapshot at the head of the LRU
+// listcache must be locked
+static void fskit_listcache_touch( struct fskit_listcache* listcache, struct fskit_dir_snapshot* snapshot ) {
+
+   if( listcache->lru_head == snapshot ) {
+      return;
+   }
+
+   // unlink (it isn't the head, so it has a predecessor)
+   snapshot->lru_prev->lru_next = snapshot->lru_next;
+
+   if( snapshot->lru_next != NULL ) {
+      snapshot->lru_next->lru_prev = snapshot->lru_prev;
+   }
+   else {
+      listcache->lru_tail = snapshot->lru_prev;
+   }
+
+   // push
+   snapshot->lru_prev = NULL;
+   snapshot->lru_next = listcache->lru_head;
+   listcache->lru_head->lru_prev = snapshot;
+   listcache->lru_head = snapshot;
+}
+
+
+// find a directory's cached snapshot in its bucket
+// listcache must be locked
+static struct fskit_dir_snapshot* fskit_listcache_find( struct fskit_listcache* listcache, uint64_t file_id ) {
+
+   struct fskit_dir_snapshot* snapshot = NULL;
+
+   for( snapshot = *fskit_listcache_bucket( listcache, file_id ); snapshot != NULL; snapshot = snapshot->hash_next ) {
+
+      if( snapshot->file_id == file_id ) {
+         break;
+      }
+   }
+
+   return snapshot;
+}
+
+
+// enable the directory listing cache on a core, holding at most max_bytes of listings.
+// pass 0 for FSKIT_LISTCACHE_DEFAULT_MAX_BYTES.
+// call this after fskit_core_init, before the core is used.
+// the cache is freed by fskit_core_destroy.
+// return 0 on success
+// return -EEXIST if the cache is already enabled
+// return -ENOMEM on OOM
+int fskit_core_listcache_enable( struct fskit_core* core, size_t max_bytes ) {
+
+   struct fskit_listcache* listcache = NULL;
+
+   if( max_bytes == 0 ) {
+      max_bytes = FSKIT_LISTCACHE_DEFAULT_MAX_BYTES;
+   }
+
+   listcache = CALLOC_LIST( struct fskit_listcache, 1 );
+   if( listcache == NULL ) {
+      return -ENOMEM;
+   }
+
+   listcache->max_bytes = max_bytes;
+
+   pthread_mutex_init( &listcache->lock, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->listcache != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_listcache_free( listcache );
+      return -EEXIST;
+   }
+
+   core->listcache = listcache;
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// free a directory listing cache.
+// snapshots still referenced by readers live on until they're released.
+// always succeeds
+int fskit_listcache_free( struct fskit_listcache* listcache ) {
+
+   if( listcache == NULL ) {
+      return 0;
+   }
+
+   while( listcache->lru_head != NULL ) {
+      fskit_listcache_remove( listcache, listcache->lru_head );
+   }
+
+   pthread_mutex_destroy( &listcache->lock );
+
+   free( listcache );
+   return 0;
+}
+
+
+// get directory listing cache statistics
+// return 0 on success
+// return -ENOSYS if the cache is disabled
+int fskit_core_listcache_stats( struct fskit_core* core, struct fskit_listcache_stats* stats ) {
+
+   struct fskit_listcache* listcache = core->listcache;
+
+   if( listcache == NULL ) {
+      return -ENOSYS;
+   }
+
+   stats->hits = __atomic_load_n( &listcache->hits, __ATOMIC_RELAXED );
+   stats->misses = __atomic_load_n( &listcache->misses, __ATOMIC_RELAXED );
+   stats->evictions = __atomic_load_n( &listcache->evictions, __ATOMIC_RELAXED );
+
+   pthread_mutex_lock( &listcache->lock );
+
+   stats->snapshots = listcache->num_snapshots;
+   stats->bytes = listcache->bytes;
+
+   pthread_mutex_unlock( &listcache->lock );
+
+   return 0;
+}
+
+
+// look up a directory's listing at path, as of its children generation gen and route table generation route_gen.
+// a stale snapshot of the directory is dropped.
+// return a new reference to the snapshot on a hit
+// return NULL on a miss, or if the cache is disabled
+struct fskit_dir_snapshot* fskit_listcache_lookup( struct fskit_core* core, uint64_t file_id, char const* path, uint64_t gen, uint64_t route_gen ) {
+
+   struct fskit_listcache* listcache = core->listcache;
+   struct fskit_dir_snapshot* snapshot = NULL;
+
+   if( listcache == NULL ) {
+      return NULL;
+   }
+
+   pthread_mutex_lock( &listcache->lock );
+
+   snapshot = fskit_listcache_find( listcache, file_id );
+   if( snapshot != NULL ) {
+
+      if( snapshot->gen == gen && snapshot->route_gen == route_gen && strcmp( snapshot->path, path ) == 0 ) {
+
+         __atomic_add_fetch( &snapshot->refcount, 1, __ATOMIC_RELAXED );
+         fskit_listcache_touch( listcache, snapshot );
+      }
+      else if( snapshot->gen <= gen && snapshot->route_gen <= route_gen ) {
+
+         // out of date
+         fskit_listcache_remove( listcache, snapshot );
+         snapshot = NULL;
+      }
+      else {
+
+         // the caller is the one out of date
+         snapshot = NULL;
+      }
+   }
+
+   pthread_mutex_unlock( &listcache->lock );
+
+   if( snapshot != NULL ) {
+      __atomic_fetch_add( &listcache->hits, 1, __ATOMIC_RELAXED );
+   }
+   else {
+      __atomic_fetch_add( &listcache->misses, 1, __ATOMIC_RELAXED );
+   }
+
+   return snapshot;
+}
+
+
+// cache a directory's snapshot, replacing any older one, and evicting the least-recently-used
+// snapshots until the cache is back within its bound.
+// the cache takes its own reference.
+// does nothing if the cache is disabled, if the snapshot is larger than the whole cache,
+// or if a newer snapshot of the directory is already cached.
+// always succeeds
+int fskit_listcache_insert( struct fskit_core* core, struct fskit_dir_snapshot* snapshot ) {
+
+   struct fskit_listcache* listcache = core->listcache;
+   struct fskit_dir_snapshot* old = NULL;
+   struct fskit_dir_snapshot** bucket = NULL;
+
+   if( listcache == NULL || fskit_dir_snapshot_size( snapshot ) > listcache->max_bytes ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &listcache->lock );
+
+   old = fskit_listcache_find( listcache, snapshot->file_id );
+   if( old != NULL ) {
+
+      if( old->gen > snapshot->gen || old->route_gen > snapshot->route_gen ) {
+
+         // raced with someone who listed the directory more recently
+         pthread_mutex_unlock( &listcache->lock );
+         return 0;
+      }
+
+      fskit_listcache_remove( listcache, old );
+   }
+
+   __atomic_add_fetch( &snapshot->refcount, 1, __ATOMIC_RELAXED );
+
+   bucket = fskit_listcache_bucket( listcache, snapshot->file_id );
+   snapshot->hash_next = *bucket;
+   *bucket = snapshot;
+
+   snapshot->lru_prev = NULL;
+   snapshot->lru_next = listcache->lru_head;
+
+   if( listcache->lru_head != NULL ) {
+      listcache->lru_head->lru_prev = snapshot;
+   }
+   else {
+      listcache->lru_tail = snapshot;
+   }
+
+   listcache->lru_head = snapshot;
+
+   listcache->bytes += fskit_dir_snapshot_size( snapshot );
+   listcache->num_snapshots++;
+
+   while( listcache->bytes > listcache->max_bytes ) {
+
+      fskit_listcache_remove( listcache, listcache->lru_tail );
+      __atomic_fetch_add( &listcache->evictions, 1, __ATOMIC_RELAXED );
+   }
+
+   pthread_mutex_unlock( &listcache->lock );
+
+   return 0;
+}
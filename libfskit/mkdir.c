@@ -111,7 +111,7 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
    if( child == NULL ) {
 
       // create an fskit_entry and attach it
-      child = CALLOC_LIST( struct fskit_entry, 1 );
+      child = fskit_entry_new_ex( core );
       if( child == NULL ) {
          return -ENOMEM;
       }
@@ -123,17 +123,17 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
          // error in allocation
          fskit_error("fskit_core_inode_alloc(%s) failed\n", path );
 
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
 
          return -EIO;
       }
       
       // set up the directory
-      err = fskit_entry_init_dir( child, parent, child_inode, user, group, mode );
+      err = fskit_entry_init_dir_ex( core, child, parent, child_inode, user, group, mode );
       if( err != 0 ) {
-         fskit_error("fskit_entry_init_dir(%s) rc = %d\n", path, err );
+         fskit_error("fskit_entry_init_dir_ex(%s) rc = %d\n", path, err );
 
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
          return err;
       }
 
@@ -151,7 +151,7 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
          fskit_error("fskit_run_user_mkdir(%s) rc = %d\n", path, err );
 
          fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
       }
       else {
 
@@ -172,10 +172,10 @@ static int fskit_mkdir_lowlevel( struct fskit_core* core, char const* path, stru
 }
 
 
-// create a directory
+// create a directory, resolving its parent from dir (whose path is dir_path) if possible, and from root otherwise
 // return -ENOTDIR if one of the elements on the path isn't a directory
 // return -EACCES if one of the directories is not searchable
-int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+static int fskit_mkdir_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
 
    int err = 0;
 
@@ -196,7 +196,7 @@ int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint
 
    fskit_safe_free( fpath );
 
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, &err );
+   struct fskit_entry* parent = fskit_entry_resolve_path_in( core, dir, dir_path, path_dirname, user, group, true, &err );
 
    if( parent == NULL || err ) {
 
@@ -245,6 +245,35 @@ int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint
 }
 
 
+// create a directory
+// return -ENOTDIR if one of the elements on the path isn't a directory
+// return -EACCES if one of the directories is not searchable
+int fskit_mkdir_ex( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group, void* cls ) {
+   return fskit_mkdir_in( core, NULL, NULL, path, mode, user, group, cls );
+}
+
+
+// create a directory at a path relative to an open directory, without re-resolving the directory from root.
+// routes see the directory's path joined with path.
+// return the same errors as fskit_mkdir, and -ENOMEM on OOM
+int fskit_mkdirat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, mode_t mode, uint64_t user, uint64_t group ) {
+
+   int rc = 0;
+   struct fskit_entry* dir = NULL;
+   char const* dir_path = NULL;
+   char* full_path = fskit_path_at( dirh, path, &dir, &dir_path );
+
+   if( full_path == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_mkdir_in( core, dir, dir_path, full_path, mode, user, group, NULL );
+
+   fskit_safe_free( full_path );
+   return rc;
+}
+
+
 // like fskit_mkdir_ex, but with a NULL cls 
 int fskit_mkdir( struct fskit_core* core, char const* path, mode_t mode, uint64_t user, uint64_t group ) {
    return fskit_mkdir_ex( core, path, mode, user, group, NULL );
@@ -145,7 +145,7 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
       }
    }
 
-   child = CALLOC_LIST( struct fskit_entry, 1 );
+   child = fskit_entry_new_ex( core );
 
    mode_t mmode = 0;
    char const* method_name = NULL;
@@ -197,7 +197,7 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
       fskit_entry_unlock( parent );
       fskit_safe_free( path_basename );
       fskit_entry_destroy( core, child, false );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
       fskit_safe_free( path );
 
       return -EINVAL;
@@ -214,7 +214,7 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
          fskit_entry_unlock( parent );
          fskit_safe_free( path_basename );
          fskit_entry_destroy( core, child, false );
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
          fskit_safe_free( path );
 
          return -EIO;
@@ -238,7 +238,7 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
          fskit_entry_unlock( parent );
          fskit_safe_free( path_basename );
          fskit_entry_destroy( core, child, true );
-         fskit_safe_free( child );
+         fskit_entry_free( core, child );
          fskit_safe_free( path );
 
          return err;
@@ -254,7 +254,7 @@ int fskit_mknod_ex( struct fskit_core* core, char const* fs_path, mode_t mode, d
    else {
       fskit_error("%s(%s) rc = %d\n", method_name, path, err );
       fskit_entry_destroy( core, child, false );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
    }
 
    fskit_entry_unlock( parent );
@@ -33,7 +33,7 @@
 // ent must be read-locked, or otherwise un-writable
 static struct fskit_file_handle* fskit_file_handle_create( struct fskit_core* core, struct fskit_entry* ent, char const* opened_path, int flags, void* handle_data ) {
 
-   struct fskit_file_handle* fh = CALLOC_LIST( struct fskit_file_handle, 1 );
+   struct fskit_file_handle* fh = (struct fskit_file_handle*)fskit_slab_alloc( &core->handle_slab );
 
    if( fh == NULL ) {
       return NULL;
@@ -46,6 +46,7 @@ static struct fskit_file_handle* fskit_file_handle_create( struct fskit_core* co
    fh->app_data = handle_data;
 
    pthread_rwlock_init( &fh->lock, NULL );
+   pthread_mutex_init( &fh->ra.lock, NULL );
 
    return fh;
 }
@@ -141,7 +142,7 @@ int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry
    fskit_entry_wlock( child );
    
    // sanity check
-   if( child->link_count == 0 || child->deletion_in_progress || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( FSKIT_ENTRY_LINK_COUNT( child ) == 0 || child->deletion_in_progress || child->type == FSKIT_ENTRY_TYPE_DEAD ) {
       rc = -ENOENT;
    }
 
@@ -194,10 +195,11 @@ int fskit_do_open( struct fskit_core* core, char const* path, struct fskit_entry
 }
 
 
-// create/open a file, with the given flags and (if creating) mode
+// create/open a file, with the given flags and (if creating) mode.
+// resolve its parent from dir (whose path is dir_path) if possible, and from root otherwise.
 // on success, return a file handle to the created/opened file.
 // on failure, return NULL and set *err to the appropriate errno
-struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err ) {
+static struct fskit_file_handle* fskit_open_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err ) {
 
    if( fskit_check_flags( flags ) != 0 ) {
       *err = -EINVAL;
@@ -237,7 +239,7 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
    struct fskit_file_handle* ret = NULL;
 
    // write-lock parent--we need to ensure that the child does not disappear on us between attaching it and routing the user-given callback
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, user, group, true, err );
+   struct fskit_entry* parent = fskit_entry_resolve_path_in( core, dir, dir_path, path_dirname, user, group, true, err );
 
    if( parent == NULL ) {
 
@@ -343,7 +345,7 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
 
       // run user truncate
       // NOTE: do *not* lock it--it has to be unlocked for running user-given routes
-      rc = fskit_run_user_trunc( core, path, child, 0, NULL );
+      rc = fskit_run_user_trunc( core, path, child, 0, NULL, NULL );
       if( rc != 0 ) {
 
          // truncate failed
@@ -387,6 +389,36 @@ struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* _p
 }
 
 
+// create/open a file, with the given flags and (if creating) mode
+// on success, return a file handle to the created/opened file.
+// on failure, return NULL and set *err to the appropriate errno
+struct fskit_file_handle* fskit_open_ex( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, void* cls, int* err ) {
+   return fskit_open_in( core, NULL, NULL, path, user, group, flags, mode, cls, err );
+}
+
+
+// open a file at a path relative to an open directory, without re-resolving the directory from root.
+// the handle's path (and the path routes see) is the directory's path joined with path.
+// return the same errors as fskit_open, and -ENOMEM on OOM
+struct fskit_file_handle* fskit_openat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err ) {
+
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* dir = NULL;
+   char const* dir_path = NULL;
+   char* full_path = fskit_path_at( dirh, path, &dir, &dir_path );
+
+   if( full_path == NULL ) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   fh = fskit_open_in( core, dir, dir_path, full_path, user, group, flags, mode, NULL, err );
+
+   fskit_safe_free( full_path );
+   return fh;
+}
+
+
 // fskit_open() without the cls (used only by creat)
 struct fskit_file_handle* fskit_open( struct fskit_core* core, char const* _path, uint64_t user, uint64_t group, int flags, mode_t mode, int* err ) {
    return fskit_open_ex( core, _path, user, group, flags, mode, NULL, err );
@@ -20,6 +20,7 @@
 */
 
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 #include <fskit/util.h>
 
 #include "fskit_private/private.h"
@@ -269,6 +270,136 @@ void fskit_sanitize_path( char* path ) {
    }
 }
 
+// find the next name in a path, starting at *path_off.
+// '/' separators and '.' names are skipped.
+// on success, set *name_len, advance *path_off past the name, and return a pointer to the (non-NUL-terminated) name within path.
+// return NULL if there are no more names.
+static char const* fskit_path_next_name( char const* path, size_t* path_off, size_t* name_len ) {
+
+   size_t i = *path_off;
+   size_t start = 0;
+
+   while( true ) {
+
+      // skip '/'
+      while( path[i] == '/' ) {
+         i++;
+      }
+
+      if( path[i] == '\0' ) {
+
+         // out of path
+         *path_off = i;
+         *name_len = 0;
+         return NULL;
+      }
+
+      start = i;
+      while( path[i] != '/' && path[i] != '\0' ) {
+         i++;
+      }
+
+      if( i - start == 1 && path[start] == '.' ) {
+         // skip '.'
+         continue;
+      }
+
+      *path_off = i;
+      *name_len = i - start;
+      return path + start;
+   }
+}
+
+// resolve an absolute path without locking any intermediate directories.
+// each directory's sequence counter is read before and re-checked after looking up the next name in it,
+// and the epoch keeps everything we look at from being freed in the meantime.
+// only the last entry is locked, and without blocking (we must not sleep in the epoch).
+// return the locked entry on success
+// return NULL if the lookup has to be retried with locks (including on any error, so the locked walk can report it)
+static struct fskit_entry* fskit_entry_resolve_path_optimistic( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock ) {
+
+   struct fskit_epoch_thread* rec = NULL;
+   struct fskit_entry* cur_ent = &core->root;
+   struct fskit_entry* next_ent = NULL;
+   uint32_t cur_seq = 0;
+   uint32_t next_seq = 0;
+   char const* name = NULL;
+   size_t name_len = 0;
+   size_t path_off = 0;
+   int rc = 0;
+
+   rec = fskit_epoch_enter( core->epoch );
+   if( rec == NULL ) {
+      return NULL;
+   }
+
+   cur_seq = FSKIT_ENTRY_SEQ( cur_ent );
+
+   while( true ) {
+
+      if( (cur_seq & 1) != 0 || FSKIT_ENTRY_LINK_COUNT( cur_ent ) <= 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD || cur_ent->deletion_in_progress ) {
+         // being changed, or going away
+         goto fallback;
+      }
+
+      // every directory on the path has to be searchable, including the last one, as in the locked walk
+      if( cur_ent->type == FSKIT_ENTRY_TYPE_DIR && !FSKIT_ENTRY_IS_DIR_SEARCHABLE( cur_ent->mode, cur_ent->owner, cur_ent->group, user, group ) ) {
+         goto fallback;
+      }
+
+      name = fskit_path_next_name( path, &path_off, &name_len );
+      if( name == NULL ) {
+         break;
+      }
+
+      if( cur_ent->type != FSKIT_ENTRY_TYPE_DIR ) {
+         goto fallback;
+      }
+
+      next_ent = fskit_entry_set_find_name_optimistic( __atomic_load_n( &cur_ent->children, __ATOMIC_ACQUIRE ), name, name_len );
+      if( next_ent == NULL ) {
+         goto fallback;
+      }
+
+      next_seq = FSKIT_ENTRY_SEQ( next_ent );
+
+      // was cur_ent changed while we searched it?
+      __atomic_thread_fence( __ATOMIC_ACQUIRE );
+      if( FSKIT_ENTRY_SEQ( cur_ent ) != cur_seq ) {
+         goto fallback;
+      }
+
+      cur_ent = next_ent;
+      cur_seq = next_seq;
+   }
+
+   if( writelock ) {
+      rc = pthread_rwlock_trywrlock( &cur_ent->lock );
+   }
+   else {
+      rc = pthread_rwlock_tryrdlock( &cur_ent->lock );
+   }
+
+   if( rc != 0 ) {
+      goto fallback;
+   }
+
+   // still the entry we found?
+   if( FSKIT_ENTRY_SEQ( cur_ent ) != cur_seq || FSKIT_ENTRY_LINK_COUNT( cur_ent ) <= 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+
+      fskit_entry_unlock( cur_ent );
+      goto fallback;
+   }
+
+   fskit_epoch_exit( rec, false );
+   return cur_ent;
+
+fallback:
+
+   fskit_epoch_exit( rec, true );
+   return NULL;
+}
+
 // Run the eval function on cur_ent.  The ent_eval callback should return 0 to indicate successful processing, and non-zero to indicate error.
 // This method returns the return code of the ent_eval callback regardless.
 // The ent_eval callback may *NOT* free an inode's memory.
@@ -288,62 +419,106 @@ static int fskit_entry_ent_eval( struct fskit_entry* prev_ent, struct fskit_entr
    return eval_rc;
 }
 
-// resolve an absolute path, running a given function on each entry as the path is walked
+// resolve a path, starting from dir (or from root, if dir is NULL), running a given function on each entry as the path is walked.
+// dir must be referenced and unlocked; path is taken relative to it (an empty path refers to dir itself).
 // returns the locked fskit_entry at the end of the path on success
-struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+static struct fskit_entry* fskit_entry_resolve_path_from( struct fskit_core* core, struct fskit_entry* dir, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+
+   // names are scanned in place: each one is a (pointer, length) slice of path
+   char const* name = NULL;
+   size_t name_len = 0;
+   size_t path_off = 0;
+   uint64_t dcache_gen = 0;
+   struct fskit_entry* cur_ent = NULL;
+   struct fskit_entry* prev_ent = NULL;
+
+   if( dir != NULL ) {
 
-   // if this path ends in '/', then append a '.'
-   char* fpath = NULL;
-   if( strlen(path) == 0 ) {
+      // resolve relative to dir, which has to be a live directory
+      name = fskit_path_next_name( path, &path_off, &name_len );
+
+      if( writelock && name == NULL ) {
+         *err = fskit_entry_wlock( dir );
+      }
+      else {
+         *err = fskit_entry_rlock( dir );
+      }
+
+      if( *err != 0 ) {
+         // dead
+         *err = -ENOENT;
+         return NULL;
+      }
+
+      if( FSKIT_ENTRY_LINK_COUNT( dir ) == 0 || dir->deletion_in_progress ) {
+         fskit_entry_unlock( dir );
+         *err = -ENOENT;
+         return NULL;
+      }
+
+      cur_ent = dir;
+      goto walk;
+   }
+
+   if( path[0] == '\0' ) {
       *err = -EINVAL;
       return NULL;
    }
 
-   if( path[strlen(path)-1] == '/' ) {
-      fpath = fskit_fullpath( path, ".", NULL );
-   }
-   else {
-      fpath = strdup( path );
+   // try the dentry cache first, if we don't need to visit each entry
+   if( ent_eval == NULL && core->dcache != NULL ) {
 
-      if( fpath == NULL ) {
-         *err = -ENOMEM;
-         return NULL;
+      struct fskit_entry* cached_ent = fskit_dcache_lookup( core, path, user, group, writelock, &dcache_gen );
+      if( cached_ent != NULL ) {
+
+         *err = 0;
+         return cached_ent;
       }
    }
 
-   char* tmp = NULL;
+   // try walking without locks, if we don't need to visit each entry
+   if( ent_eval == NULL && core->epoch != NULL ) {
+
+      struct fskit_entry* found_ent = fskit_entry_resolve_path_optimistic( core, path, user, group, writelock );
+      if( found_ent != NULL ) {
 
-   char* name = strtok_r( fpath, "/", &tmp );
-   while( name != NULL && strcmp(name, ".") == 0 ) {
-      name = strtok_r( NULL, "/", &tmp );
+         *err = 0;
+         return found_ent;
+      }
    }
 
+   name = fskit_path_next_name( path, &path_off, &name_len );
+
    // if name == NULL, then root was requested.
-   struct fskit_entry* cur_ent = fskit_core_resolve_root( core, (writelock && name == NULL) );
-   struct fskit_entry* prev_ent = NULL;
+   cur_ent = fskit_core_resolve_root( core, (writelock && name == NULL) );
 
-   if( cur_ent->link_count == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( cur_ent == NULL ) {
+      // root is being detached
+      *err = -ENOENT;
+      return NULL;
+   }
+
+   if( FSKIT_ENTRY_LINK_COUNT( cur_ent ) == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
       // filesystem was nuked
-      fskit_safe_free( fpath );
       fskit_entry_unlock( cur_ent );
       *err = -ENOENT;
       return NULL;
    }
 
-   // run our evaluator on the root entry (which is already locked)
+walk:
+
+   // run our evaluator on the first entry (which is already locked)
    if( ent_eval ) {
       
       int eval_rc = fskit_entry_ent_eval( prev_ent, cur_ent, ent_eval, cls );
       if( eval_rc != 0 ) {
          *err = eval_rc;
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
          return NULL;
       }
       
       if( cur_ent->deletion_in_progress || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD ) {
          // no longer exists 
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
          *err = -ENOENT;
          return NULL;
@@ -361,7 +536,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
             *err = -ENOENT;
          }
 
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
 
          return NULL;
@@ -375,7 +549,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
 
          // the appropriate read flag is not set
          *err = -EACCES;
-         fskit_safe_free( fpath );
          fskit_entry_unlock( cur_ent );
 
          return NULL;
@@ -394,13 +567,12 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
 
             // not a directory
             *err = -ENOTDIR;
-            fskit_safe_free( fpath );
             fskit_entry_unlock( prev_ent );
 
             return NULL;
          }
          else {
-            cur_ent = fskit_entry_set_find_name( prev_ent->children, name );
+            cur_ent = fskit_entry_set_find_name_len( prev_ent->children, name, name_len );
          }
       }
       else {
@@ -413,7 +585,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
          
          // not found
          *err = -ENOENT;
-         fskit_safe_free( fpath );
          fskit_entry_unlock( prev_ent );
 
          return NULL;
@@ -421,10 +592,7 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       else {
 
          // next path name
-         name = strtok_r( NULL, "/", &tmp );
-         while( name != NULL && strcmp(name, ".") == 0 ) {
-            name = strtok_r( NULL, "/", &tmp );
-         }
+         name = fskit_path_next_name( path, &path_off, &name_len );
 
          // keep to the locking discipline
          if( writelock ) {
@@ -444,21 +612,17 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
                fskit_entry_unlock( prev_ent );
 
                *err = eval_rc;
-               fskit_safe_free( fpath );
-
                return NULL;
             }
          }
 
-         if( cur_ent->link_count == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD || cur_ent->deletion_in_progress ) {
+         if( FSKIT_ENTRY_LINK_COUNT( cur_ent ) == 0 || cur_ent->type == FSKIT_ENTRY_TYPE_DEAD || cur_ent->deletion_in_progress ) {
             
             // just got removed
             fskit_entry_unlock( cur_ent );
             fskit_entry_unlock( prev_ent );
 
             *err = -ENOENT;
-            fskit_safe_free( fpath );
-
             return NULL;
          }
 
@@ -466,7 +630,6 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       }
    } while( true );
 
-   fskit_safe_free( fpath );
    if( name == NULL ) {
       // ran out of path
       *err = 0;
@@ -484,6 +647,12 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
       }
       */
       
+      if( dir == NULL && ent_eval == NULL && core->dcache != NULL ) {
+
+         // remember this for next time (fails harmlessly if the namespace changed while we walked)
+         fskit_dcache_insert( core, path, user, group, dcache_gen, cur_ent );
+      }
+
       return cur_ent;
    }
    else {
@@ -494,12 +663,70 @@ struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char
    }
 }
 
+// resolve an absolute path, running a given function on each entry as the path is walked
+// returns the locked fskit_entry at the end of the path on success
+struct fskit_entry* fskit_entry_resolve_path_cls( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err, int (*ent_eval)( struct fskit_entry*, void* ), void* cls ) {
+   return fskit_entry_resolve_path_from( core, NULL, path, user, group, writelock, err, ent_eval, cls );
+}
+
 // resolve an absolute path.
 // returns the locked fskit_entry at the end of the path on success
 struct fskit_entry* fskit_entry_resolve_path( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int* err ) {
    return fskit_entry_resolve_path_cls( core, path, user, group, writelock, err, NULL, NULL );
 }
 
+// resolve a path that was made by joining dir_path (dir's path) with a relative path, walking from dir instead of from root.
+// if path does not start with dir_path, or dir is NULL, it is resolved from root.
+// dir must be referenced and unlocked.
+// returns the locked fskit_entry at the end of the path on success
+struct fskit_entry* fskit_entry_resolve_path_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* path, uint64_t user, uint64_t group, bool writelock, int* err ) {
+
+   size_t dir_path_len = 0;
+
+   if( dir != NULL ) {
+
+      dir_path_len = strlen( dir_path );
+
+      // the rest of path must start at a name boundary
+      if( strncmp( path, dir_path, dir_path_len ) == 0 && (path[dir_path_len] == '/' || path[dir_path_len] == '\0' || (dir_path_len > 0 && dir_path[dir_path_len-1] == '/')) ) {
+         return fskit_entry_resolve_path_from( core, dir, path + dir_path_len, user, group, writelock, err, NULL, NULL );
+      }
+   }
+
+   return fskit_entry_resolve_path( core, path, user, group, writelock, err );
+}
+
+// resolve a path relative to an open directory, without walking from root.
+// absolute paths are resolved from root, as are all paths if dirh is NULL.
+// the same permission and liveness checks as fskit_entry_resolve_path apply to dirh's directory and everything below it.
+// returns the locked fskit_entry at the end of the path on success
+struct fskit_entry* fskit_entry_resolve_path_at( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, bool writelock, int* err ) {
+
+   if( dirh == NULL || path[0] == '/' ) {
+      return fskit_entry_resolve_path( core, path, user, group, writelock, err );
+   }
+
+   return fskit_entry_resolve_path_from( core, dirh->dent, path, user, group, writelock, err, NULL, NULL );
+}
+
+// join an open directory's path with a path relative to it, for operations that name a path relative to a directory.
+// if dirh is NULL or path is absolute, path is used as-is.
+// on success, set *dir to the directory to resolve from (NULL for root), *dir_path to its path, and return the full path (which must be freed).
+// return NULL on OOM
+char* fskit_path_at( struct fskit_dir_handle* dirh, char const* path, struct fskit_entry** dir, char const** dir_path ) {
+
+   if( dirh == NULL || path[0] == '/' ) {
+
+      *dir = NULL;
+      *dir_path = NULL;
+      return strdup_or_null( path );
+   }
+
+   *dir = dirh->dent;
+   *dir_path = dirh->path;
+   return fskit_fullpath( dirh->path, path, NULL );
+}
+
 
 // start iterating on a path 
 // return an iterator, or NULL if OOM
@@ -521,7 +748,7 @@ struct fskit_path_iterator* fskit_path_begin( struct fskit_core* core, char cons
    }
    
    // is root dead?
-   if( root->link_count == 0 || root->type == FSKIT_ENTRY_TYPE_DEAD ) {
+   if( FSKIT_ENTRY_LINK_COUNT( root ) == 0 || root->type == FSKIT_ENTRY_TYPE_DEAD ) {
       
       fskit_entry_unlock( root );
       ret->rc = -ENOENT;
@@ -572,7 +799,7 @@ bool fskit_path_end( struct fskit_path_iterator* itr ) {
 
 // advance the path iterator to the next entry in the path.
 // set itr->rc to -ENOTDIR if we encounter a file before running out of path
-// set itr->rc to -ENOMEM if we're OOM 
+// set itr->rc to -ENAMETOOLONG if a name in the path is too long
 // set itr->rc to -ENOENT if the named entry does not exist in the filesystem
 void fskit_path_next( struct fskit_path_iterator* itr ) {
    
@@ -581,7 +808,6 @@ void fskit_path_next( struct fskit_path_iterator* itr ) {
    
    size_t len = 0;
    size_t name_len = 0;
-   char* next_name = NULL;
    
    if( itr->end_of_path ) {
       return;
@@ -666,27 +892,21 @@ void fskit_path_next( struct fskit_path_iterator* itr ) {
       return;
    }
    
-   next_name = CALLOC_LIST( char, name_len + 1 );
-   if( next_name == NULL ) {
-      
-      // OOM!
-      itr->rc = -ENOMEM;
+   if( name_len > FSKIT_FILESYSTEM_NAMEMAX ) {
+
+      itr->rc = -ENAMETOOLONG;
       return;
    }
-   
-   strncpy( next_name, name_candidate, name_len );
-   
+
    // advance name (and path length considered)
    itr->name = tmp;
    itr->name_i += len;
    
    memset( itr->cur_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
-   strncpy( itr->cur_name, name_candidate, name_len );
+   memcpy( itr->cur_name, name_candidate, name_len );
    
    // look up the next entry in prev_ent 
-   itr->cur_ent = fskit_entry_set_find_name( itr->prev_ent->children, next_name );
-   
-   fskit_safe_free( next_name );
+   itr->cur_ent = fskit_entry_set_find_name_len( itr->prev_ent->children, name_candidate, name_len );
    
    if( itr->cur_ent == NULL ) {
       
@@ -788,72 +1008,80 @@ char* fskit_path_iterator_name( struct fskit_path_iterator* itr ) {
 // reference an fskit_entry 
 // resolve it, increment its open count, unlock it, and return a pointer to it.
 // this is meant to prevent the fskit_entry from getting freed, but without locking it.
+// only takes shared locks.
 // return the pointer on success
 // return NULL on error, and set *rc to the error code (i.e. from resolving the path)
 struct fskit_entry* fskit_entry_ref( struct fskit_core* core, char const* fs_path, int* rc ) {
    
    struct fskit_entry* fent = NULL;
    
-   fent = fskit_entry_resolve_path( core, fs_path, 0, 0, true, rc );
+   fent = fskit_entry_resolve_path( core, fs_path, 0, 0, false, rc );
    if( fent == NULL ) {
       
       return NULL;
    }
    
-   fent->open_count++;
+   fskit_entry_ref_entry( fent );
    fskit_entry_unlock( fent );
    
    return fent;
 }
 
-// reference a write-locked entry 
+// reference a locked entry 
+// the open count is atomic, so a read lock is enough.
 // always succeeds
 int fskit_entry_ref_entry( struct fskit_entry* fent ) {
-   fent->open_count++;
+   __atomic_add_fetch( &fent->open_count, 1, __ATOMIC_SEQ_CST );
    return 0;
 }
 
 // unreference an fskit_entry 
 // decrement the open counter, and optionally delete it if it is fully unreferenced.
+// only takes a read lock, unless this drops the last reference to an unlinked entry.
 // return 0 on success
 // return negative on error (from the user-given detach route)
 // NOTE: fent must *not* be locked!
 int fskit_entry_unref( struct fskit_core* core, char const* fs_path, struct fskit_entry* fent ) {
    
    int rc = 0;
+   int32_t open_count = 0;
+   int32_t link_count = 0;
    
-   fskit_entry_wlock( fent );
+   fskit_entry_rlock( fent );
    
-   fent->open_count--;
+   open_count = __atomic_sub_fetch( &fent->open_count, 1, __ATOMIC_SEQ_CST );
+   link_count = FSKIT_ENTRY_LINK_COUNT( fent );
    
-   if( fent->open_count <= 0 && fent->link_count <= 0 ) {
-      
-      // blow it away 
-      rc = fskit_entry_try_destroy_and_free( core, fs_path, NULL, fent );
+   fskit_entry_unlock( fent );
 
-      if( rc < 0 ) {
+   if( open_count > 0 || link_count > 0 ) {
+      return 0;
+   }
 
-         // some error occurred
-         fskit_error("fskit_entry_try_destroy_and_free(%p) rc = %d\n", fent, rc );
-         fskit_entry_unlock( fent );
+   // that was the last reference to an unlinked entry, so no one else can reach it now.
+   fskit_entry_wlock( fent );
 
-         return rc;
-      }
-      else if( rc == 0 ) {
+   // blow it away 
+   rc = fskit_entry_try_destroy_and_free( core, fs_path, NULL, fent );
 
-         // done with this entry--it's still exists
-         fskit_entry_unlock( fent );
-      }
-      else {
+   if( rc < 0 ) {
 
-         // destroyed and freed
-         rc = 0;
-      }
+      // some error occurred
+      fskit_error("fskit_entry_try_destroy_and_free(%p) rc = %d\n", fent, rc );
+      fskit_entry_unlock( fent );
+
+      return rc;
    }
-   else {
-      
+   else if( rc == 0 ) {
+
+      // done with this entry--it's still exists
       fskit_entry_unlock( fent );
    }
+   else {
+
+      // destroyed and freed
+      rc = 0;
+   }
    
    return rc;
 }
@@ -0,0 +1,833 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/pcache.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// lists a cached block can be on.
+// CLOCK only uses T1, as the clock; ARC uses all four.
+#define FSKIT_PCACHE_T1 0       // cached, and seen once recently
+#define FSKIT_PCACHE_T2 1       // cached, and seen at least twice recently
+#define FSKIT_PCACHE_B1 2       // ghosts of blocks evicted from T1 (no data)
+#define FSKIT_PCACHE_B2 3       // ghosts of blocks evicted from T2 (no data)
+#define FSKIT_PCACHE_NUM_LISTS 4
+
+// one block of one file, as of one data generation
+struct fskit_pcache_block {
+
+   uint64_t file_id;
+   uint64_t gen;
+   uint64_t idx;
+   uint64_t hash;
+
+   char* data;                  // NULL for ghosts
+   size_t len;                  // less than the block size at the end of the file
+
+   int list;                    // FSKIT_PCACHE_T1, etc.
+   int referenced;              // CLOCK reference bit (set under the read lock, so accessed atomically)
+
+   struct fskit_pcache_block* hash_next;
+
+   // circular list links
+   struct fskit_pcache_block* prev;
+   struct fskit_pcache_block* next;
+};
+
+// a circular list of blocks.
+// head is the most-recently-used block (ARC), or the clock hand (CLOCK); head->prev is the least-recently-used.
+struct fskit_pcache_list {
+
+   struct fskit_pcache_block* head;
+   size_t len;
+};
+
+// an independently-locked part of the cache, holding the blocks whose keys hash to it
+struct fskit_pcache_shard {
+
+   pthread_rwlock_t lock;
+
+   struct fskit_pcache_block** buckets;
+   size_t num_buckets;          // power of two
+
+   struct fskit_pcache_list lists[ FSKIT_PCACHE_NUM_LISTS ];
+
+   size_t capacity;             // most blocks with data
+   size_t p;                    // ARC's target length of T1
+};
+
+// cache of file blocks, keyed by (inode, data generation, block index).
+// writes and truncates bump the inode's data generation instead of finding and dropping its blocks;
+// the old blocks are never looked up again, and age out.  A destroyed inode's blocks age out the same way,
+// since no inode ever gets a data generation that another inode (or an earlier one with its number) had.
+struct fskit_pcache {
+
+   size_t block_size;
+   int policy;
+
+   struct fskit_pcache_shard shards[ FSKIT_PCACHE_SHARDS ];
+
+   // statistics (updated atomically)
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t evictions;
+   uint64_t invalidations;
+   uint64_t hit_ns;
+   uint64_t miss_ns;
+   uint64_t prefetched;
+};
+
+
+// hash a block key (splitmix64 finalizer over the mixed fields)
+static uint64_t fskit_pcache_hash( uint64_t file_id, uint64_t gen, uint64_t idx ) {
+
+   uint64_t h = file_id ^ (gen * 0x9E3779B97F4A7C15ULL) ^ (idx * 0xC2B2AE3D27D4EB4FULL);
+
+   h ^= h >> 30;
+   h *= 0xBF58476D1CE4E5B9ULL;
+   h ^= h >> 27;
+   h *= 0x94D049BB133111EBULL;
+   h ^= h >> 31;
+
+   return h;
+}
+
+// which shard a hash belongs to (the top bits, since the bottom bits pick the bucket)
+static struct fskit_pcache_shard* fskit_pcache_shard_of( struct fskit_pcache* pcache, uint64_t hash ) {
+   return &pcache->shards[ (hash >> 56) % FSKIT_PCACHE_SHARDS ];
+}
+
+// nanoseconds since some arbitrary point
+static uint64_t fskit_pcache_now_ns(void) {
+
+   struct timespec ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// unlink a block from its list
+static void fskit_pcache_list_remove( struct fskit_pcache_list* list, struct fskit_pcache_block* block ) {
+
+   if( block->next == block ) {
+      list->head = NULL;
+   }
+   else {
+
+      block->prev->next = block->next;
+      block->next->prev = block->prev;
+
+      if( list->head == block ) {
+         list->head = block->next;
+      }
+   }
+
+   block->prev = NULL;
+   block->next = NULL;
+   list->len--;
+}
+
+// put a block just behind the list's head (i.e. at the least-recently-used end, or just behind the clock hand)
+static void fskit_pcache_list_push_tail( struct fskit_pcache_list* list, struct fskit_pcache_block* block ) {
+
+   if( list->head == NULL ) {
+
+      block->prev = block;
+      block->next = block;
+      list->head = block;
+   }
+   else {
+
+      block->next = list->head;
+      block->prev = list->head->prev;
+      list->head->prev->next = block;
+      list->head->prev = block;
+   }
+
+   list->len++;
+}
+
+// put a block at the head of the list (i.e. make it the most-recently-used)
+static void fskit_pcache_list_push_head( struct fskit_pcache_list* list, struct fskit_pcache_block* block ) {
+
+   fskit_pcache_list_push_tail( list, block );
+   list->head = block;
+}
+
+// move a block to another list of the shard, as its most-recently-used block
+static void fskit_pcache_move( struct fskit_pcache_shard* shard, struct fskit_pcache_block* block, int list ) {
+
+   fskit_pcache_list_remove( &shard->lists[ block->list ], block );
+   fskit_pcache_list_push_head( &shard->lists[ list ], block );
+   block->list = list;
+}
+
+
+// find a block (or its ghost) in a shard
+// NOTE: shard must be locked
+static struct fskit_pcache_block* fskit_pcache_find( struct fskit_pcache_shard* shard, uint64_t hash, uint64_t file_id, uint64_t gen, uint64_t idx ) {
+
+   struct fskit_pcache_block* block = shard->buckets[ hash & (shard->num_buckets - 1) ];
+
+   while( block != NULL ) {
+
+      if( block->hash == hash && block->file_id == file_id && block->gen == gen && block->idx == idx ) {
+         return block;
+      }
+
+      block = block->hash_next;
+   }
+
+   return NULL;
+}
+
+// remove a block from its list and the hash table, and free it
+// NOTE: shard must be write-locked
+static void fskit_pcache_block_free( struct fskit_pcache_shard* shard, struct fskit_pcache_block* block ) {
+
+   struct fskit_pcache_block** prev = &shard->buckets[ block->hash & (shard->num_buckets - 1) ];
+
+   while( *prev != block ) {
+      prev = &(*prev)->hash_next;
+   }
+
+   *prev = block->hash_next;
+
+   fskit_pcache_list_remove( &shard->lists[ block->list ], block );
+
+   fskit_safe_free( block->data );
+   free( block );
+}
+
+// turn a cached block into a ghost on the given list
+// NOTE: shard must be write-locked
+static void fskit_pcache_block_evict( struct fskit_pcache* pcache, struct fskit_pcache_shard* shard, struct fskit_pcache_block* block, int ghost_list ) {
+
+   fskit_safe_free( block->data );
+   block->data = NULL;
+   block->len = 0;
+
+   fskit_pcache_move( shard, block, ghost_list );
+
+   __atomic_fetch_add( &pcache->evictions, 1, __ATOMIC_RELAXED );
+}
+
+
+// CLOCK: make room for one more block by sweeping the hand past referenced blocks, and evicting the first unreferenced one
+// NOTE: shard must be write-locked
+static void fskit_pcache_clock_evict( struct fskit_pcache* pcache, struct fskit_pcache_shard* shard ) {
+
+   struct fskit_pcache_list* clock = &shard->lists[ FSKIT_PCACHE_T1 ];
+   struct fskit_pcache_block* hand = clock->head;
+
+   while( __atomic_load_n( &hand->referenced, __ATOMIC_RELAXED ) ) {
+
+      // second chance
+      __atomic_store_n( &hand->referenced, 0, __ATOMIC_RELAXED );
+      hand = hand->next;
+   }
+
+   // the hand moves on to the victim's successor
+   clock->head = hand;
+   fskit_pcache_block_free( shard, hand );
+
+   __atomic_fetch_add( &pcache->evictions, 1, __ATOMIC_RELAXED );
+}
+
+// ARC: evict one cached block into its ghost list.
+// take it from T1 if T1 is over its target length (or at it, and the block being inserted was a B2 ghost), and from T2 otherwise.
+// NOTE: shard must be write-locked
+static void fskit_pcache_arc_replace( struct fskit_pcache* pcache, struct fskit_pcache_shard* shard, bool in_b2 ) {
+
+   struct fskit_pcache_list* t1 = &shard->lists[ FSKIT_PCACHE_T1 ];
+   struct fskit_pcache_list* t2 = &shard->lists[ FSKIT_PCACHE_T2 ];
+
+   if( t1->len > 0 && (t1->len > shard->p || (in_b2 && t1->len == shard->p) || t2->len == 0) ) {
+      fskit_pcache_block_evict( pcache, shard, t1->head->prev, FSKIT_PCACHE_B1 );
+   }
+   else if( t2->len > 0 ) {
+      fskit_pcache_block_evict( pcache, shard, t2->head->prev, FSKIT_PCACHE_B2 );
+   }
+}
+
+// ARC: insert a missed block, adapting T1's target length if it was a ghost.
+// NOTE: shard must be write-locked
+static void fskit_pcache_arc_insert( struct fskit_pcache* pcache, struct fskit_pcache_shard* shard, struct fskit_pcache_block* ghost, struct fskit_pcache_block* block ) {
+
+   struct fskit_pcache_list* lists = shard->lists;
+   size_t c = shard->capacity;
+   size_t delta = 0;
+   bool full = (lists[ FSKIT_PCACHE_T1 ].len + lists[ FSKIT_PCACHE_T2 ].len >= c);
+
+   if( ghost != NULL && ghost->list == FSKIT_PCACHE_B1 ) {
+
+      // T1 was too short; grow its target
+      delta = lists[ FSKIT_PCACHE_B2 ].len / lists[ FSKIT_PCACHE_B1 ].len;
+      shard->p = MIN( c, shard->p + (delta > 1 ? delta : 1) );
+
+      if( full ) {
+         fskit_pcache_arc_replace( pcache, shard, false );
+      }
+
+      // recently seen twice
+      ghost->data = block->data;
+      ghost->len = block->len;
+      fskit_pcache_move( shard, ghost, FSKIT_PCACHE_T2 );
+
+      free( block );
+      return;
+   }
+
+   if( ghost != NULL && ghost->list == FSKIT_PCACHE_B2 ) {
+
+      // T2 was too short; shrink T1's target
+      delta = lists[ FSKIT_PCACHE_B1 ].len / lists[ FSKIT_PCACHE_B2 ].len;
+      delta = (delta > 1 ? delta : 1);
+      shard->p = (shard->p > delta ? shard->p - delta : 0);
+
+      if( full ) {
+         fskit_pcache_arc_replace( pcache, shard, true );
+      }
+
+      ghost->data = block->data;
+      ghost->len = block->len;
+      fskit_pcache_move( shard, ghost, FSKIT_PCACHE_T2 );
+
+      free( block );
+      return;
+   }
+
+   // never seen
+   if( lists[ FSKIT_PCACHE_T1 ].len + lists[ FSKIT_PCACHE_B1 ].len >= c ) {
+
+      if( lists[ FSKIT_PCACHE_T1 ].len < c ) {
+
+         fskit_pcache_block_free( shard, lists[ FSKIT_PCACHE_B1 ].head->prev );
+
+         if( full ) {
+            fskit_pcache_arc_replace( pcache, shard, false );
+         }
+      }
+      else {
+
+         fskit_pcache_block_free( shard, lists[ FSKIT_PCACHE_T1 ].head->prev );
+         __atomic_fetch_add( &pcache->evictions, 1, __ATOMIC_RELAXED );
+      }
+   }
+   else if( full ) {
+
+      if( lists[ FSKIT_PCACHE_B2 ].len > 0 && lists[ FSKIT_PCACHE_T1 ].len + lists[ FSKIT_PCACHE_T2 ].len + lists[ FSKIT_PCACHE_B1 ].len + lists[ FSKIT_PCACHE_B2 ].len >= 2 * c ) {
+         fskit_pcache_block_free( shard, lists[ FSKIT_PCACHE_B2 ].head->prev );
+      }
+
+      fskit_pcache_arc_replace( pcache, shard, false );
+   }
+
+   block->list = FSKIT_PCACHE_T1;
+   fskit_pcache_list_push_head( &lists[ FSKIT_PCACHE_T1 ], block );
+}
+
+
+// is a block cached?  (doesn't count as a use of it)
+static bool fskit_pcache_has( struct fskit_pcache* pcache, uint64_t file_id, uint64_t gen, uint64_t idx ) {
+
+   uint64_t hash = fskit_pcache_hash( file_id, gen, idx );
+   struct fskit_pcache_shard* shard = fskit_pcache_shard_of( pcache, hash );
+   struct fskit_pcache_block* block = NULL;
+   bool ret = false;
+
+   pthread_rwlock_rdlock( &shard->lock );
+
+   block = fskit_pcache_find( shard, hash, file_id, gen, idx );
+   ret = (block != NULL && block->data != NULL);
+
+   pthread_rwlock_unlock( &shard->lock );
+
+   return ret;
+}
+
+// copy up to len bytes from offset off of a cached block into dest.
+// set *block_len to the length of the block.
+// return the number of bytes copied on a hit
+// return -ENOENT on a miss
+static ssize_t fskit_pcache_get( struct fskit_pcache* pcache, uint64_t file_id, uint64_t gen, uint64_t idx, char* dest, size_t off, size_t len, size_t* block_len ) {
+
+   uint64_t hash = fskit_pcache_hash( file_id, gen, idx );
+   struct fskit_pcache_shard* shard = fskit_pcache_shard_of( pcache, hash );
+   struct fskit_pcache_block* block = NULL;
+   ssize_t rc = -ENOENT;
+
+   // CLOCK hits only set the reference bit, so they can share the shard
+   if( pcache->policy == FSKIT_PCACHE_CLOCK ) {
+      pthread_rwlock_rdlock( &shard->lock );
+   }
+   else {
+      pthread_rwlock_wrlock( &shard->lock );
+   }
+
+   block = fskit_pcache_find( shard, hash, file_id, gen, idx );
+
+   if( block != NULL && block->data != NULL ) {
+
+      if( pcache->policy == FSKIT_PCACHE_CLOCK ) {
+
+         if( !__atomic_load_n( &block->referenced, __ATOMIC_RELAXED ) ) {
+            __atomic_store_n( &block->referenced, 1, __ATOMIC_RELAXED );
+         }
+      }
+      else {
+
+         fskit_pcache_move( shard, block, FSKIT_PCACHE_T2 );
+      }
+
+      rc = 0;
+      if( off < block->len ) {
+
+         rc = MIN( len, block->len - off );
+         memcpy( dest, block->data + off, rc );
+      }
+
+      *block_len = block->len;
+   }
+
+   pthread_rwlock_unlock( &shard->lock );
+
+   return rc;
+}
+
+// cache a block read from the read route.
+// the cache takes ownership of data (block_size bytes, of which len are valid).
+// always succeeds; if out of memory, or if another reader cached it first, data is just freed
+static void fskit_pcache_put( struct fskit_pcache* pcache, uint64_t file_id, uint64_t gen, uint64_t idx, char* data, size_t len ) {
+
+   uint64_t hash = fskit_pcache_hash( file_id, gen, idx );
+   struct fskit_pcache_shard* shard = fskit_pcache_shard_of( pcache, hash );
+   struct fskit_pcache_block* ghost = NULL;
+   struct fskit_pcache_block* block = CALLOC_LIST( struct fskit_pcache_block, 1 );
+
+   if( block == NULL ) {
+
+      fskit_safe_free( data );
+      return;
+   }
+
+   block->file_id = file_id;
+   block->gen = gen;
+   block->idx = idx;
+   block->hash = hash;
+   block->data = data;
+   block->len = len;
+
+   pthread_rwlock_wrlock( &shard->lock );
+
+   ghost = fskit_pcache_find( shard, hash, file_id, gen, idx );
+
+   if( ghost != NULL && ghost->data != NULL ) {
+
+      // raced with another reader
+      pthread_rwlock_unlock( &shard->lock );
+
+      fskit_safe_free( data );
+      free( block );
+      return;
+   }
+
+   if( pcache->policy == FSKIT_PCACHE_CLOCK ) {
+
+      if( shard->lists[ FSKIT_PCACHE_T1 ].len >= shard->capacity ) {
+         fskit_pcache_clock_evict( pcache, shard );
+      }
+
+      // new blocks go just behind the hand, so they get a full sweep before they're considered
+      block->list = FSKIT_PCACHE_T1;
+      fskit_pcache_list_push_tail( &shard->lists[ FSKIT_PCACHE_T1 ], block );
+   }
+   else {
+
+      fskit_pcache_arc_insert( pcache, shard, ghost, block );
+
+      if( ghost != NULL ) {
+
+         // the ghost took over block's data
+         pthread_rwlock_unlock( &shard->lock );
+         return;
+      }
+   }
+
+   block->hash_next = shard->buckets[ hash & (shard->num_buckets - 1) ];
+   shard->buckets[ hash & (shard->num_buckets - 1) ] = block;
+
+   pthread_rwlock_unlock( &shard->lock );
+}
+
+
+// read up to buflen bytes at offset through the page cache.
+// missed blocks are read whole from the read route (so the route sees block-aligned, block-sized reads), and cached.
+// return the number of bytes read on success.  A short read from the route is taken as the end of the file.
+// return -ENOMEM if out of memory
+// return negative on failure, if nothing was read
+ssize_t fskit_pcache_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle, void* handle_data ) {
+
+   struct fskit_pcache* pcache = core->pcache;
+   size_t block_size = pcache->block_size;
+   uint64_t gen = __atomic_load_n( &fent->data_gen, __ATOMIC_ACQUIRE );
+   size_t copied = 0;
+   uint64_t start = 0;
+
+   while( copied < buflen ) {
+
+      uint64_t pos = (uint64_t)offset + copied;
+      uint64_t idx = pos / block_size;
+      size_t off = pos % block_size;
+      size_t want = MIN( buflen - copied, block_size - off );
+      size_t block_len = 0;
+      ssize_t num_read = 0;
+      char* data = NULL;
+
+      start = fskit_pcache_now_ns();
+
+      num_read = fskit_pcache_get( pcache, fent->file_id, gen, idx, buf + copied, off, want, &block_len );
+      if( num_read >= 0 ) {
+
+         __atomic_fetch_add( &pcache->hits, 1, __ATOMIC_RELAXED );
+         __atomic_fetch_add( &pcache->hit_ns, fskit_pcache_now_ns() - start, __ATOMIC_RELAXED );
+      }
+      else {
+
+         data = CALLOC_LIST( char, block_size );
+         if( data == NULL ) {
+            return copied > 0 ? (ssize_t)copied : -ENOMEM;
+         }
+
+         num_read = fskit_run_user_read( core, path, fent, data, block_size, idx * block_size, handle, handle_data );
+         if( num_read < 0 ) {
+
+            fskit_safe_free( data );
+            return copied > 0 ? (ssize_t)copied : num_read;
+         }
+
+         block_len = MIN( (size_t)num_read, block_size );
+
+         num_read = 0;
+         if( off < block_len ) {
+
+            num_read = MIN( want, block_len - off );
+            memcpy( buf + copied, data + off, num_read );
+         }
+
+         __atomic_fetch_add( &pcache->misses, 1, __ATOMIC_RELAXED );
+         __atomic_fetch_add( &pcache->miss_ns, fskit_pcache_now_ns() - start, __ATOMIC_RELAXED );
+
+         fskit_pcache_put( pcache, fent->file_id, gen, idx, data, block_len );
+      }
+
+      copied += num_read;
+
+      if( (size_t)num_read < want ) {
+         // end of file
+         break;
+      }
+   }
+
+   return copied;
+}
+
+
+// fill the cache with the blocks covering [offset, offset + len) that aren't in it yet.
+// each run of missing blocks is read with one block-aligned route call, rather than one call per block.
+// stops at the end of the file (a short read).
+// return 0 on success
+// return -ENOMEM if out of memory
+// return negative if the read route failed
+int fskit_pcache_prefetch( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t offset, size_t len, void* handle, void* handle_data ) {
+
+   struct fskit_pcache* pcache = core->pcache;
+   size_t block_size = pcache->block_size;
+   uint64_t gen = __atomic_load_n( &fent->data_gen, __ATOMIC_ACQUIRE );
+   uint64_t idx = 0;
+   uint64_t last = 0;
+
+   if( len == 0 ) {
+      return 0;
+   }
+
+   idx = (uint64_t)offset / block_size;
+   last = ((uint64_t)offset + len - 1) / block_size;
+
+   while( idx <= last ) {
+
+      uint64_t run_start = 0;
+      size_t run_len = 0;
+      ssize_t num_read = 0;
+      char* run = NULL;
+
+      if( fskit_pcache_has( pcache, fent->file_id, gen, idx ) ) {
+         idx++;
+         continue;
+      }
+
+      run_start = idx;
+      while( idx <= last && !fskit_pcache_has( pcache, fent->file_id, gen, idx ) ) {
+         idx++;
+      }
+
+      run_len = (idx - run_start) * block_size;
+
+      run = CALLOC_LIST( char, run_len );
+      if( run == NULL ) {
+         return -ENOMEM;
+      }
+
+      num_read = fskit_run_user_read( core, path, fent, run, run_len, run_start * block_size, handle, handle_data );
+      if( num_read < 0 ) {
+
+         fskit_safe_free( run );
+         return num_read;
+      }
+
+      for( uint64_t i = 0; i < idx - run_start; i++ ) {
+
+         size_t block_len = 0;
+         char* data = NULL;
+
+         if( (size_t)num_read > i * block_size ) {
+            block_len = MIN( (size_t)num_read - i * block_size, block_size );
+         }
+
+         data = CALLOC_LIST( char, block_size );
+         if( data == NULL ) {
+
+            fskit_safe_free( run );
+            return -ENOMEM;
+         }
+
+         memcpy( data, run + i * block_size, block_len );
+
+         fskit_pcache_put( pcache, fent->file_id, gen, run_start + i, data, block_len );
+         __atomic_fetch_add( &pcache->prefetched, 1, __ATOMIC_RELAXED );
+
+         if( block_len < block_size ) {
+
+            // end of file
+            fskit_safe_free( run );
+            return 0;
+         }
+      }
+
+      fskit_safe_free( run );
+   }
+
+   return 0;
+}
+
+
+// enable the page cache on a core, in front of the read route.
+// pass 0 for block_size or max_bytes to use FSKIT_PCACHE_DEFAULT_BLOCK_SIZE or FSKIT_PCACHE_DEFAULT_MAX_BYTES.
+// max_bytes is split evenly between FSKIT_PCACHE_SHARDS shards, each of which holds at least one block.
+// policy is FSKIT_PCACHE_CLOCK or FSKIT_PCACHE_ARC.
+// call this after fskit_core_init, before the core is used.
+// the cache is freed by fskit_core_destroy.
+// NOTE: only fskit_read() goes through the cache.  Writes and truncates made through fskit invalidate it;
+// applications whose files change some other way must call fskit_core_pcache_invalidate().
+// return 0 on success
+// return -EINVAL if the policy is unknown
+// return -EEXIST if the cache is already enabled
+// return -ENOMEM on OOM
+int fskit_core_pcache_enable( struct fskit_core* core, size_t block_size, size_t max_bytes, int policy ) {
+
+   size_t capacity = 0;
+   size_t num_buckets = 1;
+   struct fskit_pcache* pcache = NULL;
+
+   if( policy != FSKIT_PCACHE_CLOCK && policy != FSKIT_PCACHE_ARC ) {
+      return -EINVAL;
+   }
+
+   if( block_size == 0 ) {
+      block_size = FSKIT_PCACHE_DEFAULT_BLOCK_SIZE;
+   }
+
+   if( max_bytes == 0 ) {
+      max_bytes = FSKIT_PCACHE_DEFAULT_MAX_BYTES;
+   }
+
+   capacity = max_bytes / block_size / FSKIT_PCACHE_SHARDS;
+   if( capacity == 0 ) {
+      capacity = 1;
+   }
+
+   // room for ARC's ghosts, too
+   while( num_buckets < 2 * capacity ) {
+      num_buckets <<= 1;
+   }
+
+   pcache = CALLOC_LIST( struct fskit_pcache, 1 );
+   if( pcache == NULL ) {
+      return -ENOMEM;
+   }
+
+   pcache->block_size = block_size;
+   pcache->policy = policy;
+
+   for( int i = 0; i < FSKIT_PCACHE_SHARDS; i++ ) {
+
+      pcache->shards[i].buckets = CALLOC_LIST( struct fskit_pcache_block*, num_buckets );
+      if( pcache->shards[i].buckets == NULL ) {
+
+         fskit_pcache_free( pcache );
+         return -ENOMEM;
+      }
+
+      pcache->shards[i].num_buckets = num_buckets;
+      pcache->shards[i].capacity = capacity;
+
+      pthread_rwlock_init( &pcache->shards[i].lock, NULL );
+   }
+
+   fskit_core_wlock( core );
+
+   if( core->pcache != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_pcache_free( pcache );
+      return -EEXIST;
+   }
+
+   core->pcache = pcache;
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// free a page cache
+// always succeeds
+int fskit_pcache_free( struct fskit_pcache* pcache ) {
+
+   struct fskit_pcache_block* block = NULL;
+   struct fskit_pcache_block* next = NULL;
+
+   if( pcache == NULL ) {
+      return 0;
+   }
+
+   for( int i = 0; i < FSKIT_PCACHE_SHARDS; i++ ) {
+
+      struct fskit_pcache_shard* shard = &pcache->shards[i];
+
+      if( shard->buckets == NULL ) {
+         // never initialized
+         continue;
+      }
+
+      for( size_t j = 0; j < shard->num_buckets; j++ ) {
+
+         for( block = shard->buckets[j]; block != NULL; block = next ) {
+
+            next = block->hash_next;
+
+            fskit_safe_free( block->data );
+            free( block );
+         }
+      }
+
+      fskit_safe_free( shard->buckets );
+      pthread_rwlock_destroy( &shard->lock );
+   }
+
+   free( pcache );
+   return 0;
+}
+
+
+// drop every cached block of a file, e.g. after it was changed outside of fskit.
+// this scans the whole cache; fskit itself never needs to call it (see struct fskit_pcache).
+// always succeeds; does nothing if the cache is disabled
+int fskit_core_pcache_invalidate( struct fskit_core* core, uint64_t file_id ) {
+
+   struct fskit_pcache* pcache = core->pcache;
+   struct fskit_pcache_block* block = NULL;
+   struct fskit_pcache_block* next = NULL;
+
+   if( pcache == NULL ) {
+      return 0;
+   }
+
+   for( int i = 0; i < FSKIT_PCACHE_SHARDS; i++ ) {
+
+      struct fskit_pcache_shard* shard = &pcache->shards[i];
+
+      pthread_rwlock_wrlock( &shard->lock );
+
+      for( size_t j = 0; j < shard->num_buckets; j++ ) {
+
+         for( block = shard->buckets[j]; block != NULL; block = next ) {
+
+            next = block->hash_next;
+
+            if( block->file_id == file_id ) {
+               fskit_pcache_block_free( shard, block );
+            }
+         }
+      }
+
+      pthread_rwlock_unlock( &shard->lock );
+   }
+
+   __atomic_fetch_add( &pcache->invalidations, 1, __ATOMIC_RELAXED );
+   return 0;
+}
+
+
+// get page cache statistics
+// return 0 on success
+// return -ENOSYS if the cache is disabled
+int fskit_core_pcache_stats( struct fskit_core* core, struct fskit_pcache_stats* stats ) {
+
+   struct fskit_pcache* pcache = core->pcache;
+
+   if( pcache == NULL ) {
+      return -ENOSYS;
+   }
+
+   stats->hits = __atomic_load_n( &pcache->hits, __ATOMIC_RELAXED );
+   stats->misses = __atomic_load_n( &pcache->misses, __ATOMIC_RELAXED );
+   stats->evictions = __atomic_load_n( &pcache->evictions, __ATOMIC_RELAXED );
+   stats->invalidations = __atomic_load_n( &pcache->invalidations, __ATOMIC_RELAXED );
+   stats->hit_ns = __atomic_load_n( &pcache->hit_ns, __ATOMIC_RELAXED );
+   stats->miss_ns = __atomic_load_n( &pcache->miss_ns, __ATOMIC_RELAXED );
+   stats->prefetched = __atomic_load_n( &pcache->prefetched, __ATOMIC_RELAXED );
+   stats->blocks = 0;
+
+   for( int i = 0; i < FSKIT_PCACHE_SHARDS; i++ ) {
+
+      pthread_rwlock_rdlock( &pcache->shards[i].lock );
+
+      stats->blocks += pcache->shards[i].lists[ FSKIT_PCACHE_T1 ].len + pcache->shards[i].lists[ FSKIT_PCACHE_T2 ].len;
+
+      pthread_rwlock_unlock( &pcache->shards[i].lock );
+   }
+
+   return 0;
+}
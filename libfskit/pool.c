@@ -0,0 +1,248 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// nanoseconds from start to end
+static uint64_t fskit_route_pool_elapsed( struct timespec* start, struct timespec* end ) {
+
+   int64_t ns = (int64_t)(end->tv_sec - start->tv_sec) * 1000000000LL + (end->tv_nsec - start->tv_nsec);
+   return ns > 0 ? (uint64_t)ns : 0;
+}
+
+// worker thread: run queued jobs until the pool stops
+static void* fskit_route_pool_main( void* arg ) {
+
+   struct fskit_route_pool* pool = (struct fskit_route_pool*)arg;
+   struct fskit_route_pool_job* job = NULL;
+   struct timespec started;
+   struct timespec finished;
+   uint64_t wait_ns = 0;
+   uint64_t service_ns = 0;
+   int rc = 0;
+
+   pthread_mutex_lock( &pool->lock );
+
+   while( true ) {
+
+      while( pool->head == NULL && !pool->stopping ) {
+         pthread_cond_wait( &pool->work, &pool->lock );
+      }
+
+      if( pool->head == NULL ) {
+         // stopping, and nothing left to do
+         break;
+      }
+
+      job = pool->head;
+      pool->head = job->next;
+      if( pool->head == NULL ) {
+         pool->tail = NULL;
+      }
+
+      pool->num_queued--;
+      pool->num_running++;
+
+      pthread_cond_signal( &pool->space );
+      pthread_mutex_unlock( &pool->lock );
+
+      clock_gettime( CLOCK_MONOTONIC, &started );
+      rc = (*job->func)( job->arg );
+      clock_gettime( CLOCK_MONOTONIC, &finished );
+
+      wait_ns = fskit_route_pool_elapsed( &job->queued_at, &started );
+      service_ns = fskit_route_pool_elapsed( &started, &finished );
+
+      pthread_mutex_lock( &pool->lock );
+
+      pool->num_running--;
+
+      pool->stats.calls++;
+      pool->stats.queue_wait_ns += wait_ns;
+      pool->stats.service_ns += service_ns;
+
+      if( wait_ns > pool->stats.max_queue_wait_ns ) {
+         pool->stats.max_queue_wait_ns = wait_ns;
+      }
+
+      if( service_ns > pool->stats.max_service_ns ) {
+         pool->stats.max_service_ns = service_ns;
+      }
+
+      // the caller may return (and free job) as soon as we unlock
+      job->rc = rc;
+      job->done = true;
+      pthread_cond_signal( &job->finished );
+   }
+
+   pthread_mutex_unlock( &pool->lock );
+
+   return NULL;
+}
+
+// make a worker pool with max_concurrency threads, and room for max_queued waiting callers
+// return the pool on success
+// return NULL on error, and set *err to:
+// * -EINVAL if max_concurrency or max_queued is less than 1
+// * -ENOMEM if out of memory
+// * the (negative) error from pthread_create, if we couldn't start a worker
+struct fskit_route_pool* fskit_route_pool_new( int max_concurrency, int max_queued, int* err ) {
+
+   int rc = 0;
+   struct fskit_route_pool* pool = NULL;
+
+   if( max_concurrency < 1 || max_queued < 1 ) {
+      *err = -EINVAL;
+      return NULL;
+   }
+
+   pool = CALLOC_LIST( struct fskit_route_pool, 1 );
+   if( pool == NULL ) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   pool->workers = CALLOC_LIST( pthread_t, max_concurrency );
+   if( pool->workers == NULL ) {
+
+      fskit_safe_free( pool );
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   pool->max_concurrency = max_concurrency;
+   pool->max_queued = max_queued;
+
+   pthread_mutex_init( &pool->lock, NULL );
+   pthread_cond_init( &pool->work, NULL );
+   pthread_cond_init( &pool->space, NULL );
+
+   for( int i = 0; i < max_concurrency; i++ ) {
+
+      rc = pthread_create( &pool->workers[i], NULL, fskit_route_pool_main, pool );
+      if( rc != 0 ) {
+
+         fskit_error("pthread_create rc = %d\n", rc );
+
+         fskit_route_pool_free( pool );
+         *err = -rc;
+         return NULL;
+      }
+
+      pool->num_workers++;
+   }
+
+   return pool;
+}
+
+// run func(arg) on one of the pool's workers, and wait for it to finish.
+// blocks while the queue is full.
+// return what func returned
+int fskit_route_pool_run( struct fskit_route_pool* pool, int (*func)( void* ), void* arg ) {
+
+   struct fskit_route_pool_job job;
+
+   memset( &job, 0, sizeof(struct fskit_route_pool_job) );
+
+   job.func = func;
+   job.arg = arg;
+   pthread_cond_init( &job.finished, NULL );
+
+   pthread_mutex_lock( &pool->lock );
+
+   if( pool->num_queued >= pool->max_queued ) {
+
+      // backpressure
+      pool->stats.blocked++;
+
+      while( pool->num_queued >= pool->max_queued ) {
+         pthread_cond_wait( &pool->space, &pool->lock );
+      }
+   }
+
+   // queue wait starts once we're admitted
+   clock_gettime( CLOCK_MONOTONIC, &job.queued_at );
+
+   if( pool->tail == NULL ) {
+      pool->head = &job;
+   }
+   else {
+      pool->tail->next = &job;
+   }
+
+   pool->tail = &job;
+   pool->num_queued++;
+
+   pthread_cond_signal( &pool->work );
+
+   while( !job.done ) {
+      pthread_cond_wait( &job.finished, &pool->lock );
+   }
+
+   pthread_mutex_unlock( &pool->lock );
+
+   pthread_cond_destroy( &job.finished );
+
+   return job.rc;
+}
+
+// get a snapshot of the pool's statistics
+// always succeeds
+int fskit_route_pool_get_stats( struct fskit_route_pool* pool, struct fskit_route_pool_stats* stats ) {
+
+   pthread_mutex_lock( &pool->lock );
+
+   *stats = pool->stats;
+   stats->queued = pool->num_queued;
+   stats->running = pool->num_running;
+
+   pthread_mutex_unlock( &pool->lock );
+
+   return 0;
+}
+
+// stop a pool's workers and free it.
+// NOTE: nothing may be queued on it, or waiting to be, and it must not be called from one of its workers
+// always succeeds
+int fskit_route_pool_free( struct fskit_route_pool* pool ) {
+
+   pthread_mutex_lock( &pool->lock );
+
+   pool->stopping = true;
+   pthread_cond_broadcast( &pool->work );
+
+   pthread_mutex_unlock( &pool->lock );
+
+   for( int i = 0; i < pool->num_workers; i++ ) {
+      pthread_join( pool->workers[i], NULL );
+   }
+
+   pthread_mutex_destroy( &pool->lock );
+   pthread_cond_destroy( &pool->work );
+   pthread_cond_destroy( &pool->space );
+
+   fskit_safe_free( pool->workers );
+   fskit_safe_free( pool );
+
+   return 0;
+}
@@ -0,0 +1,172 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// byte-range lock: the ranges currently held on one inode.
+// a holder waits until no held range conflicts with its own.
+struct fskit_range_lock {
+
+   struct fskit_range_lock_ent* held;
+
+   pthread_mutex_t lock;
+   pthread_cond_t released;
+};
+
+// do two ranges overlap, in a way that can't be shared?
+static bool fskit_range_conflicts( struct fskit_range_lock_ent* a, struct fskit_range_lock_ent* b ) {
+
+   if( !a->write && !b->write ) {
+      return false;
+   }
+
+   if( a->start >= a->end || b->start >= b->end ) {
+      // empty
+      return false;
+   }
+
+   return a->start < b->end && b->start < a->end;
+}
+
+// does a range conflict with any held range?
+// NOTE: rl must be locked
+static bool fskit_range_is_blocked( struct fskit_range_lock* rl, struct fskit_range_lock_ent* ent ) {
+
+   for( struct fskit_range_lock_ent* held = rl->held; held != NULL; held = held->next ) {
+
+      if( fskit_range_conflicts( held, ent ) ) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+// make a new range lock
+// return NULL on OOM
+static struct fskit_range_lock* fskit_range_lock_new(void) {
+
+   struct fskit_range_lock* rl = CALLOC_LIST( struct fskit_range_lock, 1 );
+   if( rl == NULL ) {
+      return NULL;
+   }
+
+   pthread_mutex_init( &rl->lock, NULL );
+   pthread_cond_init( &rl->released, NULL );
+
+   return rl;
+}
+
+// free a range lock
+// NOTE: nothing may hold a range in it
+int fskit_range_lock_free( struct fskit_range_lock* rl ) {
+
+   pthread_mutex_destroy( &rl->lock );
+   pthread_cond_destroy( &rl->released );
+
+   fskit_safe_free( rl );
+   return 0;
+}
+
+// get an inode's range lock, installing it if need be
+// return NULL on OOM
+// NOTE: fent must be ref'ed
+struct fskit_range_lock* fskit_entry_range_lock( struct fskit_entry* fent ) {
+
+   struct fskit_range_lock* rl = __atomic_load_n( &fent->range_lock, __ATOMIC_ACQUIRE );
+   struct fskit_range_lock* new_rl = NULL;
+
+   if( rl != NULL ) {
+      return rl;
+   }
+
+   new_rl = fskit_range_lock_new();
+   if( new_rl == NULL ) {
+      return NULL;
+   }
+
+   if( __atomic_compare_exchange_n( &fent->range_lock, &rl, new_rl, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+      return new_rl;
+   }
+
+   // someone beat us to it
+   fskit_range_lock_free( new_rl );
+   return rl;
+}
+
+// hold the bytes [start, end), blocking until no conflicting range is held.
+// write ranges conflict with every overlapping range; other ranges only conflict with overlapping write ranges.
+// ent records the held range, and must stay valid until fskit_range_unlock.
+// an empty range is recorded, but conflicts with nothing.
+// always succeeds
+int fskit_range_lock( struct fskit_range_lock* rl, struct fskit_range_lock_ent* ent, uint64_t start, uint64_t end, bool write ) {
+
+   ent->start = start;
+   ent->end = end;
+   ent->write = write;
+   ent->prev = NULL;
+
+   pthread_mutex_lock( &rl->lock );
+
+   while( fskit_range_is_blocked( rl, ent ) ) {
+      pthread_cond_wait( &rl->released, &rl->lock );
+   }
+
+   ent->next = rl->held;
+   if( rl->held != NULL ) {
+      rl->held->prev = ent;
+   }
+
+   rl->held = ent;
+
+   pthread_mutex_unlock( &rl->lock );
+
+   return 0;
+}
+
+// release a range held with fskit_range_lock, and wake up anyone waiting on the lock
+// always succeeds
+int fskit_range_unlock( struct fskit_range_lock* rl, struct fskit_range_lock_ent* ent ) {
+
+   pthread_mutex_lock( &rl->lock );
+
+   if( ent->prev != NULL ) {
+      ent->prev->next = ent->next;
+   }
+   else {
+      rl->held = ent->next;
+   }
+
+   if( ent->next != NULL ) {
+      ent->next->prev = ent->prev;
+   }
+
+   ent->prev = NULL;
+   ent->next = NULL;
+
+   pthread_cond_broadcast( &rl->released );
+
+   pthread_mutex_unlock( &rl->lock );
+
+   return 0;
+}
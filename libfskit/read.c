@@ -21,19 +21,21 @@
 
 #include <fskit/read.h>
 #include <fskit/route.h>
+#include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
 // run the user-given read route callback
 // return the number of bytes read on success
 // return negative on failure
-ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle, void* handle_data ) {
 
    int rc = 0;
    int cbrc = 0;
    struct fskit_route_dispatch_args dargs;
 
    fskit_route_io_args( &dargs, buf, buflen, offset, handle_data, NULL );
+   dargs.handle = handle;
 
    rc = fskit_route_call_read( core, path, fent, &dargs, &cbrc );
 
@@ -46,6 +48,58 @@ ssize_t fskit_run_user_read( struct fskit_core* core, char const* path, struct f
 }
 
 
+// run the user-given readv route callback.
+// if there is no readv route, run the read route once on a buffer covering the whole vector, and scatter it into iov.
+// return the number of bytes read on success
+// return -ENOMEM if out of memory
+// return negative on failure
+static ssize_t fskit_run_user_readv( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct iovec const* iov, int iovcnt, off_t offset, void* handle, void* handle_data ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   ssize_t num_read = 0;
+   size_t copied = 0;
+   char* buf = NULL;
+   struct fskit_route_dispatch_args dargs;
+
+   rc = fskit_route_iov_args( &dargs, iov, iovcnt, offset, handle_data, NULL );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   dargs.handle = handle;
+
+   rc = fskit_route_call_readv( core, path, fent, &dargs, &cbrc );
+
+   if( rc != -EPERM && rc != -ENOSYS ) {
+      return (ssize_t)cbrc;
+   }
+
+   // no readv route
+   if( iovcnt == 1 ) {
+      return fskit_run_user_read( core, path, fent, (char*)iov[0].iov_base, iov[0].iov_len, offset, handle, handle_data );
+   }
+
+   buf = CALLOC_LIST( char, dargs.iolen + 1 );
+   if( buf == NULL ) {
+      return -ENOMEM;
+   }
+
+   num_read = fskit_run_user_read( core, path, fent, buf, dargs.iolen, offset, handle, handle_data );
+
+   for( int i = 0; i < iovcnt && num_read > 0 && copied < (size_t)num_read; i++ ) {
+
+      size_t len = MIN( iov[i].iov_len, (size_t)num_read - copied );
+
+      memcpy( iov[i].iov_base, buf + copied, len );
+      copied += len;
+   }
+
+   fskit_safe_free( buf );
+
+   return num_read;
+}
+
 // read up to buflen bytes into buf, starting at the given offset in the file.
 // return the number of bytes read on success.
 // return negative on failure.
@@ -60,16 +114,110 @@ ssize_t fskit_read( struct fskit_core* core, struct fskit_file_handle* fh, char*
       return -EBADF;
    }
 
-   ssize_t num_read = fskit_run_user_read( core, fh->path, fh->fent, buf, buflen, offset, fh->app_data );
+   ssize_t num_read = 0;
+   off_t ra_off = 0;
+   size_t ra_len = 0;
+
+   // buffered writes must land first
+   int rc = fskit_wbuf_flush_range( core, fh, offset, buflen );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
+   if( core->readahead_max != 0 ) {
+      fskit_readahead( core, fh, offset, buflen, &ra_off, &ra_len );
+   }
+
+   if( core->pcache != NULL ) {
+      num_read = fskit_pcache_read( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+   }
+   else {
+      num_read = fskit_run_user_read( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+   }
+
+   if( ra_len > 0 && num_read >= 0 ) {
+
+      // keep ahead of the reader, without making it wait
+      rc = fskit_readahead_queue( core, fh, ra_off, ra_len );
+      if( rc != 0 ) {
+         fskit_error("fskit_readahead_queue(%s, %zu @ %jd) rc = %d\n", fh->path, ra_len, (intmax_t)ra_off, rc );
+      }
+   }
 
    if( num_read >= 0 ) {
 
       // update metadata
-      fskit_entry_wlock( fh->fent );
+      fskit_entry_touch_read( core, fh->fent );
+   }
 
-      fskit_entry_set_atime( fh->fent, NULL );
+   fskit_file_handle_unlock( fh );
 
-      fskit_entry_unlock( fh->fent );
+   return num_read;
+}
+
+
+// read into each of iovcnt buffers in turn, starting at the given offset in the file.
+// the read is routed once for the whole vector.
+// return the number of bytes read on success.
+// return negative on failure.
+ssize_t fskit_readv( struct fskit_core* core, struct fskit_file_handle* fh, struct iovec const* iov, int iovcnt, off_t offset ) {
+
+   if( iovcnt < 0 || iovcnt > IOV_MAX ) {
+      return -EINVAL;
+   }
+
+   fskit_file_handle_rlock( fh );
+
+   // sanity check
+   if( (fh->flags & O_WRONLY) != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return -EBADF;
+   }
+
+   if( iovcnt == 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return 0;
+   }
+
+   size_t total = 0;
+   for( int i = 0; i < iovcnt; i++ ) {
+      total += iov[i].iov_len;
+   }
+
+   // buffered writes must land first
+   int rc = fskit_wbuf_flush_range( core, fh, offset, total );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
+   off_t ra_off = 0;
+   size_t ra_len = 0;
+
+   if( core->readahead_max != 0 ) {
+      fskit_readahead( core, fh, offset, total, &ra_off, &ra_len );
+   }
+
+   ssize_t num_read = fskit_run_user_readv( core, fh->path, fh->fent, iov, iovcnt, offset, fh, fh->app_data );
+
+   if( ra_len > 0 && num_read >= 0 ) {
+
+      // keep ahead of the reader, without making it wait
+      rc = fskit_readahead_queue( core, fh, ra_off, ra_len );
+      if( rc != 0 ) {
+         fskit_error("fskit_readahead_queue(%s, %zu @ %jd) rc = %d\n", fh->path, ra_len, (intmax_t)ra_off, rc );
+      }
+   }
+
+   if( num_read >= 0 ) {
+
+      // update metadata
+      fskit_entry_touch_read( core, fh->fent );
    }
 
    fskit_file_handle_unlock( fh );
@@ -0,0 +1,516 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/readahead.h>
+#include <fskit/route.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// thread that prefetches the windows readers will get to next, so they don't wait for them
+struct fskit_readahead_worker {
+
+   pthread_t thread;
+   bool running;
+
+   // governs running, the queue, and each handle's async_* fields
+   pthread_mutex_t lock;
+   pthread_cond_t work;         // signaled when a window is queued, or the worker should stop
+   pthread_cond_t idle;         // signaled when the worker finishes a window
+
+   // handles with a window to prefetch, oldest first
+   struct fskit_file_handle* head;
+   struct fskit_file_handle* tail;
+
+   struct fskit_file_handle* busy;      // handle being prefetched for, if any
+};
+
+// size of the first window of a sequential run, given the size of the read that started it
+static size_t fskit_readahead_first_window( struct fskit_core* core, size_t len ) {
+
+   size_t window = 4 * len;
+
+   if( window < core->readahead_min ) {
+      window = core->readahead_min;
+   }
+
+   if( window > core->readahead_max ) {
+      window = core->readahead_max;
+   }
+
+   return window;
+}
+
+// size of the next window of a sequential run
+static size_t fskit_readahead_next_window( struct fskit_core* core, size_t window ) {
+
+   window *= 2;
+
+   if( window > core->readahead_max ) {
+      window = core->readahead_max;
+   }
+
+   return window;
+}
+
+// prefetch a range of fh's file: call its prefetch route, or if it has none, read the range into the page cache.
+// the range is clipped to the file's size.
+// return 0 on success, or if there is no way to prefetch
+// return negative if the prefetch failed (this is only a hint, so callers may ignore it)
+// NOTE: fh must be read-locked, or be the readahead worker's (fskit_close waits for it in fskit_readahead_release)
+int fskit_readahead_issue( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   off_t size = 0;
+   struct fskit_route_dispatch_args dargs;
+
+   fskit_entry_rlock( fh->fent );
+   size = fh->fent->size;
+   fskit_entry_unlock( fh->fent );
+
+   if( offset >= size ) {
+      return 0;
+   }
+
+   if( (off_t)len > size - offset ) {
+      len = size - offset;
+   }
+
+   fskit_route_io_args( &dargs, NULL, len, offset, fh->app_data, NULL );
+   dargs.handle = fh;
+
+   rc = fskit_route_call_prefetch( core, fh->path, fh->fent, &dargs, &cbrc );
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no prefetch route; warm the page cache instead, if there is one
+      if( core->pcache != NULL ) {
+         return fskit_pcache_prefetch( core, fh->path, fh->fent, offset, len, fh, fh->app_data );
+      }
+
+      return 0;
+   }
+
+   return cbrc;
+}
+
+// account for a read of [offset, offset + len) on fh, and prefetch ahead of it if it continues a sequential run.
+// like the kernel's readahead, the first sequential read prefetches a window starting at itself, and
+// later reads prefetch the next (doubled, up to readahead_max) window once they reach the second half of the last one.
+// a read that starts a window is prefetched here, before it is routed, since the reader needs it right away
+// (this only batches the reader's own read with what follows it); otherwise, the window to hand to the
+// readahead worker once the read has been served is put into *ra_off and *ra_len (0 if there isn't one).
+// always succeeds (prefetch failures are only logged)
+// NOTE: fh must be read-locked, and readahead must be enabled
+int fskit_readahead( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len, off_t* ra_off, size_t* ra_len ) {
+
+   int rc = 0;
+   off_t end = offset + (off_t)len;
+   off_t sync_off = 0;
+   size_t sync_len = 0;
+   struct fskit_readahead* ra = &fh->ra;
+
+   *ra_off = 0;
+   *ra_len = 0;
+
+   pthread_mutex_lock( &ra->lock );
+
+   bool hit = (ra->window > 0 && offset >= ra->start && end <= ra->end);
+   bool sequential = (offset == ra->next_off);
+
+   if( hit ) {
+      ra->hits++;
+   }
+   else {
+      ra->misses++;
+   }
+
+   ra->next_off = end;
+
+   if( sequential && (ra->window == 0 || end > ra->end) ) {
+
+      // new run, or we fell behind: prefetch from here, synchronously
+      if( ra->window == 0 ) {
+         ra->window = fskit_readahead_first_window( core, len );
+      }
+      else {
+         ra->window = fskit_readahead_next_window( core, ra->window );
+      }
+
+      sync_off = offset;
+      sync_len = (ra->window > len ? ra->window : len);
+
+      ra->start = offset;
+      ra->end = offset + (off_t)sync_len;
+      ra->windows++;
+      ra->bytes += sync_len;
+   }
+   else if( sequential && end > ra->end - (off_t)(ra->window / 2) ) {
+
+      // into the second half of the last window: prefetch the next one once this read is done
+      ra->window = fskit_readahead_next_window( core, ra->window );
+
+      *ra_off = ra->end;
+      *ra_len = ra->window;
+
+      ra->end += (off_t)ra->window;
+      ra->windows++;
+      ra->bytes += ra->window;
+   }
+   else if( !sequential && !hit ) {
+
+      // random access; stop reading ahead
+      ra->window = 0;
+      ra->start = 0;
+      ra->end = 0;
+   }
+
+   pthread_mutex_unlock( &ra->lock );
+
+   if( sync_len > 0 ) {
+
+      rc = fskit_readahead_issue( core, fh, sync_off, sync_len );
+      if( rc != 0 ) {
+         fskit_error("fskit_readahead_issue(%s, %zu @ %jd) rc = %d\n", fh->path, sync_len, (intmax_t)sync_off, rc );
+      }
+   }
+
+   return 0;
+}
+
+
+// readahead worker: prefetch queued windows, one handle at a time, until stopped.
+// queued windows are dropped when it stops, since they are only hints.
+static void* fskit_readahead_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct fskit_readahead_worker* worker = core->readahead_worker;
+   struct fskit_file_handle* fh = NULL;
+   off_t offset = 0;
+   size_t len = 0;
+   int rc = 0;
+
+   pthread_mutex_lock( &worker->lock );
+
+   while( worker->running ) {
+
+      if( worker->head == NULL ) {
+         pthread_cond_wait( &worker->work, &worker->lock );
+         continue;
+      }
+
+      fh = worker->head;
+      worker->head = fh->ra.async_next;
+      if( worker->head == NULL ) {
+         worker->tail = NULL;
+      }
+
+      offset = fh->ra.async_off;
+      len = fh->ra.async_len;
+
+      fh->ra.async_next = NULL;
+      fh->ra.async_len = 0;
+      fh->ra.async_busy = true;
+      worker->busy = fh;
+
+      pthread_mutex_unlock( &worker->lock );
+
+      rc = fskit_readahead_issue( core, fh, offset, len );
+      if( rc != 0 ) {
+         fskit_error("fskit_readahead_issue(%s, %zu @ %jd) rc = %d\n", fh->path, len, (intmax_t)offset, rc );
+      }
+
+      pthread_mutex_lock( &worker->lock );
+
+      fh->ra.async_busy = false;
+      worker->busy = NULL;
+      pthread_cond_broadcast( &worker->idle );
+   }
+
+   // drop whatever is left
+   for( fh = worker->head; fh != NULL; fh = worker->head ) {
+
+      worker->head = fh->ra.async_next;
+      fh->ra.async_next = NULL;
+      fh->ra.async_len = 0;
+   }
+
+   worker->tail = NULL;
+   pthread_cond_broadcast( &worker->idle );
+
+   pthread_mutex_unlock( &worker->lock );
+
+   return NULL;
+}
+
+
+// have the readahead worker prefetch [offset, offset + len) of fh's file, without waiting for it.
+// if fh already has a window queued, the two are merged.
+// return 0 on success
+// return -ENOSYS if readahead is not enabled
+// NOTE: fh must be read-locked
+int fskit_readahead_queue( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len ) {
+
+   struct fskit_readahead_worker* worker = core->readahead_worker;
+   off_t end = offset + (off_t)len;
+
+   if( worker == NULL ) {
+      return -ENOSYS;
+   }
+
+   pthread_mutex_lock( &worker->lock );
+
+   if( !worker->running ) {
+
+      pthread_mutex_unlock( &worker->lock );
+      return 0;
+   }
+
+   if( fh->ra.async_len > 0 ) {
+
+      // the reader got ahead of the worker; cover both windows
+      if( fh->ra.async_off + (off_t)fh->ra.async_len > end ) {
+         end = fh->ra.async_off + (off_t)fh->ra.async_len;
+      }
+
+      if( fh->ra.async_off < offset ) {
+         offset = fh->ra.async_off;
+      }
+
+      fh->ra.async_off = offset;
+      fh->ra.async_len = (size_t)(end - offset);
+   }
+   else {
+
+      fh->ra.async_off = offset;
+      fh->ra.async_len = len;
+      fh->ra.async_next = NULL;
+
+      if( worker->tail != NULL ) {
+         worker->tail->ra.async_next = fh;
+      }
+      else {
+         worker->head = fh;
+      }
+
+      worker->tail = fh;
+
+      pthread_cond_signal( &worker->work );
+   }
+
+   pthread_mutex_unlock( &worker->lock );
+
+   return 0;
+}
+
+
+// forget fh's queued window, and wait for the worker to finish any window it is prefetching for fh.
+// fskit_close calls this before the handle goes away.
+// always succeeds
+// NOTE: fh must be write-locked, so no more windows get queued
+int fskit_readahead_release( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   struct fskit_readahead_worker* worker = core->readahead_worker;
+   struct fskit_file_handle** prev = NULL;
+   struct fskit_file_handle* last = NULL;
+
+   if( worker == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &worker->lock );
+
+   if( fh->ra.async_len > 0 ) {
+
+      for( prev = &worker->head; *prev != fh; prev = &(*prev)->ra.async_next ) {
+         last = *prev;
+      }
+
+      *prev = fh->ra.async_next;
+      if( worker->tail == fh ) {
+         worker->tail = last;
+      }
+
+      fh->ra.async_next = NULL;
+      fh->ra.async_len = 0;
+   }
+
+   while( fh->ra.async_busy ) {
+      pthread_cond_wait( &worker->idle, &worker->lock );
+   }
+
+   pthread_mutex_unlock( &worker->lock );
+
+   return 0;
+}
+
+
+// stop the readahead worker and free it.
+// queued windows are dropped.
+// always succeeds
+int fskit_readahead_free( struct fskit_readahead_worker* worker ) {
+
+   bool running = false;
+
+   if( worker == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &worker->lock );
+
+   running = worker->running;
+   worker->running = false;
+   pthread_cond_signal( &worker->work );
+
+   pthread_mutex_unlock( &worker->lock );
+
+   if( running ) {
+      pthread_join( worker->thread, NULL );
+   }
+
+   pthread_mutex_destroy( &worker->lock );
+   pthread_cond_destroy( &worker->work );
+   pthread_cond_destroy( &worker->idle );
+
+   fskit_safe_free( worker );
+
+   return 0;
+}
+
+
+// wait for the readahead worker to prefetch every window queued so far
+// return 0 on success
+// return -ENOSYS if readahead is not enabled
+int fskit_core_readahead_drain( struct fskit_core* core ) {
+
+   struct fskit_readahead_worker* worker = core->readahead_worker;
+
+   if( worker == NULL ) {
+      return -ENOSYS;
+   }
+
+   pthread_mutex_lock( &worker->lock );
+
+   while( worker->running && (worker->head != NULL || worker->busy != NULL) ) {
+      pthread_cond_wait( &worker->idle, &worker->lock );
+   }
+
+   pthread_mutex_unlock( &worker->lock );
+
+   return 0;
+}
+
+
+// enable sequential readahead on this core.
+// each file handle watches for sequential fskit_read()s, and when it sees them, prefetches the range it expects
+// to be read next through the file's prefetch route (see fskit_route_prefetch), or, if there isn't one, into the
+// page cache (see fskit_core_pcache_enable).  Without either, readahead only gathers statistics.
+// windows start at 4x the read size, double with each window, and stay within [min_window, max_window]
+// (pass 0 for FSKIT_READAHEAD_DEFAULT_MIN_WINDOW or FSKIT_READAHEAD_DEFAULT_MAX_WINDOW).
+// call this after fskit_core_init, before the core is used.
+// return 0 on success
+// return -EINVAL if min_window is bigger than max_window
+// return -ENOMEM on OOM
+// return -EEXIST if readahead is already enabled
+// return negative if the readahead worker could not be started
+int fskit_core_readahead_enable( struct fskit_core* core, size_t min_window, size_t max_window ) {
+
+   int rc = 0;
+   struct fskit_readahead_worker* worker = NULL;
+
+   if( min_window == 0 ) {
+      min_window = FSKIT_READAHEAD_DEFAULT_MIN_WINDOW;
+   }
+
+   if( max_window == 0 ) {
+      max_window = FSKIT_READAHEAD_DEFAULT_MAX_WINDOW;
+   }
+
+   if( min_window > max_window ) {
+      return -EINVAL;
+   }
+
+   worker = CALLOC_LIST( struct fskit_readahead_worker, 1 );
+   if( worker == NULL ) {
+      return -ENOMEM;
+   }
+
+   pthread_mutex_init( &worker->lock, NULL );
+   pthread_cond_init( &worker->work, NULL );
+   pthread_cond_init( &worker->idle, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->readahead_max != 0 ) {
+
+      fskit_core_unlock( core );
+      fskit_readahead_free( worker );
+      return -EEXIST;
+   }
+
+   // the worker reads core->readahead_worker, so start it once that's set
+   core->readahead_worker = worker;
+   worker->running = true;
+
+   rc = pthread_create( &worker->thread, NULL, fskit_readahead_main, core );
+   if( rc != 0 ) {
+
+      worker->running = false;
+      core->readahead_worker = NULL;
+
+      fskit_core_unlock( core );
+
+      fskit_error("pthread_create rc = %d\n", rc );
+      fskit_readahead_free( worker );
+      return -rc;
+   }
+
+   core->readahead_min = min_window;
+   core->readahead_max = max_window;
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// get a file handle's readahead statistics
+// return 0 on success
+// return -ENOSYS if readahead is not enabled
+int fskit_readahead_stats( struct fskit_core* core, struct fskit_file_handle* fh, struct fskit_readahead_stats* stats ) {
+
+   if( core->readahead_max == 0 ) {
+      return -ENOSYS;
+   }
+
+   pthread_mutex_lock( &fh->ra.lock );
+
+   stats->hits = fh->ra.hits;
+   stats->misses = fh->ra.misses;
+   stats->windows = fh->ra.windows;
+   stats->bytes = fh->ra.bytes;
+   stats->window = fh->ra.window;
+
+   pthread_mutex_unlock( &fh->ra.lock );
+
+   return 0;
+}
@@ -22,21 +22,13 @@
 #include <fskit/entry.h>
 #include <fskit/readdir.h>
 #include <fskit/route.h>
+#include <fskit/stat.h>
 #include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
+static struct fskit_dir_entry** fskit_listdir_cached( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err );
 
-// table entry for seekdir/telldir positions
-struct fskit_telldir_entry {
-    
-    char name[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
-    off_t offset;
-    
-    struct fskit_telldir_entry* next;
-};
-
-#define FSKIT_TELLDIR_ENTRY_CMP( t1, t2 ) (strcmp((t1)->name, (t2)->name))
 
 // initialize a directory entry from an fskit_entry
 // return the new entry on success
@@ -109,52 +101,128 @@ int fskit_run_user_readdir( struct fskit_core* core, char const* path, struct fs
 }
 
 
-// find the starting point where we can begin to read a directory, based on the last-read name
-// set *read_itr and *read_start
-static int fskit_readdir_find_start( struct fskit_dir_handle* dirh, fskit_entry_set_itr* read_itr, fskit_entry_set** read_start ) {
+// run the user-supplied route for listdir over a buffer of packed records.
+// if there's no route for packed records, run the readdir route over them instead.
+// the route omits records by calling fskit_dir_record_omit on them.
+// if routed is not NULL, *routed is set to whether or not any route ran.
+// return 0 or positive on success
+// return negative on error
+static int fskit_run_user_readdir_buf( struct fskit_core* core, char const* path, struct fskit_entry* fent, char* buf, size_t buflen, bool* routed ) {
 
-    // find out where we can start reading
-    struct fskit_entry* dent = dirh->dent;
-    
-    fskit_entry_set* member = fskit_entry_set_find_itr( dent->children, dirh->curr_name );
-    if( member == NULL ) {
-        
-        // name is invalid--try to seek to the point where we left off 
-        fskit_entry_set* sought = NULL;
-        bool found = false;
-        
-        for( sought = fskit_entry_set_begin( read_itr, dent->children ); sought != NULL; sought = fskit_entry_set_next( read_itr ) ) {
-            
-            // if we reached the point where the names are lexicographically greater than where we left off last, then 
-            // that's the new read point 
-            char const* sought_name = fskit_entry_set_name_at( sought );
-            if( strcmp(dirh->curr_name, sought_name) < 0 ) {
-                
-                found = true;
-                break;
-            }
-        }
-        if( found ) {
-            
-            // scanned ahead!
-            *read_start = sought;
-        }
-        else {
-           
-            // end of directory!
-            *read_start = NULL;
-        }
-    }
-    else {
-        
-        *read_start = member;
+   int rc = 0;
+   int cbrc = 0;
+   struct fskit_route_dispatch_args dargs;
+   char name[FSKIT_FILESYSTEM_NAMEMAX+1];
 
-        // TODO: find out why sglib's init_on_equal method doesn't get us the right iterator
-        fskit_entry_set* tmp = NULL;
-        for( tmp = fskit_entry_set_begin( read_itr, dent->children ); tmp != NULL && tmp != member; tmp = fskit_entry_set_next( read_itr ) );
-    }
-    
-    return 0;
+   memset( name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+   fskit_basename( path, name );
+
+   fskit_route_readdir_buf_args( &dargs, name, buf, buflen );
+
+   rc = fskit_route_call_readdir_buf( core, path, fent, &dargs, &cbrc );
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no packed routes; try the plain ones
+      rc = fskit_route_call_readdir( core, path, fent, &dargs, &cbrc );
+   }
+
+   if( routed != NULL ) {
+      *routed = (rc != -EPERM && rc != -ENOSYS);
+   }
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+      // no routes
+      return 0;
+   }
+
+   return cbrc;
+}
+
+
+// can a member of a directory's children be listed?
+// i.e. it has an entry, and it isn't being garbage-collected
+static bool fskit_readdir_visible( fskit_entry_set* member ) {
+
+   struct fskit_entry* fent = fskit_entry_set_child_at( member );
+
+   return fent != NULL && !fent->deletion_in_progress && fent->type != FSKIT_ENTRY_TYPE_DEAD;
+}
+
+
+// find where to resume reading dirh, and set up *read_itr to iterate from there.
+// this is the first name after the last one we read (which may have since been removed),
+// once we've skipped any further entries that a seekdir cookie says were read.
+// dirh->dent must be at least read-locked.
+// dirh must be write-locked
+// return the first unread member of dirh->dent's children, or NULL if there are none left
+static fskit_entry_set* fskit_readdir_resume( struct fskit_dir_handle* dirh, fskit_entry_set_itr* read_itr ) {
+
+   struct fskit_entry* dent = dirh->dent;
+   fskit_entry_set* member = NULL;
+
+   if( strlen(dirh->curr_name) == 0 ) {
+
+      // haven't begun reading yet
+      member = fskit_entry_set_begin( read_itr, dent->children );
+   }
+   else {
+
+      member = fskit_entry_set_seek( read_itr, dent->children, dirh->curr_name );
+   }
+
+   for( ; member != NULL && dirh->skip > 0; member = fskit_entry_set_next( read_itr ) ) {
+
+      if( fskit_readdir_visible( member ) ) {
+
+         memset( dirh->curr_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+         strncpy( dirh->curr_name, fskit_entry_set_name_at( member ), FSKIT_FILESYSTEM_NAMEMAX );
+         dirh->skip--;
+      }
+   }
+
+   dirh->skip = 0;
+   return member;
+}
+
+
+// snapshot the attributes of the i-th entry read, listed as name, for readdirplus (if sbs is not NULL).
+// the entry is referenced, so it stays put until its stat route runs; its name is kept so it can be unreferenced by its own path.
+// fent must be at least read-locked
+// return 0 on success
+// return -ENOMEM on OOM, in which case the entry is not referenced
+static int fskit_readdir_snapshot_attrs( struct fskit_entry* fent, char const* name, struct stat* sbs, struct fskit_entry** fents, char** names, uint64_t i ) {
+
+   if( sbs == NULL ) {
+      return 0;
+   }
+
+   names[i] = strdup( name );
+   if( names[i] == NULL ) {
+      return -ENOMEM;
+   }
+
+   fskit_entry_fstat( fent, &sbs[i] );
+   fskit_entry_ref_entry( fent );
+
+   fents[i] = fent;
+   return 0;
+}
+
+
+// get the path to an entry listed as name in the directory at dir_path.
+// path must have room for strlen(dir_path) + FSKIT_FILESYSTEM_NAMEMAX + 3 bytes
+static void fskit_readdir_child_path( char const* dir_path, char const* name, char* path ) {
+
+   if( strcmp( name, "." ) == 0 ) {
+      strcpy( path, dir_path );
+   }
+   else if( strcmp( name, ".." ) == 0 ) {
+      fskit_dirname( dir_path, path );
+   }
+   else {
+      fskit_fullpath( dir_path, name, path );
+   }
 }
 
 
@@ -164,11 +232,14 @@ static int fskit_readdir_find_start( struct fskit_dir_handle* dirh, fskit_entry_
 // dirh must be write-locked
 // On success, returns a duplicated copy of a range of the given directory's children (starting at the given offset), serialized as fskit_dir_entry structures.  It will be terminated with a NULL pointer.
 // Also, it sets *num_read to the number of dir entries in the returned range.
+// If ret_sbs is not NULL, then *ret_sbs gets each returned entry's attributes, *ret_fents gets a NULL-terminated list of their (referenced) entries,
+// and *ret_names gets the names they were listed under.
+// The caller owns these (and must unreference the entries) even on error.
 // On error, returns NULL and sets *err to:
 // * -EDEADLK if there was a deadlock (this is a bug, and should be reported)
 // * -ENOMEM if there was insuffucient memory
 // If there are no children left to read (i.e. child_offset is beyond the end of the directory), then this method sets *err to 0 and returns NULL to indicate EOD
-static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, struct stat** ret_sbs, struct fskit_entry*** ret_fents, char*** ret_names, int* err ) {
 
    int rc = 0;
    uint64_t read_count = 0;
@@ -179,39 +250,22 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
    fskit_entry_set_itr read_itr;
    fskit_entry_set* entry = NULL;
    
+   struct stat* sbs = NULL;
+   struct fskit_entry** fents = NULL;
+   char** names = NULL;
+   
    if( dirh->eof ) {
        // EOF
        *num_read = 0;
        return NULL;
    }
 
-   if( strlen(dirh->curr_name) == 0 ) {
-       
-       // haven't begun reading yet 
-       read_start = fskit_entry_set_begin( &read_itr, dent->children );
-       strncpy( dirh->curr_name, fskit_entry_set_name_at( read_start ), FSKIT_FILESYSTEM_NAMEMAX );
-   }
-   else {
-
-       fskit_entry_set_itr test_itr;
-       fskit_entry_set* test_entry;
-
-       fskit_readdir_find_start( dirh, &read_itr, &read_start );
-       if( read_start == NULL ) {
-           
-           // out of directory 
-           *num_read = 0;
-           return NULL;
-       }
+   read_start = fskit_readdir_resume( dirh, &read_itr );
+   if( read_start == NULL ) {
        
-       // advance to the next entry, since that's the first unread one 
-       read_start = fskit_entry_set_next( &read_itr );
-       if( read_start == NULL ) {
-           
-           // out of directory 
-           *num_read = 0;
-           return NULL;
-       }
+       // out of directory 
+       *num_read = 0;
+       return NULL;
    }
    
    // UINT64_MAX means 'all children'
@@ -227,20 +281,33 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
       return NULL;
    }
 
+   if( ret_sbs != NULL ) {
+
+      // ...and their attributes
+      sbs = CALLOC_LIST( struct stat, num_children + 1 );
+      fents = CALLOC_LIST( struct fskit_entry*, num_children + 1 );
+      names = CALLOC_LIST( char*, num_children + 1 );
+
+      *ret_sbs = sbs;
+      *ret_fents = fents;
+      *ret_names = names;
+
+      if( sbs == NULL || fents == NULL || names == NULL ) {
+
+         fskit_dir_entry_free_list( dir_ents );
+         *err = -ENOMEM;
+         return NULL;
+      }
+   }
+
    for( entry = read_start; entry != NULL && read_count < num_children; entry = fskit_entry_set_next( &read_itr ) ) {
 
       // extract values from iterators
       struct fskit_entry* fent = fskit_entry_set_child_at( entry );
       char const* fskit_name = fskit_entry_set_name_at( entry );
 
-      // skip NULL children
-      if( fent == NULL ) {
-         continue;
-      }
-      
-      // skip garbage-collectables
-      if( fent->deletion_in_progress || fent->type == FSKIT_ENTRY_TYPE_DEAD ) {
-         
+      // skip NULL children and garbage-collectables
+      if( !fskit_readdir_visible( entry ) ) {
          continue;
       }
 
@@ -252,6 +319,11 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
 
          // handle .
          dir_ent = fskit_make_dir_entry( dent, "." );
+         if( dir_ent != NULL && fskit_readdir_snapshot_attrs( dent, ".", sbs, fents, names, read_count ) != 0 ) {
+
+            fskit_dir_entry_free( dir_ent );
+            dir_ent = NULL;
+         }
       }
       else if( strcmp( fskit_name, ".." ) == 0 ) {
 
@@ -272,6 +344,11 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
          }
 
          dir_ent = fskit_make_dir_entry( fent, ".." );
+         if( dir_ent != NULL && fskit_readdir_snapshot_attrs( fent, "..", sbs, fents, names, read_count ) != 0 ) {
+
+            fskit_dir_entry_free( dir_ent );
+            dir_ent = NULL;
+         }
 
          if( dent != fent ) {
             fskit_entry_unlock( fent );
@@ -300,6 +377,11 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
          
          // snapshot this entry
          dir_ent = fskit_make_dir_entry( fent, fskit_name );
+         if( dir_ent != NULL && fskit_readdir_snapshot_attrs( fent, fskit_name, sbs, fents, names, read_count ) != 0 ) {
+
+            fskit_dir_entry_free( dir_ent );
+            dir_ent = NULL;
+         }
 
          fskit_entry_unlock( fent );
          
@@ -353,61 +435,107 @@ static struct fskit_dir_entry** fskit_readdir_lowlevel( struct fskit_core* core,
 }
 
 
-// seekdir(3)--revert to a point in the directory stream where we were reading from in the past
+// seekdir(3)--revert to a point in the directory stream where we were reading from in the past.
+// loc is a cookie from fskit_telldir or a packed record on this handle, or 0 for the beginning of the stream.
+// unknown cookies are ignored.
 void fskit_seekdir( struct fskit_dir_handle* dirh, off_t loc ) {
     
+    uint64_t pos = (uint64_t)loc & FSKIT_DIR_COOKIE_POS_MASK;
+    uint64_t skip = (uint64_t)loc >> FSKIT_DIR_COOKIE_SKIP_SHIFT;
+    
+    if( loc < 0 ) {
+        return;
+    }
+    
     fskit_dir_handle_wlock( dirh );
     
-    // where did we leave off?
-    for( struct fskit_telldir_entry* tent = dirh->telldir_list; tent != NULL; tent = tent->next ) {
-        
-        if( tent->offset == loc ) {
-            
-            fskit_entry_set_itr read_itr;
-            fskit_entry_set* read_start = NULL;
-            
-            fskit_readdir_find_start( dirh, &read_itr, &read_start );
-            
-            if( read_start != NULL ) {
-                
-                // advance directory pointer 
-                strncpy( dirh->curr_name, fskit_entry_set_name_at( read_start ), FSKIT_FILESYSTEM_NAMEMAX );
-            }
-        }
+    if( pos == 0 ) {
+
+        memset( dirh->curr_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+        dirh->skip = skip;
+        dirh->eof = false;
     }
+    else if( pos <= dirh->telldir_count ) {
+
+        // where did we leave off?
+        struct fskit_telldir_entry* tent = &dirh->telldir_pos[ pos - 1 ];
+
+        memcpy( dirh->curr_name, tent->name, FSKIT_FILESYSTEM_NAMEMAX+1 );
+        dirh->skip = tent->skip + skip;
+        dirh->eof = tent->eof;
+    }
+
     fskit_dir_handle_unlock( dirh );
 }
 
 
-// telldir(3)--store the current point in the directory stream where we are reading currently, so we can jump to it later.
-off_t fskit_telldir( struct fskit_dir_handle* dirh ) {
+// save the current point in the directory stream.
+// dirh must be write-locked
+// return the cookie on success (0 if we're at the beginning)
+// return -EBADF if we couldn't save the position (OOM)
+static off_t fskit_telldir_locked( struct fskit_dir_handle* dirh ) {
     
-    // random place...we just need it to be unique (w.h.p)
-    off_t offset = ((uint64_t)fskit_random32() << 32) | fskit_random32();
+    struct fskit_telldir_entry* tent = NULL;
     
-    struct fskit_telldir_entry* tent = CALLOC_LIST( struct fskit_telldir_entry, 1 );
-    if( tent == NULL ) {
+    if( strlen(dirh->curr_name) == 0 && dirh->skip == 0 && !dirh->eof ) {
         
-        // emulate POSIX compliance
-        return -EBADF;
+        // haven't begun reading yet
+        return 0;
     }
     
-    // sanpshot read stream 
-    fskit_dir_handle_wlock( dirh );
-    
-    tent->offset = offset;
-    
-    if( strlen(dirh->curr_name) > 0 ) {
-        strcpy( tent->name, dirh->curr_name );
+    if( dirh->telldir_count > 0 ) {
+
+        // still where we were last time?
+        tent = &dirh->telldir_pos[ dirh->telldir_count - 1 ];
+        if( tent->eof == dirh->eof && tent->skip == dirh->skip && strcmp( tent->name, dirh->curr_name ) == 0 ) {
+
+            return dirh->telldir_count;
+        }
     }
-    else {
-        memset( tent->name, 0, FSKIT_FILESYSTEM_NAMEMAX );
+
+    if( dirh->telldir_count == dirh->telldir_cap ) {
+
+        size_t new_cap = (dirh->telldir_cap > 0 ? dirh->telldir_cap * 2 : 8);
+        struct fskit_telldir_entry* new_pos = NULL;
+        
+        if( new_cap > FSKIT_DIR_COOKIE_POS_MASK ) {
+            return -EBADF;
+        }
+        
+        new_pos = (struct fskit_telldir_entry*)realloc( dirh->telldir_pos, new_cap * sizeof(struct fskit_telldir_entry) );
+        if( new_pos == NULL ) {
+
+            // emulate POSIX compliance
+            return -EBADF;
+        }
+
+        dirh->telldir_pos = new_pos;
+        dirh->telldir_cap = new_cap;
     }
+
+    // snapshot read stream
+    tent = &dirh->telldir_pos[ dirh->telldir_count ];
+
+    memcpy( tent->name, dirh->curr_name, FSKIT_FILESYSTEM_NAMEMAX+1 );
+    tent->skip = dirh->skip;
+    tent->eof = dirh->eof;
+
+    dirh->telldir_count++;
+    return dirh->telldir_count;
+}
+
+
+// telldir(3)--store the current point in the directory stream where we are reading currently, so we can jump to it later.
+// cookies are handed out in increasing order, starting at 1 (0 is the beginning), and stay valid until the handle is closed.
+// return the cookie on success
+// return -EBADF if we couldn't save the position (OOM)
+off_t fskit_telldir( struct fskit_dir_handle* dirh ) {
+    
+    off_t offset = 0;
+    
+    fskit_dir_handle_wlock( dirh );
     
-    // insert...
-    struct fskit_telldir_entry* tmp = dirh->telldir_list;
-    tent->next = tmp;
-    dirh->telldir_list = tent;
+    offset = fskit_telldir_locked( dirh );
     
     fskit_dir_handle_unlock( dirh );
     return offset;
@@ -417,14 +545,7 @@ off_t fskit_telldir( struct fskit_dir_handle* dirh ) {
 // make the directory stream point to the beginning
 void fskit_rewinddir( struct fskit_dir_handle* dirh ) {
     
-    fskit_entry_set_itr read_itr;
-    
-    fskit_dir_handle_wlock( dirh );
-    
-    fskit_entry_set* start = fskit_entry_set_begin( &read_itr, dirh->dent->children );
-    strncpy( dirh->curr_name, fskit_entry_set_name_at( start ), FSKIT_FILESYSTEM_NAMEMAX );
-    
-    fskit_dir_handle_unlock( dirh );
+    fskit_seekdir( dirh, 0 );
 } 
 
 
@@ -482,20 +603,95 @@ int fskit_readdir_compactify_list( struct fskit_dir_entry*** ret_entries, uint64
 }
 
 
+// run the user's stat route on each of the entries read by readdirplus, so their attributes match what fskit_stat would give.
+// dents[i] is the entry (NULL if omitted), fents[i] is its inode, and sbs[i] has its attributes.
+// dir_path is the path to the directory they were read from.
+// NOTE: the inodes must not be locked, but must be referenced
+// return 0 on success
+// return -ENOMEM on OOM
+// return negative if a stat route failed
+static int fskit_run_user_stat_list( struct fskit_core* core, char const* dir_path, struct fskit_dir_entry** dents, struct fskit_entry** fents, struct stat* sbs, uint64_t num_dents ) {
+
+   int rc = 0;
+   char* path = CALLOC_LIST( char, strlen(dir_path) + FSKIT_FILESYSTEM_NAMEMAX + 3 );
+
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+
+   for( uint64_t i = 0; i < num_dents; i++ ) {
+
+      if( dents[i] == NULL ) {
+         // omitted by the readdir route
+         continue;
+      }
+
+      fskit_readdir_child_path( dir_path, dents[i]->name, path );
+
+      rc = fskit_do_user_stat( core, path, fents[i], &sbs[i] );
+      if( rc != 0 ) {
+         break;
+      }
+   }
+
+   fskit_safe_free( path );
+   return rc;
+}
+
+
+// unreference the entries readdirplus referenced, and free the list of them and of their names.
+// each is unreferenced by its own path, since this may drop the last reference to one that was unlinked in the meantime.
+// dir_path is the path to the directory they were read from.
+// always succeeds
+static int fskit_readdir_unref_list( struct fskit_core* core, char const* dir_path, struct fskit_entry** fents, char** names ) {
+
+   char* path = CALLOC_LIST( char, strlen(dir_path) + FSKIT_FILESYSTEM_NAMEMAX + 3 );
+
+   for( uint64_t i = 0; fents[i] != NULL; i++ ) {
+
+      if( path != NULL ) {
+
+         fskit_readdir_child_path( dir_path, names[i], path );
+         fskit_entry_unref( core, path, fents[i] );
+      }
+      else {
+
+         // OOM; the reference has to go regardless
+         fskit_entry_unref( core, dir_path, fents[i] );
+      }
+   }
+
+   for( uint64_t i = 0; names[i] != NULL; i++ ) {
+      fskit_safe_free( names[i] );
+   }
+
+   fskit_safe_free( path );
+   fskit_safe_free( fents );
+   fskit_safe_free( names );
+
+   return 0;
+}
+
+
 // read data from a directory, using the given directory handle.
+// if ret_sbs is not NULL, then also get each entry's attributes (as fskit_stat would), and put them into *ret_sbs.
 // returns a null-terminated list of directory entries
 // on failure, it sets *err to one of the following:
 // * -ENOMEM if no memory
 // * -EDEADLK if there would be deadlock (this is a bug if it happens)
 // * -EBADF if the directory hadndle is invalid
-struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+static struct fskit_dir_entry** fskit_readdir_ex( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, struct stat** ret_sbs, int* err ) {
 
    int rc = 0;
+   struct stat* sbs = NULL;
+   struct fskit_entry** fents = NULL;
+   char** names = NULL;
 
-   rc = fskit_dir_handle_rlock( dirh );
+   // we advance the handle's read position
+   rc = fskit_dir_handle_wlock( dirh );
    if( rc != 0 ) {
       // shouldn't happen--indicates deadlock
-      fskit_error("fskit_dir_handle_rlock(%p) rc = %d\n", dirh, rc );
+      fskit_error("fskit_dir_handle_wlock(%p) rc = %d\n", dirh, rc );
       *err = rc;
       return NULL;
    }
@@ -519,7 +715,7 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
       return NULL;
    }
    
-   struct fskit_dir_entry** dents = fskit_readdir_lowlevel( core, dirh, num_children, num_read, err );
+   struct fskit_dir_entry** dents = fskit_readdir_lowlevel( core, dirh, num_children, num_read, (ret_sbs != NULL ? &sbs : NULL), &fents, &names, err );
 
    fskit_entry_unlock( dirh->dent );
    
@@ -527,6 +723,12 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
       
       // run the user's readdir
       rc = fskit_run_user_readdir( core, dirh->path, dirh->dent, dents, *num_read );
+      if( rc == 0 && sbs != NULL ) {
+
+         // run the user's stat on what's left
+         rc = fskit_run_user_stat_list( core, dirh->path, dents, fents, sbs, *num_read );
+      }
+
       if( rc != 0 ) {
 
          fskit_dir_entry_free_list( dents );
@@ -539,6 +741,19 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
          
          // compactify the results--the user callback may have omitted some 
          uint64_t new_num_read = 0;
+
+         if( sbs != NULL ) {
+
+            // keep the attributes lined up with their entries
+            for( uint64_t i = 0; i < *num_read; i++ ) {
+
+               if( dents[i] != NULL ) {
+                  sbs[new_num_read] = sbs[i];
+                  new_num_read++;
+               }
+            }
+         }
+
          rc = fskit_readdir_compactify_list( &dents, *num_read, &new_num_read );
 
          if( rc != 0 ) {
@@ -553,14 +768,640 @@ struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_di
       }
    }
 
+   if( fents != NULL && names != NULL ) {
+
+      // done with the inodes
+      fskit_readdir_unref_list( core, dirh->path, fents, names );
+   }
+   else {
+
+      fskit_safe_free( fents );
+      fskit_safe_free( names );
+   }
+
    fskit_dir_handle_unlock( dirh );
 
+   if( ret_sbs != NULL ) {
+
+      if( dents != NULL ) {
+         *ret_sbs = sbs;
+      }
+      else {
+         fskit_safe_free( sbs );
+      }
+   }
+
    return dents;
 }
 
+
+// read data from a directory, using the given directory handle.
+// returns a null-terminated list of directory entries
+// on failure, it sets *err to one of the following:
+// * -ENOMEM if no memory
+// * -EDEADLK if there would be deadlock (this is a bug if it happens)
+// * -EBADF if the directory hadndle is invalid
+struct fskit_dir_entry** fskit_readdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, int* err ) {
+   return fskit_readdir_ex( core, dirh, num_children, num_read, NULL, err );
+}
+
 // list a whole directory's data
 // returns a null-terminated list of entries, and set *num_read to the number actually consumed 
 // return NULL on error, and set *err
 struct fskit_dir_entry** fskit_listdir( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err ) {
+
+   if( core->listcache != NULL ) {
+      return fskit_listdir_cached( core, dirh, num_read, err );
+   }
+
    return fskit_readdir( core, dirh, UINT64_MAX, num_read, err );
 }
+
+// readdirplus--read data from a directory, along with each entry's attributes, in one pass.
+// *ret_sbs is set to an array of *num_read stat buffers, filled in as fskit_stat would (i.e. the stat route runs on each entry).
+// the caller must free it.
+// returns a null-terminated list of directory entries
+// return NULL on error or EOD, as fskit_readdir does
+struct fskit_dir_entry** fskit_readdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t num_children, uint64_t* num_read, struct stat** ret_sbs, int* err ) {
+
+   *ret_sbs = NULL;
+   return fskit_readdir_ex( core, dirh, num_children, num_read, ret_sbs, err );
+}
+
+// list a whole directory's data, along with each entry's attributes
+// return NULL on error, and set *err
+struct fskit_dir_entry** fskit_listdirplus( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, struct stat** ret_sbs, int* err ) {
+   return fskit_readdirplus( core, dirh, UINT64_MAX, num_read, ret_sbs, err );
+}
+
+
+// iterate over a buffer of packed records, as filled in by fskit_readdir_buf.
+// pass NULL for rec to get the first record.
+// return the record after rec, or NULL if there are no more
+struct fskit_dir_record* fskit_dir_record_next( char* buf, size_t buflen, struct fskit_dir_record* rec ) {
+
+   size_t off = 0;
+
+   if( rec != NULL ) {
+      off = ((char*)rec - buf) + rec->reclen;
+   }
+
+   if( off + offsetof( struct fskit_dir_record, name ) > buflen ) {
+      return NULL;
+   }
+
+   rec = (struct fskit_dir_record*)(buf + off);
+   if( rec->reclen == 0 || off + rec->reclen > buflen ) {
+      return NULL;
+   }
+
+   return rec;
+}
+
+
+// user-called method to omit a packed record from a directory listing
+int fskit_dir_record_omit( struct fskit_dir_record* rec ) {
+
+   rec->type = FSKIT_ENTRY_TYPE_DEAD;
+   return 0;
+}
+
+
+// pack a directory's child into a record.
+// fent is the child, and dent is the directory (which must be at least read-locked)
+// rec must have room for FSKIT_DIR_RECORD_LEN( namelen ) bytes.
+// return 0 on success
+// return -EDEADLK if we couldn't lock fent (this is a bug)
+static int fskit_dir_record_pack( struct fskit_entry* dent, struct fskit_entry* fent, char const* name, size_t namelen, struct fskit_dir_record* rec ) {
+
+   int rc = 0;
+   size_t reclen = FSKIT_DIR_RECORD_LEN( namelen );
+
+   // careful--the directory's . and .. can be dent itself
+   if( fent != dent ) {
+
+      rc = fskit_entry_rlock( fent );
+      if( rc != 0 ) {
+
+         // shouldn't happen--indicates deadlock
+         fskit_error("BUG: fskit_entry_rlock(%p) rc = %d\n", fent, rc );
+         return rc;
+      }
+   }
+
+   memset( rec, 0, reclen );
+
+   rec->file_id = fent->file_id;
+   rec->type = fent->type;
+
+   if( fent != dent ) {
+      fskit_entry_unlock( fent );
+   }
+
+   rec->reclen = reclen;
+   rec->namelen = namelen;
+   memcpy( rec->name, name, namelen );
+
+   return 0;
+}
+
+
+// pack the records that aren't omitted to the front of the buffer
+// return the number of bytes they take up
+static size_t fskit_dir_record_compactify( char* buf, size_t buflen ) {
+
+   size_t used = 0;
+   struct fskit_dir_record* rec = NULL;
+   struct fskit_dir_record* next = NULL;
+
+   for( rec = fskit_dir_record_next( buf, buflen, NULL ); rec != NULL; rec = next ) {
+
+      // find the next one before we move this one
+      next = fskit_dir_record_next( buf, buflen, rec );
+
+      if( rec->type == FSKIT_ENTRY_TYPE_DEAD ) {
+         continue;
+      }
+
+      if( (char*)rec != buf + used ) {
+         memmove( buf + used, rec, rec->reclen );
+      }
+
+      used += ((struct fskit_dir_record*)(buf + used))->reclen;
+   }
+
+   return used;
+}
+
+
+// run a readdir route callback over a buffer of packed records.
+// it gets them as a list of directory entries, and the records whose entries it omits get omitted.
+// return the callback's result
+// return -ENOMEM if we couldn't make the list
+// return -ENOSYS if there is no callback
+int fskit_readdir_dispatch_packed( fskit_entry_route_readdir_callback_t readdir_cb, struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen ) {
+
+   int rc = 0;
+   uint64_t num_dents = 0;
+   uint64_t i = 0;
+   struct fskit_dir_entry** dents = NULL;
+   struct fskit_dir_record* rec = NULL;
+
+   if( readdir_cb == NULL ) {
+      return -ENOSYS;
+   }
+
+   for( rec = fskit_dir_record_next( buf, buflen, NULL ); rec != NULL; rec = fskit_dir_record_next( buf, buflen, rec ) ) {
+      num_dents++;
+   }
+
+   dents = CALLOC_LIST( struct fskit_dir_entry*, num_dents + 1 );
+   if( dents == NULL ) {
+      return -ENOMEM;
+   }
+
+   for( rec = fskit_dir_record_next( buf, buflen, NULL ); rec != NULL; rec = fskit_dir_record_next( buf, buflen, rec ) ) {
+
+      dents[i] = CALLOC_LIST( struct fskit_dir_entry, 1 );
+      if( dents[i] == NULL ) {
+
+         fskit_dir_entry_free_list( dents );
+         return -ENOMEM;
+      }
+
+      dents[i]->type = rec->type;
+      dents[i]->file_id = rec->file_id;
+      memcpy( dents[i]->name, rec->name, rec->namelen );
+      i++;
+   }
+
+   rc = (*readdir_cb)( core, route_metadata, fent, dents, num_dents );
+
+   i = 0;
+   for( rec = fskit_dir_record_next( buf, buflen, NULL ); rec != NULL; rec = fskit_dir_record_next( buf, buflen, rec ) ) {
+
+      if( dents[i] == NULL ) {
+
+         // omitted
+         fskit_dir_record_omit( rec );
+      }
+      else {
+
+         fskit_dir_entry_free( dents[i] );
+      }
+
+      i++;
+   }
+
+   fskit_safe_free( dents );
+   return rc;
+}
+
+
+// read as many directory entries as fit into buf, starting with the first one not yet read from dirh, and run the user's readdir over them.
+// dirh must be write-locked
+// return the number of bytes filled in on success, which can be 0 if the route omitted every entry; *eod is set if there were none left to read.
+// return negative on error, as fskit_readdir_buf does.
+static ssize_t fskit_readdir_buf_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, char* buf, size_t buflen, bool* eod ) {
+
+   int rc = 0;
+   size_t used = 0;
+   uint64_t consumed = 0;
+   off_t anchor = 0;
+   off_t cookie = 0;
+   struct fskit_entry* dent = dirh->dent;
+   fskit_entry_set_itr read_itr;
+   fskit_entry_set* entry = NULL;
+   struct fskit_dir_record* last = NULL;
+
+   if( dirh->eof ) {
+
+      *eod = true;
+      return 0;
+   }
+
+   // records in this batch count the entries read since here
+   anchor = fskit_telldir_locked( dirh );
+   if( anchor < 0 ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_entry_rlock( dent );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_entry_rlock(%p) rc = %d\n", dent, rc );
+      return rc;
+   }
+
+   for( entry = fskit_readdir_resume( dirh, &read_itr ); entry != NULL; entry = fskit_entry_set_next( &read_itr ) ) {
+
+      char const* name = fskit_entry_set_name_at( entry );
+      size_t namelen = strnlen( name, FSKIT_FILESYSTEM_NAMEMAX );
+      struct fskit_dir_record* rec = (struct fskit_dir_record*)(buf + used);
+
+      // skip NULL children and garbage-collectables
+      if( !fskit_readdir_visible( entry ) ) {
+         continue;
+      }
+
+      if( used + FSKIT_DIR_RECORD_LEN( namelen ) > buflen || consumed + 1 >= FSKIT_DIR_COOKIE_SKIP_MAX ) {
+         // full
+         break;
+      }
+
+      rc = fskit_dir_record_pack( dent, fskit_entry_set_child_at( entry ), name, namelen, rec );
+      if( rc != 0 ) {
+         break;
+      }
+
+      consumed++;
+      rec->next = anchor | (off_t)(consumed << FSKIT_DIR_COOKIE_SKIP_SHIFT);
+
+      // remember the last name, so we can resume there
+      memset( dirh->curr_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+      memcpy( dirh->curr_name, name, namelen );
+
+      used += rec->reclen;
+      last = rec;
+   }
+
+   fskit_entry_unlock( dent );
+
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   if( used == 0 ) {
+
+      if( entry != NULL ) {
+
+         // no room for the next entry
+         return -EINVAL;
+      }
+
+      // further attempts to read will EOF
+      dirh->eof = true;
+      *eod = true;
+      return 0;
+   }
+
+   // resuming after the last record needn't re-count the batch
+   cookie = fskit_telldir_locked( dirh );
+   if( cookie > 0 ) {
+      last->next = cookie;
+   }
+
+   // run the user's readdir
+   rc = fskit_run_user_readdir_buf( core, dirh->path, dent, buf, used, NULL );
+   if( rc < 0 ) {
+      return rc;
+   }
+
+   // the user callback may have omitted some
+   return fskit_dir_record_compactify( buf, used );
+}
+
+
+// read as many directory entries as fit into buf, starting with the first one not yet read from dirh.
+// they are packed as struct fskit_dir_record records (like getdents64), which can be walked with fskit_dir_record_next.
+// each record's next cookie can be given to fskit_seekdir to resume reading right after it.
+// the readdir_buf route (or, failing that, the readdir route) may omit entries; only the rest are returned.
+// return the number of bytes filled in on success, or 0 if there are no entries left to read.
+// return -EINVAL if buf is too small to hold the next entry
+// return -EBADF if the directory handle is invalid
+// return -ENOMEM if we couldn't save the read position
+// return -EDEADLK if there was a deadlock (this is a bug, and should be reported)
+ssize_t fskit_readdir_buf( struct fskit_core* core, struct fskit_dir_handle* dirh, char* buf, size_t buflen ) {
+
+   int rc = 0;
+   ssize_t used = 0;
+   bool eod = false;
+
+   // we advance the handle's read position
+   rc = fskit_dir_handle_wlock( dirh );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_dir_handle_wlock(%p) rc = %d\n", dirh, rc );
+      return rc;
+   }
+
+   // sanity check
+   if( dirh->dent == NULL ) {
+
+      // invalid
+      fskit_dir_handle_unlock( dirh );
+      return -EBADF;
+   }
+
+   // keep going if the route omitted a whole batch
+   do {
+      used = fskit_readdir_buf_lowlevel( core, dirh, buf, buflen, &eod );
+   } while( used == 0 && !eod );
+
+   fskit_dir_handle_unlock( dirh );
+
+   return used;
+}
+
+
+// pack every visible child of dent into a new buffer of records, in the order fskit_readdir lists them.
+// dent must be at least read-locked
+// return 0 on success, and set *ret_buf (malloc'ed, or NULL if there is nothing to list) and *ret_len
+// return -ENOMEM on OOM
+// return -EDEADLK if there was a deadlock (this is a bug, and should be reported)
+static int fskit_listdir_pack( struct fskit_entry* dent, char** ret_buf, size_t* ret_len ) {
+
+   int rc = 0;
+   size_t len = 0;
+   size_t used = 0;
+   char* buf = NULL;
+   fskit_entry_set_itr itr;
+   fskit_entry_set* entry = NULL;
+
+   *ret_buf = NULL;
+   *ret_len = 0;
+
+   // size it up...
+   for( entry = fskit_entry_set_begin( &itr, dent->children ); entry != NULL; entry = fskit_entry_set_next( &itr ) ) {
+
+      if( fskit_readdir_visible( entry ) ) {
+         len += FSKIT_DIR_RECORD_LEN( strnlen( fskit_entry_set_name_at( entry ), FSKIT_FILESYSTEM_NAMEMAX ) );
+      }
+   }
+
+   if( len == 0 ) {
+      return 0;
+   }
+
+   buf = CALLOC_LIST( char, len );
+   if( buf == NULL ) {
+      return -ENOMEM;
+   }
+
+   // ...and fill it in
+   for( entry = fskit_entry_set_begin( &itr, dent->children ); entry != NULL; entry = fskit_entry_set_next( &itr ) ) {
+
+      char const* name = fskit_entry_set_name_at( entry );
+      size_t namelen = strnlen( name, FSKIT_FILESYSTEM_NAMEMAX );
+
+      if( !fskit_readdir_visible( entry ) ) {
+         continue;
+      }
+
+      rc = fskit_dir_record_pack( dent, fskit_entry_set_child_at( entry ), name, namelen, (struct fskit_dir_record*)(buf + used) );
+      if( rc != 0 ) {
+
+         fskit_safe_free( buf );
+         return rc;
+      }
+
+      used += FSKIT_DIR_RECORD_LEN( namelen );
+   }
+
+   *ret_buf = buf;
+   *ret_len = used;
+   return 0;
+}
+
+
+// get a snapshot of dirh's whole directory, as fskit_listdir would list it.
+// it comes from the listing cache if the directory's children haven't changed since it was cached.
+// otherwise, the directory is listed and the readdir_buf route (or, failing that, the readdir route) runs over it.
+// the result is only cached if no route ran, since a route can list the directory differently each time.
+// dirh must be at least read-locked
+// return a reference to the snapshot on success
+// return NULL on error, and set *err as fskit_listdir_snapshot does
+static struct fskit_dir_snapshot* fskit_listdir_snapshot_lowlevel( struct fskit_core* core, struct fskit_dir_handle* dirh, int* err ) {
+
+   int rc = 0;
+   bool routed = false;
+   char* buf = NULL;
+   size_t len = 0;
+   uint64_t file_id = 0;
+   uint64_t gen = 0;
+   uint64_t route_gen = 0;
+   struct fskit_dir_snapshot* snapshot = NULL;
+
+   // snapshots taken before a route change could have been filtered differently
+   route_gen = __atomic_load_n( &core->route_gen, __ATOMIC_ACQUIRE );
+
+   rc = fskit_entry_rlock( dirh->dent );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_entry_rlock(%p) rc = %d\n", dirh->dent, rc );
+      *err = rc;
+      return NULL;
+   }
+
+   file_id = dirh->dent->file_id;
+   gen = dirh->dent->children_gen;
+
+   snapshot = fskit_listcache_lookup( core, file_id, dirh->path, gen, route_gen );
+   if( snapshot == NULL ) {
+      rc = fskit_listdir_pack( dirh->dent, &buf, &len );
+   }
+
+   fskit_entry_unlock( dirh->dent );
+
+   if( snapshot != NULL ) {
+      return snapshot;
+   }
+
+   if( rc != 0 ) {
+      *err = rc;
+      return NULL;
+   }
+
+   if( buf != NULL ) {
+
+      // run the user's readdir
+      rc = fskit_run_user_readdir_buf( core, dirh->path, dirh->dent, buf, len, &routed );
+      if( rc < 0 ) {
+
+         fskit_safe_free( buf );
+         *err = rc;
+         return NULL;
+      }
+
+      // the user callback may have omitted some
+      len = fskit_dir_record_compactify( buf, len );
+   }
+
+   snapshot = fskit_dir_snapshot_new( file_id, dirh->path, gen, route_gen, buf, len );
+   if( snapshot == NULL ) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   if( !routed ) {
+      fskit_listcache_insert( core, snapshot );
+   }
+
+   return snapshot;
+}
+
+
+// get an immutable listing of the whole directory that dirh refers to, as fskit_listdir would list it
+// (but as packed records, which can be walked with fskit_dir_snapshot_next).
+// if the listing cache is enabled (see fskit_core_listcache_enable), the same snapshot is shared by
+// every caller until a child is added, removed, or renamed.  It does not change dirh's read position.
+// the caller must release it with fskit_dir_snapshot_unref.
+// return NULL on error, and set *err to:
+// * -ENOMEM if there was insufficient memory
+// * -EBADF if the directory handle is invalid
+// * -EDEADLK if there was a deadlock (this is a bug, and should be reported)
+// * the route's error, if the readdir route failed
+struct fskit_dir_snapshot* fskit_listdir_snapshot( struct fskit_core* core, struct fskit_dir_handle* dirh, int* err ) {
+
+   int rc = 0;
+   struct fskit_dir_snapshot* snapshot = NULL;
+
+   *err = 0;
+
+   rc = fskit_dir_handle_rlock( dirh );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_dir_handle_rlock(%p) rc = %d\n", dirh, rc );
+      *err = rc;
+      return NULL;
+   }
+
+   if( dirh->dent == NULL ) {
+
+      // invalid
+      fskit_dir_handle_unlock( dirh );
+      *err = -EBADF;
+      return NULL;
+   }
+
+   snapshot = fskit_listdir_snapshot_lowlevel( core, dirh, err );
+
+   fskit_dir_handle_unlock( dirh );
+
+   return snapshot;
+}
+
+
+// list a whole directory from its snapshot (see fskit_listdir_snapshot), if dirh hasn't been read from yet.
+// this leaves dirh at the end of the directory.  Otherwise, read the rest of the directory as usual.
+// returns a null-terminated list of entries, and sets *num_read to the number listed
+// return NULL on error or EOD, as fskit_readdir does
+static struct fskit_dir_entry** fskit_listdir_cached( struct fskit_core* core, struct fskit_dir_handle* dirh, uint64_t* num_read, int* err ) {
+
+   int rc = 0;
+   uint64_t i = 0;
+   struct fskit_dir_snapshot* snapshot = NULL;
+   struct fskit_dir_record const* rec = NULL;
+   struct fskit_dir_record const* last = NULL;
+   struct fskit_dir_entry** dents = NULL;
+
+   *num_read = 0;
+
+   // we advance the handle's read position
+   rc = fskit_dir_handle_wlock( dirh );
+   if( rc != 0 ) {
+      // shouldn't happen--indicates deadlock
+      fskit_error("fskit_dir_handle_wlock(%p) rc = %d\n", dirh, rc );
+      *err = rc;
+      return NULL;
+   }
+
+   if( dirh->dent == NULL || dirh->eof || dirh->skip > 0 || strlen(dirh->curr_name) > 0 ) {
+
+      // invalid, or not at the beginning
+      fskit_dir_handle_unlock( dirh );
+      return fskit_readdir( core, dirh, UINT64_MAX, num_read, err );
+   }
+
+   snapshot = fskit_listdir_snapshot_lowlevel( core, dirh, err );
+   if( snapshot == NULL ) {
+
+      fskit_dir_handle_unlock( dirh );
+      return NULL;
+   }
+
+   if( fskit_dir_snapshot_count( snapshot ) > 0 ) {
+
+      dents = CALLOC_LIST( struct fskit_dir_entry*, fskit_dir_snapshot_count( snapshot ) + 1 );
+      if( dents == NULL ) {
+         *err = -ENOMEM;
+      }
+   }
+
+   for( rec = fskit_dir_snapshot_next( snapshot, NULL ); dents != NULL && rec != NULL; rec = fskit_dir_snapshot_next( snapshot, rec ) ) {
+
+      dents[i] = CALLOC_LIST( struct fskit_dir_entry, 1 );
+      if( dents[i] == NULL ) {
+
+         fskit_dir_entry_free_list( dents );
+         dents = NULL;
+         *err = -ENOMEM;
+         break;
+      }
+
+      dents[i]->type = rec->type;
+      dents[i]->file_id = rec->file_id;
+      memcpy( dents[i]->name, rec->name, rec->namelen );
+
+      last = rec;
+      i++;
+   }
+
+   if( *err == 0 ) {
+
+      // everything has been read
+      if( last != NULL ) {
+
+         memset( dirh->curr_name, 0, FSKIT_FILESYSTEM_NAMEMAX+1 );
+         memcpy( dirh->curr_name, last->name, last->namelen );
+      }
+
+      dirh->eof = true;
+      *num_read = i;
+   }
+
+   fskit_dir_snapshot_unref( snapshot );
+   fskit_dir_handle_unlock( dirh );
+
+   return dents;
+}
@@ -21,6 +21,7 @@
 
 #include <fskit/rename.h>
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 #include <fskit/util.h>
 #include <fskit/route.h>
 #include <fskit/entry.h>
@@ -215,19 +216,27 @@ int fskit_entry_rename_in_directory( struct fskit_entry* fent_parent, struct fsk
       return -ENOMEM;
    }
    
+   FSKIT_ENTRY_WRITE_BEGIN( fent_parent );
+
    fskit_entry_set_remove( &fent_parent->children, old_name );
    
    fskit_entry_set_remove( &fent_parent->children, new_name );
    fskit_entry_set_insert( &fent_parent->children, new_name, fent );
+   fskit_entry_bump_children_gen( fent_parent );
+
+   FSKIT_ENTRY_WRITE_END( fent_parent );
    
    return 0;
 }
 
 
 // rename the inode at old_path to the one at new_path. This is an atomic operation.
+// old_path's parent is resolved from old_dir (whose path is old_dir_path) if possible, and from root otherwise.
+// new_path's parent is always resolved from root if it differs from old_path's, since we need all of its ancestors
+// to make sure we're not moving a directory beneath itself.
 // return 0 on success
 // return negative on failure to resolve either old_path or new_path (see path_resolution(7))
-int fskit_rename( struct fskit_core* core, char const* old_path, char const* new_path, uint64_t user, uint64_t group ) {
+static int fskit_rename_in( struct fskit_core* core, struct fskit_entry* old_dir, char const* old_dir_path, char const* old_path, char const* new_path, uint64_t user, uint64_t group ) {
 
    int err_old = 0, err_new = 0, err = 0;
 
@@ -250,7 +259,7 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
    // resolve the parent *lower* in the FS hierarchy first.  order matters due to locking!
    if( fskit_depth( old_path ) > fskit_depth( new_path ) ) {
 
-      fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
+      fent_old_parent = fskit_entry_resolve_path_in( core, old_dir, old_dir_path, old_path_dirname, user, group, true, &err_old );
       if( fent_old_parent != NULL ) {
 
          fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
@@ -259,20 +268,20 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
    else if( fskit_depth( old_path ) < fskit_depth( new_path ) ) {
 
       fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
-      fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
+      fent_old_parent = fskit_entry_resolve_path_in( core, old_dir, old_dir_path, old_path_dirname, user, group, true, &err_old );
    }
    else {
       // do these paths have the same parent?
       if( strcmp( old_path_dirname, new_path_dirname ) == 0 ) {
          
          // only resolve one path
-         fent_common_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
+         fent_common_parent = fskit_entry_resolve_path_in( core, old_dir, old_dir_path, old_path_dirname, user, group, true, &err_old );
       }
       else {
          
          // parents are different; safe to lock both
          fent_new_parent = fskit_entry_resolve_inodes( core, new_path_dirname, user, group, &err_new, &new_path_inodes );
-         fent_old_parent = fskit_entry_resolve_path( core, old_path_dirname, user, group, true, &err_old );
+         fent_old_parent = fskit_entry_resolve_path_in( core, old_dir, old_dir_path, old_path_dirname, user, group, true, &err_old );
       }
    }
 
@@ -436,6 +445,9 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
    struct fskit_entry* dest_parent = NULL;
    err = 0;
 
+   // old_path (and everything beneath it) is about to move
+   fskit_core_dcache_invalidate( core );
+
    if( fent_common_parent != NULL ) {
 
       // dealing with entries in the same directory
@@ -499,3 +511,46 @@ int fskit_rename( struct fskit_core* core, char const* old_path, char const* new
 
    return err;
 }
+
+
+// rename the inode at old_path to the one at new_path. This is an atomic operation.
+// return 0 on success
+// return negative on failure to resolve either old_path or new_path (see path_resolution(7))
+int fskit_rename( struct fskit_core* core, char const* old_path, char const* new_path, uint64_t user, uint64_t group ) {
+   return fskit_rename_in( core, NULL, NULL, old_path, new_path, user, group );
+}
+
+
+// rename the inode at old_path (relative to old_dirh) to new_path (relative to new_dirh).
+// old_path's parent is found without re-resolving old_dirh from root.
+// new_path's parent is resolved from root unless it is the same as old_path's, since renaming
+// a directory into another one has to check every ancestor of the destination.
+// routes see the directories' paths joined with old_path and new_path.
+// return 0 on success
+// return negative on failure to resolve either old_path or new_path (see path_resolution(7)), or -ENOMEM on OOM
+int fskit_renameat( struct fskit_core* core, struct fskit_dir_handle* old_dirh, char const* old_path, struct fskit_dir_handle* new_dirh, char const* new_path, uint64_t user, uint64_t group ) {
+
+   int rc = 0;
+   struct fskit_entry* old_dir = NULL;
+   struct fskit_entry* new_dir = NULL;
+   char const* old_dir_path = NULL;
+   char const* new_dir_path = NULL;
+   char* old_full_path = NULL;
+   char* new_full_path = NULL;
+
+   old_full_path = fskit_path_at( old_dirh, old_path, &old_dir, &old_dir_path );
+   new_full_path = fskit_path_at( new_dirh, new_path, &new_dir, &new_dir_path );
+
+   if( old_full_path == NULL || new_full_path == NULL ) {
+
+      fskit_safe_free( old_full_path );
+      fskit_safe_free( new_full_path );
+      return -ENOMEM;
+   }
+
+   rc = fskit_rename_in( core, old_dir, old_dir_path, old_full_path, new_full_path, user, group );
+
+   fskit_safe_free( old_full_path );
+   fskit_safe_free( new_full_path );
+   return rc;
+}
@@ -21,6 +21,7 @@
 
 #include <fskit/rmdir.h>
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 #include <fskit/util.h>
 
 #include "fskit_private/private.h"
@@ -111,6 +112,9 @@ int fskit_rmdir( struct fskit_core* core, char const* _path, uint64_t user, uint
       return -ENOTEMPTY;
    }
 
+   // path will no longer resolve to dent
+   fskit_core_dcache_invalidate( core );
+
    // empty. Detach from the filesystem
    rc = fskit_entry_detach_lowlevel( parent, path_basename );
    fskit_safe_free( path_basename );
@@ -25,10 +25,65 @@
 
 #include "fskit_private/private.h"
 
+// maximum number of regex match groups to keep on the stack when matching a route
+#define FSKIT_ROUTE_MATCH_STACK_MAX 16
+
+// bytes of stack space a route call uses for its match groups before falling back to the heap
+#define FSKIT_ROUTE_ARENA_SIZE 1024
+
+// maximum number of distinct route prefixes a path can match before we just try every route
+#define FSKIT_ROUTE_TRIE_MAX_CANDIDATES 32
+
+// how a route's regex gets matched
+#define FSKIT_ROUTE_PROG_REGEX          0       // regexec
+#define FSKIT_ROUTE_PROG_ANY            1       // FSKIT_ROUTE_ANY
+#define FSKIT_ROUTE_PROG_SEGMENTS       2       // literal components and [^/]+ components, separated by /
+
+// path component matchers
+#define FSKIT_ROUTE_SEGMENT_LITERAL     0       // exactly this string
+#define FSKIT_ROUTE_SEGMENT_NAME        1       // [^/]+
+#define FSKIT_ROUTE_SEGMENT_CAPTURE     2       // ([^/]+)
+
+// ERE characters that are not matched literally
+#define FSKIT_ROUTE_REGEX_SPECIAL       ".[]()*+?{}|^$\\"
+
+struct fskit_route_segment {
+
+   int type;                    // FSKIT_ROUTE_SEGMENT_*
+   char const* literal;         // for FSKIT_ROUTE_SEGMENT_LITERAL (points into the route's regex string)
+   size_t len;
+};
+
+// per-call scratch space for route metadata, so that matching a route needn't touch the heap
+struct fskit_route_arena {
+
+   union {
+      char buf[ FSKIT_ROUTE_ARENA_SIZE ];
+      void* align;
+   } mem;
+
+   size_t used;
+};
+
+// node in a route row's literal prefix trie
+struct fskit_route_trie_node {
+
+   char c;
+   struct fskit_route_trie_node* children;
+   struct fskit_route_trie_node* next;          // next sibling
+
+   // ids of the routes whose prefix ends here, in row order
+   unsigned long* route_ids;
+   int num_route_ids;
+};
+
 struct fskit_route_table_row {
    
    int route_type;
    fskit_route_list_t routes;
+
+   // routes indexed by literal prefix (NULL if it couldn't be built; then every route is a candidate)
+   struct fskit_route_trie_node* trie;
    
    // for rb tree
    struct fskit_route_table_row* left;
@@ -37,10 +92,21 @@ struct fskit_route_table_row {
 };
 
 
+// an immutable route table, shared by every route call that referenced it while it was current
+struct fskit_route_snapshot {
+
+   int refcount;                // one for the core, plus one per route call using it
+   uint64_t gen;                // core->route_gen when this snapshot was made
+   fskit_route_table* routes;
+};
+
+
 SGLIB_DEFINE_VECTOR_FUNCTIONS( fskit_path_route_entry );
 
 SGLIB_DEFINE_RBTREE_FUNCTIONS( fskit_route_table, left, right, color, FSKIT_ROUTE_TABLE_ROW_CMP );
 
+static void fskit_path_route_unref( struct fskit_path_route* route );
+
 
 // new empty route table 
 fskit_route_table* fskit_route_table_new(void) {
@@ -95,6 +161,107 @@ static int fskit_route_table_row_append( struct fskit_route_table_row* row, stru
    return sglib_fskit_path_route_entry_vector_push_back( &row->routes, route );
 }
 
+// free a prefix trie
+static void fskit_route_trie_free( struct fskit_route_trie_node* node ) {
+
+   struct fskit_route_trie_node* next = NULL;
+
+   while( node != NULL ) {
+
+      next = node->next;
+
+      fskit_route_trie_free( node->children );
+      fskit_safe_free( node->route_ids );
+      free( node );
+
+      node = next;
+   }
+}
+
+// find a node's child for a character
+static struct fskit_route_trie_node* fskit_route_trie_child( struct fskit_route_trie_node* node, char c ) {
+
+   for( struct fskit_route_trie_node* child = node->children; child != NULL; child = child->next ) {
+
+      if( child->c == c ) {
+         return child;
+      }
+   }
+
+   return NULL;
+}
+
+// add a route id under a prefix
+// return 0 on success, -ENOMEM on OOM
+static int fskit_route_trie_insert( struct fskit_route_trie_node* root, char const* prefix, size_t prefix_len, unsigned long route_id ) {
+
+   struct fskit_route_trie_node* node = root;
+   struct fskit_route_trie_node* child = NULL;
+   unsigned long* route_ids = NULL;
+
+   for( size_t i = 0; i < prefix_len; i++ ) {
+
+      child = fskit_route_trie_child( node, prefix[i] );
+      if( child == NULL ) {
+
+         child = CALLOC_LIST( struct fskit_route_trie_node, 1 );
+         if( child == NULL ) {
+            return -ENOMEM;
+         }
+
+         child->c = prefix[i];
+         child->next = node->children;
+         node->children = child;
+      }
+
+      node = child;
+   }
+
+   route_ids = (unsigned long*)realloc( node->route_ids, sizeof(unsigned long) * (node->num_route_ids + 1) );
+   if( route_ids == NULL ) {
+      return -ENOMEM;
+   }
+
+   route_ids[ node->num_route_ids ] = route_id;
+   node->route_ids = route_ids;
+   node->num_route_ids++;
+
+   return 0;
+}
+
+// (re)build a row's prefix trie from its routes.
+// on OOM, the row is left without one, and every route will be tried.
+static void fskit_route_table_row_index( struct fskit_route_table_row* row ) {
+
+   int rc = 0;
+   struct fskit_route_trie_node* root = NULL;
+
+   fskit_route_trie_free( row->trie );
+   row->trie = NULL;
+
+   root = CALLOC_LIST( struct fskit_route_trie_node, 1 );
+   if( root == NULL ) {
+      return;
+   }
+
+   for( unsigned long i = 0; i < fskit_route_table_row_len( row ); i++ ) {
+
+      struct fskit_path_route* route = fskit_route_table_row_at_ref( row, i );
+      if( route == NULL ) {
+         continue;
+      }
+
+      rc = fskit_route_trie_insert( root, route->prefix, route->prefix_len, i );
+      if( rc != 0 ) {
+
+         fskit_route_trie_free( root );
+         return;
+      }
+   }
+
+   row->trie = root;
+}
+
 // start iterating over a route table
 struct fskit_route_table_row* fskit_route_table_begin( fskit_route_table_itr* itr, fskit_route_table* route_table ) {
    
@@ -107,7 +274,7 @@ struct fskit_route_table_row* fskit_route_table_next( fskit_route_table_itr* itr
    return sglib_fskit_route_table_it_next( itr );
 }
 
-// free up a row, and all the routes it contains.
+// free up a row, and release all the routes it contains.
 int fskit_route_table_row_free( struct fskit_route_table_row* row ) {
    
    if( row != NULL ) {
@@ -119,11 +286,13 @@ int fskit_route_table_row_free( struct fskit_route_table_row* row ) {
              continue;
          }
          
-         fskit_path_route_free( route );
-         fskit_safe_free( route );
+         fskit_path_route_unref( route );
       }
       
       sglib_fskit_path_route_entry_vector_free( &row->routes );
+
+      fskit_route_trie_free( row->trie );
+      row->trie = NULL;
    }
    
    return 0;
@@ -153,6 +322,100 @@ int fskit_route_table_free( fskit_route_table* route_table ) {
 }
 
 
+// copy a route table.  the copy shares (and references) the original's routes.
+// return NULL on OOM
+fskit_route_table* fskit_route_table_dup( fskit_route_table* route_table ) {
+
+   fskit_route_table* ret = NULL;
+   fskit_route_table_itr itr;
+   struct fskit_route_table_row* row = NULL;
+   struct fskit_route_table_row* new_row = NULL;
+
+   for( row = fskit_route_table_begin( &itr, route_table ); row != NULL; row = fskit_route_table_next( &itr ) ) {
+
+      new_row = fskit_route_table_row_new( row->route_type );
+      if( new_row == NULL ) {
+
+         fskit_route_table_free( ret );
+         return NULL;
+      }
+
+      // keep the holes, so route handles stay the same
+      for( unsigned long i = 0; i < fskit_route_table_row_len( row ); i++ ) {
+
+         if( fskit_route_table_row_append( new_row, fskit_route_table_row_at_ref( row, i ) ) < 0 ) {
+
+            sglib_fskit_path_route_entry_vector_free( &new_row->routes );
+            fskit_safe_free( new_row );
+            fskit_route_table_free( ret );
+            return NULL;
+         }
+      }
+
+      for( unsigned long i = 0; i < fskit_route_table_row_len( new_row ); i++ ) {
+
+         struct fskit_path_route* route = fskit_route_table_row_at_ref( new_row, i );
+         if( route != NULL ) {
+            __atomic_add_fetch( &route->refcount, 1, __ATOMIC_RELAXED );
+         }
+      }
+
+      fskit_route_table_row_index( new_row );
+
+      sglib_fskit_route_table_add( &ret, new_row );
+   }
+
+   return ret;
+}
+
+
+// make a route table snapshot, which takes ownership of routes
+// return NULL on OOM
+struct fskit_route_snapshot* fskit_route_snapshot_new( fskit_route_table* routes, uint64_t gen ) {
+
+   struct fskit_route_snapshot* snapshot = CALLOC_LIST( struct fskit_route_snapshot, 1 );
+   if( snapshot == NULL ) {
+      return NULL;
+   }
+
+   snapshot->refcount = 1;
+   snapshot->gen = gen;
+   snapshot->routes = routes;
+
+   return snapshot;
+}
+
+
+// release a reference to a route table snapshot.
+// the last reference frees it, and releases its routes.
+void fskit_route_snapshot_unref( struct fskit_route_snapshot* snapshot ) {
+
+   if( snapshot == NULL || __atomic_sub_fetch( &snapshot->refcount, 1, __ATOMIC_ACQ_REL ) > 0 ) {
+      return;
+   }
+
+   fskit_route_table_free( snapshot->routes );
+   free( snapshot );
+}
+
+
+// reference the core's current route table snapshot.
+// route changes swap in a new snapshot instead of waiting for us to finish with this one.
+static struct fskit_route_snapshot* fskit_route_snapshot_get( struct fskit_core* core ) {
+
+   struct fskit_route_snapshot* snapshot = NULL;
+
+   fskit_core_route_rlock( core );
+
+   snapshot = core->routes;
+   __atomic_add_fetch( &snapshot->refcount, 1, __ATOMIC_RELAXED );
+
+   fskit_core_route_unlock( core );
+
+   return snapshot;
+}
+
+
 // insert a route into the route table.  Puts the pointer only; does not duplicate the route (i.e. the table owns the route now).
 // return a route ID on success (>= 0)
 // return -ENOMEM on OOM 
@@ -204,6 +467,8 @@ int fskit_route_table_insert( fskit_route_table** route_table, int route_type, s
       route_id = fskit_route_table_row_len( row ) - 1;      
    }
    
+   fskit_route_table_row_index( row );
+
    fskit_debug("Add new route table row entry %p for type %d at %d\n", route, route_type, route_id );
    return route_id;
 }
@@ -277,13 +542,17 @@ struct fskit_path_route* fskit_route_table_remove( fskit_route_table** route_tab
       fskit_route_table_row_free( row );
       fskit_safe_free( row );
    }
+   else {
+
+      fskit_route_table_row_index( row );
+   }
    
    return route;
 }
 
 
 // initialize route metadata
-// the match group becomes the owner of matches
+// the match group becomes the owner of matches, but only borrows matched_path
 // return 0 on success
 static int fskit_route_metadata_init( struct fskit_route_metadata* route_metadata, char* matched_path, int num_matches, char** matches ) {
    memset( route_metadata, 0, sizeof(struct fskit_route_metadata) );
@@ -301,7 +570,7 @@ static int fskit_route_metadata_init( struct fskit_route_metadata* route_metadat
 // return 0 on success
 static int fskit_route_metadata_free( struct fskit_route_metadata* route_metadata ) {
 
-   if( route_metadata->argv != NULL ) {
+   if( route_metadata->argv != NULL && route_metadata->argv_on_heap ) {
 
       for( int i = 0; i < route_metadata->argc; i++ ) {
 
@@ -316,22 +585,29 @@ static int fskit_route_metadata_free( struct fskit_route_metadata* route_metadat
       route_metadata->argv = NULL;
    }
 
+   // NOTE: path and name are borrowed from the caller, so don't free them
 
-   if( route_metadata->path != NULL ) {
+   memset( route_metadata, 0, sizeof(struct fskit_route_metadata) );
 
-      fskit_safe_free( route_metadata->path );
-      route_metadata->path = NULL;
-   }
-   
-   if( route_metadata->name != NULL ) {
-      
-      fskit_safe_free( route_metadata->name );
-      route_metadata->name = NULL;
+   return 0;
+}
+
+
+// allocate space from a route call's arena
+// return NULL if there isn't enough left
+static void* fskit_route_arena_alloc( struct fskit_route_arena* arena, size_t size ) {
+
+   size_t off = (arena->used + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+   void* ret = NULL;
+
+   if( off > FSKIT_ROUTE_ARENA_SIZE || size > FSKIT_ROUTE_ARENA_SIZE - off ) {
+      return NULL;
    }
 
-   memset( route_metadata, 0, sizeof(struct fskit_route_metadata) );
+   ret = arena->mem.buf + off;
+   arena->used = off + size;
 
-   return 0;
+   return ret;
 }
 
 
@@ -357,79 +633,267 @@ static int fskit_num_expected_matches( char const* path ) {
    return num_groups + 1;
 }
 
-// match a path against a regex, and fill in the given match group with the matched strings
+// free a regmatch buffer, if it was allocated (i.e. isn't the given stack buffer)
+static void fskit_route_match_buf_free( regmatch_t* m, regmatch_t* stack_buf ) {
+
+   if( m != stack_buf ) {
+      free( m );
+   }
+}
+
+// match a path against FSKIT_ROUTE_ANY, filling in m the way regexec would
+// return 0 on match, REG_NOMATCH if not, or -1 if regexec has to decide
+static int fskit_route_exec_any( char const* path, size_t nmatch, regmatch_t* m ) {
+
+   size_t i = 0;
+   regoff_t last_name = -1;
+
+   if( path[0] != '/' ) {
+      // a match can't start at the beginning of the path
+      return REG_NOMATCH;
+   }
+
+   while( path[i] == '/' ) {
+      i++;
+   }
+
+   // the group captures the last repetition: the last name and any slashes after it
+   for( ; path[i] != '\0'; i++ ) {
+
+      if( path[i] == '\n' ) {
+         return -1;
+      }
+
+      if( path[i] != '/' && path[i-1] == '/' ) {
+         last_name = i;
+      }
+   }
+
+   for( size_t j = 0; j < nmatch; j++ ) {
+      m[j].rm_so = -1;
+      m[j].rm_eo = -1;
+   }
+
+   if( nmatch > 0 ) {
+      m[0].rm_so = 0;
+      m[0].rm_eo = i;
+   }
+
+   if( nmatch > 1 && last_name >= 0 ) {
+      m[1].rm_so = last_name;
+      m[1].rm_eo = i;
+   }
+
+   return 0;
+}
+
+// match a whole path against a route's path components, filling in m the way regexec would
+// return 0 on match, REG_NOMATCH if not, or -1 if regexec has to decide
+static int fskit_route_exec_segments( struct fskit_path_route* route, char const* path, size_t nmatch, regmatch_t* m ) {
+
+   char const* p = path;
+   char const* end = NULL;
+   size_t group = 1;
+
+   for( size_t j = 0; j < nmatch; j++ ) {
+      m[j].rm_so = -1;
+      m[j].rm_eo = -1;
+   }
+
+   for( int i = 0; i < route->num_segments; i++ ) {
+
+      struct fskit_route_segment* seg = &route->segments[i];
+
+      if( i > 0 ) {
+
+         if( *p != '/' ) {
+            return REG_NOMATCH;
+         }
+
+         p++;
+      }
+
+      for( end = p; *end != '/' && *end != '\0'; end++ ) {
+
+         if( *end == '\n' ) {
+            return -1;
+         }
+      }
+
+      if( seg->type == FSKIT_ROUTE_SEGMENT_LITERAL ) {
+
+         if( (size_t)(end - p) != seg->len || memcmp( p, seg->literal, seg->len ) != 0 ) {
+            return REG_NOMATCH;
+         }
+      }
+      else {
+
+         if( end == p ) {
+            return REG_NOMATCH;
+         }
+
+         if( seg->type == FSKIT_ROUTE_SEGMENT_CAPTURE ) {
+
+            if( group < nmatch ) {
+               m[group].rm_so = p - path;
+               m[group].rm_eo = end - path;
+            }
+
+            group++;
+         }
+      }
+
+      p = end;
+   }
+
+   if( *p != '\0' ) {
+      return REG_NOMATCH;
+   }
+
+   if( nmatch > 0 ) {
+      m[0].rm_so = 0;
+      m[0].rm_eo = p - path;
+   }
+
+   return 0;
+}
+
+// run a route's matcher on a path.
+// fill in m[0] through m[nmatch-1] exactly as regexec would for the whole-path match;
+// a match that doesn't cover the whole path may be reported as no match.
+// return 0 on match, nonzero if not
+static int fskit_route_exec( struct fskit_path_route* route, char const* path, size_t nmatch, regmatch_t* m ) {
+
+   int rc = -1;
+
+   if( route->prog == FSKIT_ROUTE_PROG_ANY ) {
+      rc = fskit_route_exec_any( path, nmatch, m );
+   }
+   else if( route->prog == FSKIT_ROUTE_PROG_SEGMENTS ) {
+      rc = fskit_route_exec_segments( route, path, nmatch, m );
+   }
+
+   if( rc < 0 ) {
+      rc = regexec( &route->path_regex, path, nmatch, m, 0 );
+   }
+
+   return rc;
+}
+
+// match a path against a regex, and fill in the given match group with the matched strings.
+// the route metadata borrows path; it must remain valid until the metadata is freed.
+// the match groups go into the arena if they fit, and onto the heap otherwise.
 // return 0 on success, -ENOMEM on oom
-static int fskit_match_regex( struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, char const* path ) {
+static int fskit_match_regex( struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, char const* path, struct fskit_route_arena* arena ) {
 
    int rc = 0;
-   regmatch_t* m = CALLOC_LIST( regmatch_t, route->num_expected_matches + 1 );
-   size_t path_len = strlen(path);
+   regmatch_t m_buf[ FSKIT_ROUTE_MATCH_STACK_MAX ];
+   regmatch_t* m = m_buf;
+   size_t path_len = 0;
 
-   if( m == NULL ) {
+   // most routes have only a few groups, so avoid the heap if we can
+   if( route->num_expected_matches + 1 > FSKIT_ROUTE_MATCH_STACK_MAX ) {
 
-      return -ENOMEM;
+      m = CALLOC_LIST( regmatch_t, route->num_expected_matches + 1 );
+      if( m == NULL ) {
+
+         return -ENOMEM;
+      }
+   }
+   else {
+
+      memset( m_buf, 0, sizeof(regmatch_t) * (route->num_expected_matches + 1) );
    }
 
-   rc = regexec( &route->path_regex, path, route->num_expected_matches, m, 0 );
+   rc = fskit_route_exec( route, path, route->num_expected_matches, m );
 
    if( rc != 0 ) {
       // no matches
-      fskit_safe_free( m );
+      fskit_route_match_buf_free( m, m_buf );
       return -ENOENT;
    }
 
    // sanity check
    if( m[0].rm_so < 0 || m[0].rm_eo < 0 ) {
       // no match
-      fskit_safe_free( m );
+      fskit_route_match_buf_free( m, m_buf );
       return -ENOENT;
    }
 
    // matched! whole path?
+   path_len = strlen(path);
    if( (signed)path_len != m[0].rm_eo - m[0].rm_so ) {
       // didn't match the whole path
       fskit_debug("Matched only %d:%d of 0:%zu in '%s'\n", m[0].rm_so, m[0].rm_eo, path_len, path );
-      fskit_safe_free( m );
+      fskit_route_match_buf_free( m, m_buf );
       return -ENOENT;
    }
 
-   char** argv = CALLOC_LIST( char*, route->num_expected_matches + 1 );
-   if( argv == NULL ) {
+   // how much space do the match groups need?
+   int i = 1;
+   size_t argv_len = sizeof(char*) * (route->num_expected_matches + 1);
+   size_t strings_len = 0;
 
-      fskit_safe_free( m );
-      return -ENOMEM;
+   for( i = 1; i <= route->num_expected_matches && m[i].rm_so >= 0 && m[i].rm_eo >= 0; i++ ) {
+      strings_len += m[i].rm_eo - m[i].rm_so + 1;
    }
 
-   char* path_dup = strdup( path );
-   if( path_dup == NULL ) {
+   char** argv = NULL;
+   char* strings = NULL;
+   bool argv_on_heap = false;
 
-      FREE_LIST( argv );
-      fskit_safe_free( m );
-      return -ENOMEM;
+   if( arena != NULL ) {
+      argv = (char**)fskit_route_arena_alloc( arena, argv_len + strings_len );
    }
 
-   // accumulate matches
-   int i = 1;
-   for( i = 1; i <= route->num_expected_matches && m[i].rm_so >= 0 && m[i].rm_eo >= 0; i++ ) {
+   if( argv != NULL ) {
+
+      // one block: the argv array, then the strings
+      memset( argv, 0, argv_len );
+      strings = (char*)argv + argv_len;
+
+      for( i = 1; i <= route->num_expected_matches && m[i].rm_so >= 0 && m[i].rm_eo >= 0; i++ ) {
+
+         memcpy( strings, path + m[i].rm_so, m[i].rm_eo - m[i].rm_so );
+         strings[ m[i].rm_eo - m[i].rm_so ] = '\0';
+
+         argv[i-1] = strings;
+         strings += m[i].rm_eo - m[i].rm_so + 1;
+      }
+   }
+   else {
 
-      char* next_match = CALLOC_LIST( char, m[i].rm_eo - m[i].rm_so + 1 );
-      if( next_match == NULL ) {
+      argv = CALLOC_LIST( char*, route->num_expected_matches + 1 );
+      if( argv == NULL ) {
 
-         FREE_LIST( argv );
-         fskit_safe_free( argv );
-         fskit_safe_free( m );
+         fskit_route_match_buf_free( m, m_buf );
          return -ENOMEM;
       }
 
-      strncpy( next_match, path + m[i].rm_so, m[i].rm_eo - m[i].rm_so );
+      argv_on_heap = true;
+
+      // accumulate matches
+      for( i = 1; i <= route->num_expected_matches && m[i].rm_so >= 0 && m[i].rm_eo >= 0; i++ ) {
+
+         char* next_match = CALLOC_LIST( char, m[i].rm_eo - m[i].rm_so + 1 );
+         if( next_match == NULL ) {
 
-      argv[i-1] = next_match;
+            FREE_LIST( argv );
+            fskit_route_match_buf_free( m, m_buf );
+            return -ENOMEM;
+         }
+
+         strncpy( next_match, path + m[i].rm_so, m[i].rm_eo - m[i].rm_so );
+
+         argv[i-1] = next_match;
+      }
    }
 
    // i is the number of args
-   fskit_route_metadata_init( route_metadata, path_dup, i, argv );
+   fskit_route_metadata_init( route_metadata, (char*)path, i, argv );
+   route_metadata->argv_on_heap = argv_on_heap;
 
-   fskit_safe_free( m );
+   fskit_route_match_buf_free( m, m_buf );
    return 0;
 }
 
@@ -441,36 +905,136 @@ static bool fskit_path_route_is_defined( struct fskit_path_route* route ) {
    return route->path_regex_str != NULL;
 }
 
-// start running a route's callback.
-// enforce the consistency discipline by locking the route appropriately
-static int fskit_route_enter( struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+// find the striped lock that serializes a route call under the FSKIT_INODE_STRIPED or FSKIT_HANDLE_SEQUENTIAL discipline.
+// calls through a handle are keyed by the handle under FSKIT_HANDLE_SEQUENTIAL; everything else is keyed by inode.
+// return NULL if there is nothing to serialize on (i.e. no inode)
+static pthread_mutex_t* fskit_route_stripe( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
 
-   int rc = 0;
-   
-   if( fent == NULL && !dargs->fent_absent ) {
-       fskit_error("%s", "BUG: entry is NULL\n");
-       exit(1);
-   }
-  
-   // the fent must be ref'ed before the route is called 
-   if( fent != NULL && route->route_type != FSKIT_ROUTE_MATCH_DETACH && route->route_type != FSKIT_ROUTE_MATCH_DESTROY && fent->open_count <= 0 && fent->link_count <= 0 ) {
-      fskit_error("\n\nBUG: entry %p is not ref'ed (open = %d, link = %d)\n\n", fent, fent->open_count, fent->link_count);
-      exit(1);
-   }
+   uint64_t key = 0;
 
-   // enforce the consistency discipline for this route
-   if( route->consistency_discipline == FSKIT_SEQUENTIAL ) {
-      rc = pthread_rwlock_wrlock( &route->lock );
+   if( route->consistency_discipline == FSKIT_HANDLE_SEQUENTIAL && dargs->handle != NULL ) {
+      key = (uint64_t)(uintptr_t)dargs->handle;
    }
-   else if( route->consistency_discipline == FSKIT_CONCURRENT ) {
-      rc = pthread_rwlock_rdlock( &route->lock );
+   else if( fent != NULL ) {
+      key = fent->file_id;
    }
-   else if( fent != NULL && route->consistency_discipline == FSKIT_INODE_SEQUENTIAL ) {
+   else {
+      return NULL;
+   }
+
+   // mix the bits, since neither inode numbers nor pointers are uniform in their low bits
+   key ^= key >> 33;
+   key *= 0xff51afd7ed558ccdULL;
+   key ^= key >> 33;
+
+   return &core->route_stripes[ key % FSKIT_ROUTE_LOCK_STRIPES ].u.lock;
+}
+
+// is this an asynchronous I/O route?
+static bool fskit_route_is_async( struct fskit_path_route* route ) {
+
+   return route->route_type == FSKIT_ROUTE_MATCH_READ_ASYNC || route->route_type == FSKIT_ROUTE_MATCH_WRITE_ASYNC || route->route_type == FSKIT_ROUTE_MATCH_TRUNC_ASYNC;
+}
+
+// is this a discipline that serializes through the core's striped locks?
+static bool fskit_route_is_striped( struct fskit_path_route* route ) {
+
+   return route->consistency_discipline == FSKIT_INODE_STRIPED || route->consistency_discipline == FSKIT_HANDLE_SEQUENTIAL;
+}
+
+// find the byte range a route call covers under the FSKIT_RANGE_SEQUENTIAL discipline.
+// reads and writes cover the bytes they transfer (prefetches, the bytes they will read), and truncates cover everything from the new size onward.
+// any other call covers the whole file.
+// return true if the range may be shared with other overlapping non-exclusive ranges (i.e. it's a read)
+static bool fskit_route_range( struct fskit_path_route* route, struct fskit_route_dispatch_args* dargs, uint64_t* start, uint64_t* end ) {
+
+   uint64_t off = (dargs->iooff > 0 ? (uint64_t)dargs->iooff : 0);
+
+   switch( route->route_type ) {
+
+      case FSKIT_ROUTE_MATCH_READ:
+      case FSKIT_ROUTE_MATCH_WRITE:
+      case FSKIT_ROUTE_MATCH_READV:
+      case FSKIT_ROUTE_MATCH_WRITEV:
+      case FSKIT_ROUTE_MATCH_READ_ASYNC:
+      case FSKIT_ROUTE_MATCH_WRITE_ASYNC:
+      case FSKIT_ROUTE_MATCH_PREFETCH:
+
+         *start = off;
+         *end = (off + dargs->iolen < off ? UINT64_MAX : off + dargs->iolen);
+         return route->route_type == FSKIT_ROUTE_MATCH_READ || route->route_type == FSKIT_ROUTE_MATCH_READV || route->route_type == FSKIT_ROUTE_MATCH_READ_ASYNC || route->route_type == FSKIT_ROUTE_MATCH_PREFETCH;
+
+      case FSKIT_ROUTE_MATCH_TRUNC:
+      case FSKIT_ROUTE_MATCH_TRUNC_ASYNC:
+
+         *start = off;
+         *end = UINT64_MAX;
+         return false;
+
+      default:
+
+         *start = 0;
+         *end = UINT64_MAX;
+         return false;
+   }
+}
+
+// start running a route's callback.
+// enforce the consistency discipline by locking the route appropriately.
+// range is filled in with the byte range held under FSKIT_RANGE_SEQUENTIAL.
+// return 0 on success
+// return -ENOMEM if out of memory
+static int fskit_route_enter( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, struct fskit_range_lock_ent* range ) {
+
+   int rc = 0;
+   pthread_mutex_t* stripe = NULL;
+   struct fskit_range_lock* rl = NULL;
+   uint64_t start = 0;
+   uint64_t end = 0;
+   bool shared = false;
+   
+   if( fent == NULL && !dargs->fent_absent ) {
+       fskit_error("%s", "BUG: entry is NULL\n");
+       exit(1);
+   }
+  
+   // the fent must be ref'ed before the route is called 
+   if( fent != NULL && route->route_type != FSKIT_ROUTE_MATCH_DETACH && route->route_type != FSKIT_ROUTE_MATCH_DESTROY && FSKIT_ENTRY_OPEN_COUNT( fent ) <= 0 && FSKIT_ENTRY_LINK_COUNT( fent ) <= 0 ) {
+      fskit_error("\n\nBUG: entry %p is not ref'ed (open = %d, link = %d)\n\n", fent, FSKIT_ENTRY_OPEN_COUNT( fent ), FSKIT_ENTRY_LINK_COUNT( fent ));
+      exit(1);
+   }
+
+   // enforce the consistency discipline for this route
+   if( route->consistency_discipline == FSKIT_SEQUENTIAL ) {
+      rc = pthread_rwlock_wrlock( &route->lock );
+   }
+   else if( route->consistency_discipline == FSKIT_CONCURRENT && !fskit_route_is_async( route ) ) {
+      // (asynchronous routes may be left in another thread, so they can't hold the route's lock)
+      rc = pthread_rwlock_rdlock( &route->lock );
+   }
+   else if( fent != NULL && route->consistency_discipline == FSKIT_INODE_SEQUENTIAL ) {
       rc = fskit_entry_wlock( fent );
    }
    else if( fent != NULL && route->consistency_discipline == FSKIT_INODE_CONCURRENT ) {
       rc = fskit_entry_rlock( fent );
    }
+   else if( fskit_route_is_striped( route ) ) {
+
+      stripe = fskit_route_stripe( core, route, fent, dargs );
+      if( stripe != NULL ) {
+         rc = pthread_mutex_lock( stripe );
+      }
+   }
+   else if( fent != NULL && route->consistency_discipline == FSKIT_RANGE_SEQUENTIAL ) {
+
+      rl = fskit_entry_range_lock( fent );
+      if( rl == NULL ) {
+         return -ENOMEM;
+      }
+
+      shared = fskit_route_range( route, dargs, &start, &end );
+      rc = fskit_range_lock( rl, range, start, end, !shared );
+   }
    
    if( rc != 0 ) {
       // indicates deadlock
@@ -483,20 +1047,89 @@ static int fskit_route_enter( struct fskit_path_route* route, struct fskit_entry
 
 // finish running a route's callback.
 // clean up from enforcing the consistency discipline
-static int fskit_route_leave( struct fskit_path_route* route, struct fskit_entry* fent ) {
+static int fskit_route_leave( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, struct fskit_range_lock_ent* range ) {
    
+   pthread_mutex_t* stripe = NULL;
+
    if( fent != NULL && (route->consistency_discipline == FSKIT_INODE_SEQUENTIAL || route->consistency_discipline == FSKIT_INODE_CONCURRENT) ) {
       fskit_entry_unlock( fent );
    }
-   else if( route->consistency_discipline == FSKIT_SEQUENTIAL || route->consistency_discipline == FSKIT_CONCURRENT ) {
+   else if( route->consistency_discipline == FSKIT_SEQUENTIAL || (route->consistency_discipline == FSKIT_CONCURRENT && !fskit_route_is_async( route )) ) {
       pthread_rwlock_unlock( &route->lock );
    }
+   else if( fskit_route_is_striped( route ) ) {
+
+      stripe = fskit_route_stripe( core, route, fent, dargs );
+      if( stripe != NULL ) {
+         pthread_mutex_unlock( stripe );
+      }
+   }
+   else if( fent != NULL && route->consistency_discipline == FSKIT_RANGE_SEQUENTIAL ) {
+      fskit_range_unlock( fent->range_lock, range );
+   }
    
    return 0;
 }
 
+// run an I/O continuation.
+// the continuation updates the inode's metadata, so it needs the inode's write lock.  FSKIT_INODE_SEQUENTIAL already holds it,
+// and FSKIT_INODE_CONCURRENT holds the read lock, so its continuation waits for fskit_route_io_cont_left.
+// the other disciplines don't hold the inode's lock at all, so take it here.
+static void fskit_route_io_cont( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int rc ) {
+
+   if( route->consistency_discipline == FSKIT_INODE_SEQUENTIAL ) {
+
+      (*dargs->io_cont)( core, fent, dargs->iooff, rc );
+   }
+   else if( route->consistency_discipline != FSKIT_INODE_CONCURRENT ) {
+
+      fskit_entry_wlock( fent );
+      (*dargs->io_cont)( core, fent, dargs->iooff, rc );
+      fskit_entry_unlock( fent );
+   }
+}
+
+// run the I/O continuation that fskit_route_io_cont put off, now that the route has been left and the inode's read lock released
+static void fskit_route_io_cont_left( struct fskit_core* core, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int rc ) {
+
+   if( dargs->io_cont != NULL && route->consistency_discipline == FSKIT_INODE_CONCURRENT ) {
+
+      fskit_entry_wlock( fent );
+      (*dargs->io_cont)( core, fent, dargs->iooff, rc );
+      fskit_entry_unlock( fent );
+   }
+}
+
 #define fskit_safe_dispatch( method, ... ) ((method) == NULL ? -ENOSYS : (*method)( __VA_ARGS__ ))
 
+// call an asynchronous I/O route.
+// the operation may complete in another thread before the callback even returns, so its token gets its own reference to the route.
+// return the callback's result; if it's FSKIT_IO_PENDING, the token (and dargs) may already be gone
+static int fskit_route_dispatch_async( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+
+   int rc = 0;
+   struct fskit_io_token* token = dargs->io_token;
+
+   __atomic_add_fetch( &route->refcount, 1, __ATOMIC_RELAXED );
+   token->route = route;
+
+   if( route->route_type == FSKIT_ROUTE_MATCH_TRUNC_ASYNC ) {
+      rc = fskit_safe_dispatch( route->method.trunc_async_cb, core, route_metadata, fent, dargs->iooff, dargs->handle_data, token );
+   }
+   else {
+      rc = fskit_safe_dispatch( route->method.io_async_cb, core, route_metadata, fent, dargs->iobuf, dargs->iolen, dargs->iooff, dargs->handle_data, token );
+   }
+
+   if( rc != FSKIT_IO_PENDING ) {
+
+      // finished already.  the caller's route table snapshot still references the route.
+      token->route = NULL;
+      fskit_path_route_unref( route );
+   }
+
+   return rc;
+}
+
 // dispatch a route
 // return the result of the callback, or -ENOSYS if the callback is NULL
 // fent *cannot* be locked--its lock status will be set through the route's consistency discipline
@@ -504,9 +1137,16 @@ static int fskit_route_leave( struct fskit_path_route* route, struct fskit_entry
 static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
 
    int rc = 0;
+   struct fskit_range_lock_ent range;
+   struct fskit_range_lock_ent* held = &range;
+
+   if( dargs->io_token != NULL ) {
+      // a pending asynchronous operation holds its range until it completes
+      held = &dargs->io_token->range;
+   }
 
    // enforce the consistency discipline
-   rc = fskit_route_enter( route, fent, dargs );
+   rc = fskit_route_enter( core, route, fent, dargs, held );
    if( rc != 0 ) {
       fskit_error("fskit_route_enter(route %s) rc = %d\n", route->path_regex_str, rc );
       return rc;
@@ -543,7 +1183,20 @@ static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_met
 
       case FSKIT_ROUTE_MATCH_READDIR:
 
-         rc = fskit_safe_dispatch( route->method.readdir_cb, core, route_metadata, fent, dargs->dents, dargs->num_dents );
+         if( dargs->dirbuf != NULL ) {
+
+            // packed records; give the callback the list it expects
+            rc = fskit_readdir_dispatch_packed( route->method.readdir_cb, core, route_metadata, fent, dargs->dirbuf, dargs->dirbuf_len );
+         }
+         else {
+
+            rc = fskit_safe_dispatch( route->method.readdir_cb, core, route_metadata, fent, dargs->dents, dargs->num_dents );
+         }
+         break;
+
+      case FSKIT_ROUTE_MATCH_READDIR_BUF:
+
+         rc = fskit_safe_dispatch( route->method.readdir_buf_cb, core, route_metadata, fent, dargs->dirbuf, dargs->dirbuf_len );
          break;
 
       case FSKIT_ROUTE_MATCH_READ:
@@ -553,18 +1206,53 @@ static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_met
 
          if( dargs->io_cont != NULL ) {
             // call the continuation within the context of the enforced consistency discipline
-            (*dargs->io_cont)( core, fent, dargs->iooff, rc );
+            fskit_route_io_cont( core, route, fent, dargs, rc );
+         }
+
+         break;
+
+      case FSKIT_ROUTE_MATCH_READV:
+      case FSKIT_ROUTE_MATCH_WRITEV:
+
+         rc = fskit_safe_dispatch( route->method.iov_cb, core, route_metadata, fent, dargs->iov, dargs->iovcnt, dargs->iooff, dargs->handle_data );
+
+         if( dargs->io_cont != NULL ) {
+            // call the continuation within the context of the enforced consistency discipline
+            fskit_route_io_cont( core, route, fent, dargs, rc );
+         }
+
+         break;
+
+      case FSKIT_ROUTE_MATCH_READ_ASYNC:
+      case FSKIT_ROUTE_MATCH_WRITE_ASYNC:
+      case FSKIT_ROUTE_MATCH_TRUNC_ASYNC:
+
+         rc = fskit_route_dispatch_async( core, route_metadata, route, fent, dargs );
+         if( rc == FSKIT_IO_PENDING ) {
+
+            // fskit_io_complete() runs the continuation and leaves the consistency discipline
+            return rc;
+         }
+
+         if( dargs->io_cont != NULL ) {
+            // call the continuation within the context of the enforced consistency discipline
+            fskit_route_io_cont( core, route, fent, dargs, rc );
          }
 
          break;
 
+      case FSKIT_ROUTE_MATCH_PREFETCH:
+
+         rc = fskit_safe_dispatch( route->method.prefetch_cb, core, route_metadata, fent, dargs->iolen, dargs->iooff, dargs->handle_data );
+         break;
+
       case FSKIT_ROUTE_MATCH_TRUNC:
 
          rc = fskit_safe_dispatch( route->method.trunc_cb, core, route_metadata, fent, dargs->iooff, dargs->handle_data );
 
          if( dargs->io_cont != NULL ) {
             // call the continuation within the context of the enforced consistency discipline
-            (*dargs->io_cont)( core, fent, dargs->iooff, rc );
+            fskit_route_io_cont( core, route, fent, dargs, rc );
          }
 
          break;
@@ -630,8 +1318,10 @@ static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_met
          rc = -EINVAL;
    }
 
-   fskit_route_leave( route, fent );
-   
+   fskit_route_leave( core, route, fent, dargs, held );
+
+   fskit_route_io_cont_left( core, route, fent, dargs, rc );
+
    if( rc < 0 ) {
        fskit_error("fskit_safe_dispatch(%d) rc = %d\n", route->route_type, rc );
    }
@@ -639,36 +1329,142 @@ static int fskit_route_dispatch( struct fskit_core* core, struct fskit_route_met
 }
 
 
+// a route dispatch, bundled up to run on a worker pool
+struct fskit_route_pool_call {
+
+   struct fskit_core* core;
+   struct fskit_route_metadata* route_metadata;
+   struct fskit_path_route* route;
+   struct fskit_entry* fent;
+   struct fskit_route_dispatch_args* dargs;
+};
+
+// run a bundled route dispatch (in a pool worker)
+static int fskit_route_pool_call_main( void* arg ) {
+
+   struct fskit_route_pool_call* call = (struct fskit_route_pool_call*)arg;
+   return fskit_route_dispatch( call->core, call->route_metadata, call->route, call->fent, call->dargs );
+}
+
+// dispatch a route call on the route's worker pool, and wait for it.
+// the consistency discipline is enforced by the worker, so we hold no route locks while we wait.
+// return the callback's result
+static int fskit_route_dispatch_pooled( struct fskit_core* core, struct fskit_route_pool* pool, struct fskit_route_metadata* route_metadata, struct fskit_path_route* route, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs ) {
+
+   struct fskit_route_pool_call call;
+
+   call.core = core;
+   call.route_metadata = route_metadata;
+   call.route = route;
+   call.fent = fent;
+   call.dargs = dargs;
+
+   return fskit_route_pool_run( pool, fskit_route_pool_call_main, &call );
+}
+
+
 // try to match a path and type to a route.
+// the match groups are allocated from arena where possible.
 // we consider it "found" if we can match on a regex in the route table.
+// only routes whose literal prefix the path starts with are tried, in the order they were declared.
 // return a pointer to the first matching route 
 // return -ENOENT if no match
 // NOTE: not thread-safe
-static struct fskit_path_route* fskit_route_match( fskit_route_table* route_table, int route_type, char const* path, struct fskit_route_metadata* route_metadata ) {
+static struct fskit_path_route* fskit_route_match( fskit_route_table* route_table, int route_type, char const* path, struct fskit_route_metadata* route_metadata, struct fskit_route_arena* arena ) {
 
    int rc = 0;
    struct fskit_path_route* route = NULL;
+   struct fskit_route_trie_node* node = NULL;
+   struct fskit_route_trie_node* candidates[ FSKIT_ROUTE_TRIE_MAX_CANDIDATES ];
+   int next[ FSKIT_ROUTE_TRIE_MAX_CANDIDATES ];
+   int num_candidates = 0;
+   bool try_all = false;
    
    struct fskit_route_table_row* row = fskit_route_table_get_row( route_table, route_type );
    
    if( row == NULL ) {
       return NULL;
    }
-   
-   for( unsigned long i = 0; i < fskit_route_table_row_len( row ); i++ ) {
-      
-      route = fskit_route_table_row_at_ref( row, i );
-      
-      if( !fskit_path_route_is_defined( route ) ) {
-         continue;
+
+   // no index (OOM)
+   try_all = (row->trie == NULL);
+
+   // find the routes whose prefixes this path starts with
+   node = row->trie;
+   for( size_t i = 0; node != NULL; i++ ) {
+
+      if( node->num_route_ids > 0 ) {
+
+         if( num_candidates >= FSKIT_ROUTE_TRIE_MAX_CANDIDATES ) {
+
+            // too many; just try them all
+            try_all = true;
+            break;
+         }
+
+         candidates[ num_candidates ] = node;
+         next[ num_candidates ] = 0;
+         num_candidates++;
       }
-      
-      // match?
-      rc = fskit_match_regex( route_metadata, route, path );
-      if( rc == 0 ) {
-         
-         // matched!
-         return route;
+
+      if( path[i] == '\0' ) {
+         break;
+      }
+
+      node = fskit_route_trie_child( node, path[i] );
+   }
+
+   if( try_all ) {
+
+      for( unsigned long i = 0; i < fskit_route_table_row_len( row ); i++ ) {
+
+         route = fskit_route_table_row_at_ref( row, i );
+
+         if( route == NULL || !fskit_path_route_is_defined( route ) ) {
+            continue;
+         }
+
+         // match?
+         rc = fskit_match_regex( route_metadata, route, path, arena );
+         if( rc == 0 ) {
+
+            // matched!
+            return route;
+         }
+      }
+   }
+   else {
+
+      // try the candidates in row order
+      while( true ) {
+
+         int best = -1;
+
+         for( int i = 0; i < num_candidates; i++ ) {
+
+            if( next[i] < candidates[i]->num_route_ids && (best < 0 || candidates[i]->route_ids[ next[i] ] < candidates[best]->route_ids[ next[best] ]) ) {
+               best = i;
+            }
+         }
+
+         if( best < 0 ) {
+            break;
+         }
+
+         route = fskit_route_table_row_at_ref( row, candidates[best]->route_ids[ next[best] ] );
+         next[best]++;
+
+         if( route == NULL || !fskit_path_route_is_defined( route ) ) {
+            continue;
+         }
+
+         // match?
+         rc = fskit_match_regex( route_metadata, route, path, arena );
+         if( rc == 0 ) {
+
+            // matched!
+            return route;
+         }
       }
    }
    
@@ -682,12 +1478,8 @@ static struct fskit_path_route* fskit_route_match( fskit_route_table* route_tabl
 // return 0 on success
 static int fskit_route_metadata_populate( struct fskit_route_metadata* route_metadata, struct fskit_route_dispatch_args* dargs ) {
    
-   if( dargs->name != NULL ) {
-      route_metadata->name = strdup( dargs->name );
-      if( route_metadata->name == NULL ) {
-         return -ENOMEM;
-      }
-   }
+   // borrowed; dargs outlives the route call
+   route_metadata->name = (char*)dargs->name;
    
    route_metadata->parent = dargs->parent;
    route_metadata->new_parent = dargs->new_parent;
@@ -702,26 +1494,248 @@ static int fskit_route_metadata_populate( struct fskit_route_metadata* route_met
 }
 
 
+
+// one remembered route match for an inode, allocated as a single block along with its path and match groups.
+// immutable once published; in-flight route calls borrow argv by holding a reference.
+struct fskit_route_cache_ent {
+
+   int refcount;                        // one for the cache slot, plus one per route call using it
+   uint64_t gen;                        // generation of the route table snapshot the match was made against
+   struct fskit_path_route* route;      // matched route, or NULL if no route matched.  only valid while that snapshot is referenced
+   char* path;                          // the path that was matched
+   int argc;
+   char** argv;                         // match groups
+};
+
+// per-inode route match cache, indexed by route type
+struct fskit_route_cache {
+
+   pthread_mutex_t lock;
+   struct fskit_route_cache_ent* ents[ FSKIT_ROUTE_NUM_ROUTE_TYPES ];
+};
+
+
+// release a reference to a cached match, freeing it on the last reference
+static void fskit_route_cache_ent_unref( struct fskit_route_cache_ent* ent ) {
+
+   if( __atomic_sub_fetch( &ent->refcount, 1, __ATOMIC_ACQ_REL ) > 0 ) {
+      return;
+   }
+
+   free( ent );
+}
+
+
+// free an inode's route cache
+// NOTE: no route call may be using it
+int fskit_route_cache_free( struct fskit_route_cache* cache ) {
+
+   if( cache == NULL ) {
+      return 0;
+   }
+
+   for( int i = 0; i < FSKIT_ROUTE_NUM_ROUTE_TYPES; i++ ) {
+
+      if( cache->ents[i] != NULL ) {
+         fskit_route_cache_ent_unref( cache->ents[i] );
+      }
+   }
+
+   pthread_mutex_destroy( &cache->lock );
+   free( cache );
+   return 0;
+}
+
+
+// can we remember the route that fent's path matches for this route type?
+// inode creation and destruction routes run once per inode, so there's nothing to gain.
+static bool fskit_route_cacheable( struct fskit_core* core, int route_type, struct fskit_entry* fent ) {
+
+   if( !__atomic_load_n( &core->route_cache, __ATOMIC_RELAXED ) || fent == NULL || route_type < 0 || route_type >= FSKIT_ROUTE_NUM_ROUTE_TYPES ) {
+      return false;
+   }
+
+   switch( route_type ) {
+
+      case FSKIT_ROUTE_MATCH_CREATE:
+      case FSKIT_ROUTE_MATCH_MKNOD:
+      case FSKIT_ROUTE_MATCH_MKDIR:
+      case FSKIT_ROUTE_MATCH_DETACH:
+      case FSKIT_ROUTE_MATCH_DESTROY:
+         return false;
+
+      default:
+         return true;
+   }
+}
+
+
+// look up the route fent's path last matched for this route type.
+// return a referenced cache entry if it was matched against the given route table generation with the same path.
+// return NULL on miss.
+// NOTE: the caller must hold a reference to the route table snapshot with generation gen; fent must be ref'ed
+static struct fskit_route_cache_ent* fskit_route_cache_lookup( struct fskit_core* core, uint64_t gen, struct fskit_entry* fent, int route_type, char const* path ) {
+
+   struct fskit_route_cache* cache = __atomic_load_n( &fent->route_cache, __ATOMIC_ACQUIRE );
+   struct fskit_route_cache_ent* ent = NULL;
+
+   if( cache != NULL ) {
+
+      pthread_mutex_lock( &cache->lock );
+
+      ent = cache->ents[ route_type ];
+
+      // the path check catches renames and hard links
+      if( ent != NULL && ent->gen == gen && strcmp( ent->path, path ) == 0 ) {
+         __atomic_add_fetch( &ent->refcount, 1, __ATOMIC_RELAXED );
+      }
+      else {
+         ent = NULL;
+      }
+
+      pthread_mutex_unlock( &cache->lock );
+   }
+
+   if( ent != NULL ) {
+      __atomic_fetch_add( &core->route_cache_hits, 1, __ATOMIC_RELAXED );
+   }
+   else {
+      __atomic_fetch_add( &core->route_cache_misses, 1, __ATOMIC_RELAXED );
+   }
+
+   return ent;
+}
+
+
+// remember that fent's path matched route (which may be NULL) for this route type in the route table with generation gen,
+// along with a copy of its match groups.
+// this is best-effort; on OOM, nothing is remembered.
+// NOTE: the caller must hold a reference to the route table snapshot with generation gen; fent must be ref'ed
+static void fskit_route_cache_insert( struct fskit_core* core, uint64_t gen, struct fskit_entry* fent, int route_type, char const* path, struct fskit_path_route* route, struct fskit_route_metadata* route_metadata ) {
+
+   struct fskit_route_cache* cache = __atomic_load_n( &fent->route_cache, __ATOMIC_ACQUIRE );
+   struct fskit_route_cache* new_cache = NULL;
+   struct fskit_route_cache_ent* ent = NULL;
+   struct fskit_route_cache_ent* old_ent = NULL;
+   size_t path_len = strlen( path );
+   size_t len = sizeof(struct fskit_route_cache_ent) + sizeof(char*) * (route_metadata->argc + 1) + path_len + 1;
+   char* strings = NULL;
+
+   if( cache == NULL ) {
+
+      new_cache = CALLOC_LIST( struct fskit_route_cache, 1 );
+      if( new_cache == NULL ) {
+         return;
+      }
+
+      pthread_mutex_init( &new_cache->lock, NULL );
+
+      // another route call on this inode may have beaten us to it
+      if( __atomic_compare_exchange_n( &fent->route_cache, &cache, new_cache, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+         cache = new_cache;
+      }
+      else {
+         fskit_route_cache_free( new_cache );
+      }
+   }
+
+   for( int i = 0; i < route_metadata->argc; i++ ) {
+
+      if( route_metadata->argv[i] != NULL ) {
+         len += strlen( route_metadata->argv[i] ) + 1;
+      }
+   }
+
+   ent = (struct fskit_route_cache_ent*)calloc( 1, len );
+   if( ent == NULL ) {
+      return;
+   }
+
+   ent->refcount = 1;
+   ent->gen = gen;
+   ent->route = route;
+   ent->argc = route_metadata->argc;
+   ent->argv = (char**)(ent + 1);
+
+   strings = (char*)(ent->argv + route_metadata->argc + 1);
+
+   for( int i = 0; i < route_metadata->argc; i++ ) {
+
+      if( route_metadata->argv[i] != NULL ) {
+
+         strcpy( strings, route_metadata->argv[i] );
+         ent->argv[i] = strings;
+         strings += strlen( strings ) + 1;
+      }
+   }
+
+   memcpy( strings, path, path_len + 1 );
+   ent->path = strings;
+
+   pthread_mutex_lock( &cache->lock );
+
+   old_ent = cache->ents[ route_type ];
+   cache->ents[ route_type ] = ent;
+
+   pthread_mutex_unlock( &cache->lock );
+
+   if( old_ent != NULL ) {
+      fskit_route_cache_ent_unref( old_ent );
+   }
+}
+
+
 // call a route
 // return 0 on success, -EPERM if no route found
 // place the callback status in *cbrc, if called.
+// the route table is not locked while the callback runs, so routes can be changed in the meantime;
+// the call finishes with the route it matched.
+// if the route cache is enabled, the route fent's path matched last time is reused as long as the route table hasn't changed.
+// match groups are built on this call's stack (unless they're too big), so dispatching a route needn't allocate.
 // NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
 int fskit_route_call( struct fskit_core* core, int route_type, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
 
    int rc = 0;   
    struct fskit_route_metadata route_metadata;   
    struct fskit_path_route* route = NULL;
+   struct fskit_route_pool* pool = NULL;
+   struct fskit_route_cache_ent* cached = NULL;
+   struct fskit_route_snapshot* snapshot = NULL;
+   struct fskit_route_arena arena;
 
    memset( &route_metadata, 0, sizeof(struct fskit_route_metadata) );
+   arena.used = 0;
 
-   // stop routes from getting changed out from under us
-   fskit_core_route_rlock( core );
+   // stop routes from getting freed out from under us
+   snapshot = fskit_route_snapshot_get( core );
+
+   if( fskit_route_cacheable( core, route_type, fent ) ) {
 
-   route = fskit_route_match( core->routes, route_type, path, &route_metadata );
+      cached = fskit_route_cache_lookup( core, snapshot->gen, fent, route_type, path );
+      if( cached != NULL ) {
+
+         // hit; borrow the cached match groups
+         route = cached->route;
+         fskit_route_metadata_init( &route_metadata, (char*)path, cached->argc, cached->argv );
+      }
+      else {
+
+         route = fskit_route_match( snapshot->routes, route_type, path, &route_metadata, &arena );
+         fskit_route_cache_insert( core, snapshot->gen, fent, route_type, path, route, &route_metadata );
+      }
+   }
+   else {
+
+      route = fskit_route_match( snapshot->routes, route_type, path, &route_metadata, &arena );
+   }
 
    if( route == NULL ) {
       // no route found
-      fskit_core_route_unlock( core );
+      if( cached != NULL ) {
+         fskit_route_cache_ent_unref( cached );
+      }
+
+      fskit_route_snapshot_unref( snapshot );
       return -EPERM;
    }
    
@@ -730,8 +1744,14 @@ int fskit_route_call( struct fskit_core* core, int route_type, char const* path,
    if( rc != 0 ) {
       
       // failed for some reason
-      fskit_core_route_unlock( core );
-      fskit_route_metadata_free( &route_metadata );
+      if( cached != NULL ) {
+         fskit_route_cache_ent_unref( cached );
+      }
+      else {
+         fskit_route_metadata_free( &route_metadata );
+      }
+
+      fskit_route_snapshot_unref( snapshot );
       return -EPERM;
    }
    
@@ -739,11 +1759,25 @@ int fskit_route_call( struct fskit_core* core, int route_type, char const* path,
    fskit_debug("Call route type %d (%d)\n", route->route_type, route_type );
                
    // dispatch
-   *cbrc = fskit_route_dispatch( core, &route_metadata, route, fent, dargs );
+   pool = __atomic_load_n( &route->pool, __ATOMIC_ACQUIRE );
+   if( pool != NULL ) {
+      *cbrc = fskit_route_dispatch_pooled( core, pool, &route_metadata, route, fent, dargs );
+   }
+   else {
+      *cbrc = fskit_route_dispatch( core, &route_metadata, route, fent, dargs );
+   }
 
-   fskit_core_route_unlock( core );
+   if( cached != NULL ) {
 
-   rc = fskit_route_metadata_free( &route_metadata );
+      // the cache owns the match groups
+      fskit_route_cache_ent_unref( cached );
+   }
+   else {
+
+      rc = fskit_route_metadata_free( &route_metadata );
+   }
+
+   fskit_route_snapshot_unref( snapshot );
    return rc;
 }
 
@@ -802,6 +1836,15 @@ int fskit_route_call_readdir( struct fskit_core* core, char const* path, struct
 }
 
 
+// call the route to read a directory into a buffer of packed records
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_readdir_buf( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_READDIR_BUF, path, fent, dargs, cbrc );
+}
+
+
 // call the route to read(). The requisite iobuf will be filled in on success.
 // return 0 if a route was called, or -EPERM if there are no routes.
 // set the route callback return code in *cbrc
@@ -820,6 +1863,33 @@ int fskit_route_call_write( struct fskit_core* core, char const* path, struct fs
 }
 
 
+// call the route to readv(). The requisite iovec buffers will be filled in on success.
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_readv( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_READV, path, fent, dargs, cbrc );
+}
+
+
+// call the route to writev().
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_writev( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_WRITEV, path, fent, dargs, cbrc );
+}
+
+
+// call the route to prefetch a byte range (readahead).
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_prefetch( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_PREFETCH, path, fent, dargs, cbrc );
+}
+
+
 // call the route to trunc().
 // return 0 if a route was called, or -EPERM if there are no routes.
 // set the route callback return code in *cbrc
@@ -829,6 +1899,55 @@ int fskit_route_call_trunc( struct fskit_core* core, char const* path, struct fs
 }
 
 
+// call the asynchronous route to read().
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc.  If it's FSKIT_IO_PENDING, dargs->io_token now belongs to the route.
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_read_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_READ_ASYNC, path, fent, dargs, cbrc );
+}
+
+
+// call the asynchronous route to write().
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc.  If it's FSKIT_IO_PENDING, dargs->io_token now belongs to the route.
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_write_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_WRITE_ASYNC, path, fent, dargs, cbrc );
+}
+
+
+// call the asynchronous route to trunc().
+// return 0 if a route was called, or -EPERM if there are no routes.
+// set the route callback return code in *cbrc.  If it's FSKIT_IO_PENDING, dargs->io_token now belongs to the route.
+// NOTE: fent *cannot* be locked--its lock status will be set through the route consistency discipline
+int fskit_route_call_trunc_async( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct fskit_route_dispatch_args* dargs, int* cbrc ) {
+   return fskit_route_call( core, FSKIT_ROUTE_MATCH_TRUNC_ASYNC, path, fent, dargs, cbrc );
+}
+
+
+// finish the route call of a pending asynchronous operation: run its I/O continuation,
+// leave its consistency discipline, and drop its reference to the route.
+// always succeeds
+int fskit_route_io_finish( struct fskit_io_token* token, ssize_t rc ) {
+
+   struct fskit_path_route* route = token->route;
+
+   if( token->dargs.io_cont != NULL ) {
+      fskit_route_io_cont( token->core, route, token->fent, &token->dargs, rc );
+   }
+
+   fskit_route_leave( token->core, route, token->fent, &token->dargs, &token->range );
+
+   fskit_route_io_cont_left( token->core, route, token->fent, &token->dargs, rc );
+
+   token->route = NULL;
+   fskit_path_route_unref( route );
+
+   return 0;
+}
+
+
 // call the route to unlink or rmdir.
 // return 0 if a route was called, or -EPERM if there are no routes.
 // set the route callback return code in *cbrc
@@ -918,6 +2037,140 @@ int fskit_route_call_removexattr( struct fskit_core* core, char const* path, str
 }
 
 
+// is this part of a regex all literal characters?
+static bool fskit_route_regex_is_literal( char const* str, size_t len ) {
+
+   for( size_t i = 0; i < len; i++ ) {
+
+      if( str[i] == '\0' || strchr( FSKIT_ROUTE_REGEX_SPECIAL, str[i] ) != NULL ) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+// find the literal prefix that every path matching a route's regex must start with.
+// since a route has to match the whole path, the match always starts at the beginning.
+static void fskit_path_route_compile_prefix( struct fskit_path_route* route ) {
+
+   char const* str = route->path_regex_str;
+   size_t len = 0;
+
+   route->prefix = str;
+   route->prefix_len = 0;
+
+   if( strchr( str, '|' ) != NULL ) {
+      // alternatives may not share a prefix
+      return;
+   }
+
+   if( str[0] == '^' ) {
+      str++;
+   }
+
+   while( str[len] != '\0' && strchr( FSKIT_ROUTE_REGEX_SPECIAL, str[len] ) == NULL ) {
+      len++;
+   }
+
+   // a quantifier makes the last character optional or repeated
+   if( len > 0 && str[len] != '\0' && strchr( "*+?{", str[len] ) != NULL ) {
+      len--;
+   }
+
+   route->prefix = str;
+   route->prefix_len = len;
+}
+
+// compile a route's regex into a simpler matcher, if it's FSKIT_ROUTE_ANY or a sequence of
+// /-separated components that are each literal, [^/]+ or ([^/]+) (optionally anchored by ^ and $).
+// otherwise, (or on OOM), the route is matched with regexec.
+static void fskit_path_route_compile( struct fskit_path_route* route ) {
+
+   char const* str = route->path_regex_str;
+   size_t len = strlen( str );
+   char const* p = NULL;
+   char const* end = NULL;
+   int num_segments = 1;
+   struct fskit_route_segment* segments = NULL;
+
+   route->prog = FSKIT_ROUTE_PROG_REGEX;
+
+   fskit_path_route_compile_prefix( route );
+
+   if( strcmp( str, FSKIT_ROUTE_ANY ) == 0 ) {
+
+      route->prog = FSKIT_ROUTE_PROG_ANY;
+      return;
+   }
+
+   if( len > 0 && str[0] == '^' ) {
+      str++;
+      len--;
+   }
+
+   if( len > 0 && str[len-1] == '$' ) {
+      len--;
+   }
+
+   for( size_t i = 0; i < len; i++ ) {
+
+      if( str[i] == '/' ) {
+         num_segments++;
+      }
+   }
+
+   segments = CALLOC_LIST( struct fskit_route_segment, num_segments );
+   if( segments == NULL ) {
+      return;
+   }
+
+   // NOTE: [^/]+ contains a /, so we can't just split on /
+   p = str;
+   num_segments = 0;
+   while( true ) {
+
+      struct fskit_route_segment* seg = &segments[ num_segments ];
+      num_segments++;
+
+      if( strncmp( p, "([^/]+)", strlen("([^/]+)") ) == 0 ) {
+
+         seg->type = FSKIT_ROUTE_SEGMENT_CAPTURE;
+         end = p + strlen("([^/]+)");
+      }
+      else if( strncmp( p, "[^/]+", strlen("[^/]+") ) == 0 ) {
+
+         seg->type = FSKIT_ROUTE_SEGMENT_NAME;
+         end = p + strlen("[^/]+");
+      }
+      else {
+
+         for( end = p; end < str + len && *end != '/'; end++ );
+
+         seg->type = FSKIT_ROUTE_SEGMENT_LITERAL;
+         seg->literal = p;
+         seg->len = end - p;
+      }
+
+      if( end > str + len || (end < str + len && *end != '/') || (seg->type == FSKIT_ROUTE_SEGMENT_LITERAL && !fskit_route_regex_is_literal( seg->literal, seg->len )) ) {
+
+         // needs a real regex
+         fskit_safe_free( segments );
+         return;
+      }
+
+      if( end == str + len ) {
+         break;
+      }
+
+      p = end + 1;
+   }
+
+   route->prog = FSKIT_ROUTE_PROG_SEGMENTS;
+   route->segments = segments;
+   route->num_segments = num_segments;
+}
+
 // initialize a path route
 // return 0 on success, negative on error
 static int fskit_path_route_init( struct fskit_path_route* route, char const* regex_str, int consistency_discipline, int route_type, union fskit_route_method method ) {
@@ -941,52 +2194,114 @@ static int fskit_path_route_init( struct fskit_path_route* route, char const* re
 
    route->num_expected_matches = fskit_num_expected_matches( regex_str );
 
+   fskit_path_route_compile( route );
+
    route->consistency_discipline = consistency_discipline;
    route->route_type = route_type;
    route->method = method;
 
-   pthread_rwlock_init( &route->lock, NULL );
+   pthread_rwlock_init( &route->lock, NULL );
+
+   return 0;
+}
+
+// free a path route
+int fskit_path_route_free( struct fskit_path_route* route ) {
+
+   if( route->path_regex_str != NULL ) {
+      fskit_safe_free( route->path_regex_str );
+      route->path_regex_str = NULL;
+
+      // NOTE: the regex is only set if the string is set
+      regfree( &route->path_regex );
+
+      fskit_safe_free( route->segments );
+
+      pthread_rwlock_destroy( &route->lock );
+   }
+
+   if( route->pool != NULL ) {
+      fskit_route_pool_free( route->pool );
+   }
+
+   memset( route, 0, sizeof(struct fskit_path_route) );
+
+   return 0;
+}
+
+
+// unref a path route; free it once no route table snapshot refers to it
+static void fskit_path_route_unref( struct fskit_path_route* route ) {
+
+   if( __atomic_sub_fetch( &route->refcount, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+
+      fskit_path_route_free( route );
+      fskit_safe_free( route );
+   }
+}
+
+
+// start changing the route table: serialize against other writers, and copy the current table.
+// readers keep using the current snapshot until fskit_route_update_commit swaps in the copy.
+// return the copy on success
+// return NULL on OOM (in which case nothing is locked)
+static fskit_route_table* fskit_route_update_begin( struct fskit_core* core ) {
+
+   fskit_route_table* routes = NULL;
+
+   pthread_mutex_lock( &core->route_update_lock );
+
+   routes = fskit_route_table_dup( core->routes->routes );
+   if( routes == NULL ) {
+
+      pthread_mutex_unlock( &core->route_update_lock );
+   }
 
-   return 0;
+   return routes;
 }
 
-// free a path route
-int fskit_path_route_free( struct fskit_path_route* route ) {
 
-   if( route->path_regex_str != NULL ) {
-      fskit_safe_free( route->path_regex_str );
-      route->path_regex_str = NULL;
+// publish a changed copy of the route table, and stop serializing writers.
+// the old snapshot is freed once its last in-flight route call finishes.
+// return 0 on success
+// return -ENOMEM on OOM, in which case routes is freed and the route table is unchanged
+static int fskit_route_update_commit( struct fskit_core* core, fskit_route_table* routes ) {
 
-      // NOTE: the regex is only set if the string is set
-      regfree( &route->path_regex );
+   struct fskit_route_snapshot* old_snapshot = NULL;
+   struct fskit_route_snapshot* snapshot = fskit_route_snapshot_new( routes, core->route_gen + 1 );
 
-      pthread_rwlock_destroy( &route->lock );
+   if( snapshot == NULL ) {
+
+      fskit_route_table_free( routes );
+      pthread_mutex_unlock( &core->route_update_lock );
+      return -ENOMEM;
    }
 
-   memset( route, 0, sizeof(struct fskit_path_route) );
+   // cached route matches are now stale
+   core->route_gen++;
+
+   fskit_core_route_wlock( core );
+
+   old_snapshot = core->routes;
+   core->routes = snapshot;
+
+   fskit_core_route_unlock( core );
 
+   pthread_mutex_unlock( &core->route_update_lock );
+
+   fskit_route_snapshot_unref( old_snapshot );
    return 0;
 }
 
 
-// remove all routes from a given route table, freeing them and destroying them 
-// return 0 on success
-// return -EINVAL if there are no routes defined for this type
-static int fskit_path_route_erase_all( fskit_route_table** route_table, int route_type ) {
-   
-   struct fskit_route_table_row* row = fskit_route_table_get_row( *route_table, route_type );
-   if( row == NULL ) {
-      return -EINVAL;
-   }
-   
-   // clear it out 
-   sglib_fskit_route_table_delete( route_table, row );
-   fskit_route_table_row_free( row );
-   fskit_safe_free( row );
-   
-   return 0;
+// discard a copy of the route table from fskit_route_update_begin, and stop serializing writers.
+static void fskit_route_update_abort( struct fskit_core* core, fskit_route_table* routes ) {
+
+   fskit_route_table_free( routes );
+   pthread_mutex_unlock( &core->route_update_lock );
 }
 
+
 // declare a route
 // return >= 0 on success (this is the "route handle")
 // return -EINVAL if we couldn't compile the regex
@@ -994,6 +2309,8 @@ static int fskit_path_route_erase_all( fskit_route_table** route_table, int rout
 static int fskit_path_route_decl( struct fskit_core* core, char const* route_regex, int route_type, union fskit_route_method method, int consistency_discipline ) {
 
    int rc = 0;
+   int handle = 0;
+   fskit_route_table* routes = NULL;
    struct fskit_path_route* route = CALLOC_LIST( struct fskit_path_route, 1 );
    if( route == NULL ) {
       return -ENOMEM;
@@ -1006,43 +2323,61 @@ static int fskit_path_route_decl( struct fskit_core* core, char const* route_reg
       return rc;
    }
 
-   // atomically update route table
-   fskit_core_route_wlock( core );
+   // owned by the route table
+   route->refcount = 1;
 
-   rc = fskit_route_table_insert( &core->routes, route_type, route );
+   routes = fskit_route_update_begin( core );
+   if( routes == NULL ) {
 
-   fskit_core_route_unlock( core );
+      fskit_path_route_unref( route );
+      return -ENOMEM;
+   }
 
-   return rc;
+   rc = fskit_route_table_insert( &routes, route_type, route );
+   if( rc < 0 ) {
+
+      fskit_route_update_abort( core, routes );
+      fskit_path_route_unref( route );
+      return rc;
+   }
+
+   handle = rc;
+
+   rc = fskit_route_update_commit( core, routes );
+   if( rc != 0 ) {
+
+      // route was freed along with routes
+      return rc;
+   }
+
+   return handle;
 }
 
-// undeclare a route
+// undeclare a route.
+// route calls already in progress finish with it.
 // return 0 on success
 // return -EINVAL if it's a bad route handle
+// return -ENOMEM if out of memory
 static int fskit_path_route_undecl( struct fskit_core* core, int route_type, int route_handle ) {
 
-   int rc = 0;
-
    struct fskit_path_route* route = NULL;
+   fskit_route_table* routes = fskit_route_update_begin( core );
 
-   // atomically update route table
-   fskit_core_route_wlock( core );
-
-   route = fskit_route_table_remove( &core->routes, route_type, route_handle );
+   if( routes == NULL ) {
+      return -ENOMEM;
+   }
 
-   fskit_core_route_unlock( core );
-   
+   route = fskit_route_table_remove( &routes, route_type, route_handle );
    if( route == NULL ) {
+
+      fskit_route_update_abort( core, routes );
       return -EINVAL;
    }
-   else {
-      
-      // destroy 
-      fskit_path_route_free( route );
-      fskit_safe_free( route );
-   }
-   
-   return rc;
+
+   // drop the copy's reference; the current snapshot still has one
+   fskit_path_route_unref( route );
+
+   return fskit_route_update_commit( core, routes );
 }
 
 // declare a route for creating a file
@@ -1165,6 +2500,27 @@ int fskit_unroute_readdir( struct fskit_core* core, int route_handle ) {
    return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_READDIR, route_handle );
 }
 
+// declare a route for reading a directory into a buffer of packed records.
+// if a directory matches no such route, fskit_readdir_buf falls back to its readdir route.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_readdir_buf( struct fskit_core* core, char const* route_regex, fskit_entry_route_readdir_buf_callback_t readdir_buf_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.readdir_buf_cb = readdir_buf_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READDIR_BUF, method, consistency_discipline );
+}
+
+// undeclare an existing route for reading a directory into packed records
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_readdir_buf( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_READDIR_BUF, route_handle );
+}
+
 // declare a route for reading a file
 // return >= 0 on success (the route handle)
 // return -EINVAL if we couldn't compile the regex
@@ -1205,6 +2561,145 @@ int fskit_unroute_write( struct fskit_core* core, int route_handle ) {
    return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_WRITE, route_handle );
 }
 
+// declare an asynchronous route for reading a file.
+// the callback either returns what a read route would, or FSKIT_IO_PENDING and later calls fskit_io_complete() with it.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or the consistency discipline isn't supported
+// return -ENOMEM if out of memory
+int fskit_route_read_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_async_callback_t io_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.io_async_cb = io_cb;
+
+   if( consistency_discipline != FSKIT_CONCURRENT && consistency_discipline != FSKIT_RANGE_SEQUENTIAL ) {
+      return -EINVAL;
+   }
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READ_ASYNC, method, consistency_discipline );
+}
+
+// undeclare an existing asynchronous route for reading a file
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_read_async( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_READ_ASYNC, route_handle );
+}
+
+// declare an asynchronous route for writing a file.
+// the callback either returns what a write route would, or FSKIT_IO_PENDING and later calls fskit_io_complete() with it.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or the consistency discipline isn't supported
+// return -ENOMEM if out of memory
+int fskit_route_write_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_io_async_callback_t io_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.io_async_cb = io_cb;
+
+   if( consistency_discipline != FSKIT_CONCURRENT && consistency_discipline != FSKIT_RANGE_SEQUENTIAL ) {
+      return -EINVAL;
+   }
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_WRITE_ASYNC, method, consistency_discipline );
+}
+
+// undeclare an existing asynchronous route for writing a file
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_write_async( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_WRITE_ASYNC, route_handle );
+}
+
+// declare an asynchronous route for truncating a file.
+// the callback either returns what a trunc route would, or FSKIT_IO_PENDING and later calls fskit_io_complete() with it.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex, or the consistency discipline isn't supported
+// return -ENOMEM if out of memory
+int fskit_route_trunc_async( struct fskit_core* core, char const* route_regex, fskit_entry_route_trunc_async_callback_t trunc_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.trunc_async_cb = trunc_cb;
+
+   if( consistency_discipline != FSKIT_CONCURRENT && consistency_discipline != FSKIT_RANGE_SEQUENTIAL ) {
+      return -EINVAL;
+   }
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_TRUNC_ASYNC, method, consistency_discipline );
+}
+
+// undeclare an existing asynchronous route for truncating a file
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_trunc_async( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_TRUNC_ASYNC, route_handle );
+}
+
+// declare a route for prefetching part of a file.
+// if readahead is enabled, the callback is given the byte range that a sequential reader is expected to read next,
+// so it can start fetching it.  It runs on the reader's thread, so it should not wait for the data.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_prefetch( struct fskit_core* core, char const* route_regex, fskit_entry_route_prefetch_callback_t prefetch_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.prefetch_cb = prefetch_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_PREFETCH, method, consistency_discipline );
+}
+
+// undeclare an existing route for prefetching part of a file
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_prefetch( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_PREFETCH, route_handle );
+}
+
+// declare a route for reading a file into a vector of buffers.
+// if there's no readv route for a path, fskit_readv falls back to its read route.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_readv( struct fskit_core* core, char const* route_regex, fskit_entry_route_iov_callback_t iov_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.iov_cb = iov_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_READV, method, consistency_discipline );
+}
+
+// undeclare an existing route for reading a file into a vector of buffers
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_readv( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_READV, route_handle );
+}
+
+// declare a route for writing a vector of buffers to a file.
+// if there's no writev route for a path, fskit_writev falls back to its write route.
+// return >= 0 on success (the route handle)
+// return -EINVAL if we couldn't compile the regex
+// return -ENOMEM if out of memory
+int fskit_route_writev( struct fskit_core* core, char const* route_regex, fskit_entry_route_iov_callback_t iov_cb, int consistency_discipline ) {
+
+   union fskit_route_method method;
+   method.iov_cb = iov_cb;
+
+   return fskit_path_route_decl( core, route_regex, FSKIT_ROUTE_MATCH_WRITEV, method, consistency_discipline );
+}
+
+// undeclare an existing route for writing a vector of buffers to a file
+// return 0 on success
+// return -EINVAL if the route can't possibly exist.
+int fskit_unroute_writev( struct fskit_core* core, int route_handle ) {
+
+   return fskit_path_route_undecl( core, FSKIT_ROUTE_MATCH_WRITEV, route_handle );
+}
+
 // declare a route for truncating a file
 // return >= 0 on success (the route handle)
 // return -EINVAL if we couldn't compile the regex
@@ -1444,17 +2939,128 @@ int fskit_unroute_removexattr( struct fskit_core* core, int route_handle ) {
 int fskit_unroute_all( struct fskit_core* core ) {
    
    int rc = 0;
-   
-   // atomically update route table
-   fskit_core_route_wlock( core );
+   fskit_route_table* routes = NULL;
 
-   for( int i = 0; i < FSKIT_ROUTE_NUM_ROUTE_TYPES; i++ ) {
-      
-      fskit_path_route_erase_all( &core->routes, i );
+   // start from an empty table, instead of copying and erasing the old one
+   pthread_mutex_lock( &core->route_update_lock );
+
+   routes = fskit_route_table_new();
+   if( routes == NULL ) {
+
+      pthread_mutex_unlock( &core->route_update_lock );
+      return -ENOMEM;
    }
-   
-   fskit_core_route_unlock( core );
 
+   rc = fskit_route_update_commit( core, routes );
+
+   return rc;
+}
+
+// enable per-inode route match caching on a core.
+// each inode remembers, per route type, the route its path matched and the match groups,
+// so repeated calls on it skip regex evaluation until its path or the route table changes.
+// NOTE: route callbacks must not modify the match groups
+// return 0 on success
+// return -EEXIST if the cache is already enabled
+int fskit_core_route_cache_enable( struct fskit_core* core ) {
+
+   bool enabled = false;
+
+   if( !__atomic_compare_exchange_n( &core->route_cache, &enabled, true, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {
+      return -EEXIST;
+   }
+
+   return 0;
+}
+
+// get route match cache statistics
+// return 0 on success
+// return -ENOSYS if the cache is disabled
+int fskit_core_route_cache_stats( struct fskit_core* core, struct fskit_route_cache_stats* stats ) {
+
+   if( !__atomic_load_n( &core->route_cache, __ATOMIC_RELAXED ) ) {
+      return -ENOSYS;
+   }
+
+   stats->hits = __atomic_load_n( &core->route_cache_hits, __ATOMIC_RELAXED );
+   stats->misses = __atomic_load_n( &core->route_cache_misses, __ATOMIC_RELAXED );
+
+   return 0;
+}
+
+// run a route's callbacks on a pool of max_concurrency worker threads, so slow callbacks don't tie up their callers' threads
+// beyond waiting for the result.  At most max_queued calls wait for a worker; further callers block until there's room.
+// route_type and route_handle identify the route, as passed to and returned by the fskit_route_* method that declared it.
+// return 0 on success
+// return -EINVAL if there is no such route, or max_concurrency or max_queued is less than 1
+// return -EEXIST if the route already has a worker pool
+// return -ENOMEM if out of memory
+// return -EAGAIN if we couldn't start the workers
+int fskit_route_pool_enable( struct fskit_core* core, int route_type, int route_handle, int max_concurrency, int max_queued ) {
+
+   int rc = 0;
+   struct fskit_route_pool* pool = NULL;
+   struct fskit_route_pool* old_pool = NULL;
+   struct fskit_path_route* route = NULL;
+   struct fskit_route_snapshot* snapshot = fskit_route_snapshot_get( core );
+
+   if( route_handle >= 0 ) {
+      route = fskit_route_table_find( snapshot->routes, route_type, route_handle );
+   }
+
+   if( route == NULL ) {
+
+      fskit_route_snapshot_unref( snapshot );
+      return -EINVAL;
+   }
+
+   pool = fskit_route_pool_new( max_concurrency, max_queued, &rc );
+   if( pool == NULL ) {
+
+      fskit_route_snapshot_unref( snapshot );
+      return rc;
+   }
+
+   if( !__atomic_compare_exchange_n( &route->pool, &old_pool, pool, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED ) ) {
+
+      fskit_route_pool_free( pool );
+      rc = -EEXIST;
+   }
+
+   fskit_route_snapshot_unref( snapshot );
+   return rc;
+}
+
+// get a route's worker pool statistics
+// return 0 on success
+// return -EINVAL if there is no such route
+// return -ENOSYS if the route has no worker pool
+int fskit_route_pool_stats( struct fskit_core* core, int route_type, int route_handle, struct fskit_route_pool_stats* stats ) {
+
+   int rc = 0;
+   struct fskit_route_pool* pool = NULL;
+   struct fskit_path_route* route = NULL;
+   struct fskit_route_snapshot* snapshot = fskit_route_snapshot_get( core );
+
+   if( route_handle >= 0 ) {
+      route = fskit_route_table_find( snapshot->routes, route_type, route_handle );
+   }
+
+   if( route == NULL ) {
+      rc = -EINVAL;
+   }
+   else {
+
+      pool = __atomic_load_n( &route->pool, __ATOMIC_ACQUIRE );
+      if( pool == NULL ) {
+         rc = -ENOSYS;
+      }
+      else {
+         fskit_route_pool_get_stats( pool, stats );
+      }
+   }
+
+   fskit_route_snapshot_unref( snapshot );
    return rc;
 }
 
@@ -1529,6 +3135,18 @@ int fskit_route_readdir_args( struct fskit_route_dispatch_args* dargs, char cons
 }
 
 
+// set up dargs for readdir() into packed records
+int fskit_route_readdir_buf_args( struct fskit_route_dispatch_args* dargs, char const* name, char* dirbuf, size_t dirbuf_len ) {
+
+   memset( dargs, 0, sizeof(struct fskit_route_dispatch_args) );
+
+   dargs->name = name;
+   dargs->dirbuf = dirbuf;
+   dargs->dirbuf_len = dirbuf_len;
+   return 0;
+}
+
+
 // set up dargs for read() and write()
 int fskit_route_io_args( struct fskit_route_dispatch_args* dargs, char* iobuf, size_t iolen, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont ) {
 
@@ -1543,6 +3161,34 @@ int fskit_route_io_args( struct fskit_route_dispatch_args* dargs, char* iobuf, s
    return 0;
 }
 
+// set up dargs for readv() and writev()
+// return 0 on success
+// return -EINVAL if the buffers' total length doesn't fit in an ssize_t
+int fskit_route_iov_args( struct fskit_route_dispatch_args* dargs, struct iovec const* iov, int iovcnt, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont ) {
+
+   size_t iolen = 0;
+
+   memset( dargs, 0, sizeof(struct fskit_route_dispatch_args) );
+
+   for( int i = 0; i < iovcnt; i++ ) {
+
+      if( iov[i].iov_len > (size_t)SSIZE_MAX - iolen ) {
+         return -EINVAL;
+      }
+
+      iolen += iov[i].iov_len;
+   }
+
+   dargs->iov = iov;
+   dargs->iovcnt = iovcnt;
+   dargs->iolen = iolen;
+   dargs->iooff = iooff;
+   dargs->handle_data = handle_data;
+   dargs->io_cont = io_cont;
+
+   return 0;
+}
+
 // set up dargs for trunc
 int fskit_route_trunc_args( struct fskit_route_dispatch_args* dargs, char const* name, off_t iooff, void* handle_data, fskit_route_io_continuation io_cont ) {
 
@@ -1689,6 +3335,7 @@ int fskit_route_metadata_num_match_groups( struct fskit_route_metadata* route_me
 }
 
 // get the match groups (null-terminated list of char*)
+// they are only valid until the route callback returns
 char** fskit_route_metadata_get_match_groups( struct fskit_route_metadata* route_metadata ) {
    return route_metadata->argv;
 }
@@ -0,0 +1,346 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// bytes per chunk of objects
+#define FSKIT_SLAB_CHUNK_SIZE (64 * 1024)
+
+// maximum number of free objects a thread holds on to
+#define FSKIT_SLAB_CACHE_MAX 64
+
+// number of objects moved between a thread's cache and the slab at once
+#define FSKIT_SLAB_CACHE_BATCH 32
+
+// all objects are aligned to this
+#define FSKIT_SLAB_ALIGN 8
+
+// a chunk of objects.  Objects follow the header.
+struct fskit_slab_chunk {
+
+   struct fskit_slab_chunk* next;
+   uint64_t pad;                // keep the first object 16-byte aligned
+};
+
+// a free object (overlays the object's first bytes)
+struct fskit_slab_free_obj {
+
+   struct fskit_slab_free_obj* next;
+};
+
+// a thread's cache of free objects from one slab
+struct fskit_slab_cache {
+
+   struct fskit_slab* slab;
+
+   struct fskit_slab_free_obj* free_list;
+   unsigned int count;
+
+   // siblings in slab->caches
+   struct fskit_slab_cache* prev;
+   struct fskit_slab_cache* next;
+};
+
+
+// give a thread's cached objects back to its slab when the thread exits
+static void fskit_slab_cache_release( void* arg ) {
+
+   struct fskit_slab_cache* cache = (struct fskit_slab_cache*)arg;
+   struct fskit_slab* slab = cache->slab;
+   struct fskit_slab_free_obj* obj = NULL;
+
+   pthread_mutex_lock( &slab->lock );
+
+   while( cache->free_list != NULL ) {
+
+      obj = cache->free_list;
+      cache->free_list = obj->next;
+
+      obj->next = slab->free_list;
+      slab->free_list = obj;
+   }
+
+   if( cache->prev != NULL ) {
+      cache->prev->next = cache->next;
+   }
+   else {
+      slab->caches = cache->next;
+   }
+
+   if( cache->next != NULL ) {
+      cache->next->prev = cache->prev;
+   }
+
+   pthread_mutex_unlock( &slab->lock );
+
+   fskit_safe_free( cache );
+}
+
+
+// get the calling thread's cache for this slab, creating it if need be
+// return NULL if the slab has no per-thread caches, or on OOM
+static struct fskit_slab_cache* fskit_slab_cache_get( struct fskit_slab* slab ) {
+
+   struct fskit_slab_cache* cache = NULL;
+
+   if( !slab->have_cache_key ) {
+      return NULL;
+   }
+
+   cache = (struct fskit_slab_cache*)pthread_getspecific( slab->cache_key );
+   if( cache != NULL ) {
+      return cache;
+   }
+
+   cache = CALLOC_LIST( struct fskit_slab_cache, 1 );
+   if( cache == NULL ) {
+      return NULL;
+   }
+
+   cache->slab = slab;
+
+   if( pthread_setspecific( slab->cache_key, cache ) != 0 ) {
+      fskit_safe_free( cache );
+      return NULL;
+   }
+
+   pthread_mutex_lock( &slab->lock );
+
+   cache->next = slab->caches;
+   if( slab->caches != NULL ) {
+      slab->caches->prev = cache;
+   }
+   slab->caches = cache;
+
+   pthread_mutex_unlock( &slab->lock );
+
+   return cache;
+}
+
+
+// carve a new chunk into free objects
+// slab must be locked
+// return 0 on success
+// return -ENOMEM on OOM
+static int fskit_slab_grow( struct fskit_slab* slab ) {
+
+   struct fskit_slab_chunk* chunk = NULL;
+   struct fskit_slab_free_obj* obj = NULL;
+   char* objs = NULL;
+
+   chunk = (struct fskit_slab_chunk*)malloc( FSKIT_SLAB_CHUNK_SIZE );
+   if( chunk == NULL ) {
+      return -ENOMEM;
+   }
+
+   chunk->next = slab->chunks;
+   slab->chunks = chunk;
+   slab->num_chunks++;
+
+   objs = (char*)(chunk + 1);
+
+   // push in reverse, so objects get handed out in address order
+   for( size_t i = slab->objs_per_chunk; i > 0; i-- ) {
+
+      obj = (struct fskit_slab_free_obj*)(objs + (i - 1) * slab->obj_size);
+      obj->next = slab->free_list;
+      slab->free_list = obj;
+   }
+
+   return 0;
+}
+
+
+// set up a slab of objects of the given size
+// return 0 on success
+// return -EINVAL if objects won't fit into a chunk
+int fskit_slab_init( struct fskit_slab* slab, size_t obj_size ) {
+
+   memset( slab, 0, sizeof(struct fskit_slab) );
+
+   if( obj_size < sizeof(struct fskit_slab_free_obj) ) {
+      obj_size = sizeof(struct fskit_slab_free_obj);
+   }
+
+   obj_size = (obj_size + FSKIT_SLAB_ALIGN - 1) & ~((size_t)FSKIT_SLAB_ALIGN - 1);
+
+   if( obj_size > FSKIT_SLAB_CHUNK_SIZE - sizeof(struct fskit_slab_chunk) ) {
+      return -EINVAL;
+   }
+
+   slab->obj_size = obj_size;
+   slab->objs_per_chunk = (FSKIT_SLAB_CHUNK_SIZE - sizeof(struct fskit_slab_chunk)) / obj_size;
+
+   pthread_mutex_init( &slab->lock, NULL );
+
+   // per-thread caches are an optimization; go without if we're out of keys
+   if( pthread_key_create( &slab->cache_key, fskit_slab_cache_release ) == 0 ) {
+      slab->have_cache_key = true;
+   }
+   else {
+      fskit_error("%s", "WARN: pthread_key_create failed; slab will not cache per thread\n");
+   }
+
+   return 0;
+}
+
+
+// allocate a zeroed object
+// return NULL on OOM
+void* fskit_slab_alloc( struct fskit_slab* slab ) {
+
+   int rc = 0;
+   struct fskit_slab_free_obj* obj = NULL;
+   struct fskit_slab_cache* cache = fskit_slab_cache_get( slab );
+
+   if( cache != NULL && cache->free_list != NULL ) {
+
+      // fast path
+      obj = cache->free_list;
+      cache->free_list = obj->next;
+      cache->count--;
+
+      memset( obj, 0, slab->obj_size );
+      return obj;
+   }
+
+   pthread_mutex_lock( &slab->lock );
+
+   if( slab->free_list == NULL ) {
+
+      rc = fskit_slab_grow( slab );
+      if( rc != 0 ) {
+         pthread_mutex_unlock( &slab->lock );
+         return NULL;
+      }
+   }
+
+   obj = slab->free_list;
+   slab->free_list = obj->next;
+
+   // refill this thread's cache while we're here
+   if( cache != NULL ) {
+
+      while( cache->count < FSKIT_SLAB_CACHE_BATCH && slab->free_list != NULL ) {
+
+         struct fskit_slab_free_obj* next = slab->free_list;
+         slab->free_list = next->next;
+
+         next->next = cache->free_list;
+         cache->free_list = next;
+         cache->count++;
+      }
+   }
+
+   pthread_mutex_unlock( &slab->lock );
+
+   memset( obj, 0, slab->obj_size );
+   return obj;
+}
+
+
+// free an object that came from fskit_slab_alloc
+void fskit_slab_free( struct fskit_slab* slab, void* ptr ) {
+
+   struct fskit_slab_free_obj* obj = (struct fskit_slab_free_obj*)ptr;
+   struct fskit_slab_cache* cache = NULL;
+
+   if( ptr == NULL ) {
+      return;
+   }
+
+   cache = fskit_slab_cache_get( slab );
+   if( cache == NULL ) {
+
+      pthread_mutex_lock( &slab->lock );
+
+      obj->next = slab->free_list;
+      slab->free_list = obj;
+
+      pthread_mutex_unlock( &slab->lock );
+      return;
+   }
+
+   obj->next = cache->free_list;
+   cache->free_list = obj;
+   cache->count++;
+
+   if( cache->count > FSKIT_SLAB_CACHE_MAX ) {
+
+      // give a batch back, so other threads can use it
+      pthread_mutex_lock( &slab->lock );
+
+      while( cache->count > FSKIT_SLAB_CACHE_MAX - FSKIT_SLAB_CACHE_BATCH ) {
+
+         obj = cache->free_list;
+         cache->free_list = obj->next;
+         cache->count--;
+
+         obj->next = slab->free_list;
+         slab->free_list = obj;
+      }
+
+      pthread_mutex_unlock( &slab->lock );
+   }
+}
+
+
+// free all of a slab's memory, including objects still in use.
+// NOTE: no other thread may be using the slab
+int fskit_slab_destroy( struct fskit_slab* slab ) {
+
+   struct fskit_slab_chunk* chunk = NULL;
+   struct fskit_slab_cache* cache = NULL;
+
+   if( slab->have_cache_key ) {
+
+      // no more thread-exit callbacks
+      pthread_key_delete( slab->cache_key );
+      slab->have_cache_key = false;
+   }
+
+   pthread_mutex_lock( &slab->lock );
+
+   while( slab->caches != NULL ) {
+
+      cache = slab->caches;
+      slab->caches = cache->next;
+      fskit_safe_free( cache );
+   }
+
+   while( slab->chunks != NULL ) {
+
+      chunk = slab->chunks;
+      slab->chunks = chunk->next;
+      free( chunk );
+   }
+
+   slab->free_list = NULL;
+   slab->num_chunks = 0;
+
+   pthread_mutex_unlock( &slab->lock );
+   pthread_mutex_destroy( &slab->lock );
+
+   return 0;
+}
+
@@ -21,6 +21,8 @@
 
 #include <fskit/stat.h>
 #include <fskit/route.h>
+#include <fskit/path.h>
+#include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
@@ -52,15 +54,15 @@ int fskit_do_user_stat( struct fskit_core* core, char const* fs_path, struct fsk
    return cbrc;
 }
 
-// stat a path.
+// stat a path, resolving it from dir (whose path is dir_path) if possible, and from root otherwise.
 // fill in the stat buffer on success.
+// only takes shared locks (unless the entry gets unlinked while we have it referenced).
 // return the usual path resolution errors.
-int fskit_stat( struct fskit_core* core, char const* fs_path, uint64_t user, uint64_t group, struct stat* sb ) {
+static int fskit_stat_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* fs_path, uint64_t user, uint64_t group, struct stat* sb ) {
 
    int rc = 0;
 
-   // ref this entry, so it won't disappear on stat
-   struct fskit_entry* fent = fskit_entry_ref( core, fs_path, &rc );
+   struct fskit_entry* fent = fskit_entry_resolve_path_in( core, dir, dir_path, fs_path, 0, 0, false, &rc );
    if( fent == NULL ) {
       
       // doesn't exist, but maybe the FS implementation will add it... 
@@ -68,14 +70,48 @@ int fskit_stat( struct fskit_core* core, char const* fs_path, uint64_t user, uin
       return rc;
    }
    
-   // stat it
-   rc = fskit_fstat( core, fs_path, fent, sb );
+   // fill in defaults while we have it read-locked
+   fskit_entry_fstat( fent, sb );
+
+   // ref this entry, so it won't disappear during the user's route
+   fskit_entry_ref_entry( fent );
+   fskit_entry_unlock( fent );
+
+   rc = fskit_do_user_stat( core, fs_path, fent, sb );
 
    fskit_entry_unref( core, fs_path, fent );
    
    return rc;
 }
 
+// stat a path.
+// fill in the stat buffer on success.
+// only takes shared locks (unless the entry gets unlinked while we have it referenced).
+// return the usual path resolution errors.
+int fskit_stat( struct fskit_core* core, char const* fs_path, uint64_t user, uint64_t group, struct stat* sb ) {
+   return fskit_stat_in( core, NULL, NULL, fs_path, user, group, sb );
+}
+
+// stat a path relative to an open directory, without re-resolving the directory from root.
+// routes see the directory's path joined with path.
+// return the usual path resolution errors, and -ENOMEM on OOM
+int fskit_statat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t user, uint64_t group, struct stat* sb ) {
+
+   int rc = 0;
+   struct fskit_entry* dir = NULL;
+   char const* dir_path = NULL;
+   char* full_path = fskit_path_at( dirh, path, &dir, &dir_path );
+
+   if( full_path == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_stat_in( core, dir, dir_path, full_path, user, group, sb );
+
+   fskit_safe_free( full_path );
+   return rc;
+}
+
 // generate a full mode from the entry's type and permission bits 
 mode_t fskit_fullmode( int fskit_type, mode_t mode ) {
    
@@ -121,7 +157,7 @@ int fskit_entry_fstat( struct fskit_entry* fent, struct stat* sb ) {
    sb->st_dev = 0;
    sb->st_ino = fent->file_id;
    sb->st_mode = fskit_fullmode( fent->type, fent->mode );
-   sb->st_nlink = fent->link_count;
+   sb->st_nlink = FSKIT_ENTRY_LINK_COUNT( fent );
    sb->st_uid = fent->owner;
    sb->st_gid = fent->group;
    sb->st_rdev = fent->dev;
@@ -129,8 +165,13 @@ int fskit_entry_fstat( struct fskit_entry* fent, struct stat* sb ) {
    sb->st_blksize = 0;
    sb->st_blocks = 0;
 
-   sb->st_atim.tv_sec = fent->atime_sec;
-   sb->st_atim.tv_nsec = fent->atime_nsec;
+   int64_t atime_sec = 0;
+   int32_t atime_nsec = 0;
+
+   fskit_entry_get_atime( fent, &atime_sec, &atime_nsec );
+
+   sb->st_atim.tv_sec = atime_sec;
+   sb->st_atim.tv_nsec = atime_nsec;
 
    sb->st_mtim.tv_sec = fent->mtime_sec;
    sb->st_mtim.tv_nsec = fent->mtime_nsec;
@@ -79,7 +79,7 @@ int fskit_symlink( struct fskit_core* core, char const* target, char const* link
    }
 
    // allocate
-   child = CALLOC_LIST( struct fskit_entry, 1 );
+   child = fskit_entry_new_ex( core );
    if( child == NULL ) {
 
       fskit_entry_unlock( parent );
@@ -90,7 +90,7 @@ int fskit_symlink( struct fskit_core* core, char const* target, char const* link
    if( file_id == 0 ) {
 
       fskit_entry_unlock( parent );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
       return -EIO;
    }
 
@@ -99,7 +99,7 @@ int fskit_symlink( struct fskit_core* core, char const* target, char const* link
    if( rc != 0 ) {
 
       fskit_entry_destroy( core, child, true );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
 
       fskit_entry_unlock( parent );
       return -EIO;
@@ -110,7 +110,7 @@ int fskit_symlink( struct fskit_core* core, char const* target, char const* link
    if( rc != 0 ) {
 
       fskit_entry_destroy( core, child, true );
-      fskit_safe_free( child );
+      fskit_entry_free( core, child );
 
       fskit_entry_unlock( parent );
       return -EIO;
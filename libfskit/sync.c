@@ -46,12 +46,20 @@ static int fskit_do_user_sync( struct fskit_core* core, char const* path, struct
 
 
 // sync a file handle
-// basically, just call the user route
+// basically, just call the user route (after flushing any buffered writes)
+// return negative if a buffered write could not be flushed
 int fskit_fsync( struct fskit_core* core, struct fskit_file_handle* fh ) {
 
    fskit_file_handle_rlock( fh );
-   
-   int rc = fskit_do_user_sync( core, fh->path, fh->fent );
+
+   int rc = fskit_wbuf_flush( core, fh );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
+   rc = fskit_do_user_sync( core, fh->path, fh->fent );
    
    fskit_file_handle_unlock( fh );
 
@@ -26,14 +26,17 @@
 #include "fskit_private/private.h"
 
 
-// i/o continuation, called with the same locks held as the trunc()
-static int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent, off_t new_size, ssize_t trunc_rc ) {
+// i/o continuation, called once the trunc() is done
+// fent must be write-locked
+int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent, off_t new_size, ssize_t trunc_rc ) {
+
+   // cached blocks are stale now
+   fskit_entry_bump_data_gen( fent );
 
    if( trunc_rc == 0 ) {
 
       // update metadata
-      fskit_entry_set_mtime( fent, NULL );
-      fskit_entry_set_atime( fent, NULL );
+      fskit_entry_touch_write( core, fent );
 
       fent->size = new_size;
    }
@@ -45,7 +48,7 @@ static int fskit_trunc_cont( struct fskit_core* core, struct fskit_entry* fent,
 // fent should be referenced, but it should NOT be locked in any way
 // return 0 on success
 // return negative on failure
-int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fskit_entry* fent, off_t new_size, void* handle, void* handle_data ) {
 
    int rc = 0;
    int cbrc = 0;
@@ -56,6 +59,7 @@ int fskit_run_user_trunc( struct fskit_core* core, char const* path, struct fski
    fskit_basename( path, name );
 
    fskit_route_trunc_args( &dargs, name, new_size, handle_data, fskit_trunc_cont );
+   dargs.handle = handle;
 
    rc = fskit_route_call_trunc( core, path, fent, &dargs, &cbrc );
 
@@ -92,7 +96,15 @@ int fskit_ftrunc( struct fskit_core* core, struct fskit_file_handle* fh, off_t n
       return -EBADF;
    }
 
-   int rc = fskit_run_user_trunc( core, fh->path, fh->fent, new_size, fh->app_data );
+   // buffered writes must land first
+   int rc = fskit_wbuf_flush( core, fh );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
+   rc = fskit_run_user_trunc( core, fh->path, fh->fent, new_size, fh, fh->app_data );
 
    fskit_file_handle_unlock( fh );
 
@@ -119,7 +131,7 @@ int fskit_trunc( struct fskit_core* core, char const* path, uint64_t user, uint6
 
    fskit_entry_unlock( fent );
 
-   rc = fskit_run_user_trunc( core, path, fent, new_size, NULL );
+   rc = fskit_run_user_trunc( core, path, fent, new_size, NULL, NULL );
 
    // unreference
    fskit_entry_wlock( fent );
@@ -21,15 +21,16 @@
 
 #include <fskit/unlink.h>
 #include <fskit/path.h>
+#include <fskit/dcache.h>
 #include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
 
-// unlink a file from the filesystem
+// unlink a file from the filesystem, resolving its parent from dir (whose path is dir_path) if possible, and from root otherwise
 // return 0 on success
 // return the usual path resolution errors
-int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uint64_t group ) {
+static int fskit_unlink_in( struct fskit_core* core, struct fskit_entry* dir, char const* dir_path, char const* path, uint64_t owner, uint64_t group ) {
 
    // get some info about this file first
    int rc = 0;
@@ -47,7 +48,7 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
       return -ENOMEM;
    }
 
-   struct fskit_entry* parent = fskit_entry_resolve_path( core, path_dirname, owner, group, true, &err );
+   struct fskit_entry* parent = fskit_entry_resolve_path_in( core, dir, dir_path, path_dirname, owner, group, true, &err );
 
    free( path_dirname );
 
@@ -80,6 +81,13 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
       return -ENOENT;
    }
    
+   // hold a reference across the detach, since fent is not locked:
+   // whoever drops the last reference once it is unlinked will destroy it.
+   fskit_entry_ref_entry( fent );
+
+   // path will no longer resolve to fent
+   fskit_core_dcache_invalidate( core );
+
    // detach fent from parent
    rc = fskit_entry_detach_lowlevel( parent, path_basename );
    free( path_basename );
@@ -88,6 +96,7 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
 
       fskit_error("fskit_entry_detach_lowlevel(%p) rc = %d\n", fent, rc );
 
+      __atomic_sub_fetch( &fent->open_count, 1, __ATOMIC_SEQ_CST );
       fskit_entry_unlock( parent );
       return rc;
    }
@@ -101,6 +110,8 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
    }
    
    fskit_entry_wlock( fent );
+
+   __atomic_sub_fetch( &fent->open_count, 1, __ATOMIC_SEQ_CST );
    
    // try to destroy fent
    // note that this unlocks fent and destroys it if it is fully unref'ed
@@ -127,3 +138,33 @@ int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uin
 
    return rc;
 }
+
+
+// unlink a file from the filesystem
+// return 0 on success
+// return the usual path resolution errors
+int fskit_unlink( struct fskit_core* core, char const* path, uint64_t owner, uint64_t group ) {
+   return fskit_unlink_in( core, NULL, NULL, path, owner, group );
+}
+
+
+// unlink a file at a path relative to an open directory, without re-resolving the directory from root.
+// routes see the directory's path joined with path.
+// return 0 on success
+// return the usual path resolution errors, and -ENOMEM on OOM
+int fskit_unlinkat( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, uint64_t owner, uint64_t group ) {
+
+   int rc = 0;
+   struct fskit_entry* dir = NULL;
+   char const* dir_path = NULL;
+   char* full_path = fskit_path_at( dirh, path, &dir, &dir_path );
+
+   if( full_path == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = fskit_unlink_in( core, dir, dir_path, full_path, owner, group );
+
+   fskit_safe_free( full_path );
+   return rc;
+}
@@ -44,8 +44,8 @@ int fskit_entry_set_ctime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
-   fent->ctime_sec = new_time.tv_sec;
-   fent->ctime_nsec = new_time.tv_nsec;
+   __atomic_store_n( &fent->ctime_sec, new_time.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->ctime_nsec, new_time.tv_nsec, __ATOMIC_RELAXED );
 
    return 0;
 }
@@ -69,8 +69,8 @@ int fskit_entry_set_mtime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
-   fent->mtime_sec = new_time.tv_sec;
-   fent->mtime_nsec = new_time.tv_nsec;
+   __atomic_store_n( &fent->mtime_sec, new_time.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->mtime_nsec, new_time.tv_nsec, __ATOMIC_RELAXED );
 
    return 0;
 }
@@ -95,8 +95,177 @@ int fskit_entry_set_atime( struct fskit_entry* fent, struct timespec* now ) {
       memcpy( &new_time, now, sizeof(struct timespec) );
    }
 
-   fent->atime_sec = new_time.tv_sec;
-   fent->atime_nsec = new_time.tv_nsec;
+   __atomic_store_n( &fent->atime_sec, new_time.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->atime_nsec, new_time.tv_nsec, __ATOMIC_RELAXED );
+
+   return 0;
+}
+
+// get the time to stamp I/O with, from the core's clock
+// return 0 on success
+// return -errno if the clock could not be read
+int fskit_core_now( struct fskit_core* core, struct timespec* now ) {
+
+   clockid_t clock_id = ((core->time_flags & FSKIT_TIME_COARSE) != 0 ? CLOCK_REALTIME_COARSE : CLOCK_REALTIME);
+
+   int rc = clock_gettime( clock_id, now );
+   if( rc != 0 ) {
+      rc = -errno;
+      fskit_error("clock_gettime rc = %d\n", rc);
+      return rc;
+   }
+
+   return 0;
+}
+
+// is an inode's atime due for an update under FSKIT_ATIME_RELATIME?
+// that is, is it no newer than mtime or ctime, or at least a day old?
+// reads the timestamps without locking fent; a torn read just means an extra (or skipped) update.
+static bool fskit_entry_atime_is_stale( struct fskit_entry* fent, struct timespec* now ) {
+
+   int64_t atime_sec = __atomic_load_n( &fent->atime_sec, __ATOMIC_RELAXED );
+   int32_t atime_nsec = __atomic_load_n( &fent->atime_nsec, __ATOMIC_RELAXED );
+   int64_t mtime_sec = __atomic_load_n( &fent->mtime_sec, __ATOMIC_RELAXED );
+   int32_t mtime_nsec = __atomic_load_n( &fent->mtime_nsec, __ATOMIC_RELAXED );
+   int64_t ctime_sec = __atomic_load_n( &fent->ctime_sec, __ATOMIC_RELAXED );
+   int32_t ctime_nsec = __atomic_load_n( &fent->ctime_nsec, __ATOMIC_RELAXED );
+
+   if( atime_sec < mtime_sec || (atime_sec == mtime_sec && atime_nsec <= mtime_nsec) ) {
+      return true;
+   }
+
+   if( atime_sec < ctime_sec || (atime_sec == ctime_sec && atime_nsec <= ctime_nsec) ) {
+      return true;
+   }
+
+   return (now->tv_sec - atime_sec >= 24 * 60 * 60);
+}
+
+// fold a read time recorded under FSKIT_ATIME_LAZYTIME into atime, if it's newer
+// always succeeds
+// NOTE: fent must be write-locked
+int fskit_entry_fold_atime( struct fskit_entry* fent ) {
+
+   int64_t pending = __atomic_load_n( &fent->atime_pending_ns, __ATOMIC_RELAXED );
+
+   if( pending > fent->atime_sec * 1000000000LL + fent->atime_nsec ) {
+
+      __atomic_store_n( &fent->atime_sec, pending / 1000000000LL, __ATOMIC_RELAXED );
+      __atomic_store_n( &fent->atime_nsec, (int32_t)(pending % 1000000000LL), __ATOMIC_RELAXED );
+   }
+
+   return 0;
+}
+
+// update an inode's timestamps for a read, according to the core's atime policy.
+// only FSKIT_ATIME_STRICT always takes the inode's write lock.
+// return 0 on success
+// return -errno if the clock could not be read
+// NOTE: fent must NOT be locked
+int fskit_entry_touch_read( struct fskit_core* core, struct fskit_entry* fent ) {
+
+   int rc = 0;
+   int64_t now_ns = 0;
+   struct timespec now;
+
+   if( core->atime_policy == FSKIT_ATIME_NOATIME ) {
+      return 0;
+   }
+
+   rc = fskit_core_now( core, &now );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   switch( core->atime_policy ) {
+
+      case FSKIT_ATIME_RELATIME:
+
+         if( !fskit_entry_atime_is_stale( fent, &now ) ) {
+            return 0;
+         }
+
+         fskit_entry_wlock( fent );
+
+         // someone else may have gotten here first
+         if( fskit_entry_atime_is_stale( fent, &now ) ) {
+            fskit_entry_set_atime( fent, &now );
+         }
+
+         fskit_entry_unlock( fent );
+         break;
+
+      case FSKIT_ATIME_LAZYTIME:
+
+         // only store if the clock moved, so readers of a hot file mostly just load
+         now_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+         if( __atomic_load_n( &fent->atime_pending_ns, __ATOMIC_RELAXED ) < now_ns ) {
+            __atomic_store_n( &fent->atime_pending_ns, now_ns, __ATOMIC_RELAXED );
+         }
+
+         break;
+
+      default:
+
+         fskit_entry_wlock( fent );
+         fskit_entry_set_atime( fent, &now );
+         fskit_entry_unlock( fent );
+         break;
+   }
+
+   return 0;
+}
+
+// update an inode's timestamps for a write or truncate: always mtime, and atime under FSKIT_ATIME_STRICT.
+// any lazily-recorded read time is folded in.
+// return 0 on success
+// return -errno if the clock could not be read
+// NOTE: fent must be write-locked
+int fskit_entry_touch_write( struct fskit_core* core, struct fskit_entry* fent ) {
+
+   struct timespec now;
+
+   int rc = fskit_core_now( core, &now );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   fskit_entry_set_mtime( fent, &now );
+
+   if( core->atime_policy == FSKIT_ATIME_STRICT ) {
+      fskit_entry_set_atime( fent, &now );
+   }
+
+   fskit_entry_fold_atime( fent );
+
+   return 0;
+}
+
+// set how this core's I/O updates inode timestamps.
+// policy is one of FSKIT_ATIME_STRICT (the default), FSKIT_ATIME_RELATIME, FSKIT_ATIME_NOATIME, or FSKIT_ATIME_LAZYTIME.
+// flags may include FSKIT_TIME_COARSE.
+// NOTE: under FSKIT_ATIME_LAZYTIME, stat and fskit_entry_get_atime() see read times right away, but
+// an inode's atime field is only updated on its next write, truncate, or close.
+// call this after fskit_core_init, before the core is used.
+// return 0 on success
+// return -EINVAL if the policy or flags are unknown
+int fskit_core_atime_policy( struct fskit_core* core, int policy, int flags ) {
+
+   if( policy < FSKIT_ATIME_STRICT || policy > FSKIT_ATIME_LAZYTIME ) {
+      return -EINVAL;
+   }
+
+   if( (flags & ~FSKIT_TIME_COARSE) != 0 ) {
+      return -EINVAL;
+   }
+
+   fskit_core_wlock( core );
+
+   core->atime_policy = policy;
+   core->time_flags = flags;
+
+   fskit_core_unlock( core );
 
    return 0;
 }
@@ -166,11 +335,14 @@ int fskit_utimes( struct fskit_core* core, char const* path, uint64_t user, uint
       mtime = times[1];
    }
 
-   fent->atime_sec = atime.tv_sec;
-   fent->atime_nsec = atime.tv_usec * 1000;
+   __atomic_store_n( &fent->atime_sec, atime.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->atime_nsec, atime.tv_usec * 1000, __ATOMIC_RELAXED );
+
+   __atomic_store_n( &fent->mtime_sec, mtime.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->mtime_nsec, mtime.tv_usec * 1000, __ATOMIC_RELAXED );
 
-   fent->mtime_sec = mtime.tv_sec;
-   fent->mtime_nsec = mtime.tv_usec * 1000;
+   // explicitly-set times win over lazily-recorded reads
+   __atomic_store_n( &fent->atime_pending_ns, 0, __ATOMIC_RELAXED );
 
    fskit_entry_unlock( fent );
    return 0;
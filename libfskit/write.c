@@ -22,6 +22,7 @@
 #include <fskit/write.h>
 #include <fskit/utime.h>
 #include <fskit/route.h>
+#include <fskit/util.h>
 
 #include "fskit_private/private.h"
 
@@ -29,9 +30,11 @@
 // fent must be write-locked
 int fskit_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t offset, ssize_t num_written ) {
 
+   // cached blocks are stale now (even if the write failed partway)
+   fskit_entry_bump_data_gen( fent );
+
    if( num_written >= 0 ) {
-      fskit_entry_set_mtime( fent, NULL );
-      fskit_entry_set_atime( fent, NULL );
+      fskit_entry_touch_write( core, fent );
 
       off_t size_delta = 0;
       if( offset + num_written > fent->size ) {
@@ -47,24 +50,81 @@ int fskit_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t o
 // run the user-given write route callback
 // return the number of bytes written on success
 // return negative on failure
-ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, char const* buf, size_t buflen, off_t offset, void* handle_data ) {
+ssize_t fskit_run_user_write( struct fskit_core* core, char const* path, struct fskit_entry* fent, char const* buf, size_t buflen, off_t offset, void* handle, void* handle_data ) {
 
    int rc = 0;
    int cbrc = 0;
    struct fskit_route_dispatch_args dargs;
 
    fskit_route_io_args( &dargs, (char*)buf, buflen, offset, handle_data, fskit_write_cont );
+   dargs.handle = handle;
 
    rc = fskit_route_call_write( core, path, fent, &dargs, &cbrc );
 
    if( rc == -EPERM || rc == -ENOSYS ) {
-      // no routes installed
+
+      // no routes installed; the data goes nowhere, but the file was still written
+      fskit_entry_wlock( fent );
+      fskit_write_cont( core, fent, offset, buflen );
+      fskit_entry_unlock( fent );
+
       return 0;
    }
 
    return (ssize_t)cbrc;
 }
 
+// run the user-given writev route callback.
+// if there is no writev route, gather iov into one buffer and run the write route on it once.
+// either way, the write continuation runs once.
+// return the number of bytes written on success
+// return -ENOMEM if out of memory
+// return negative on failure
+static ssize_t fskit_run_user_writev( struct fskit_core* core, char const* path, struct fskit_entry* fent, struct iovec const* iov, int iovcnt, off_t offset, void* handle, void* handle_data ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   ssize_t num_written = 0;
+   size_t copied = 0;
+   char* buf = NULL;
+   struct fskit_route_dispatch_args dargs;
+
+   rc = fskit_route_iov_args( &dargs, iov, iovcnt, offset, handle_data, fskit_write_cont );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   dargs.handle = handle;
+
+   rc = fskit_route_call_writev( core, path, fent, &dargs, &cbrc );
+
+   if( rc != -EPERM && rc != -ENOSYS ) {
+      return (ssize_t)cbrc;
+   }
+
+   // no writev route
+   if( iovcnt == 1 ) {
+      return fskit_run_user_write( core, path, fent, (char const*)iov[0].iov_base, iov[0].iov_len, offset, handle, handle_data );
+   }
+
+   buf = CALLOC_LIST( char, dargs.iolen + 1 );
+   if( buf == NULL ) {
+      return -ENOMEM;
+   }
+
+   for( int i = 0; i < iovcnt; i++ ) {
+
+      memcpy( buf + copied, iov[i].iov_base, iov[i].iov_len );
+      copied += iov[i].iov_len;
+   }
+
+   num_written = fskit_run_user_write( core, path, fent, buf, dargs.iolen, offset, handle, handle_data );
+
+   fskit_safe_free( buf );
+
+   return num_written;
+}
+
 // write up to buflen bytes into buf, starting at the given offset in the file.
 // return the number of bytes written on success.
 // return negative on failure.
@@ -79,21 +139,68 @@ ssize_t fskit_write( struct fskit_core* core, struct fskit_file_handle* fh, char
       return -EBADF;
    }
 
-   ssize_t num_written = fskit_run_user_write( core, fh->path, fh->fent, buf, buflen, offset, fh->app_data );
+   ssize_t num_written = 0;
 
-   if( num_written >= 0 ) {
+   if( core->writeback != NULL ) {
+
+      // buffered writes keep the file's size up to date themselves, without locking it
+      num_written = fskit_wbuf_write( core, fh, buf, buflen, offset );
+
+      fskit_file_handle_unlock( fh );
+      return num_written;
+   }
+
+   // the write continuation stamps mtime and grows the file
+   num_written = fskit_run_user_write( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+
+   fskit_file_handle_unlock( fh );
+
+   return num_written;
+}
 
-      // update metadata
-      fskit_entry_wlock( fh->fent );
 
-      fskit_entry_set_mtime( fh->fent, NULL );
-      fskit_entry_set_atime( fh->fent, NULL );
+// write each of iovcnt buffers in turn, starting at the given offset in the file.
+// the write is routed once for the whole vector.
+// return the number of bytes written on success.
+// return negative on failure.
+ssize_t fskit_writev( struct fskit_core* core, struct fskit_file_handle* fh, struct iovec const* iov, int iovcnt, off_t offset ) {
 
-      fh->fent->size = ((unsigned)(offset + buflen) > fh->fent->size ? offset + buflen : fh->fent->size);
+   size_t total = 0;
 
-      fskit_entry_unlock( fh->fent );
+   if( iovcnt < 0 || iovcnt > IOV_MAX ) {
+      return -EINVAL;
    }
 
+   fskit_file_handle_rlock( fh );
+
+   // sanity check
+   if( (fh->flags & (O_RDWR | O_WRONLY)) == 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return -EBADF;
+   }
+
+   if( iovcnt == 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return 0;
+   }
+
+   for( int i = 0; i < iovcnt; i++ ) {
+      total += iov[i].iov_len;
+   }
+
+   // buffered writes must land first
+   int rc = fskit_wbuf_flush_range( core, fh, offset, total );
+   if( rc != 0 ) {
+
+      fskit_file_handle_unlock( fh );
+      return rc;
+   }
+
+   // the write continuation stamps mtime and grows the file
+   ssize_t num_written = fskit_run_user_writev( core, fh->path, fh->fent, iov, iovcnt, offset, fh, fh->app_data );
+
    fskit_file_handle_unlock( fh );
 
    return num_written;
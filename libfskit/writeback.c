@@ -0,0 +1,609 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include <fskit/writeback.h>
+#include <fskit/route.h>
+#include <fskit/util.h>
+
+#include "fskit_private/private.h"
+
+// one handle's buffered writes: a single dirty extent [off, off + len)
+struct fskit_wbuf {
+
+   pthread_mutex_t lock;
+
+   char* buf;
+   size_t cap;
+
+   off_t off;
+   size_t len;
+
+   uint64_t dirty_since_ns;     // when len last went from 0 to nonzero
+   int err;                     // first error from a background flush, reported by fsync or close
+
+   struct fskit_file_handle* fh;
+
+   // flusher's list
+   struct fskit_wbuf* prev;
+   struct fskit_wbuf* next;
+
+   // references held by the flusher while it works on this buffer without the list's lock (protected by the list's lock).
+   // fskit_wbuf_release waits for them to go away before freeing the buffer.
+   int refs;
+   struct fskit_wbuf* flush_next;       // flusher's list of buffers to look at in this pass
+};
+
+// write-back state for a core
+struct fskit_writeback {
+
+   size_t max_bytes;
+   uint64_t flush_ns;
+
+   pthread_t flusher;
+   bool running;
+
+   // governs running, the list of buffers, and their refs.
+   // never held while a buffer is locked or flushed, so a slow write route only holds up its own buffer.
+   pthread_mutex_t lock;
+   pthread_cond_t wake;
+   pthread_cond_t unref;        // signaled when the flusher drops its references
+
+   struct fskit_wbuf* head;
+};
+
+// nanoseconds since some arbitrary point
+static uint64_t fskit_writeback_now_ns(void) {
+
+   struct timespec ts;
+
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// grow a file to at least new_size without locking it, so buffered writes don't take the inode's lock.
+static void fskit_wbuf_grow( struct fskit_entry* fent, off_t new_size ) {
+
+   off_t size = __atomic_load_n( &fent->size, __ATOMIC_RELAXED );
+
+   while( new_size > size && !__atomic_compare_exchange_n( &fent->size, &size, new_size, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+}
+
+// stamp a file's mtime (and atime, under FSKIT_ATIME_STRICT) as fskit_entry_touch_write does, but without locking it,
+// so a buffered write is seen as soon as it is accepted.
+// return 0 on success
+// return -errno if the clock could not be read
+static int fskit_wbuf_touch( struct fskit_core* core, struct fskit_entry* fent ) {
+
+   struct timespec now;
+
+   int rc = fskit_core_now( core, &now );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   __atomic_store_n( &fent->mtime_sec, now.tv_sec, __ATOMIC_RELAXED );
+   __atomic_store_n( &fent->mtime_nsec, now.tv_nsec, __ATOMIC_RELAXED );
+
+   if( core->atime_policy == FSKIT_ATIME_STRICT ) {
+
+      __atomic_store_n( &fent->atime_sec, now.tv_sec, __ATOMIC_RELAXED );
+      __atomic_store_n( &fent->atime_nsec, now.tv_nsec, __ATOMIC_RELAXED );
+   }
+
+   return 0;
+}
+
+// continuation for a flushed extent.
+// the file's size and mtime were already updated when the data was buffered; this only makes sure the size covers what was written.
+// fent must be write-locked
+static int fskit_wbuf_write_cont( struct fskit_core* core, struct fskit_entry* fent, off_t offset, ssize_t num_written ) {
+
+   fskit_entry_bump_data_gen( fent );
+
+   if( num_written >= 0 ) {
+
+      // (buffered writes grow it without the lock)
+      fskit_wbuf_grow( fent, offset + num_written );
+   }
+
+   return 0;
+}
+
+// route the dirty extent, and empty the buffer whether or not it succeeds.
+// return 0 on success, or if there is no write route
+// return -EIO if the route wrote less than the whole extent
+// return negative on route failure
+// NOTE: wb must be locked
+static int fskit_wbuf_flush_locked( struct fskit_core* core, struct fskit_wbuf* wb ) {
+
+   int rc = 0;
+   int cbrc = 0;
+   struct fskit_file_handle* fh = wb->fh;
+   struct fskit_route_dispatch_args dargs;
+
+   if( wb->len == 0 ) {
+      return 0;
+   }
+
+   fskit_route_io_args( &dargs, wb->buf, wb->len, wb->off, fh->app_data, fskit_wbuf_write_cont );
+   dargs.handle = fh;
+
+   rc = fskit_route_call_write( core, fh->path, fh->fent, &dargs, &cbrc );
+
+   if( rc == -EPERM || rc == -ENOSYS ) {
+
+      // no routes installed; the data goes nowhere, but the file was still written
+      fskit_entry_wlock( fh->fent );
+      fskit_wbuf_write_cont( core, fh->fent, wb->off, wb->len );
+      fskit_entry_unlock( fh->fent );
+
+      rc = 0;
+   }
+   else if( cbrc < 0 ) {
+      rc = cbrc;
+   }
+   else if( (size_t)cbrc < wb->len ) {
+      rc = -EIO;
+   }
+   else {
+      rc = 0;
+   }
+
+   if( rc != 0 ) {
+      fskit_error("flush %s [%jd, %zu) rc = %d\n", fh->path, (intmax_t)wb->off, wb->len, rc );
+   }
+
+   wb->len = 0;
+   return rc;
+}
+
+// flusher thread: route every extent that has been dirty for longer than flush_ns.
+// each pass references every buffer and lets go of the list's lock, so write routes run with only their own buffer locked.
+static void* fskit_writeback_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct fskit_writeback* writeback = core->writeback;
+   uint64_t period_ns = writeback->flush_ns / 2;
+   struct timespec deadline;
+   struct fskit_wbuf* pass = NULL;
+   uint64_t now = 0;
+   int rc = 0;
+
+   if( period_ns < 1000000 ) {
+      period_ns = 1000000;
+   }
+
+   pthread_mutex_lock( &writeback->lock );
+
+   while( writeback->running ) {
+
+      clock_gettime( CLOCK_REALTIME, &deadline );
+      deadline.tv_sec += period_ns / 1000000000ULL;
+      deadline.tv_nsec += period_ns % 1000000000ULL;
+      if( deadline.tv_nsec >= 1000000000L ) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000L;
+      }
+
+      pthread_cond_timedwait( &writeback->wake, &writeback->lock, &deadline );
+
+      if( !writeback->running ) {
+         break;
+      }
+
+      // hold on to every buffer, so none can be freed while we look at it
+      pass = NULL;
+      for( struct fskit_wbuf* wb = writeback->head; wb != NULL; wb = wb->next ) {
+
+         wb->refs++;
+         wb->flush_next = pass;
+         pass = wb;
+      }
+
+      pthread_mutex_unlock( &writeback->lock );
+
+      now = fskit_writeback_now_ns();
+
+      for( struct fskit_wbuf* wb = pass; wb != NULL; wb = wb->flush_next ) {
+
+         // a busy buffer is being written to, and will be looked at next time
+         if( pthread_mutex_trylock( &wb->lock ) != 0 ) {
+            continue;
+         }
+
+         if( wb->len > 0 && now - wb->dirty_since_ns >= writeback->flush_ns ) {
+
+            rc = fskit_wbuf_flush_locked( core, wb );
+            if( rc != 0 && wb->err == 0 ) {
+               wb->err = rc;
+            }
+         }
+
+         pthread_mutex_unlock( &wb->lock );
+      }
+
+      pthread_mutex_lock( &writeback->lock );
+
+      for( struct fskit_wbuf* wb = pass; wb != NULL; wb = wb->flush_next ) {
+         wb->refs--;
+      }
+
+      pthread_cond_broadcast( &writeback->unref );
+   }
+
+   pthread_mutex_unlock( &writeback->lock );
+
+   return NULL;
+}
+
+// get fh's write buffer, creating and registering it if need be.
+// return NULL if out of memory
+// NOTE: fh must be read-locked, and core->writeback must be set
+static struct fskit_wbuf* fskit_wbuf_get( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   struct fskit_writeback* writeback = core->writeback;
+   struct fskit_wbuf* wb = __atomic_load_n( &fh->wbuf, __ATOMIC_ACQUIRE );
+   struct fskit_wbuf* expected = NULL;
+
+   if( wb != NULL ) {
+      return wb;
+   }
+
+   wb = CALLOC_LIST( struct fskit_wbuf, 1 );
+   if( wb == NULL ) {
+      return NULL;
+   }
+
+   wb->buf = CALLOC_LIST( char, writeback->max_bytes );
+   if( wb->buf == NULL ) {
+
+      fskit_safe_free( wb );
+      return NULL;
+   }
+
+   wb->cap = writeback->max_bytes;
+   wb->fh = fh;
+   pthread_mutex_init( &wb->lock, NULL );
+
+   if( !__atomic_compare_exchange_n( &fh->wbuf, &expected, wb, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+
+      // another writer on this handle beat us to it
+      pthread_mutex_destroy( &wb->lock );
+      fskit_safe_free( wb->buf );
+      fskit_safe_free( wb );
+      return expected;
+   }
+
+   pthread_mutex_lock( &writeback->lock );
+
+   wb->next = writeback->head;
+   if( writeback->head != NULL ) {
+      writeback->head->prev = wb;
+   }
+   writeback->head = wb;
+
+   pthread_mutex_unlock( &writeback->lock );
+
+   return wb;
+}
+
+// buffer a write to fh, if it extends or overlaps the dirty extent and the result still fits.
+// otherwise, flush the dirty extent first and start a new one.
+// writes too big to buffer go straight to the write route (after flushing any data they overlap).
+// the buffer is flushed as soon as it fills.
+// return buflen if the data was buffered, or the write route's result if not
+// return -ENOMEM if out of memory
+// return negative if a flush failed
+// NOTE: fh must be read-locked, and core->writeback must be set
+ssize_t fskit_wbuf_write( struct fskit_core* core, struct fskit_file_handle* fh, char const* buf, size_t buflen, off_t offset ) {
+
+   int rc = 0;
+   off_t start = 0;
+   off_t end = 0;
+   struct fskit_wbuf* wb = NULL;
+
+   if( buflen > core->writeback->max_bytes ) {
+
+      rc = fskit_wbuf_flush_range( core, fh, offset, buflen );
+      if( rc != 0 ) {
+         return rc;
+      }
+
+      return fskit_run_user_write( core, fh->path, fh->fent, buf, buflen, offset, fh, fh->app_data );
+   }
+
+   wb = fskit_wbuf_get( core, fh );
+   if( wb == NULL ) {
+      return -ENOMEM;
+   }
+
+   pthread_mutex_lock( &wb->lock );
+
+   if( wb->len > 0 ) {
+
+      start = wb->off;
+      end = wb->off + (off_t)wb->len;
+
+      if( offset < start ) {
+         start = offset;
+      }
+
+      if( offset + (off_t)buflen > end ) {
+         end = offset + (off_t)buflen;
+      }
+
+      if( offset > wb->off + (off_t)wb->len || offset + (off_t)buflen < wb->off || (size_t)(end - start) > wb->cap ) {
+
+         // not contiguous with what we have, or too big to merge
+         rc = fskit_wbuf_flush_locked( core, wb );
+         if( rc != 0 ) {
+
+            pthread_mutex_unlock( &wb->lock );
+            return rc;
+         }
+      }
+      else if( start < wb->off ) {
+
+         // extends backwards
+         memmove( wb->buf + (wb->off - start), wb->buf, wb->len );
+         wb->off = start;
+      }
+   }
+
+   if( wb->len == 0 ) {
+
+      wb->off = offset;
+      wb->dirty_since_ns = fskit_writeback_now_ns();
+      end = offset + (off_t)buflen;
+   }
+
+   memcpy( wb->buf + (offset - wb->off), buf, buflen );
+   wb->len = (size_t)(end - wb->off);
+
+   // the new size and mtime are visible right away
+   fskit_wbuf_grow( fh->fent, offset + (off_t)buflen );
+   fskit_wbuf_touch( core, fh->fent );
+
+   if( wb->len == wb->cap ) {
+
+      rc = fskit_wbuf_flush_locked( core, wb );
+   }
+
+   pthread_mutex_unlock( &wb->lock );
+
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   return (ssize_t)buflen;
+}
+
+// flush fh's buffered data if it overlaps [offset, offset + len)
+// return 0 on success, or if there is nothing to flush
+// return negative if the flush failed
+// NOTE: fh must be locked
+int fskit_wbuf_flush_range( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len ) {
+
+   int rc = 0;
+   struct fskit_wbuf* wb = __atomic_load_n( &fh->wbuf, __ATOMIC_ACQUIRE );
+
+   if( wb == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &wb->lock );
+
+   if( wb->len > 0 && offset < wb->off + (off_t)wb->len && offset + (off_t)len > wb->off ) {
+      rc = fskit_wbuf_flush_locked( core, wb );
+   }
+
+   pthread_mutex_unlock( &wb->lock );
+
+   return rc;
+}
+
+// flush all of fh's buffered data
+// return 0 on success, or if there is nothing to flush
+// return negative if this flush, or an earlier background flush, failed (the latter is reported once)
+// NOTE: fh must be locked
+int fskit_wbuf_flush( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   int rc = 0;
+   struct fskit_wbuf* wb = __atomic_load_n( &fh->wbuf, __ATOMIC_ACQUIRE );
+
+   if( wb == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &wb->lock );
+
+   rc = fskit_wbuf_flush_locked( core, wb );
+
+   if( rc == 0 ) {
+      rc = wb->err;
+   }
+
+   wb->err = 0;
+
+   pthread_mutex_unlock( &wb->lock );
+
+   return rc;
+}
+
+// flush and free fh's write buffer, if it has one
+// return 0 on success
+// return negative if the final flush (or an earlier background one) failed; the buffer is freed regardless
+// NOTE: fh must be write-locked
+int fskit_wbuf_release( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   int rc = 0;
+   struct fskit_wbuf* wb = fh->wbuf;
+   struct fskit_writeback* writeback = core->writeback;
+
+   if( wb == NULL ) {
+      return 0;
+   }
+
+   rc = fskit_wbuf_flush( core, fh );
+
+   pthread_mutex_lock( &writeback->lock );
+
+   if( wb->prev != NULL ) {
+      wb->prev->next = wb->next;
+   }
+   else {
+      writeback->head = wb->next;
+   }
+
+   if( wb->next != NULL ) {
+      wb->next->prev = wb->prev;
+   }
+
+   // the flusher may still be looking at it
+   while( wb->refs > 0 ) {
+      pthread_cond_wait( &writeback->unref, &writeback->lock );
+   }
+
+   pthread_mutex_unlock( &writeback->lock );
+
+   fh->wbuf = NULL;
+
+   pthread_mutex_destroy( &wb->lock );
+   fskit_safe_free( wb->buf );
+   fskit_safe_free( wb );
+
+   return rc;
+}
+
+
+// enable write-back buffering on this core.
+// each open file handle gets a buffer of up to max_bytes (FSKIT_WRITEBACK_DEFAULT_MAX_BYTES if 0) that coalesces
+// sequential, adjacent, and overlapping writes into one call to the write route.
+// a buffer is flushed when it fills, when a write or read through its handle doesn't fit with it or overlaps it,
+// on fskit_fsync, fskit_ftrunc and fskit_close, and once it has been dirty for flush_ms (FSKIT_WRITEBACK_DEFAULT_FLUSH_MS if 0).
+// buffered writes update the file's size and mtime right away, without locking it.
+// NOTE: buffered data is only visible through the handle that wrote it until it is flushed.
+// call this before any files are opened.
+// return 0 on success
+// return -EEXIST if write-back is already enabled
+// return -ENOMEM if out of memory
+// return negative if the flusher thread could not be started
+int fskit_core_writeback_enable( struct fskit_core* core, size_t max_bytes, unsigned int flush_ms ) {
+
+   int rc = 0;
+   struct fskit_writeback* writeback = NULL;
+
+   if( max_bytes == 0 ) {
+      max_bytes = FSKIT_WRITEBACK_DEFAULT_MAX_BYTES;
+   }
+
+   if( flush_ms == 0 ) {
+      flush_ms = FSKIT_WRITEBACK_DEFAULT_FLUSH_MS;
+   }
+
+   writeback = CALLOC_LIST( struct fskit_writeback, 1 );
+   if( writeback == NULL ) {
+      return -ENOMEM;
+   }
+
+   writeback->max_bytes = max_bytes;
+   writeback->flush_ns = (uint64_t)flush_ms * 1000000ULL;
+
+   pthread_mutex_init( &writeback->lock, NULL );
+   pthread_cond_init( &writeback->wake, NULL );
+   pthread_cond_init( &writeback->unref, NULL );
+
+   fskit_core_wlock( core );
+
+   if( core->writeback != NULL ) {
+
+      fskit_core_unlock( core );
+      fskit_writeback_free( writeback );
+      return -EEXIST;
+   }
+
+   // the flusher reads core->writeback, so start it once that's set
+   core->writeback = writeback;
+   writeback->running = true;
+
+   rc = pthread_create( &writeback->flusher, NULL, fskit_writeback_main, core );
+   if( rc != 0 ) {
+
+      writeback->running = false;
+      core->writeback = NULL;
+
+      fskit_core_unlock( core );
+
+      fskit_error("pthread_create rc = %d\n", rc );
+      fskit_writeback_free( writeback );
+      return -rc;
+   }
+
+   fskit_core_unlock( core );
+
+   return 0;
+}
+
+
+// stop the flusher and free write-back state.
+// data still buffered in open handles is discarded.
+// always succeeds
+int fskit_writeback_free( struct fskit_writeback* writeback ) {
+
+   struct fskit_wbuf* wb = NULL;
+   struct fskit_wbuf* next = NULL;
+   bool running = false;
+
+   if( writeback == NULL ) {
+      return 0;
+   }
+
+   pthread_mutex_lock( &writeback->lock );
+
+   running = writeback->running;
+   writeback->running = false;
+   pthread_cond_signal( &writeback->wake );
+
+   pthread_mutex_unlock( &writeback->lock );
+
+   if( running ) {
+      pthread_join( writeback->flusher, NULL );
+   }
+
+   for( wb = writeback->head; wb != NULL; wb = next ) {
+
+      next = wb->next;
+
+      wb->fh->wbuf = NULL;
+
+      pthread_mutex_destroy( &wb->lock );
+      fskit_safe_free( wb->buf );
+      fskit_safe_free( wb );
+   }
+
+   pthread_mutex_destroy( &writeback->lock );
+   pthread_cond_destroy( &writeback->wake );
+   pthread_cond_destroy( &writeback->unref );
+
+   fskit_safe_free( writeback );
+
+   return 0;
+}
@@ -0,0 +1,554 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-aio.h"
+
+#include <poll.h>
+
+#define NUM_OPS 64
+#define BLOCK_SIZE 16
+
+// a pretend device: asynchronous routes queue jobs, and a worker thread carries them out later
+struct aio_job {
+
+   struct fskit_io_token* token;
+   int type;            // FSKIT_ROUTE_MATCH_READ_ASYNC, _WRITE_ASYNC, or _TRUNC_ASYNC
+   char* buf;
+   size_t len;
+   off_t offset;
+
+   struct aio_job* next;
+};
+
+static struct aio_job* jobs = NULL;
+static struct aio_job** jobs_tail = &jobs;
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_ready = PTHREAD_COND_INITIALIZER;
+static bool worker_hold = false;
+static bool worker_stop = false;
+
+static char backing[ NUM_OPS * BLOCK_SIZE ];
+static pthread_mutex_t backing_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct fskit_core* core = NULL;
+static struct fskit_file_handle* fh = NULL;
+static struct fskit_io_cq* cq = NULL;
+
+static void* worker_main( void* arg ) {
+
+   struct aio_job* job = NULL;
+   ssize_t rc = 0;
+
+   while( true ) {
+
+      pthread_mutex_lock( &jobs_lock );
+
+      while( !worker_stop && (jobs == NULL || worker_hold) ) {
+         pthread_cond_wait( &jobs_ready, &jobs_lock );
+      }
+
+      if( worker_stop ) {
+         pthread_mutex_unlock( &jobs_lock );
+         break;
+      }
+
+      job = jobs;
+      jobs = job->next;
+      if( jobs == NULL ) {
+         jobs_tail = &jobs;
+      }
+
+      pthread_mutex_unlock( &jobs_lock );
+
+      // pretend to be slow
+      usleep( 100 );
+
+      pthread_mutex_lock( &backing_lock );
+
+      if( job->type == FSKIT_ROUTE_MATCH_READ_ASYNC ) {
+         memcpy( job->buf, backing + job->offset, job->len );
+         rc = job->len;
+      }
+      else if( job->type == FSKIT_ROUTE_MATCH_WRITE_ASYNC ) {
+         memcpy( backing + job->offset, job->buf, job->len );
+         rc = job->len;
+      }
+      else {
+         rc = 0;
+      }
+
+      pthread_mutex_unlock( &backing_lock );
+
+      fskit_io_complete( job->token, rc );
+      free( job );
+   }
+
+   return NULL;
+}
+
+static int queue_job( int type, struct fskit_io_token* token, char* buf, size_t len, off_t offset ) {
+
+   struct aio_job* job = (struct aio_job*)calloc( 1, sizeof(struct aio_job) );
+
+   job->token = token;
+   job->type = type;
+   job->buf = buf;
+   job->len = len;
+   job->offset = offset;
+
+   pthread_mutex_lock( &jobs_lock );
+
+   *jobs_tail = job;
+   jobs_tail = &job->next;
+
+   pthread_cond_signal( &jobs_ready );
+   pthread_mutex_unlock( &jobs_lock );
+
+   return FSKIT_IO_PENDING;
+}
+
+static void worker_set_hold( bool hold ) {
+
+   pthread_mutex_lock( &jobs_lock );
+
+   worker_hold = hold;
+
+   pthread_cond_signal( &jobs_ready );
+   pthread_mutex_unlock( &jobs_lock );
+}
+
+static int read_async_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_io_token* token ) {
+   return queue_job( FSKIT_ROUTE_MATCH_READ_ASYNC, token, buf, buflen, offset );
+}
+
+static int write_async_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_io_token* token ) {
+   return queue_job( FSKIT_ROUTE_MATCH_WRITE_ASYNC, token, buf, buflen, offset );
+}
+
+static int trunc_async_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data, struct fskit_io_token* token ) {
+   return queue_job( FSKIT_ROUTE_MATCH_TRUNC_ASYNC, token, NULL, 0, new_size );
+}
+
+// writes only the first byte
+static int short_write_async_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_io_token* token ) {
+   return queue_job( FSKIT_ROUTE_MATCH_WRITE_ASYNC, token, buf, 1, offset );
+}
+
+// finishes without going through the worker
+static int sync_write_async_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data, struct fskit_io_token* token ) {
+   return buflen;
+}
+
+static int sync_read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   memset( buf, 'S', buflen );
+   return buflen;
+}
+
+// reap exactly num completions, and check that each one succeeded with rc == expected
+static void reap( int num, ssize_t expected, int* seen ) {
+
+   struct fskit_io_completion completions[8];
+   int reaped = 0;
+
+   while( reaped < num ) {
+
+      int rc = fskit_io_cq_poll( cq, completions, 8, 5000 );
+      if( rc <= 0 ) {
+         fskit_error("fskit_io_cq_poll rc = %d after %d of %d\n", rc, reaped, num );
+         exit(1);
+      }
+
+      for( int i = 0; i < rc; i++ ) {
+
+         if( completions[i].rc != expected ) {
+            fskit_error("completion %p rc = %zd, expected %zd\n", completions[i].user_data, completions[i].rc, expected );
+            exit(1);
+         }
+
+         if( seen != NULL ) {
+            seen[ (intptr_t)completions[i].user_data ]++;
+         }
+      }
+
+      reaped += rc;
+   }
+}
+
+// an overlapping write, started from its own thread since it blocks until its range is free
+struct blocked_write {
+
+   char buf[BLOCK_SIZE];
+   pthread_t thread;
+   volatile int started;
+};
+
+static void* blocked_write_main( void* arg ) {
+
+   struct blocked_write* bw = (struct blocked_write*)arg;
+
+   int rc = fskit_write_async( core, fh, bw->buf, BLOCK_SIZE, BLOCK_SIZE / 2, cq, (void*)1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_write_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   __atomic_store_n( &bw->started, 1, __ATOMIC_SEQ_CST );
+   return NULL;
+}
+
+static struct fskit_file_handle* open_file( char const* path ) {
+
+   int rc = 0;
+   struct fskit_file_handle* h = fskit_create( core, path, 0, 0, 0644, &rc );
+
+   if( h == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, h );
+
+   h = fskit_open( core, path, 0, 0, O_RDWR, 0, &rc );
+   if( h == NULL ) {
+      fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   return h;
+}
+
+int main( int argc, char** argv ) {
+
+   int rc;
+   pthread_t worker;
+   struct stat sb;
+   struct pollfd pfd;
+   struct fskit_io_completion completion;
+   struct blocked_write bw;
+   int seen[ NUM_OPS ];
+   char* bufs[ NUM_OPS ];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   // only disciplines whose locks can be released from another thread are allowed
+   rc = fskit_route_read_async( core, "/.*", read_async_cb, FSKIT_INODE_SEQUENTIAL );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_route_read_async(FSKIT_INODE_SEQUENTIAL) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_read_async( core, "/data", read_async_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write_async( core, "/data", write_async_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_trunc_async( core, "/data", trunc_async_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_trunc_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write_async( core, "/quick", sync_write_async_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write_async( core, "/short", short_write_async_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_read( core, "/plain", sync_read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   cq = fskit_io_cq_new();
+   if( cq == NULL ) {
+      fskit_error("%s", "fskit_io_cq_new failed\n");
+      exit(1);
+   }
+
+   pthread_create( &worker, NULL, worker_main, NULL );
+
+   fh = open_file( "/data" );
+
+   // nothing to reap yet
+   rc = fskit_io_cq_poll( cq, &completion, 1, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_io_cq_poll on empty queue rc = %d\n", rc );
+      exit(1);
+   }
+
+   // many writes in flight at once
+   memset( seen, 0, sizeof(seen) );
+
+   for( int i = 0; i < NUM_OPS; i++ ) {
+
+      bufs[i] = (char*)malloc( BLOCK_SIZE );
+      memset( bufs[i], 'a' + (i % 26), BLOCK_SIZE );
+
+      rc = fskit_write_async( core, fh, bufs[i], BLOCK_SIZE, i * BLOCK_SIZE, cq, (void*)(intptr_t)i );
+      if( rc != 0 ) {
+         fskit_error("fskit_write_async(%d) rc = %d\n", i, rc );
+         exit(1);
+      }
+   }
+
+   reap( NUM_OPS, BLOCK_SIZE, seen );
+
+   for( int i = 0; i < NUM_OPS; i++ ) {
+
+      if( seen[i] != 1 ) {
+         fskit_error("write %d completed %d times\n", i, seen[i] );
+         exit(1);
+      }
+   }
+
+   // completions updated the file size
+   rc = fskit_stat( core, "/data", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != NUM_OPS * BLOCK_SIZE ) {
+      fskit_error("fskit_stat('/data') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   printf("%d async writes: OK\n", NUM_OPS );
+
+   // read them back
+   memset( seen, 0, sizeof(seen) );
+
+   for( int i = 0; i < NUM_OPS; i++ ) {
+
+      memset( bufs[i], 0, BLOCK_SIZE );
+
+      rc = fskit_read_async( core, fh, bufs[i], BLOCK_SIZE, i * BLOCK_SIZE, cq, (void*)(intptr_t)i );
+      if( rc != 0 ) {
+         fskit_error("fskit_read_async(%d) rc = %d\n", i, rc );
+         exit(1);
+      }
+   }
+
+   reap( NUM_OPS, BLOCK_SIZE, seen );
+
+   for( int i = 0; i < NUM_OPS; i++ ) {
+
+      for( int j = 0; j < BLOCK_SIZE; j++ ) {
+
+         if( bufs[i][j] != 'a' + (i % 26) ) {
+            fskit_error("read %d byte %d is '%c'\n", i, j, bufs[i][j] );
+            exit(1);
+         }
+      }
+   }
+
+   printf("%d async reads: OK\n", NUM_OPS );
+
+   // completion queue is pollable
+   worker_set_hold( true );
+
+   rc = fskit_read_async( core, fh, bufs[0], BLOCK_SIZE, 0, cq, (void*)0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_read_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   pfd.fd = fskit_io_cq_fd( cq );
+   pfd.events = POLLIN;
+   pfd.revents = 0;
+
+   rc = poll( &pfd, 1, 0 );
+   if( rc != 0 ) {
+      fskit_error("poll before completion rc = %d\n", rc );
+      exit(1);
+   }
+
+   worker_set_hold( false );
+
+   rc = poll( &pfd, 1, 5000 );
+   if( rc != 1 || (pfd.revents & POLLIN) == 0 ) {
+      fskit_error("poll after completion rc = %d, revents = %x\n", rc, pfd.revents );
+      exit(1);
+   }
+
+   reap( 1, BLOCK_SIZE, NULL );
+
+   rc = poll( &pfd, 1, 0 );
+   if( rc != 0 ) {
+      fskit_error("poll after reaping rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("poll: OK\n");
+
+   // an overlapping write waits for the pending one to complete
+   worker_set_hold( true );
+
+   rc = fskit_write_async( core, fh, bufs[0], BLOCK_SIZE, 0, cq, (void*)0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_write_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   memset( &bw, 0, sizeof(bw) );
+   pthread_create( &bw.thread, NULL, blocked_write_main, &bw );
+
+   usleep( 50000 );
+
+   if( __atomic_load_n( &bw.started, __ATOMIC_SEQ_CST ) ) {
+      fskit_error("%s", "overlapping write started while another was pending\n");
+      exit(1);
+   }
+
+   worker_set_hold( false );
+   pthread_join( bw.thread, NULL );
+
+   reap( 2, BLOCK_SIZE, NULL );
+
+   printf("overlapping writes: serialized\n");
+
+   // truncate
+   rc = fskit_ftrunc_async( core, fh, BLOCK_SIZE, cq, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_ftrunc_async rc = %d\n", rc );
+      exit(1);
+   }
+
+   reap( 1, 0, NULL );
+
+   rc = fskit_stat( core, "/data", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != BLOCK_SIZE ) {
+      fskit_error("fskit_stat('/data') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   printf("async truncate: OK\n");
+
+   fskit_close( core, fh );
+
+   // a route that finishes right away still posts its completion
+   fh = open_file( "/quick" );
+
+   rc = fskit_write_async( core, fh, bufs[0], BLOCK_SIZE, 0, cq, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_write_async('/quick') rc = %d\n", rc );
+      exit(1);
+   }
+
+   reap( 1, BLOCK_SIZE, NULL );
+
+   rc = fskit_stat( core, "/quick", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != BLOCK_SIZE ) {
+      fskit_error("fskit_stat('/quick') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   printf("synchronous async route: OK\n");
+
+   // a short write grows the file only by what was written, as fskit_write does
+   fh = open_file( "/short" );
+
+   rc = fskit_write_async( core, fh, bufs[0], 10, 0, cq, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_write_async('/short') rc = %d\n", rc );
+      exit(1);
+   }
+
+   reap( 1, 1, NULL );
+
+   rc = fskit_stat( core, "/short", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != 1 ) {
+      fskit_error("fskit_stat('/short') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   printf("short write: OK\n");
+
+   // without an asynchronous route, the synchronous route runs
+   fh = open_file( "/plain" );
+
+   rc = fskit_read_async( core, fh, bufs[0], BLOCK_SIZE, 0, cq, NULL );
+   if( rc != 0 ) {
+      fskit_error("fskit_read_async('/plain') rc = %d\n", rc );
+      exit(1);
+   }
+
+   reap( 1, BLOCK_SIZE, NULL );
+
+   if( bufs[0][0] != 'S' ) {
+      fskit_error("fallback read got '%c'\n", bufs[0][0] );
+      exit(1);
+   }
+
+   // and the handle's access mode is still enforced
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/plain", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/plain') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_write_async( core, fh, bufs[0], BLOCK_SIZE, 0, cq, NULL );
+   if( rc != -EBADF ) {
+      fskit_error("fskit_write_async on read-only handle rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   printf("fallback: OK\n");
+
+   pthread_mutex_lock( &jobs_lock );
+   worker_stop = true;
+   pthread_cond_signal( &jobs_ready );
+   pthread_mutex_unlock( &jobs_lock );
+
+   pthread_join( worker, NULL );
+
+   for( int i = 0; i < NUM_OPS; i++ ) {
+      free( bufs[i] );
+   }
+
+   fskit_io_cq_free( cq );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
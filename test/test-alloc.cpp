@@ -0,0 +1,258 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// verify that path resolution on the fskit_stat() path, and dispatching a warm read route,
+// make no heap allocations.
+// NOTE: this interposes on glibc's allocator.
+
+#include "test-alloc.h"
+
+extern "C" {
+
+void* __libc_malloc( size_t size );
+void* __libc_calloc( size_t nmemb, size_t size );
+void* __libc_realloc( void* ptr, size_t size );
+
+static volatile int counting = 0;
+static volatile uint64_t num_allocs = 0;
+
+void* malloc( size_t size ) {
+   if( counting ) {
+      num_allocs++;
+   }
+   return __libc_malloc( size );
+}
+
+void* calloc( size_t nmemb, size_t size ) {
+   if( counting ) {
+      num_allocs++;
+   }
+   return __libc_calloc( nmemb, size );
+}
+
+void* realloc( void* ptr, size_t size ) {
+   if( counting ) {
+      num_allocs++;
+   }
+   return __libc_realloc( ptr, size );
+}
+
+}
+
+// stat a path many times, and return the number of allocations made
+static uint64_t count_stat_allocs( struct fskit_core* core, char const* path, int iterations ) {
+
+   struct stat sb;
+   int rc = 0;
+   uint64_t ret = 0;
+
+   num_allocs = 0;
+   counting = 1;
+
+   for( int i = 0; i < iterations; i++ ) {
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         break;
+      }
+   }
+
+   counting = 0;
+   ret = num_allocs;
+
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   return ret;
+}
+
+// last non-empty match group seen by the read route
+static char read_group[ FSKIT_FILESYSTEM_NAMEMAX+1 ];
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   int argc = fskit_route_metadata_num_match_groups( route_metadata );
+   char** argv = fskit_route_metadata_get_match_groups( route_metadata );
+
+   // remember the last non-empty group
+   for( int i = 0; i < argc && argv[i] != NULL; i++ ) {
+
+      if( argv[i][0] != '\0' ) {
+         strncpy( read_group, argv[i], FSKIT_FILESYSTEM_NAMEMAX );
+      }
+   }
+
+   return 0;
+}
+
+// read a file many times through its route, and return the number of allocations made
+static uint64_t count_read_allocs( struct fskit_core* core, struct fskit_file_handle* fh, int iterations ) {
+
+   char buf[1];
+   ssize_t rc = 0;
+   uint64_t ret = 0;
+
+   // warm up
+   memset( read_group, 0, sizeof(read_group) );
+
+   rc = fskit_read( core, fh, buf, sizeof(buf), 0 );
+   if( rc != 0 || strcmp( read_group, "f" ) != 0 ) {
+      fskit_error("fskit_read rc = %zd, group = '%s'\n", rc, read_group );
+      exit(1);
+   }
+
+   num_allocs = 0;
+   counting = 1;
+
+   for( int i = 0; i < iterations; i++ ) {
+
+      rc = fskit_read( core, fh, buf, sizeof(buf), 0 );
+      if( rc != 0 ) {
+         break;
+      }
+   }
+
+   counting = 0;
+   ret = num_allocs;
+
+   if( rc != 0 ) {
+      fskit_error("fskit_read rc = %zd\n", rc );
+      exit(1);
+   }
+
+   return ret;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   struct fskit_file_handle* fh = NULL;
+   void* output;
+   uint64_t allocs = 0;
+
+   char const* dirs[] = { "/a", "/ab", "/a/b", "/a/b/c", "/a/b/c/d", NULL };
+   char const* paths[] = { "/", "/a", "/ab", "/a/b/c/d/f", "/a/b/c/d/", "//a/./b//c/d/./f", NULL };
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   for( int i = 0; dirs[i] != NULL; i++ ) {
+
+      rc = fskit_mkdir( core, dirs[i], 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", dirs[i], rc );
+         exit(1);
+      }
+   }
+
+   fh = fskit_create( core, "/a/b/c/d/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/a/b/c/d/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // names that are prefixes of one another must resolve to distinct entries
+   struct stat sb_a, sb_ab;
+   if( fskit_stat( core, "/a", 0, 0, &sb_a ) != 0 || fskit_stat( core, "/ab", 0, 0, &sb_ab ) != 0 || sb_a.st_ino == sb_ab.st_ino ) {
+      fskit_error("%s", "'/a' and '/ab' did not resolve to distinct entries\n");
+      exit(1);
+   }
+
+   // a missing name that is a prefix of an existing one must not resolve
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, "/a/b/c/d/ff", 0, 0, false, &rc );
+   if( fent != NULL || rc != -ENOENT ) {
+      fskit_error("fskit_entry_resolve_path('/a/b/c/d/ff') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; paths[i] != NULL; i++ ) {
+
+      allocs = count_stat_allocs( core, paths[i], 1000 );
+
+      printf("fskit_stat('%s'): %" PRIu64 " allocations in 1000 calls\n", paths[i], allocs );
+
+      if( allocs != 0 ) {
+         fskit_error("fskit_stat('%s') allocated memory\n", paths[i] );
+         exit(1);
+      }
+   }
+
+   // a route simple enough to be matched without regexec
+   rc = fskit_route_read( core, "/a/b/c/d/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_open( core, "/a/b/c/d/f", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/a/b/c/d/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   allocs = count_read_allocs( core, fh, 1000 );
+
+   printf("fskit_read (compiled route): %" PRIu64 " allocations in 1000 calls\n", allocs );
+
+   if( allocs != 0 ) {
+      fskit_error("%s", "dispatching a compiled read route allocated memory\n");
+      exit(1);
+   }
+
+   // a route that needs regexec, which allocates; the route cache skips it once warm
+   fskit_unroute_all( core );
+
+   rc = fskit_route_read( core, "/a/b/c/(d|e)/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_route_cache_enable( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_route_cache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   allocs = count_read_allocs( core, fh, 1000 );
+
+   printf("fskit_read (cached route): %" PRIu64 " allocations in 1000 calls\n", allocs );
+
+   if( allocs != 0 ) {
+      fskit_error("%s", "dispatching a cached read route allocated memory\n");
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,206 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-at.h"
+
+static char last_created[PATH_MAX+1];
+
+static int create_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, mode_t mode, void** inode_data, void** handle_data ) {
+
+   strncpy( last_created, fskit_route_metadata_get_path( route_metadata ), PATH_MAX );
+   return 0;
+}
+
+// resolve a path relative to a directory, and verify that we got the expected error code
+static void expect_resolve_at( struct fskit_core* core, struct fskit_dir_handle* dirh, char const* path, int expected_rc ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path_at( core, dirh, path, 2, 2, false, &rc );
+
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected_rc ) {
+      fskit_error("fskit_entry_resolve_path_at('%s') rc = %d, expected %d\n", path, rc, expected_rc );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_dir_handle* dirh = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_entry* fent = NULL;
+   struct stat sb;
+   int rc;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   rc = fskit_route_create( core, "/.*", create_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_create rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/a", 0777, 0, 0 );
+   if( rc == 0 ) {
+      rc = fskit_mkdir( core, "/a/b", 0777, 1, 1 );
+   }
+
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   dirh = fskit_opendir( core, "/a/b", 1, 1, &rc );
+   if( dirh == NULL ) {
+      fskit_error("fskit_opendir('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // create beneath the directory
+   rc = fskit_mkdirat( core, dirh, "c", 0755, 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdirat('c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdirat( core, dirh, "c", 0755, 1, 1 );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_mkdirat('c') rc = %d, expected %d\n", rc, -EEXIST );
+      exit(1);
+   }
+
+   fh = fskit_openat( core, dirh, "c/f", 1, 1, O_CREAT | O_RDWR, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_openat('c/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // routes and handles see the full path
+   if( strcmp( last_created, "/a/b/c/f" ) != 0 ) {
+      fskit_error("create route got '%s', expected '/a/b/c/f'\n", last_created );
+      exit(1);
+   }
+
+   rc = fskit_statat( core, dirh, "c/f", 1, 1, &sb );
+   if( rc != 0 || sb.st_ino != fskit_entry_get_file_id( fskit_file_handle_get_entry( fh ) ) ) {
+      fskit_error("fskit_statat('c/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   expect_resolve_at( core, dirh, "c/f", 0 );
+   expect_resolve_at( core, dirh, "./c/../c/f", 0 );
+   expect_resolve_at( core, dirh, "/a/b/c/f", 0 );
+   expect_resolve_at( core, NULL, "/a/b/c/f", 0 );
+   expect_resolve_at( core, dirh, "c/nope", -ENOENT );
+   expect_resolve_at( core, dirh, "c/f/g", -ENOTDIR );
+
+   fent = fskit_entry_resolve_path_at( core, dirh, "", 0, 0, false, &rc );
+   if( fent == NULL || fent != fskit_dir_handle_get_entry( dirh ) ) {
+      fskit_error("fskit_entry_resolve_path_at('') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_entry_unlock( fent );
+
+   // permission checks still apply below the directory
+   rc = fskit_chmod( core, "/a/b/c", 1, 1, 0700 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod('/a/b/c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_openat( core, dirh, "c/f", 2, 2, O_RDONLY, 0, &rc );
+   if( fh != NULL || rc != -EACCES ) {
+      fskit_error("fskit_openat('c/f') rc = %d, expected %d\n", rc, -EACCES );
+      exit(1);
+   }
+
+   rc = fskit_chmod( core, "/a/b/c", 1, 1, 0755 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod('/a/b/c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // rename within and across directories
+   rc = fskit_renameat( core, dirh, "c/f", dirh, "c/g", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_renameat('c/f', 'c/g') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve_at( core, dirh, "c/f", -ENOENT );
+   expect_resolve_at( core, dirh, "c/g", 0 );
+
+   rc = fskit_renameat( core, dirh, "c/g", NULL, "/a/g", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_renameat('c/g', '/a/g') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve_at( core, dirh, "c/g", -ENOENT );
+   expect_resolve_at( core, dirh, "../g", 0 );
+
+   // unlink
+   rc = fskit_unlinkat( core, dirh, "../g", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlinkat('../g') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve_at( core, dirh, "../g", -ENOENT );
+
+   // once the directory is removed, nothing resolves beneath it
+   rc = fskit_rmdir( core, "/a/b/c", 1, 1 );
+   if( rc == 0 ) {
+      rc = fskit_rmdir( core, "/a/b", 1, 1 );
+   }
+
+   if( rc != 0 ) {
+      fskit_error("fskit_rmdir('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdirat( core, dirh, "c", 0755, 1, 1 );
+   if( rc != -ENOENT ) {
+      fskit_error("fskit_mkdirat('c') on a removed directory rc = %d, expected %d\n", rc, -ENOENT );
+      exit(1);
+   }
+
+   expect_resolve_at( core, dirh, "", -ENOENT );
+
+   fskit_closedir( core, dirh );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
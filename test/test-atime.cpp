@@ -0,0 +1,247 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-atime.h"
+
+#define DAY (24 * 60 * 60)
+
+// set a file's atime and mtime to the given offsets (in seconds) from now
+static void set_times( struct fskit_core* core, char const* path, time_t atime_ago, time_t mtime_ago ) {
+
+   struct timeval times[2];
+   time_t now = time(NULL);
+   int rc = 0;
+
+   memset( times, 0, sizeof(times) );
+
+   times[0].tv_sec = now - atime_ago;
+   times[1].tv_sec = now - mtime_ago;
+
+   rc = fskit_utimes( core, path, 0, 0, times );
+   if( rc != 0 ) {
+      fskit_error("fskit_utimes('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+}
+
+// how many seconds ago the file was last accessed or modified
+static void get_times( struct fskit_core* core, char const* path, time_t* atime_ago, time_t* mtime_ago ) {
+
+   struct stat sb;
+   time_t now = time(NULL);
+   int rc = 0;
+
+   rc = fskit_stat( core, path, 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   *atime_ago = now - sb.st_atim.tv_sec;
+   *mtime_ago = now - sb.st_mtim.tv_sec;
+}
+
+static void do_read( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   char buf[10];
+
+   ssize_t rc = fskit_read( core, fh, buf, sizeof(buf), 0 );
+   if( rc < 0 ) {
+      fskit_error("fskit_read rc = %zd\n", rc );
+      exit(1);
+   }
+}
+
+static void do_write( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   char buf[10];
+
+   memset( buf, 'a', sizeof(buf) );
+
+   ssize_t rc = fskit_write( core, fh, buf, sizeof(buf), 0 );
+   if( rc < 0 ) {
+      fskit_error("fskit_write rc = %zd\n", rc );
+      exit(1);
+   }
+}
+
+// check that atime (and mtime) are (or aren't) recent
+static void check_times( struct fskit_core* core, char const* what, bool atime_recent, bool mtime_recent ) {
+
+   time_t atime_ago = 0;
+   time_t mtime_ago = 0;
+
+   get_times( core, "/f", &atime_ago, &mtime_ago );
+
+   if( (atime_ago <= 2) != atime_recent || (mtime_ago <= 2) != mtime_recent ) {
+      fskit_error("%s: atime %lds ago, mtime %lds ago; expected atime %s, mtime %s\n", what, (long)atime_ago, (long)mtime_ago,
+                  atime_recent ? "recent" : "old", mtime_recent ? "recent" : "old" );
+      exit(1);
+   }
+}
+
+static struct fskit_core* setup( int policy, int flags, struct fskit_file_handle** fh ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_atime_policy( core, policy, flags );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_atime_policy(%d, %d) rc = %d\n", policy, flags, rc );
+      exit(1);
+   }
+
+   *fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( *fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, *fh );
+
+   *fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( *fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   return core;
+}
+
+static void teardown( struct fskit_core* core, struct fskit_file_handle* fh ) {
+
+   void* output;
+
+   fskit_close( core, fh );
+   fskit_test_end( core, &output );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   time_t atime_ago = 0;
+   time_t mtime_ago = 0;
+   void* output;
+   int rc = 0;
+
+   // strict: every read and write
+   for( int flags = 0; flags <= FSKIT_TIME_COARSE; flags += FSKIT_TIME_COARSE ) {
+
+      core = setup( FSKIT_ATIME_STRICT, flags, &fh );
+
+      set_times( core, "/f", 100, 100 );
+      do_read( core, fh );
+      check_times( core, "strict read", true, false );
+
+      set_times( core, "/f", 100, 100 );
+      do_write( core, fh );
+      check_times( core, "strict write", true, true );
+
+      teardown( core, fh );
+   }
+
+   // relatime: only when atime isn't newer than mtime, or is a day old
+   core = setup( FSKIT_ATIME_RELATIME, 0, &fh );
+
+   // (a new file's ctime is now, so only an atime in the future is newer than both mtime and ctime)
+   set_times( core, "/f", -1000, 200 );
+   do_read( core, fh );
+
+   get_times( core, "/f", &atime_ago, &mtime_ago );
+   if( atime_ago > -900 ) {
+      fskit_error("relatime, fresh atime: atime %lds ago\n", (long)atime_ago );
+      exit(1);
+   }
+
+   set_times( core, "/f", 200, 100 );
+   do_read( core, fh );
+   check_times( core, "relatime, atime older than mtime", true, false );
+
+   set_times( core, "/f", 2 * DAY, 3 * DAY );
+   do_read( core, fh );
+   check_times( core, "relatime, day-old atime", true, false );
+
+   // writes don't set atime, but make the next read do so
+   set_times( core, "/f", 100, 100 );
+   do_write( core, fh );
+   check_times( core, "relatime write", false, true );
+
+   do_read( core, fh );
+   check_times( core, "relatime read after write", true, true );
+
+   teardown( core, fh );
+
+   // noatime: never
+   core = setup( FSKIT_ATIME_NOATIME, 0, &fh );
+
+   set_times( core, "/f", 100, 100 );
+   do_read( core, fh );
+   check_times( core, "noatime read", false, false );
+
+   do_write( core, fh );
+   check_times( core, "noatime write", false, true );
+
+   teardown( core, fh );
+
+   // lazytime: reads are visible to stat right away, and explicitly-set times still win
+   core = setup( FSKIT_ATIME_LAZYTIME, FSKIT_TIME_COARSE, &fh );
+
+   set_times( core, "/f", 100, 100 );
+   do_read( core, fh );
+   check_times( core, "lazytime read", true, false );
+
+   set_times( core, "/f", 100, 100 );
+   check_times( core, "lazytime utimes after read", false, false );
+
+   do_read( core, fh );
+   do_write( core, fh );
+   check_times( core, "lazytime write after read", true, true );
+
+   teardown( core, fh );
+
+   // bad arguments
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_atime_policy( core, FSKIT_ATIME_LAZYTIME + 1, 0 );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_core_atime_policy(bad policy) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_atime_policy( core, FSKIT_ATIME_STRICT, 0x100 );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_core_atime_policy(bad flags) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,158 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-dcache.h"
+
+// resolve a path, and verify that we got the expected error code
+static void expect_resolve( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, int expected_rc ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, user, group, false, &rc );
+
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected_rc ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, expected_rc );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_dcache_stats stats;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_dcache_enable( core, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_dcache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   // setup: /a/b/c/f, where /a/b and below are owned by user 1
+   rc = fskit_mkdir( core, "/a", 0777, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/a') rc = %d\n", rc );
+      exit(1);
+   }
+
+   char const* dirs[] = { "/a/b", "/a/b/c", NULL };
+   for( int i = 0; dirs[i] != NULL; i++ ) {
+
+      rc = fskit_mkdir( core, dirs[i], 0755, 1, 1 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", dirs[i], rc );
+         exit(1);
+      }
+   }
+
+   fh = fskit_create( core, "/a/b/c/f", 1, 1, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/a/b/c/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // repeated lookups should hit
+   for( int i = 0; i < 10; i++ ) {
+      expect_resolve( core, "/a/b/c/f", 1, 1, 0 );
+   }
+
+   fskit_core_dcache_stats( core, &stats );
+   printf("after resolve: hits=%" PRIu64 " misses=%" PRIu64 " invalidations=%" PRIu64 "\n", stats.hits, stats.misses, stats.invalidations );
+
+   if( stats.hits == 0 ) {
+      fskit_error("%s", "no dentry cache hits\n");
+      exit(1);
+   }
+
+   // rename an ancestor: the old path must stop resolving
+   rc = fskit_rename( core, "/a/b", "/a/x", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename('/a/b', '/a/x') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c/f", 1, 1, -ENOENT );
+   expect_resolve( core, "/a/x/c/f", 1, 1, 0 );
+   expect_resolve( core, "/a/x/c/f", 1, 1, 0 );
+
+   // revoke search permission on an ancestor: other users must be refused
+   expect_resolve( core, "/a/x/c/f", 2, 2, 0 );
+
+   rc = fskit_chmod( core, "/a/x", 1, 1, 0700 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod('/a/x') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/x/c/f", 2, 2, -EACCES );
+   expect_resolve( core, "/a/x/c/f", 1, 1, 0 );
+
+   // unlink
+   rc = fskit_unlink( core, "/a/x/c/f", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/a/x/c/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/x/c/f", 1, 1, -ENOENT );
+
+   // rmdir
+   expect_resolve( core, "/a/x/c", 1, 1, 0 );
+
+   rc = fskit_rmdir( core, "/a/x/c", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rmdir('/a/x/c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/x/c", 1, 1, -ENOENT );
+
+   // detach the whole subtree
+   expect_resolve( core, "/a/x", 1, 1, 0 );
+
+   rc = fskit_detach_all( core, "/a" );
+   if( rc != 0 ) {
+      fskit_error("fskit_detach_all('/a') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/x", 1, 1, -ENOENT );
+   expect_resolve( core, "/a", 1, 1, -ENOENT );
+
+   fskit_core_dcache_stats( core, &stats );
+   printf("final: hits=%" PRIu64 " misses=%" PRIu64 " invalidations=%" PRIu64 "\n", stats.hits, stats.misses, stats.invalidations );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
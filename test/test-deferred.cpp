@@ -0,0 +1,294 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-deferred.h"
+
+#define NUM_DIRS 10
+#define NUM_FILES 50
+#define BATCH_SIZE 16
+
+// entries in a tree made by make_tree: the root, its directories, and their files
+#define TREE_SIZE( num_dirs, num_files ) (1 + (num_dirs) + (num_dirs) * (num_files))
+
+static int num_destroyed = 0;
+static int num_file_detached = 0;
+
+static int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+
+   __atomic_add_fetch( &num_destroyed, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+static int detach_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+
+   __atomic_add_fetch( &num_file_detached, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// make root, with num_dirs directories of num_files files each
+static void make_tree( struct fskit_core* core, char const* root, int num_dirs, int num_files ) {
+
+   int rc = 0;
+   char path[PATH_MAX];
+
+   rc = fskit_mkdir( core, root, 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('%s') rc = %d\n", root, rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < num_dirs; i++ ) {
+
+      snprintf( path, PATH_MAX, "%s/d-%d", root, i );
+
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      for( int j = 0; j < num_files; j++ ) {
+
+         snprintf( path, PATH_MAX, "%s/d-%d/f-%d", root, i, j );
+
+         struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+         if( fh == NULL ) {
+            fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+            exit(1);
+         }
+
+         fskit_close( core, fh );
+      }
+   }
+}
+
+// resolve a path, and verify that we got the expected error code
+static void expect_resolve( struct fskit_core* core, char const* path, int expected_rc ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected_rc ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, expected_rc );
+      exit(1);
+   }
+}
+
+static void expect_destroyed( int expected ) {
+
+   int destroyed = __atomic_load_n( &num_destroyed, __ATOMIC_SEQ_CST );
+
+   if( destroyed != expected ) {
+      fskit_error("%d entries destroyed, expected %d\n", destroyed, expected );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+   int destroyed = 0;
+   void* output = NULL;
+   struct fskit_deferred_stats stats;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_file_handle* fh2 = NULL;
+   struct fskit_entry* parent = NULL;
+   struct fskit_entry* child = NULL;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_route_destroy( core, "/.*", destroy_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_destroy rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_detach( core, "/file", detach_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_detach rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( fskit_core_deferred_stats( core, &stats ) != -ENOSYS || fskit_core_deferred_drain( core ) != -ENOSYS ) {
+      fskit_error("%s", "reaper stats/drain should be unavailable before it's enabled\n");
+      exit(1);
+   }
+
+   // without the reaper, removal happens right away
+   make_tree( core, "/small", 3, 5 );
+
+   rc = fskit_deferred_remove_path( core, "/small", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_deferred_remove_path('/small') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/small", -ENOENT );
+   expect_destroyed( TREE_SIZE( 3, 5 ) );
+
+   rc = fskit_deferred_remove_path( core, "/", 0, 0 );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_deferred_remove_path('/') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // start the reaper
+   rc = fskit_core_deferred_enable( core, BATCH_SIZE );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_deferred_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_deferred_enable( core, BATCH_SIZE );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_deferred_enable again rc = %d\n", rc );
+      exit(1);
+   }
+
+   make_tree( core, "/big", NUM_DIRS, NUM_FILES );
+   make_tree( core, "/big2", NUM_DIRS, NUM_FILES );
+
+   // an open file outlives its removal
+   fh = fskit_open( core, "/big/d-0/f-0", 0, 0, O_RDONLY, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/big/d-0/f-0') rc = %d\n", rc );
+      exit(1);
+   }
+
+   destroyed = __atomic_load_n( &num_destroyed, __ATOMIC_SEQ_CST );
+
+   rc = fskit_deferred_remove_path( core, "/big", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_deferred_remove_path('/big') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the whole tree is gone from the namespace right away
+   expect_resolve( core, "/big", -ENOENT );
+   expect_resolve( core, "/big/d-1", -ENOENT );
+   expect_resolve( core, "/big/d-1/f-1", -ENOENT );
+
+   // the name can be reused right away
+   rc = fskit_mkdir( core, "/big", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/big') again rc = %d\n", rc );
+      exit(1);
+   }
+
+   // lowlevel: lock the parent, then the child
+   parent = fskit_entry_resolve_path( core, "/", 0, 0, true, &rc );
+   if( parent == NULL ) {
+      fskit_error("fskit_entry_resolve_path('/') rc = %d\n", rc );
+      exit(1);
+   }
+
+   child = fskit_entry_set_find_name( fskit_entry_get_children( parent ), "big2" );
+   if( child == NULL ) {
+      fskit_error("%s", "no /big2\n");
+      exit(1);
+   }
+
+   fskit_entry_wlock( child );
+
+   rc = fskit_deferred_remove_all( core, "/big2", child );
+   if( rc != 0 ) {
+      fskit_error("fskit_deferred_remove_all('/big2') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_entry_unlock( parent );
+
+   expect_resolve( core, "/big2", -ENOENT );
+
+   // files too
+   fh2 = fskit_create( core, "/file", 0, 0, 0644, &rc );
+   if( fh2 == NULL ) {
+      fskit_error("fskit_create('/file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh2 );
+
+   rc = fskit_deferred_remove_path( core, "/file", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_deferred_remove_path('/file') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/file", -ENOENT );
+
+   if( num_file_detached != 1 ) {
+      fskit_error("'/file' detached %d times\n", num_file_detached );
+      exit(1);
+   }
+
+   rc = fskit_core_deferred_drain( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_deferred_drain rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_core_deferred_stats( core, &stats );
+   printf("queued=%" PRIu64 " completed=%" PRIu64 " failed=%" PRIu64 " pending=%" PRIu64 " reaped=%" PRIu64 " batches=%" PRIu64 "\n",
+          stats.queued, stats.completed, stats.failed, stats.pending, stats.reaped, stats.batches );
+
+   if( stats.queued != 3 || stats.completed != 3 || stats.failed != 0 || stats.pending != 0 ||
+       stats.reaped != 2 * TREE_SIZE( NUM_DIRS, NUM_FILES ) + 1 || stats.batches < TREE_SIZE( NUM_DIRS, NUM_FILES ) / BATCH_SIZE ) {
+      fskit_error("%s", "unexpected reaper statistics\n");
+      exit(1);
+   }
+
+   // everything but the open file
+   expect_destroyed( destroyed + 2 * TREE_SIZE( NUM_DIRS, NUM_FILES ) + 1 - 1 );
+
+   fskit_close( core, fh );
+
+   expect_destroyed( destroyed + 2 * TREE_SIZE( NUM_DIRS, NUM_FILES ) + 1 );
+
+   // leave a removal queued; destroying the core finishes it
+   make_tree( core, "/late", NUM_DIRS, NUM_FILES );
+
+   destroyed = __atomic_load_n( &num_destroyed, __ATOMIC_SEQ_CST );
+
+   rc = fskit_deferred_remove_path( core, "/late", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_deferred_remove_path('/late') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   if( __atomic_load_n( &num_destroyed, __ATOMIC_SEQ_CST ) < destroyed + TREE_SIZE( NUM_DIRS, NUM_FILES ) ) {
+      fskit_error("%s", "core destroyed before the reaper finished\n");
+      exit(1);
+   }
+
+   return 0;
+}
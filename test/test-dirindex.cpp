@@ -0,0 +1,214 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-dirindex.h"
+
+#define NUM_FILES 2000
+
+// verify that a directory's children iterate in sorted order, and that there are the expected number of them
+static void check_children( struct fskit_core* core, char const* path, unsigned int expected_count, bool expect_hashed ) {
+
+   int rc = 0;
+   unsigned int count = 0;
+   char const* prev_name = NULL;
+   fskit_entry_set_itr itr;
+   fskit_entry_set* dp = NULL;
+
+   struct fskit_entry* dir = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+   if( dir == NULL ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_entry_set* children = fskit_entry_get_children( dir );
+
+   for( dp = fskit_entry_set_begin( &itr, children ); dp != NULL; dp = fskit_entry_set_next( &itr ) ) {
+
+      char const* name = fskit_entry_set_name_at( dp );
+
+      if( prev_name != NULL && strcmp( prev_name, name ) >= 0 ) {
+         fskit_error("out of order: '%s' before '%s'\n", prev_name, name );
+         exit(1);
+      }
+
+      if( fskit_entry_set_find_itr( children, name ) != dp ) {
+         fskit_error("lookup of '%s' did not find its own entry\n", name );
+         exit(1);
+      }
+
+      prev_name = name;
+      count++;
+   }
+
+   if( count != expected_count || fskit_entry_set_count( children ) != expected_count ) {
+      fskit_error("'%s': iterated %u, counted %u, expected %u\n", path, count, fskit_entry_set_count( children ), expected_count );
+      exit(1);
+   }
+
+   if( fskit_entry_set_is_hashed( children ) != expect_hashed ) {
+      fskit_error("'%s': hashed = %d, expected %d\n", path, fskit_entry_set_is_hashed( children ), expect_hashed );
+      exit(1);
+   }
+
+   fskit_entry_unlock( dir );
+}
+
+// resolve a path, and verify that we got the expected error code
+static void expect_resolve( struct fskit_core* core, char const* path, int expected_rc ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, 0, 0, false, &rc );
+
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected_rc ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, expected_rc );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   char path[PATH_MAX];
+   struct fskit_file_handle* fh = NULL;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   // index small directories, so we exercise growth and shrinking
+   rc = fskit_core_dir_hash_threshold( core, 16 );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_dir_hash_threshold rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/big", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/big') rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_children( core, "/big", 2, false );
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/big/f%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   check_children( core, "/big", NUM_FILES + 2, true );
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/big/f%d", i );
+      expect_resolve( core, path, 0 );
+   }
+
+   expect_resolve( core, "/big/f", -ENOENT );
+   expect_resolve( core, "/big/f00", -ENOENT );
+
+   // remove the odd-numbered files
+   for( int i = 1; i < NUM_FILES; i += 2 ) {
+
+      snprintf( path, PATH_MAX, "/big/f%d", i );
+
+      rc = fskit_unlink( core, path, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_unlink('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   check_children( core, "/big", NUM_FILES / 2 + 2, true );
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/big/f%d", i );
+      expect_resolve( core, path, (i % 2 == 0 ? 0 : -ENOENT) );
+   }
+
+   // remove all but a few; the index should go away
+   for( int i = 4; i < NUM_FILES; i += 2 ) {
+
+      snprintf( path, PATH_MAX, "/big/f%d", i );
+
+      rc = fskit_unlink( core, path, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_unlink('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   check_children( core, "/big", 4, false );
+   expect_resolve( core, "/big/f0", 0 );
+   expect_resolve( core, "/big/f2", 0 );
+   expect_resolve( core, "/big/f4", -ENOENT );
+
+   // subdirectories inherit the threshold
+   rc = fskit_mkdir( core, "/big/sub", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/big/sub') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < 32; i++ ) {
+
+      snprintf( path, PATH_MAX, "/big/sub/f%d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   check_children( core, "/big/sub", 34, true );
+
+   rc = fskit_detach_all( core, "/big" );
+   if( rc != 0 ) {
+      fskit_error("fskit_detach_all('/big') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/big", -ENOENT );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
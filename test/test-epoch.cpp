@@ -0,0 +1,257 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-epoch.h"
+
+#define NUM_THREADS 8
+#define NUM_LOOKUPS 20000
+#define NUM_CHURNS 500
+
+// resolve a path, and verify that we got the expected error code
+static void expect_resolve( struct fskit_core* core, char const* path, uint64_t user, uint64_t group, bool writelock, int expected_rc ) {
+
+   int rc = 0;
+   struct fskit_entry* fent = fskit_entry_resolve_path( core, path, user, group, writelock, &rc );
+
+   if( fent != NULL ) {
+      fskit_entry_unlock( fent );
+   }
+
+   if( rc != expected_rc ) {
+      fskit_error("fskit_entry_resolve_path('%s') rc = %d, expected %d\n", path, rc, expected_rc );
+      exit(1);
+   }
+}
+
+// look up a path over and over, while another thread creates and removes it
+static void* lookup_thread_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct fskit_entry* fent = NULL;
+   int rc = 0;
+
+   for( int i = 0; i < NUM_LOOKUPS; i++ ) {
+
+      fent = fskit_entry_resolve_path( core, "/d/e/f", 0, 0, (i % 4 == 0), &rc );
+      if( fent != NULL ) {
+
+         if( fskit_entry_get_type( fent ) != FSKIT_ENTRY_TYPE_FILE ) {
+            fskit_error("resolved /d/e/f to a non-file (type %d)\n", fskit_entry_get_type( fent ) );
+            exit(1);
+         }
+
+         fskit_entry_unlock( fent );
+      }
+      else if( rc != -ENOENT ) {
+         fskit_error("fskit_entry_resolve_path('/d/e/f') rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_epoch_stats stats;
+   pthread_t threads[NUM_THREADS];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   rc = fskit_core_epoch_stats( core, &stats );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_core_epoch_stats rc = %d, expected %d\n", rc, -ENOSYS );
+      exit(1);
+   }
+
+   rc = fskit_core_epoch_enable( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_epoch_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_epoch_enable( core );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_epoch_enable rc = %d, expected %d\n", rc, -EEXIST );
+      exit(1);
+   }
+
+   // setup: /a/b/c/f, where /a/b and below are owned by user 1
+   rc = fskit_mkdir( core, "/a", 0777, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/a') rc = %d\n", rc );
+      exit(1);
+   }
+
+   char const* dirs[] = { "/a/b", "/a/b/c", NULL };
+   for( int i = 0; dirs[i] != NULL; i++ ) {
+
+      rc = fskit_mkdir( core, dirs[i], 0755, 1, 1 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", dirs[i], rc );
+         exit(1);
+      }
+   }
+
+   fh = fskit_create( core, "/a/b/c/f", 1, 1, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/a/b/c/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // lookups succeed and fail like locked ones do
+   expect_resolve( core, "/", 0, 0, false, 0 );
+   expect_resolve( core, "/", 0, 0, true, 0 );
+   expect_resolve( core, "/a/b/c/f", 2, 2, false, 0 );
+   expect_resolve( core, "/a/b/c/f", 2, 2, true, 0 );
+   expect_resolve( core, "/a/./b/c/", 2, 2, false, 0 );
+   expect_resolve( core, "/a/b/c/nope", 2, 2, false, -ENOENT );
+   expect_resolve( core, "/a/b/c/f/g", 2, 2, false, -ENOTDIR );
+
+   // permission changes are seen right away
+   rc = fskit_chmod( core, "/a/b", 1, 1, 0700 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c/f", 2, 2, false, -EACCES );
+   expect_resolve( core, "/a/b/c/f", 1, 1, false, 0 );
+
+   // ...including on the last directory in the path
+   expect_resolve( core, "/a/b", 2, 2, false, -EACCES );
+   expect_resolve( core, "/a/b/", 2, 2, true, -EACCES );
+   expect_resolve( core, "/a/b", 1, 1, false, 0 );
+
+   rc = fskit_chmod( core, "/a/b", 1, 1, 0755 );
+   if( rc != 0 ) {
+      fskit_error("fskit_chmod('/a/b') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c/f", 2, 2, false, 0 );
+
+   // renames are seen right away
+   rc = fskit_rename( core, "/a/b/c", "/a/b/c2", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename('/a/b/c') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c/f", 2, 2, false, -ENOENT );
+   expect_resolve( core, "/a/b/c2/f", 2, 2, false, 0 );
+   expect_resolve( core, "/a/b/c2/../c2/f", 2, 2, false, 0 );
+
+   // so are removals
+   rc = fskit_unlink( core, "/a/b/c2/f", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/a/b/c2/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c2/f", 2, 2, false, -ENOENT );
+
+   rc = fskit_rmdir( core, "/a/b/c2", 1, 1 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rmdir('/a/b/c2') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_resolve( core, "/a/b/c2", 2, 2, false, -ENOENT );
+   expect_resolve( core, "/a/b", 2, 2, false, 0 );
+
+   rc = fskit_core_epoch_stats( core, &stats );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_epoch_stats rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( stats.lookups == 0 || stats.fallbacks == 0 ) {
+      fskit_error("lookups = %" PRIu64 ", fallbacks = %" PRIu64 "; expected both to be nonzero\n", stats.lookups, stats.fallbacks );
+      exit(1);
+   }
+
+   // lookups racing with creation and removal
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, lookup_thread_main, core );
+   }
+
+   for( int i = 0; i < NUM_CHURNS; i++ ) {
+
+      rc = fskit_mkdir( core, "/d", 0755, 0, 0 );
+      if( rc == 0 ) {
+         rc = fskit_mkdir( core, "/d/e", 0755, 0, 0 );
+      }
+
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('/d/e') rc = %d\n", rc );
+         exit(1);
+      }
+
+      fh = fskit_create( core, "/d/e/f", 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('/d/e/f') rc = %d\n", rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+
+      rc = fskit_unlink( core, "/d/e/f", 0, 0 );
+      if( rc == 0 ) {
+         rc = fskit_rmdir( core, "/d/e", 0, 0 );
+      }
+
+      if( rc == 0 ) {
+         rc = fskit_rmdir( core, "/d", 0, 0 );
+      }
+
+      if( rc != 0 ) {
+         fskit_error("removing /d/e/f rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   fskit_core_epoch_stats( core, &stats );
+
+   if( stats.deferred == 0 || stats.reclaimed > stats.deferred ) {
+      fskit_error("deferred = %" PRIu64 ", reclaimed = %" PRIu64 "\n", stats.deferred, stats.reclaimed );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
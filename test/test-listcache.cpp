@@ -0,0 +1,291 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+
+#include "test-listcache.h"
+
+#define NUM_FILES 50
+#define NUM_DIRS 40
+#define MAX_BYTES 4096
+
+// omit files with odd numbers
+static int readdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, struct fskit_dir_entry** dents, size_t num_dents ) {
+
+   for( size_t i = 0; i < num_dents; i++ ) {
+
+      size_t len = strlen( dents[i]->name );
+      if( dents[i]->name[0] == 'f' && (dents[i]->name[ len - 1 ] - '0') % 2 == 1 ) {
+         fskit_readdir_omit( dents, i );
+      }
+   }
+
+   return 0;
+}
+
+// list a directory, and verify that it has the expected number of entries,
+// and that name is (or isn't) one of them.
+static void expect_listing( struct fskit_core* core, char const* path, uint64_t expected_count, char const* name, bool present ) {
+
+   int rc = 0;
+   uint64_t num_listed = 0;
+   bool found = false;
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, path, 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   struct fskit_dir_entry** dents = fskit_listdir( core, dh, &num_listed, &rc );
+   if( dents == NULL ) {
+      fskit_error("fskit_listdir('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   for( uint64_t i = 0; i < num_listed; i++ ) {
+
+      if( strcmp( dents[i]->name, name ) == 0 ) {
+         found = true;
+      }
+   }
+
+   fskit_dir_entry_free_list( dents );
+
+   if( num_listed != expected_count || found != present ) {
+      fskit_error("listed %" PRIu64 " entries of '%s' (expected %" PRIu64 "), '%s' %s\n", num_listed, path, expected_count, name, found ? "present" : "missing" );
+      exit(1);
+   }
+
+   // the handle is at the end now
+   dents = fskit_listdir( core, dh, &num_listed, &rc );
+   if( dents != NULL || rc != 0 ) {
+      fskit_error("fskit_listdir('%s') after listing everything rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_closedir( core, dh );
+}
+
+static void get_stats( struct fskit_core* core, struct fskit_listcache_stats* stats ) {
+
+   int rc = fskit_core_listcache_stats( core, stats );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_listcache_stats rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("hits=%" PRIu64 " misses=%" PRIu64 " evictions=%" PRIu64 " snapshots=%" PRIu64 " bytes=%" PRIu64 "\n",
+          stats->hits, stats->misses, stats->evictions, stats->snapshots, stats->bytes );
+}
+
+static void create_file( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+   void* output = NULL;
+   char path[PATH_MAX];
+   struct fskit_listcache_stats stats;
+   struct fskit_listcache_stats before;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_snapshot* snap1 = NULL;
+   struct fskit_dir_snapshot* snap2 = NULL;
+   uint64_t count = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_listcache_stats( core, &stats );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_core_listcache_stats rc = %d before enabling\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_listcache_enable( core, MAX_BYTES );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_listcache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_listcache_enable( core, MAX_BYTES );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_listcache_enable again rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/d", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/d/f-%03d", i );
+      create_file( core, path );
+   }
+
+   // repeated listings should hit
+   for( int i = 0; i < 10; i++ ) {
+      expect_listing( core, "/d", NUM_FILES + 2, "f-000", true );
+   }
+
+   get_stats( core, &stats );
+   if( stats.hits < 9 || stats.snapshots == 0 ) {
+      fskit_error("%s", "no listing cache hits\n");
+      exit(1);
+   }
+
+   // snapshots are shared
+   dh = fskit_opendir( core, "/d", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   snap1 = fskit_listdir_snapshot( core, dh, &rc );
+   snap2 = fskit_listdir_snapshot( core, dh, &rc );
+   if( snap1 == NULL || snap1 != snap2 ) {
+      fskit_error("fskit_listdir_snapshot gave %p and %p, rc = %d\n", snap1, snap2, rc );
+      exit(1);
+   }
+
+   for( struct fskit_dir_record const* rec = fskit_dir_snapshot_next( snap1, NULL ); rec != NULL; rec = fskit_dir_snapshot_next( snap1, rec ) ) {
+      count++;
+   }
+
+   if( count != NUM_FILES + 2 || fskit_dir_snapshot_count( snap1 ) != count ) {
+      fskit_error("snapshot has %" PRIu64 " records (count %" PRIu64 ")\n", count, fskit_dir_snapshot_count( snap1 ) );
+      exit(1);
+   }
+
+   fskit_dir_snapshot_unref( snap2 );
+
+   // changes are visible right away, and old snapshots stay intact
+   create_file( core, "/d/new" );
+   expect_listing( core, "/d", NUM_FILES + 3, "new", true );
+
+   if( fskit_dir_snapshot_count( snap1 ) != NUM_FILES + 2 ) {
+      fskit_error("%s", "snapshot changed\n");
+      exit(1);
+   }
+
+   fskit_dir_snapshot_unref( snap1 );
+   fskit_closedir( core, dh );
+
+   rc = fskit_rename( core, "/d/new", "/d/renamed", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_listing( core, "/d", NUM_FILES + 3, "new", false );
+   expect_listing( core, "/d", NUM_FILES + 3, "renamed", true );
+
+   rc = fskit_unlink( core, "/d/renamed", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_listing( core, "/d", NUM_FILES + 2, "renamed", false );
+
+   // moving a directory repoints its ..
+   rc = fskit_mkdir( core, "/d/sub", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/d/sub') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_listing( core, "/d/sub", 2, "..", true );
+
+   rc = fskit_rename( core, "/d/sub", "/sub", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename('/d/sub', '/sub') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_listing( core, "/sub", 2, "..", true );
+   expect_listing( core, "/d", NUM_FILES + 2, "sub", false );
+
+   // routed listings aren't cached
+   int readdir_route = fskit_route_readdir( core, "/d", readdir_cb, FSKIT_CONCURRENT );
+   if( readdir_route < 0 ) {
+      fskit_error("fskit_route_readdir rc = %d\n", readdir_route );
+      exit(1);
+   }
+
+   get_stats( core, &before );
+
+   expect_listing( core, "/d", NUM_FILES / 2 + 2, "f-001", false );
+   expect_listing( core, "/d", NUM_FILES / 2 + 2, "f-001", false );
+
+   get_stats( core, &stats );
+   if( stats.hits != before.hits ) {
+      fskit_error("%s", "routed listing was cached\n");
+      exit(1);
+   }
+
+   rc = fskit_unroute_readdir( core, readdir_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_readdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_listing( core, "/d", NUM_FILES + 2, "f-001", true );
+
+   // memory stays bounded
+   for( int i = 0; i < NUM_DIRS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/e-%03d", i );
+
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      expect_listing( core, path, 2, ".", true );
+   }
+
+   get_stats( core, &stats );
+   if( stats.bytes > MAX_BYTES || stats.evictions == 0 ) {
+      fskit_error("%s", "listing cache is unbounded\n");
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,309 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-pcache.h"
+
+#define BLOCK_SIZE 64
+#define BLOCKS_PER_SHARD 4
+#define FILE_BLOCKS 256
+
+// the "backend": one file's bytes
+static char backing[ FILE_BLOCKS * BLOCK_SIZE ];
+static size_t backing_size = 0;
+
+// read route calls, and whether any of them weren't whole, aligned blocks
+static int num_reads = 0;
+static bool unaligned = false;
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   size_t len = 0;
+
+   num_reads++;
+
+   if( offset % BLOCK_SIZE != 0 || buflen != BLOCK_SIZE ) {
+      unaligned = true;
+   }
+
+   if( (size_t)offset < backing_size ) {
+      len = MIN( buflen, backing_size - offset );
+      memcpy( buf, backing + offset, len );
+   }
+
+   return len;
+}
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   memcpy( backing + offset, buf, buflen );
+
+   if( offset + buflen > backing_size ) {
+      backing_size = offset + buflen;
+   }
+
+   return buflen;
+}
+
+static int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+
+   backing_size = new_size;
+   return 0;
+}
+
+// give every file the same inode number, so a recreated file reuses its predecessor's
+static uint64_t same_inode_alloc( struct fskit_entry* parent, struct fskit_entry* child, void* app_data ) {
+   return 42;
+}
+
+// read and check against the backend, and check how many route calls it took
+static void check_read( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len, int expected_reads, char const* what ) {
+
+   char buf[ FILE_BLOCKS * BLOCK_SIZE ];
+   size_t expected_len = 0;
+   int before = num_reads;
+   ssize_t rc = 0;
+
+   if( (size_t)offset < backing_size ) {
+      expected_len = MIN( len, backing_size - offset );
+   }
+
+   rc = fskit_read( core, fh, buf, len, offset );
+   if( rc != (signed)expected_len ) {
+      fskit_error("%s: fskit_read(%zu @ %jd) rc = %zd, expected %zu\n", what, len, (intmax_t)offset, rc, expected_len );
+      exit(1);
+   }
+
+   if( memcmp( buf, backing + offset, expected_len ) != 0 ) {
+      fskit_error("%s: fskit_read(%zu @ %jd) got the wrong data\n", what, len, (intmax_t)offset );
+      exit(1);
+   }
+
+   if( expected_reads >= 0 && num_reads - before != expected_reads ) {
+      fskit_error("%s: %d read route calls, expected %d\n", what, num_reads - before, expected_reads );
+      exit(1);
+   }
+}
+
+static void run( int policy, char const* name ) {
+
+   int rc;
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh;
+   struct fskit_pcache_stats stats;
+   char buf[ BLOCK_SIZE ];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_pcache_enable( core, BLOCK_SIZE, BLOCK_SIZE * BLOCKS_PER_SHARD * FSKIT_PCACHE_SHARDS, policy );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_pcache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_pcache_enable( core, BLOCK_SIZE, 0, policy );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_pcache_enable(again) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_core_inode_alloc_cb( core, same_inode_alloc );
+
+   fskit_route_read( core, "/f", read_cb, FSKIT_CONCURRENT );
+   fskit_route_write( core, "/f", write_cb, FSKIT_CONCURRENT );
+   fskit_route_trunc( core, "/f", trunc_cb, FSKIT_CONCURRENT );
+
+   for( size_t i = 0; i < sizeof(backing); i++ ) {
+      backing[i] = 'a' + (i % 26);
+   }
+
+   num_reads = 0;
+   unaligned = false;
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // (creating it truncated it)
+   backing_size = sizeof(backing);
+
+   fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // misses fetch whole blocks; hits don't reach the route
+   check_read( core, fh, 10, 100, 2, "cold" );
+   check_read( core, fh, 10, 100, 0, "warm" );
+   check_read( core, fh, 64, 10, 0, "warm, within a block" );
+
+   if( unaligned ) {
+      fskit_error("%s", "read route saw an unaligned read\n");
+      exit(1);
+   }
+
+   // writes invalidate
+   memset( buf, 'W', sizeof(buf) );
+
+   rc = fskit_write( core, fh, buf, 8, 20 );
+   if( rc != 8 ) {
+      fskit_error("fskit_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_read( core, fh, 10, 100, 2, "after write" );
+   check_read( core, fh, 10, 100, 0, "after write, warm" );
+
+   // truncates invalidate, and short blocks are the end of the file
+   rc = fskit_ftrunc( core, fh, 100 );
+   if( rc != 0 ) {
+      fskit_error("fskit_ftrunc rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_read( core, fh, 0, 200, 2, "after truncate" );
+   check_read( core, fh, 0, 200, 0, "after truncate, warm" );
+   check_read( core, fh, 150, 10, 1, "past the end" );
+
+   backing_size = sizeof(backing);
+
+   rc = fskit_ftrunc( core, fh, backing_size );
+   if( rc != 0 ) {
+      fskit_error("fskit_ftrunc rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the cache stays within its budget
+   check_read( core, fh, 0, sizeof(backing), FILE_BLOCKS, "whole file" );
+
+   fskit_core_pcache_stats( core, &stats );
+   if( stats.blocks > BLOCKS_PER_SHARD * FSKIT_PCACHE_SHARDS || stats.evictions == 0 ) {
+      fskit_error("%" PRIu64 " blocks cached, %" PRIu64 " evictions\n", stats.blocks, stats.evictions );
+      exit(1);
+   }
+
+   if( policy == FSKIT_PCACHE_ARC ) {
+
+      // blocks read twice survive a scan of blocks read once
+      check_read( core, fh, 0, BLOCK_SIZE, -1, "hot" );
+      check_read( core, fh, 0, BLOCK_SIZE, 0, "hot, again" );
+
+      for( int i = 1; i < FILE_BLOCKS; i++ ) {
+         check_read( core, fh, i * BLOCK_SIZE, BLOCK_SIZE, -1, "scan" );
+      }
+
+      check_read( core, fh, 0, BLOCK_SIZE, 0, "hot, after scan" );
+   }
+
+   fskit_close( core, fh );
+
+   // destroying the file leaves its blocks to age out, but a new file with its inode number never sees them
+   rc = fskit_unlink( core, "/f", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_core_pcache_stats( core, &stats );
+   if( stats.blocks == 0 || stats.invalidations != 0 ) {
+      fskit_error("after unlink: %" PRIu64 " blocks cached, %" PRIu64 " invalidations\n", stats.blocks, stats.invalidations );
+      exit(1);
+   }
+
+   for( size_t i = 0; i < sizeof(backing); i++ ) {
+      backing[i] = 'A' + (i % 26);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') again rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   backing_size = sizeof(backing);
+
+   fh = fskit_open( core, "/f", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/f') again rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_read( core, fh, 0, BLOCK_SIZE, 1, "recreated" );
+   check_read( core, fh, 0, BLOCK_SIZE, 0, "recreated, warm" );
+
+   fskit_close( core, fh );
+
+   // explicit invalidation drops every block
+   fskit_core_pcache_invalidate( core, 42 );
+
+   fskit_core_pcache_stats( core, &stats );
+
+   printf("%s: hits = %" PRIu64 ", misses = %" PRIu64 ", evictions = %" PRIu64 ", invalidations = %" PRIu64 ", hit time = %" PRIu64 "ns, miss time = %" PRIu64 "ns\n",
+          name, stats.hits, stats.misses, stats.evictions, stats.invalidations, stats.hit_ns, stats.miss_ns );
+
+   if( stats.blocks != 0 || stats.invalidations != 1 ) {
+      fskit_error("after invalidate: %" PRIu64 " blocks cached, %" PRIu64 " invalidations\n", stats.blocks, stats.invalidations );
+      exit(1);
+   }
+
+   rc = fskit_unlink( core, "/f", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/f') again rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   void* output;
+   int rc;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_pcache_enable( core, 0, 0, 0 );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_core_pcache_enable(bad policy) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   run( FSKIT_PCACHE_CLOCK, "clock" );
+   run( FSKIT_PCACHE_ARC, "arc" );
+
+   return 0;
+}
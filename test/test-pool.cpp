@@ -0,0 +1,197 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-pool.h"
+
+#define NUM_THREADS 8
+#define NUM_CALLS 4
+#define MAX_CONCURRENCY 2
+#define MAX_QUEUED 2
+#define SERVICE_US 20000
+
+static struct fskit_core* core = NULL;
+
+// number of stat callbacks running, and the most that ever ran at once
+static int in_flight = 0;
+static int max_in_flight = 0;
+
+// thread the last stat callback ran in
+static pthread_t last_thread;
+
+// a slow backend
+static int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   int n = __atomic_add_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   int max = __atomic_load_n( &max_in_flight, __ATOMIC_SEQ_CST );
+
+   while( n > max && !__atomic_compare_exchange_n( &max_in_flight, &max, n, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+   last_thread = pthread_self();
+
+   usleep( SERVICE_US );
+
+   __atomic_sub_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// a fast one
+static int getxattr_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char const* name, char* value, size_t value_len ) {
+   return -ENOATTR;
+}
+
+static void* stat_main( void* arg ) {
+
+   struct stat sb;
+
+   for( int i = 0; i < NUM_CALLS; i++ ) {
+
+      int rc = fskit_stat( core, "/f", 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('/f') rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   int rc;
+   int stat_handle;
+   int getxattr_handle;
+   pthread_t threads[NUM_THREADS];
+   struct fskit_route_pool_stats stats;
+   struct fskit_file_handle* fh;
+   struct stat sb;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   stat_handle = fskit_route_stat( core, "/.*", stat_cb, FSKIT_CONCURRENT );
+   if( stat_handle < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", stat_handle );
+      exit(1);
+   }
+
+   getxattr_handle = fskit_route_getxattr( core, "/.*", getxattr_cb, FSKIT_CONCURRENT );
+   if( getxattr_handle < 0 ) {
+      fskit_error("fskit_route_getxattr rc = %d\n", getxattr_handle );
+      exit(1);
+   }
+
+   // bad arguments
+   rc = fskit_route_pool_enable( core, FSKIT_ROUTE_MATCH_STAT, stat_handle + 1, MAX_CONCURRENCY, MAX_QUEUED );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_route_pool_enable(bad handle) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_pool_enable( core, FSKIT_ROUTE_MATCH_STAT, stat_handle, 0, MAX_QUEUED );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_route_pool_enable(0 workers) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_pool_enable( core, FSKIT_ROUTE_MATCH_STAT, stat_handle, MAX_CONCURRENCY, MAX_QUEUED );
+   if( rc != 0 ) {
+      fskit_error("fskit_route_pool_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_pool_enable( core, FSKIT_ROUTE_MATCH_STAT, stat_handle, MAX_CONCURRENCY, MAX_QUEUED );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_route_pool_enable(again) rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the fast route stays inline
+   rc = fskit_route_pool_stats( core, FSKIT_ROUTE_MATCH_GETXATTR, getxattr_handle, &stats );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_route_pool_stats(getxattr) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // the callback runs in a worker, not the caller
+   rc = fskit_stat( core, "/f", 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( pthread_equal( last_thread, pthread_self() ) ) {
+      fskit_error("%s", "pooled stat callback ran in the caller's thread\n");
+      exit(1);
+   }
+
+   // many callers, but no more than MAX_CONCURRENCY callbacks at once
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, stat_main, NULL );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   if( max_in_flight > MAX_CONCURRENCY ) {
+      fskit_error("%d stat callbacks ran at once (limit %d)\n", max_in_flight, MAX_CONCURRENCY );
+      exit(1);
+   }
+
+   rc = fskit_route_pool_stats( core, FSKIT_ROUTE_MATCH_STAT, stat_handle, &stats );
+   if( rc != 0 ) {
+      fskit_error("fskit_route_pool_stats rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("calls = %" PRIu64 ", blocked = %" PRIu64 ", queue wait = %" PRIu64 "ns (max %" PRIu64 "ns), service = %" PRIu64 "ns (max %" PRIu64 "ns), max in flight = %d\n",
+          stats.calls, stats.blocked, stats.queue_wait_ns, stats.max_queue_wait_ns, stats.service_ns, stats.max_service_ns, max_in_flight );
+
+   if( stats.calls != NUM_THREADS * NUM_CALLS + 1 ) {
+      fskit_error("calls = %" PRIu64 ", expected %d\n", stats.calls, NUM_THREADS * NUM_CALLS + 1 );
+      exit(1);
+   }
+
+   if( stats.service_ns < stats.calls * SERVICE_US * 1000 ) {
+      fskit_error("service = %" PRIu64 "ns, expected at least %" PRIu64 "ns\n", stats.service_ns, stats.calls * SERVICE_US * 1000 );
+      exit(1);
+   }
+
+   if( stats.queue_wait_ns == 0 || stats.queued != 0 || stats.running != 0 ) {
+      fskit_error("queue wait = %" PRIu64 "ns, queued = %d, running = %d\n", stats.queue_wait_ns, stats.queued, stats.running );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
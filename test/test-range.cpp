@@ -0,0 +1,291 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-range.h"
+
+#define NUM_THREADS 4
+#define NUM_WRITES 200
+
+// a route call at this offset blocks until released
+static off_t block_offset = -1;
+static volatile int blocked = 0;
+static volatile int release = 0;
+
+// number of route calls running, and the most that ever ran at once
+static int in_flight = 0;
+static int max_in_flight = 0;
+
+static struct fskit_core* core = NULL;
+static struct fskit_file_handle* fh = NULL;
+
+static void maybe_block( off_t offset ) {
+
+   if( offset != __atomic_load_n( &block_offset, __ATOMIC_SEQ_CST ) ) {
+      return;
+   }
+
+   __atomic_store_n( &blocked, 1, __ATOMIC_SEQ_CST );
+
+   while( !__atomic_load_n( &release, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+}
+
+static int io_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   int n = __atomic_add_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   int max = __atomic_load_n( &max_in_flight, __ATOMIC_SEQ_CST );
+
+   while( n > max && !__atomic_compare_exchange_n( &max_in_flight, &max, n, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+   maybe_block( offset );
+
+   // give the other calls a chance to overlap
+   sched_yield();
+
+   __atomic_sub_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   return buflen;
+}
+
+static int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+
+   maybe_block( new_size );
+   return 0;
+}
+
+// an I/O call to run in its own thread
+struct range_op {
+
+   char const* name;
+   int type;            // FSKIT_ROUTE_MATCH_READ, _WRITE, or _TRUNC
+   off_t offset;
+   size_t len;
+
+   pthread_t thread;
+   volatile int done;
+};
+
+static void* range_op_main( void* arg ) {
+
+   struct range_op* op = (struct range_op*)arg;
+   char buf[64];
+   ssize_t rc = 0;
+
+   memset( buf, 0, sizeof(buf) );
+
+   if( op->type == FSKIT_ROUTE_MATCH_READ ) {
+      rc = fskit_read( core, fh, buf, op->len, op->offset );
+   }
+   else if( op->type == FSKIT_ROUTE_MATCH_WRITE ) {
+      rc = fskit_write( core, fh, buf, op->len, op->offset );
+   }
+   else {
+      rc = fskit_ftrunc( core, fh, op->offset );
+      if( rc == 0 ) {
+         rc = op->len;
+      }
+   }
+
+   if( rc != (signed)op->len ) {
+      fskit_error("%s rc = %zd\n", op->name, rc );
+      exit(1);
+   }
+
+   __atomic_store_n( &op->done, 1, __ATOMIC_SEQ_CST );
+   return NULL;
+}
+
+static void range_op_start( struct range_op* op, char const* name, int type, off_t offset, size_t len ) {
+
+   op->name = name;
+   op->type = type;
+   op->offset = offset;
+   op->len = len;
+   op->done = 0;
+
+   pthread_create( &op->thread, NULL, range_op_main, op );
+}
+
+// start a call that blocks inside its route until range_release
+static void range_op_start_blocked( struct range_op* op, char const* name, int type, off_t offset, size_t len ) {
+
+   __atomic_store_n( &blocked, 0, __ATOMIC_SEQ_CST );
+   __atomic_store_n( &release, 0, __ATOMIC_SEQ_CST );
+   __atomic_store_n( &block_offset, offset, __ATOMIC_SEQ_CST );
+
+   range_op_start( op, name, type, offset, len );
+
+   while( !__atomic_load_n( &blocked, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+}
+
+static void range_release( struct range_op* blocker ) {
+
+   __atomic_store_n( &release, 1, __ATOMIC_SEQ_CST );
+   pthread_join( blocker->thread, NULL );
+
+   __atomic_store_n( &block_offset, -1, __ATOMIC_SEQ_CST );
+}
+
+// check that op finishes (or doesn't) while a blocking call holds its range
+static void expect_parallel( struct range_op* op, bool parallel ) {
+
+   if( parallel ) {
+
+      // must finish without the blocker
+      pthread_join( op->thread, NULL );
+      return;
+   }
+
+   usleep( 50000 );
+
+   if( __atomic_load_n( &op->done, __ATOMIC_SEQ_CST ) ) {
+      fskit_error("%s ran alongside an overlapping call\n", op->name );
+      exit(1);
+   }
+}
+
+// block a call on one range, and check whether a call on another can run meanwhile
+static void check_overlap( int blocker_type, off_t blocker_off, size_t blocker_len, int type, off_t off, size_t len, bool parallel, char const* name ) {
+
+   struct range_op blocker;
+   struct range_op op;
+
+   range_op_start_blocked( &blocker, "blocker", blocker_type, blocker_off, blocker_len );
+   range_op_start( &op, name, type, off, len );
+
+   expect_parallel( &op, parallel );
+
+   range_release( &blocker );
+
+   if( !parallel ) {
+      pthread_join( op.thread, NULL );
+   }
+
+   printf("%s: %s\n", name, parallel ? "parallel" : "serialized" );
+}
+
+static void* writer_main( void* arg ) {
+
+   char buf[16];
+
+   memset( buf, 0, sizeof(buf) );
+
+   for( int i = 0; i < NUM_WRITES; i++ ) {
+
+      ssize_t rc = fskit_write( core, fh, buf, sizeof(buf), 0 );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   int rc;
+   pthread_t threads[NUM_THREADS];
+   struct stat sb;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_route_read( core, "/([^/]+)", io_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/([^/]+)", io_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_trunc( core, "/([^/]+)", trunc_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_trunc rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // disjoint writes run in parallel; overlapping ones don't
+   check_overlap( FSKIT_ROUTE_MATCH_WRITE, 0, 16, FSKIT_ROUTE_MATCH_WRITE, 16, 16, true, "write [0,16) vs write [16,32)" );
+   check_overlap( FSKIT_ROUTE_MATCH_WRITE, 0, 16, FSKIT_ROUTE_MATCH_WRITE, 8, 16, false, "write [0,16) vs write [8,24)" );
+
+   // overlapping reads share; reads and writes don't
+   check_overlap( FSKIT_ROUTE_MATCH_READ, 0, 16, FSKIT_ROUTE_MATCH_READ, 8, 16, true, "read [0,16) vs read [8,24)" );
+   check_overlap( FSKIT_ROUTE_MATCH_WRITE, 0, 16, FSKIT_ROUTE_MATCH_READ, 8, 16, false, "write [0,16) vs read [8,24)" );
+   check_overlap( FSKIT_ROUTE_MATCH_READ, 8, 16, FSKIT_ROUTE_MATCH_WRITE, 0, 16, false, "read [8,24) vs write [0,16)" );
+
+   // a truncate covers everything from its new size onward
+   check_overlap( FSKIT_ROUTE_MATCH_TRUNC, 32, 0, FSKIT_ROUTE_MATCH_WRITE, 0, 16, true, "trunc 32 vs write [0,16)" );
+   check_overlap( FSKIT_ROUTE_MATCH_TRUNC, 32, 0, FSKIT_ROUTE_MATCH_WRITE, 40, 8, false, "trunc 32 vs write [40,48)" );
+   check_overlap( FSKIT_ROUTE_MATCH_WRITE, 40, 8, FSKIT_ROUTE_MATCH_TRUNC, 32, 0, false, "write [40,48) vs trunc 32" );
+
+   // many writers on the same range never overlap
+   __atomic_store_n( &max_in_flight, 0, __ATOMIC_SEQ_CST );
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, writer_main, NULL );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   if( max_in_flight != 1 ) {
+      fskit_error("%d overlapping writes ran at once\n", max_in_flight );
+      exit(1);
+   }
+
+   // metadata updates from the calls above all landed
+   rc = fskit_stat( core, "/f", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != 32 ) {
+      fskit_error("fskit_stat('/f') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
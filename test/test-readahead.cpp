@@ -0,0 +1,423 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-readahead.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define READ_SIZE 4096
+#define MIN_WINDOW (16 * 1024)
+#define MAX_WINDOW (64 * 1024)
+
+// prefetch and read route calls (prefetches also come from the readahead worker)
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static bool prefetch_blocked = false;          // if set, prefetches past the first window wait until it's cleared
+static int num_prefetches = 0;
+static off_t prefetch_off[1024];
+static size_t prefetch_len[1024];
+
+static int num_reads = 0;
+static size_t max_read_len = 0;
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   size_t len = 0;
+
+   pthread_mutex_lock( &prefetch_lock );
+
+   num_reads++;
+
+   if( buflen > max_read_len ) {
+      max_read_len = buflen;
+   }
+
+   pthread_mutex_unlock( &prefetch_lock );
+
+   if( offset < FILE_SIZE ) {
+
+      len = MIN( buflen, (size_t)(FILE_SIZE - offset) );
+
+      for( size_t i = 0; i < len; i++ ) {
+         buf[i] = (char)((offset + i) % 251);
+      }
+   }
+
+   return len;
+}
+
+static int prefetch_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, size_t len, off_t offset, void* handle_data ) {
+
+   pthread_mutex_lock( &prefetch_lock );
+
+   while( prefetch_blocked && offset > 0 ) {
+      pthread_cond_wait( &prefetch_cond, &prefetch_lock );
+   }
+
+   prefetch_off[ num_prefetches ] = offset;
+   prefetch_len[ num_prefetches ] = len;
+   num_prefetches++;
+
+   pthread_mutex_unlock( &prefetch_lock );
+   return 0;
+}
+
+static int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+   return 0;
+}
+
+static void do_read( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len ) {
+
+   char buf[ MAX_WINDOW ];
+   size_t expected = 0;
+   ssize_t rc = 0;
+
+   if( offset < FILE_SIZE ) {
+      expected = MIN( len, (size_t)(FILE_SIZE - offset) );
+   }
+
+   rc = fskit_read( core, fh, buf, len, offset );
+   if( rc != (signed)expected ) {
+      fskit_error("fskit_read(%zu @ %jd) rc = %zd, expected %zu\n", len, (intmax_t)offset, rc, expected );
+      exit(1);
+   }
+
+   for( size_t i = 0; i < expected; i++ ) {
+      if( buf[i] != (char)((offset + i) % 251) ) {
+         fskit_error("fskit_read(%zu @ %jd) got the wrong data at %zu\n", len, (intmax_t)offset, i );
+         exit(1);
+      }
+   }
+}
+
+// read, and wait for the readahead worker to catch up, so the windows it prefetches are predictable
+static void do_read_sync( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, size_t len ) {
+
+   int rc = 0;
+
+   do_read( core, fh, offset, len );
+
+   rc = fskit_core_readahead_drain( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_readahead_drain rc = %d\n", rc );
+      exit(1);
+   }
+}
+
+// make a core with a FILE_SIZE-byte file, and open it
+static struct fskit_core* setup( bool with_prefetch, bool with_pcache, struct fskit_file_handle** fh ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_readahead_enable( core, MIN_WINDOW, MAX_WINDOW );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_readahead_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( with_pcache ) {
+
+      rc = fskit_core_pcache_enable( core, READ_SIZE, 0, FSKIT_PCACHE_CLOCK );
+      if( rc != 0 ) {
+         fskit_error("fskit_core_pcache_enable rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   fskit_route_read( core, "/f", read_cb, FSKIT_CONCURRENT );
+   fskit_route_trunc( core, "/f", trunc_cb, FSKIT_CONCURRENT );
+
+   if( with_prefetch ) {
+      fskit_route_prefetch( core, "/f", prefetch_cb, FSKIT_CONCURRENT );
+   }
+
+   *fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( *fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, *fh );
+
+   *fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( *fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_ftrunc( core, *fh, FILE_SIZE );
+   if( rc != 0 ) {
+      fskit_error("fskit_ftrunc rc = %d\n", rc );
+      exit(1);
+   }
+
+   num_prefetches = 0;
+   num_reads = 0;
+   max_read_len = 0;
+
+   return core;
+}
+
+static void test_prefetch_route(void) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_readahead_stats stats;
+   void* output;
+   int rc = 0;
+   int n = 0;
+
+   core = setup( true, false, &fh );
+
+   // a sequential run prefetches contiguous, growing windows, and stays ahead of the reader
+   for( off_t off = 0; off < 512 * 1024; off += READ_SIZE ) {
+      do_read_sync( core, fh, off, READ_SIZE );
+   }
+
+   if( num_prefetches < 2 || prefetch_off[0] != 0 || prefetch_len[0] != MIN_WINDOW ) {
+      fskit_error("%d prefetches, first was %zu @ %jd\n", num_prefetches, prefetch_len[0], (intmax_t)prefetch_off[0] );
+      exit(1);
+   }
+
+   for( int i = 1; i < num_prefetches; i++ ) {
+
+      if( prefetch_off[i] != prefetch_off[i-1] + (off_t)prefetch_len[i-1] ) {
+         fskit_error("prefetch %d is %zu @ %jd, not contiguous with the last\n", i, prefetch_len[i], (intmax_t)prefetch_off[i] );
+         exit(1);
+      }
+
+      if( prefetch_len[i] < prefetch_len[i-1] || prefetch_len[i] > MAX_WINDOW ) {
+         fskit_error("prefetch %d is %zu bytes, after %zu\n", i, prefetch_len[i], prefetch_len[i-1] );
+         exit(1);
+      }
+   }
+
+   if( prefetch_len[ num_prefetches - 1 ] != MAX_WINDOW ) {
+      fskit_error("window never grew to %d\n", MAX_WINDOW );
+      exit(1);
+   }
+
+   rc = fskit_readahead_stats( core, fh, &stats );
+   if( rc != 0 || stats.misses != 1 || stats.hits != 512 / 4 - 1 || stats.window != MAX_WINDOW || stats.windows != (unsigned)num_prefetches ) {
+      fskit_error("fskit_readahead_stats rc = %d, hits = %" PRIu64 ", misses = %" PRIu64 ", windows = %" PRIu64 ", window = %zu\n", rc, stats.hits, stats.misses, stats.windows, stats.window );
+      exit(1);
+   }
+
+   // random reads stop readahead
+   n = num_prefetches;
+
+   do_read_sync( core, fh, 900 * 1024, READ_SIZE );
+   do_read_sync( core, fh, 100 * 1024 + 17, READ_SIZE );
+
+   fskit_readahead_stats( core, fh, &stats );
+   if( stats.window != 0 || num_prefetches != n ) {
+      fskit_error("after random reads: window = %zu, %d new prefetches\n", stats.window, num_prefetches - n );
+      exit(1);
+   }
+
+   // windows don't go past the end of the file
+   n = num_prefetches;
+
+   do_read_sync( core, fh, FILE_SIZE - 2 * READ_SIZE, READ_SIZE );
+   do_read_sync( core, fh, FILE_SIZE - READ_SIZE, READ_SIZE );
+   do_read_sync( core, fh, FILE_SIZE, READ_SIZE );
+
+   if( num_prefetches != n + 1 || prefetch_off[n] != FILE_SIZE - READ_SIZE || prefetch_len[n] != READ_SIZE ) {
+      fskit_error("%d prefetches near the end; last was %zu @ %jd\n", num_prefetches - n, prefetch_len[ num_prefetches - 1 ], (intmax_t)prefetch_off[ num_prefetches - 1 ] );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   fskit_test_end( core, &output );
+}
+
+static void test_pcache(void) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_readahead_stats stats;
+   struct fskit_pcache_stats pstats;
+   void* output;
+
+   core = setup( false, true, &fh );
+
+   // without a prefetch route, windows are read into the page cache in one route call each
+   for( off_t off = 0; off < 512 * 1024; off += READ_SIZE ) {
+      do_read_sync( core, fh, off, READ_SIZE );
+   }
+
+   fskit_readahead_stats( core, fh, &stats );
+   fskit_core_pcache_stats( core, &pstats );
+
+   if( (unsigned)num_reads != stats.windows || max_read_len != MAX_WINDOW || pstats.misses != 0 ) {
+      fskit_error("%d read route calls (longest %zu) for %" PRIu64 " windows; %" PRIu64 " cache misses\n", num_reads, max_read_len, stats.windows, pstats.misses );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+   fskit_test_end( core, &output );
+}
+
+struct close_args {
+   struct fskit_core* core;
+   struct fskit_file_handle* fh;
+   bool closed;
+};
+
+static void* close_thread( void* arg ) {
+
+   struct close_args* args = (struct close_args*)arg;
+
+   fskit_close( args->core, args->fh );
+
+   pthread_mutex_lock( &prefetch_lock );
+   args->closed = true;
+   pthread_mutex_unlock( &prefetch_lock );
+
+   return NULL;
+}
+
+static void test_async(void) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct close_args args;
+   pthread_t thread;
+   void* output;
+   int n = 0;
+   bool closed = false;
+
+   core = setup( true, false, &fh );
+
+   // readers don't wait for windows past the first one
+   pthread_mutex_lock( &prefetch_lock );
+   prefetch_blocked = true;
+   pthread_mutex_unlock( &prefetch_lock );
+
+   for( off_t off = 0; off < 64 * 1024; off += READ_SIZE ) {
+      do_read( core, fh, off, READ_SIZE );
+   }
+
+   pthread_mutex_lock( &prefetch_lock );
+   n = num_prefetches;
+   pthread_mutex_unlock( &prefetch_lock );
+
+   if( n != 1 || prefetch_off[0] != 0 ) {
+      fskit_error("%d prefetches done while the worker was blocked\n", n );
+      exit(1);
+   }
+
+   // closing waits for the window being prefetched, and drops the rest
+   args.core = core;
+   args.fh = fh;
+   args.closed = false;
+
+   pthread_create( &thread, NULL, close_thread, &args );
+
+   usleep( 100000 );
+
+   pthread_mutex_lock( &prefetch_lock );
+   closed = args.closed;
+   prefetch_blocked = false;
+   pthread_cond_broadcast( &prefetch_cond );
+   pthread_mutex_unlock( &prefetch_lock );
+
+   if( closed ) {
+      fskit_error("%s\n", "fskit_close did not wait for the readahead worker" );
+      exit(1);
+   }
+
+   pthread_join( thread, NULL );
+
+   fskit_core_readahead_drain( core );
+
+   if( num_prefetches != 2 || prefetch_off[1] != MIN_WINDOW ) {
+      fskit_error("%d prefetches after close; last was %zu @ %jd\n", num_prefetches, prefetch_len[ num_prefetches - 1 ], (intmax_t)prefetch_off[ num_prefetches - 1 ] );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_readahead_stats stats;
+   void* output;
+   int rc;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_readahead_enable( core, MAX_WINDOW, MIN_WINDOW );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_core_readahead_enable(min > max) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_readahead_stats( core, fh, &stats );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_readahead_stats(disabled) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_readahead_drain( core );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_core_readahead_drain(disabled) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   rc = fskit_core_readahead_enable( core, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_readahead_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_readahead_enable( core, 0, 0 );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_readahead_enable(again) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   test_prefetch_route();
+   test_pcache();
+   test_async();
+
+   return 0;
+}
@@ -83,6 +83,154 @@ int fskit_test_readdir( struct fskit_core* core, char const* path ) {
 }
 
 
+#define NUM_PAGED_FILES 500
+#define PAGE_SIZE 7
+
+// read the next batch from a directory handle, and verify that it continues in sorted order after *last.
+// return the number read (0 at the end of the directory)
+static uint64_t read_page( struct fskit_core* core, struct fskit_dir_handle* dh, char* last ) {
+
+   int rc = 0;
+   uint64_t num_read = 0;
+   struct fskit_dir_entry** dents = fskit_readdir( core, dh, PAGE_SIZE, &num_read, &rc );
+
+   if( rc != 0 ) {
+      fskit_error("fskit_readdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( uint64_t i = 0; i < num_read; i++ ) {
+
+      if( strcmp( last, dents[i]->name ) >= 0 ) {
+         fskit_error("out of order: '%s' before '%s'\n", last, dents[i]->name );
+         exit(1);
+      }
+
+      strcpy( last, dents[i]->name );
+   }
+
+   if( dents != NULL ) {
+      fskit_dir_entry_free_list( dents );
+   }
+
+   return num_read;
+}
+
+// page through a large directory, removing entries behind and ahead of the read position,
+// and check that telldir/seekdir/rewinddir put us back where we were.
+static void fskit_test_readdir_resume( struct fskit_core* core ) {
+
+   int rc = 0;
+   char path[PATH_MAX];
+   char last[FSKIT_FILESYSTEM_NAMEMAX+1];
+   char saved[FSKIT_FILESYSTEM_NAMEMAX+1];
+   uint64_t total = 0;
+   uint64_t num_read = 0;
+   uint64_t expected = NUM_PAGED_FILES + 2;
+   off_t cookie = 0;
+
+   rc = fskit_mkdir( core, "/paged", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/paged') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_PAGED_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/paged/file-%04d", i );
+
+      struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, "/paged", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/paged') rc = %d\n", rc );
+      exit(1);
+   }
+
+   memset( last, 0, sizeof(last) );
+
+   while( true ) {
+
+      num_read = read_page( core, dh, last );
+      if( num_read == 0 ) {
+         break;
+      }
+
+      total += num_read;
+
+      if( total == 3 * PAGE_SIZE ) {
+
+         // remove the last name we read; we should resume right after it
+         snprintf( path, PATH_MAX, "/paged/%s", last );
+         rc = fskit_unlink( core, path, 0, 0 );
+         if( rc != 0 ) {
+            fskit_error("fskit_unlink('%s') rc = %d\n", path, rc );
+            exit(1);
+         }
+
+         // remove one we haven't read yet; we should never see it
+         rc = fskit_unlink( core, "/paged/file-0400", 0, 0 );
+         if( rc != 0 ) {
+            fskit_error("fskit_unlink('/paged/file-0400') rc = %d\n", rc );
+            exit(1);
+         }
+
+         expected--;
+
+         cookie = fskit_telldir( dh );
+         strcpy( saved, last );
+      }
+   }
+
+   if( total != expected ) {
+      fskit_error("read %" PRIu64 " entries, expected %" PRIu64 "\n", total, expected );
+      exit(1);
+   }
+
+   // go back to the saved position, and re-read the rest
+   if( fskit_telldir( dh ) == cookie || cookie <= 0 ) {
+      fskit_error("bad telldir cookie %jd\n", (intmax_t)cookie );
+      exit(1);
+   }
+
+   fskit_seekdir( dh, cookie );
+   strcpy( last, saved );
+
+   total = 3 * PAGE_SIZE;
+   while( (num_read = read_page( core, dh, last )) > 0 ) {
+      total += num_read;
+   }
+
+   if( total != expected ) {
+      fskit_error("after seekdir: read %" PRIu64 " entries, expected %" PRIu64 "\n", total, expected );
+      exit(1);
+   }
+
+   // start over
+   fskit_rewinddir( dh );
+   memset( last, 0, sizeof(last) );
+
+   total = 0;
+   while( (num_read = read_page( core, dh, last )) > 0 ) {
+      total += num_read;
+   }
+
+   if( total != expected - 1 ) {
+      fskit_error("after rewinddir: read %" PRIu64 " entries, expected %" PRIu64 "\n", total, expected - 1 );
+      exit(1);
+   }
+
+   fskit_closedir( core, dh );
+}
+
+
 int main( int argc, char** argv ) {
 
    struct fskit_core* core = NULL;
@@ -121,6 +269,8 @@ int main( int argc, char** argv ) {
 
    fskit_print_tree( stdout, fskit_core_get_root( core ) );
 
+   fskit_test_readdir_resume( core );
+
    fskit_test_end( core, &output );
 
    return 0;
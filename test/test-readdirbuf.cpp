@@ -0,0 +1,261 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-readdirbuf.h"
+
+#define NUM_FILES 200
+#define BUF_LEN 256
+
+// calls to each route
+static int num_readdir_calls = 0;
+static int num_readdir_buf_calls = 0;
+
+// omit files with odd numbers
+static int readdir_buf_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, char* buf, size_t buflen ) {
+
+   num_readdir_buf_calls++;
+
+   for( struct fskit_dir_record* rec = fskit_dir_record_next( buf, buflen, NULL ); rec != NULL; rec = fskit_dir_record_next( buf, buflen, rec ) ) {
+
+      if( rec->namelen > 0 && (rec->name[ rec->namelen - 1 ] - '0') % 2 == 1 ) {
+         fskit_dir_record_omit( rec );
+      }
+   }
+
+   return 0;
+}
+
+// omit files whose numbers end in 0
+static int readdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, struct fskit_dir_entry** dents, size_t num_dents ) {
+
+   num_readdir_calls++;
+
+   for( size_t i = 0; i < num_dents; i++ ) {
+
+      size_t len = strlen( dents[i]->name );
+      if( len > 0 && dents[i]->name[ len - 1 ] == '0' ) {
+         fskit_readdir_omit( dents, i );
+      }
+   }
+
+   return 0;
+}
+
+// read the rest of a directory through a BUF_LEN-byte buffer.
+// check that the records are well-formed and in order, and that none of them should have been omitted.
+// return the number of records read
+static int read_all( struct fskit_core* core, struct fskit_dir_handle* dh, char* last, char omit_mod2, char omit_digit ) {
+
+   char buf[BUF_LEN];
+   int count = 0;
+   ssize_t len = 0;
+
+   while( (len = fskit_readdir_buf( core, dh, buf, BUF_LEN )) > 0 ) {
+
+      for( struct fskit_dir_record* rec = fskit_dir_record_next( buf, len, NULL ); rec != NULL; rec = fskit_dir_record_next( buf, len, rec ) ) {
+
+         char tail = rec->name[ rec->namelen - 1 ];
+
+         if( rec->reclen != FSKIT_DIR_RECORD_LEN( rec->namelen ) || strlen( rec->name ) != rec->namelen ) {
+            fskit_error("malformed record '%s'\n", rec->name );
+            exit(1);
+         }
+
+         if( strcmp( last, rec->name ) >= 0 ) {
+            fskit_error("out of order: '%s' before '%s'\n", last, rec->name );
+            exit(1);
+         }
+
+         if( rec->name[0] == 'f' && ((omit_mod2 && (tail - '0') % 2 == 1) || tail == omit_digit) ) {
+            fskit_error("'%s' should have been omitted\n", rec->name );
+            exit(1);
+         }
+
+         strcpy( last, rec->name );
+         count++;
+      }
+   }
+
+   if( len < 0 ) {
+      fskit_error("fskit_readdir_buf rc = %zd\n", len );
+      exit(1);
+   }
+
+   return count;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+   void* output = NULL;
+   char path[PATH_MAX];
+   char buf[BUF_LEN];
+   char last[FSKIT_FILESYSTEM_NAMEMAX+1];
+   char resume_after[FSKIT_FILESYSTEM_NAMEMAX+1];
+   uint64_t num_listed = 0;
+   ssize_t len = 0;
+   int count = 0;
+   off_t cookie = 0;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_entry** dents = NULL;
+   struct fskit_dir_record* rec = NULL;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/d", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/d/f-%03d", i );
+
+      struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+   }
+
+   // how many entries does the plain listing have?
+   dh = fskit_opendir( core, "/d", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   dents = fskit_listdir( core, dh, &num_listed, &rc );
+   if( dents == NULL ) {
+      fskit_error("fskit_listdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_dir_entry_free_list( dents );
+
+   // the packed listing should match it
+   fskit_rewinddir( dh );
+   memset( last, 0, sizeof(last) );
+
+   count = read_all( core, dh, last, 0, 0 );
+   if( count != (int)num_listed ) {
+      fskit_error("read %d records, expected %" PRIu64 "\n", count, num_listed );
+      exit(1);
+   }
+
+   // too small for any record
+   fskit_rewinddir( dh );
+
+   len = fskit_readdir_buf( core, dh, buf, 8 );
+   if( len != -EINVAL ) {
+      fskit_error("fskit_readdir_buf rc = %zd, expected %d\n", len, -EINVAL );
+      exit(1);
+   }
+
+   // resume from a record in the middle of a batch
+   len = fskit_readdir_buf( core, dh, buf, BUF_LEN );
+   if( len <= 0 ) {
+      fskit_error("fskit_readdir_buf rc = %zd\n", len );
+      exit(1);
+   }
+
+   rec = fskit_dir_record_next( buf, len, NULL );
+   rec = fskit_dir_record_next( buf, len, rec );
+   if( rec == NULL || fskit_dir_record_next( buf, len, rec ) == NULL ) {
+      fskit_error("%s", "expected more than two records in a batch\n");
+      exit(1);
+   }
+
+   cookie = rec->next;
+   strcpy( resume_after, rec->name );
+
+   // read ahead, then go back
+   strcpy( last, fskit_dir_record_next( buf, len, rec )->name );
+   read_all( core, dh, last, 0, 0 );
+
+   fskit_seekdir( dh, cookie );
+   strcpy( last, resume_after );
+
+   count = read_all( core, dh, last, 0, 0 );
+
+   // . and .. come first, followed by f-000
+   if( count != (int)num_listed - 2 ) {
+      fskit_error("read %d records after seekdir, expected %d\n", count, (int)num_listed - 2 );
+      exit(1);
+   }
+
+   // packed route
+   int readdir_buf_route = fskit_route_readdir_buf( core, "/d", readdir_buf_cb, FSKIT_CONCURRENT );
+   if( readdir_buf_route < 0 ) {
+      fskit_error("fskit_route_readdir_buf rc = %d\n", readdir_buf_route );
+      exit(1);
+   }
+
+   int readdir_route = fskit_route_readdir( core, "/d", readdir_cb, FSKIT_CONCURRENT );
+   if( readdir_route < 0 ) {
+      fskit_error("fskit_route_readdir rc = %d\n", readdir_route );
+      exit(1);
+   }
+
+   fskit_rewinddir( dh );
+   memset( last, 0, sizeof(last) );
+
+   count = read_all( core, dh, last, 1, 0 );
+   if( count != (int)num_listed - NUM_FILES / 2 || num_readdir_buf_calls == 0 || num_readdir_calls != 0 ) {
+      fskit_error("read %d records (readdir_buf %d calls, readdir %d calls)\n", count, num_readdir_buf_calls, num_readdir_calls );
+      exit(1);
+   }
+
+   // without it, the plain route runs over the packed records
+   rc = fskit_unroute_readdir_buf( core, readdir_buf_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_readdir_buf rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_rewinddir( dh );
+   memset( last, 0, sizeof(last) );
+
+   count = read_all( core, dh, last, 0, '0' );
+   if( count != (int)num_listed - NUM_FILES / 10 || num_readdir_calls == 0 ) {
+      fskit_error("read %d records (readdir %d calls)\n", count, num_readdir_calls );
+      exit(1);
+   }
+
+   rc = fskit_unroute_readdir( core, readdir_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_readdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_closedir( core, dh );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,263 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-readdirplus.h"
+
+#define NUM_FILES 50
+
+// calls to the stat route
+static int num_stat_calls = 0;
+
+// report a block size, so we can tell the route ran
+static int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   num_stat_calls++;
+   sb->st_blksize = 4096;
+   return 0;
+}
+
+// unlink /d/victim while readdirplus holds it, so readdirplus drops its last reference
+static int victim_stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   int rc = fskit_unlink( core, "/d/victim", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/d/victim') rc = %d\n", rc );
+      exit(1);
+   }
+
+   return 0;
+}
+
+// path the destroy route last ran on
+static char destroyed_path[PATH_MAX];
+
+static int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+
+   strncpy( destroyed_path, fskit_route_metadata_get_path( route_metadata ), PATH_MAX - 1 );
+   return 0;
+}
+
+// omit f-007
+static int readdir_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* dent, struct fskit_dir_entry** dents, size_t num_dents ) {
+
+   for( size_t i = 0; i < num_dents; i++ ) {
+
+      if( strcmp( dents[i]->name, "f-007" ) == 0 ) {
+         fskit_readdir_omit( dents, i );
+      }
+   }
+
+   return 0;
+}
+
+// list /d with attributes, and check them against fskit_stat.
+// return the number of entries listed
+static uint64_t check_listing( struct fskit_core* core ) {
+
+   int rc = 0;
+   uint64_t num_read = 0;
+   uint64_t num_listed = 0;
+   struct stat* sbs = NULL;
+   struct stat sb;
+   char path[PATH_MAX];
+
+   struct fskit_dir_handle* dh = fskit_opendir( core, "/d", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   struct fskit_dir_entry** dents = fskit_listdirplus( core, dh, &num_read, &sbs, &rc );
+   if( dents == NULL || sbs == NULL ) {
+      fskit_error("fskit_listdirplus rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( uint64_t i = 0; i < num_read; i++ ) {
+
+      if( strcmp( dents[i]->name, "." ) == 0 ) {
+         strcpy( path, "/d" );
+      }
+      else if( strcmp( dents[i]->name, ".." ) == 0 ) {
+         strcpy( path, "/" );
+      }
+      else {
+         snprintf( path, PATH_MAX, "/d/%s", dents[i]->name );
+      }
+
+      rc = fskit_stat( core, path, 0, 0, &sb );
+      if( rc != 0 ) {
+         fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      if( sbs[i].st_ino != dents[i]->file_id || sbs[i].st_ino != sb.st_ino || sbs[i].st_mode != sb.st_mode || sbs[i].st_size != sb.st_size || sbs[i].st_nlink != sb.st_nlink || sbs[i].st_blksize != sb.st_blksize ) {
+         fskit_error("'%s': readdirplus gave ino %" PRIu64 " mode %o size %jd blksize %d; stat gave ino %" PRIu64 " mode %o size %jd blksize %d\n",
+                     path, (uint64_t)sbs[i].st_ino, sbs[i].st_mode, (intmax_t)sbs[i].st_size, (int)sbs[i].st_blksize, (uint64_t)sb.st_ino, sb.st_mode, (intmax_t)sb.st_size, (int)sb.st_blksize );
+         exit(1);
+      }
+   }
+
+   num_listed = num_read;
+
+   fskit_dir_entry_free_list( dents );
+   free( sbs );
+
+   // nothing left
+   dents = fskit_readdirplus( core, dh, 10, &num_read, &sbs, &rc );
+   if( dents != NULL || sbs != NULL || rc != 0 ) {
+      fskit_error("fskit_readdirplus at EOD: dents = %p, sbs = %p, rc = %d\n", dents, sbs, rc );
+      exit(1);
+   }
+
+   fskit_closedir( core, dh );
+
+   return num_listed;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc = 0;
+   void* output = NULL;
+   char path[PATH_MAX];
+   uint64_t num_listed = 0;
+   uint64_t num_read = 0;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_dir_handle* dh = NULL;
+   struct fskit_dir_entry** dents = NULL;
+   struct stat* sbs = NULL;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/d", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/d/sub", 0700, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/d/sub') rc = %d\n", rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_FILES; i++ ) {
+
+      snprintf( path, PATH_MAX, "/d/f-%03d", i );
+
+      fh = fskit_create( core, path, 0, 0, 0600 + (i % 8) * 010, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+
+      rc = fskit_trunc( core, path, 0, 0, i * 100 );
+      if( rc != 0 ) {
+         fskit_error("fskit_trunc('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   // no routes
+   num_listed = check_listing( core );
+   if( num_listed != NUM_FILES + 3 ) {
+      fskit_error("listed %" PRIu64 " entries, expected %d\n", num_listed, NUM_FILES + 3 );
+      exit(1);
+   }
+
+   // the stat route runs on each entry, and the readdir route's omissions keep the rest lined up
+   rc = fskit_route_stat( core, "/d/f-.*", stat_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_readdir( core, "/d", readdir_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_readdir rc = %d\n", rc );
+      exit(1);
+   }
+
+   num_stat_calls = 0;
+   num_listed = check_listing( core );
+   if( num_listed != NUM_FILES + 2 ) {
+      fskit_error("listed %" PRIu64 " entries, expected %d\n", num_listed, NUM_FILES + 2 );
+      exit(1);
+   }
+
+   // once by readdirplus and once by fskit_stat for each file but f-007
+   if( num_stat_calls != 2 * (NUM_FILES - 1) ) {
+      fskit_error("stat route ran %d times, expected %d\n", num_stat_calls, 2 * (NUM_FILES - 1) );
+      exit(1);
+   }
+
+   // an entry unlinked while it's listed is destroyed by its own path
+   fh = fskit_create( core, "/d/victim", 0, 0, 0600, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/d/victim') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   rc = fskit_route_stat( core, "/d/victim", victim_stat_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_destroy( core, "/d/.*", destroy_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_destroy rc = %d\n", rc );
+      exit(1);
+   }
+
+   dh = fskit_opendir( core, "/d", 0, 0, &rc );
+   if( dh == NULL ) {
+      fskit_error("fskit_opendir('/d') rc = %d\n", rc );
+      exit(1);
+   }
+
+   dents = fskit_listdirplus( core, dh, &num_read, &sbs, &rc );
+   if( dents == NULL || sbs == NULL ) {
+      fskit_error("fskit_listdirplus rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_dir_entry_free_list( dents );
+   free( sbs );
+   fskit_closedir( core, dh );
+
+   if( strcmp( destroyed_path, "/d/victim" ) != 0 ) {
+      fskit_error("destroy route ran on '%s', expected '/d/victim'\n", destroyed_path );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,227 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-readv.h"
+
+// backing store for /f
+static char data[4096];
+
+// calls to each route, and the vector length the last vectored call saw
+static int num_io_calls = 0;
+static int num_iov_calls = 0;
+static int last_iovcnt = 0;
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   num_io_calls++;
+   memcpy( buf, data + offset, buflen );
+   return buflen;
+}
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   num_io_calls++;
+   memcpy( data + offset, buf, buflen );
+   return buflen;
+}
+
+static int readv_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct iovec const* iov, int iovcnt, off_t offset, void* handle_data ) {
+
+   int total = 0;
+
+   num_iov_calls++;
+   last_iovcnt = iovcnt;
+
+   for( int i = 0; i < iovcnt; i++ ) {
+
+      memcpy( iov[i].iov_base, data + offset + total, iov[i].iov_len );
+      total += iov[i].iov_len;
+   }
+
+   return total;
+}
+
+static int writev_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct iovec const* iov, int iovcnt, off_t offset, void* handle_data ) {
+
+   int total = 0;
+
+   num_iov_calls++;
+   last_iovcnt = iovcnt;
+
+   for( int i = 0; i < iovcnt; i++ ) {
+
+      memcpy( data + offset + total, iov[i].iov_base, iov[i].iov_len );
+      total += iov[i].iov_len;
+   }
+
+   return total;
+}
+
+// write "hello", " ", "world" at offset through fh, and read it back into three differently-sized buffers.
+// check the data, the file size, and which routes ran.
+static void check_vectored_io( struct fskit_core* core, struct fskit_file_handle* fh, off_t offset, int expected_io_calls, int expected_iov_calls ) {
+
+   char hello[] = "hello";
+   char space[] = " ";
+   char world[] = "world";
+   struct iovec out[3] = { { hello, 5 }, { space, 1 }, { world, 5 } };
+
+   char a[3], b[4], c[4];
+   struct iovec in[3] = { { a, sizeof(a) }, { b, sizeof(b) }, { c, sizeof(c) } };
+
+   struct stat sb;
+   ssize_t rc = 0;
+
+   num_io_calls = 0;
+   num_iov_calls = 0;
+
+   rc = fskit_writev( core, fh, out, 3, offset );
+   if( rc != 11 ) {
+      fskit_error("fskit_writev rc = %zd\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_stat( core, "/f", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != offset + 11 ) {
+      fskit_error("fskit_stat('/f') rc = %zd, size = %jd, expected %jd\n", rc, (intmax_t)sb.st_size, (intmax_t)(offset + 11) );
+      exit(1);
+   }
+
+   memset( a, 0, sizeof(a) );
+   memset( b, 0, sizeof(b) );
+   memset( c, 0, sizeof(c) );
+
+   rc = fskit_readv( core, fh, in, 3, offset );
+   if( rc != 11 ) {
+      fskit_error("fskit_readv rc = %zd\n", rc );
+      exit(1);
+   }
+
+   if( memcmp( a, "hel", 3 ) != 0 || memcmp( b, "lo w", 4 ) != 0 || memcmp( c, "orld", 4 ) != 0 ) {
+      fskit_error("fskit_readv got '%.3s' '%.4s' '%.4s'\n", a, b, c );
+      exit(1);
+   }
+
+   // each vectored call is routed once
+   if( num_io_calls != expected_io_calls || num_iov_calls != expected_iov_calls ) {
+      fskit_error("io calls = %d, iov calls = %d, expected %d, %d\n", num_io_calls, num_iov_calls, expected_io_calls, expected_iov_calls );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   int rc;
+   int readv_route = 0;
+   int writev_route = 0;
+   char buf[4];
+   struct iovec iov[1] = { { buf, sizeof(buf) } };
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // no routes at all
+   rc = fskit_readv( core, fh, iov, 1, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_readv rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_readv( core, fh, iov, -1, 0 );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_readv rc = %d, expected %d\n", rc, -EINVAL );
+      exit(1);
+   }
+
+   rc = fskit_route_read( core, "/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/([^/]+)", write_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   // without vectored routes, each vector goes through the plain routes once
+   check_vectored_io( core, fh, 0, 2, 0 );
+
+   readv_route = fskit_route_readv( core, "/([^/]+)", readv_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( readv_route < 0 ) {
+      fskit_error("fskit_route_readv rc = %d\n", readv_route );
+      exit(1);
+   }
+
+   writev_route = fskit_route_writev( core, "/([^/]+)", writev_cb, FSKIT_RANGE_SEQUENTIAL );
+   if( writev_route < 0 ) {
+      fskit_error("fskit_route_writev rc = %d\n", writev_route );
+      exit(1);
+   }
+
+   // with them, the vectored routes see the whole vector
+   check_vectored_io( core, fh, 100, 0, 2 );
+
+   if( last_iovcnt != 3 ) {
+      fskit_error("vectored route saw %d buffers\n", last_iovcnt );
+      exit(1);
+   }
+
+   rc = fskit_unroute_readv( core, readv_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_readv rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_unroute_writev( core, writev_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_writev rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_vectored_io( core, fh, 200, 2, 0 );
+
+   fskit_close( core, fh );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,148 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-ref.h"
+
+#define NUM_THREADS 8
+#define NUM_STATS 20000
+
+static int num_destroyed = 0;
+
+static int destroy_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, void* inode_data ) {
+
+   __atomic_add_fetch( &num_destroyed, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+// stat a path over and over, while another thread creates and unlinks it
+static void* stat_thread_main( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct stat sb;
+
+   for( int i = 0; i < NUM_STATS; i++ ) {
+      fskit_stat( core, "/churn", 0, 0, &sb );
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_entry* fent = NULL;
+   struct fskit_file_handle* fh = NULL;
+   pthread_t threads[NUM_THREADS];
+   int rc;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   rc = fskit_route_destroy( core, "/.*", destroy_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_destroy rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   // a referenced entry outlives its last link, and goes away on the last unref
+   fent = fskit_entry_ref( core, "/f", &rc );
+   if( fent == NULL ) {
+      fskit_error("fskit_entry_ref('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_entry_ref_entry( fent );
+
+   rc = fskit_unlink( core, "/f", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_unlink('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   if( num_destroyed != 0 ) {
+      fskit_error("destroyed %d entries while still referenced\n", num_destroyed );
+      exit(1);
+   }
+
+   fskit_entry_unref( core, "/f", fent );
+
+   if( num_destroyed != 0 ) {
+      fskit_error("destroyed %d entries while still referenced\n", num_destroyed );
+      exit(1);
+   }
+
+   fskit_entry_unref( core, "/f", fent );
+
+   if( num_destroyed != 1 ) {
+      fskit_error("destroyed %d entries, expected 1\n", num_destroyed );
+      exit(1);
+   }
+
+   // stat storms racing with unlink
+   num_destroyed = 0;
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, stat_thread_main, core );
+   }
+
+   for( int i = 0; i < 1000; i++ ) {
+
+      fh = fskit_create( core, "/churn", 0, 0, 0644, &rc );
+      if( fh == NULL ) {
+         fskit_error("fskit_create('/churn') rc = %d\n", rc );
+         exit(1);
+      }
+
+      fskit_close( core, fh );
+
+      rc = fskit_unlink( core, "/churn", 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_unlink('/churn') rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   if( num_destroyed != 1000 ) {
+      fskit_error("destroyed %d entries, expected 1000\n", num_destroyed );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
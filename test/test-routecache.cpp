@@ -0,0 +1,223 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-routecache.h"
+
+// match groups seen by the last stat and read route calls
+static char last_groups[2][3][FSKIT_FILESYSTEM_NAMEMAX+1];
+static int num_calls[2];
+
+static void record_groups( int which, struct fskit_route_metadata* route_metadata ) {
+
+   int argc = fskit_route_metadata_num_match_groups( route_metadata );
+   char** argv = fskit_route_metadata_get_match_groups( route_metadata );
+
+   memset( last_groups[which], 0, sizeof(last_groups[which]) );
+
+   for( int i = 0; i < argc && i < 3 && argv[i] != NULL; i++ ) {
+      strncpy( last_groups[which][i], argv[i], FSKIT_FILESYSTEM_NAMEMAX );
+   }
+
+   num_calls[which]++;
+}
+
+static int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+   record_groups( 0, route_metadata );
+   return 0;
+}
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+   record_groups( 1, route_metadata );
+   memset( buf, 0, buflen );
+   return buflen;
+}
+
+// stat a path, and verify that the stat route saw the expected match groups
+static void expect_stat_groups( struct fskit_core* core, char const* path, char const* g0, char const* g1 ) {
+
+   struct stat sb;
+   int calls = num_calls[0];
+
+   int rc = fskit_stat( core, path, 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   if( num_calls[0] != calls + 1 ) {
+      fskit_error("stat route not called for '%s'\n", path );
+      exit(1);
+   }
+
+   if( strcmp( last_groups[0][0], g0 ) != 0 || strcmp( last_groups[0][1], g1 ) != 0 ) {
+      fskit_error("stat('%s') groups = '%s', '%s', expected '%s', '%s'\n", path, last_groups[0][0], last_groups[0][1], g0, g1 );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   int stat_route = 0;
+   struct fskit_file_handle* fh = NULL;
+   struct fskit_route_cache_stats stats;
+   struct stat sb;
+   char buf[16];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_route_cache_stats( core, &stats );
+   if( rc != -ENOSYS ) {
+      fskit_error("fskit_core_route_cache_stats rc = %d, expected %d\n", rc, -ENOSYS );
+      exit(1);
+   }
+
+   rc = fskit_core_route_cache_enable( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_route_cache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_route_cache_enable( core );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_route_cache_enable rc = %d, expected %d\n", rc, -EEXIST );
+      exit(1);
+   }
+
+   // a route that never matches comes first, so a miss has to skip it
+   rc = fskit_route_stat( core, "/nomatch/([^/]+)", stat_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   stat_route = fskit_route_stat( core, "/([^/]+)/([^/]+)", stat_cb, FSKIT_CONCURRENT );
+   if( stat_route < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", stat_route );
+      exit(1);
+   }
+
+   rc = fskit_route_read( core, "/([^/]+)/([^/]+)", read_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_mkdir( core, "/a", 0755, 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_mkdir('/a') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, "/a/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/a/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/a/f", 0, 0, O_RDONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/a/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // repeated calls reuse the match, and see the same groups
+   for( int i = 0; i < 10; i++ ) {
+      expect_stat_groups( core, "/a/f", "a", "f" );
+   }
+
+   for( int i = 0; i < 10; i++ ) {
+
+      rc = fskit_read( core, fh, buf, sizeof(buf), 0 );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_read rc = %d\n", rc );
+         exit(1);
+      }
+
+      if( strcmp( last_groups[1][0], "a" ) != 0 || strcmp( last_groups[1][1], "f" ) != 0 ) {
+         fskit_error("read groups = '%s', '%s'\n", last_groups[1][0], last_groups[1][1] );
+         exit(1);
+      }
+   }
+
+   fskit_core_route_cache_stats( core, &stats );
+   printf("after repeat: hits=%" PRIu64 " misses=%" PRIu64 "\n", stats.hits, stats.misses );
+
+   if( stats.hits < 18 ) {
+      fskit_error("%s", "too few route cache hits\n");
+      exit(1);
+   }
+
+   // the same inode under a new path must be matched again
+   rc = fskit_rename( core, "/a/f", "/a/g", 0, 0 );
+   if( rc != 0 ) {
+      fskit_error("fskit_rename('/a/f', '/a/g') rc = %d\n", rc );
+      exit(1);
+   }
+
+   expect_stat_groups( core, "/a/g", "a", "g" );
+
+   // so must every inode once the route table changes
+   rc = fskit_unroute_stat( core, stat_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_stat( core, "/(a)/(g)", stat_cb, FSKIT_CONCURRENT );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   // the new route lands in the old route's slot, at the same position in the row
+   expect_stat_groups( core, "/a/g", "a", "g" );
+
+   rc = fskit_unroute_all( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_all rc = %d\n", rc );
+      exit(1);
+   }
+
+   // no route left to call
+   int calls = num_calls[0];
+   rc = fskit_stat( core, "/a/g", 0, 0, &sb );
+   if( rc != 0 || num_calls[0] != calls ) {
+      fskit_error("fskit_stat('/a/g') rc = %d, calls = %d, expected %d\n", rc, num_calls[0], calls );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fskit_core_route_cache_stats( core, &stats );
+   printf("final: hits=%" PRIu64 " misses=%" PRIu64 "\n", stats.hits, stats.misses );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
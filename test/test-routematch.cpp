@@ -0,0 +1,267 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// differential test: route matching (prefix index, compiled patterns, regexec fallback) must pick
+// the same route and produce the same match groups as trying each route's regex in turn with regexec.
+
+#include "test-routematch.h"
+
+#define MAX_GROUPS 8
+
+struct match_result {
+
+   int route;           // index into patterns, or -1 if nothing matched
+   int argc;
+   char argv[ MAX_GROUPS ][ FSKIT_FILESYSTEM_NAMEMAX+1 ];
+   bool has_argv[ MAX_GROUPS ];
+};
+
+static char const* patterns[] = {
+   "/a/b",
+   "/a/([^/]+)",
+   "^/a/[^/]+/([^/]+)$",
+   "/(a)/(b)",
+   "/a/([^/]+)\\.txt",
+   "/x(y)?/([^/]+)",
+   "/ab*/([^/]+)",
+   "/q|/r",
+   "/b/(.*)",
+   "/b/([^/]+)/",
+   "/[^/]+/c",
+   "/",
+   "",
+   "/([^/]+)",
+   "/([^/]+)/([^/]+)",
+   FSKIT_ROUTE_ANY,
+   NULL
+};
+
+#define NUM_PATTERNS 16
+
+static char const* paths[] = {
+   "/", "//", "/a", "/a/", "/a/b", "/a/b/", "//a//b//", "/a/b/c", "/a/b/c/d", "/a/b.txt", "/a/.txt",
+   "/xy/z", "/x/z", "/xyy/z", "/a/z", "/abbb/q", "/q", "/r", "/b", "/b/", "/b/c", "/b/c/", "/b/c/d",
+   "/c/c", "/d/c", "/a\nb", "/a/b\nc", "/a\n/b", "\n/a", "a/b", "ab", "", "/a//b", "/a/b//",
+   NULL
+};
+
+static struct match_result last_match;
+
+// reference: a copy of what fskit_match_regex does, including how it counts match groups
+static int reference_match_one( regex_t* reg, char const* pattern, char const* path, struct match_result* res ) {
+
+   int num_expected = 1;
+   regmatch_t m[ MAX_GROUPS + 2 ];
+
+   for( int i = 0; pattern[i] != '\0'; i++ ) {
+      if( pattern[i] == '(' && (i == 0 || pattern[i-1] != '\\') ) {
+         num_expected++;
+      }
+   }
+
+   memset( m, 0, sizeof(m) );
+
+   if( regexec( reg, path, num_expected, m, 0 ) != 0 ) {
+      return -ENOENT;
+   }
+
+   if( m[0].rm_so < 0 || m[0].rm_eo < 0 || (signed)strlen(path) != m[0].rm_eo - m[0].rm_so ) {
+      return -ENOENT;
+   }
+
+   memset( res, 0, sizeof(struct match_result) );
+
+   int i = 1;
+   for( i = 1; i <= num_expected && m[i].rm_so >= 0 && m[i].rm_eo >= 0; i++ ) {
+
+      strncpy( res->argv[i-1], path + m[i].rm_so, m[i].rm_eo - m[i].rm_so );
+      res->has_argv[i-1] = true;
+   }
+
+   res->argc = i;
+   return 0;
+}
+
+// reference: try each active route in order
+static void reference_match( regex_t* regs, bool const* active, char const* path, struct match_result* res ) {
+
+   for( int i = 0; i < NUM_PATTERNS; i++ ) {
+
+      if( active[i] && reference_match_one( &regs[i], patterns[i], path, res ) == 0 ) {
+         res->route = i;
+         return;
+      }
+   }
+
+   memset( res, 0, sizeof(struct match_result) );
+   res->route = -1;
+}
+
+static int record_match( int route, struct fskit_route_metadata* route_metadata ) {
+
+   int argc = fskit_route_metadata_num_match_groups( route_metadata );
+   char** argv = fskit_route_metadata_get_match_groups( route_metadata );
+
+   memset( &last_match, 0, sizeof(struct match_result) );
+
+   last_match.route = route;
+   last_match.argc = argc;
+
+   for( int i = 0; i < argc && i < MAX_GROUPS && argv[i] != NULL; i++ ) {
+
+      strncpy( last_match.argv[i], argv[i], FSKIT_FILESYSTEM_NAMEMAX );
+      last_match.has_argv[i] = true;
+   }
+
+   return 0;
+}
+
+// one stat callback per pattern, so we can tell which route was called
+template <int N> static int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+   return record_match( N, route_metadata );
+}
+
+static fskit_entry_route_stat_callback_t stat_cbs[ NUM_PATTERNS ] = {
+   stat_cb<0>, stat_cb<1>, stat_cb<2>, stat_cb<3>, stat_cb<4>, stat_cb<5>, stat_cb<6>, stat_cb<7>,
+   stat_cb<8>, stat_cb<9>, stat_cb<10>, stat_cb<11>, stat_cb<12>, stat_cb<13>, stat_cb<14>, stat_cb<15>
+};
+
+// route a path through fskit's stat routes
+static void fskit_match( struct fskit_core* core, char const* path, struct match_result* res ) {
+
+   struct stat sb;
+
+   memset( &last_match, 0, sizeof(struct match_result) );
+   last_match.route = -1;
+
+   fskit_stat( core, path, 0, 0, &sb );
+
+   memcpy( res, &last_match, sizeof(struct match_result) );
+}
+
+// check every path against the reference
+static void check_paths( struct fskit_core* core, regex_t* regs, bool const* active, char const* what ) {
+
+   struct match_result expected;
+   struct match_result actual;
+
+   for( int i = 0; paths[i] != NULL; i++ ) {
+
+      reference_match( regs, active, paths[i], &expected );
+      fskit_match( core, paths[i], &actual );
+
+      if( memcmp( &expected, &actual, sizeof(struct match_result) ) != 0 ) {
+
+         fskit_error("%s: path '%s': expected route %d argc %d, got route %d argc %d\n", what, paths[i], expected.route, expected.argc, actual.route, actual.argc );
+
+         for( int j = 0; j < MAX_GROUPS; j++ ) {
+            if( expected.has_argv[j] || actual.has_argv[j] ) {
+               fskit_error("   group %d: expected '%s', got '%s'\n", j, expected.argv[j], actual.argv[j] );
+            }
+         }
+
+         exit(1);
+      }
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   regex_t regs[ NUM_PATTERNS ];
+   int handles[ NUM_PATTERNS ];
+   bool active[ NUM_PATTERNS ];
+   char what[100];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   for( int i = 0; i < NUM_PATTERNS; i++ ) {
+
+      rc = regcomp( &regs[i], patterns[i], REG_EXTENDED | REG_NEWLINE );
+      if( rc != 0 ) {
+         fskit_error("regcomp('%s') rc = %d\n", patterns[i], rc );
+         exit(1);
+      }
+
+      active[i] = false;
+   }
+
+   // each route on its own
+   for( int i = 0; i < NUM_PATTERNS; i++ ) {
+
+      rc = fskit_route_stat( core, patterns[i], stat_cbs[i], FSKIT_CONCURRENT );
+      if( rc < 0 ) {
+         fskit_error("fskit_route_stat('%s') rc = %d\n", patterns[i], rc );
+         exit(1);
+      }
+
+      active[i] = true;
+
+      snprintf( what, sizeof(what), "only '%s'", patterns[i] );
+      check_paths( core, regs, active, what );
+
+      active[i] = false;
+      fskit_unroute_all( core );
+   }
+
+   // all routes at once: the first declared match wins
+   for( int i = 0; i < NUM_PATTERNS; i++ ) {
+
+      handles[i] = fskit_route_stat( core, patterns[i], stat_cbs[i], FSKIT_CONCURRENT );
+      if( handles[i] < 0 ) {
+         fskit_error("fskit_route_stat('%s') rc = %d\n", patterns[i], handles[i] );
+         exit(1);
+      }
+
+      active[i] = true;
+   }
+
+   check_paths( core, regs, active, "all routes" );
+
+   // remove some, leaving holes in the route table
+   for( int i = 0; i < NUM_PATTERNS; i += 3 ) {
+
+      rc = fskit_unroute_stat( core, handles[i] );
+      if( rc != 0 ) {
+         fskit_error("fskit_unroute_stat(%d) rc = %d\n", handles[i], rc );
+         exit(1);
+      }
+
+      active[i] = false;
+   }
+
+   check_paths( core, regs, active, "after removal" );
+
+   for( int i = 0; i < NUM_PATTERNS; i++ ) {
+      regfree( &regs[i] );
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
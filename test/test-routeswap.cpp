@@ -0,0 +1,204 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-routeswap.h"
+
+// set by the slow route once it is running, and by main to let it return
+static volatile int slow_running = 0;
+static volatile int slow_release = 0;
+
+// match group the slow route saw, read after the route table changed under it
+static char slow_group[FSKIT_FILESYSTEM_NAMEMAX+1];
+
+static int num_calls = 0;
+static volatile int churn_done = 0;
+
+static int slow_stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   __atomic_store_n( &slow_running, 1, __ATOMIC_SEQ_CST );
+
+   while( !__atomic_load_n( &slow_release, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   char** argv = fskit_route_metadata_get_match_groups( route_metadata );
+   strncpy( slow_group, argv[0], FSKIT_FILESYSTEM_NAMEMAX );
+
+   __atomic_add_fetch( &num_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+static int stat_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, struct stat* sb ) {
+
+   __atomic_add_fetch( &num_calls, 1, __ATOMIC_SEQ_CST );
+   return 0;
+}
+
+static void* slow_stat_thread( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct stat sb;
+
+   int rc = fskit_stat( core, "/slow/x", 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('/slow/x') rc = %d\n", rc );
+      exit(1);
+   }
+
+   return NULL;
+}
+
+// stat paths while the route table changes underneath
+static void* churn_stat_thread( void* arg ) {
+
+   struct fskit_core* core = (struct fskit_core*)arg;
+   struct stat sb;
+
+   while( !__atomic_load_n( &churn_done, __ATOMIC_SEQ_CST ) ) {
+
+      fskit_stat( core, "/churn/x", 0, 0, &sb );
+      fskit_stat( core, "/other", 0, 0, &sb );
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   int slow_route = 0;
+   int route = 0;
+   int calls = 0;
+   pthread_t slow_thread;
+   pthread_t churn_threads[2];
+   struct stat sb;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_route_cache_enable( core );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_route_cache_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   slow_route = fskit_route_stat( core, "/slow/([^/]+)", slow_stat_cb, FSKIT_CONCURRENT );
+   if( slow_route < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", slow_route );
+      exit(1);
+   }
+
+   pthread_create( &slow_thread, NULL, slow_stat_thread, core );
+
+   while( !__atomic_load_n( &slow_running, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   // the route table can change while the slow route is running...
+   route = fskit_route_stat( core, "/fast/([^/]+)", stat_cb, FSKIT_CONCURRENT );
+   if( route < 0 ) {
+      fskit_error("fskit_route_stat rc = %d\n", route );
+      exit(1);
+   }
+
+   rc = fskit_stat( core, "/fast/y", 0, 0, &sb );
+   if( rc != 0 || __atomic_load_n( &num_calls, __ATOMIC_SEQ_CST ) != 1 ) {
+      fskit_error("fskit_stat('/fast/y') rc = %d, calls = %d\n", rc, num_calls );
+      exit(1);
+   }
+
+   // ...including removing the route that is running
+   rc = fskit_unroute_stat( core, slow_route );
+   if( rc != 0 ) {
+      fskit_error("fskit_unroute_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_unroute_stat( core, slow_route );
+   if( rc != -EINVAL ) {
+      fskit_error("fskit_unroute_stat rc = %d, expected %d\n", rc, -EINVAL );
+      exit(1);
+   }
+
+   // the in-flight call still has its route and match groups
+   __atomic_store_n( &slow_release, 1, __ATOMIC_SEQ_CST );
+   pthread_join( slow_thread, NULL );
+
+   if( strcmp( slow_group, "x" ) != 0 || __atomic_load_n( &num_calls, __ATOMIC_SEQ_CST ) != 2 ) {
+      fskit_error("slow route saw '%s', calls = %d\n", slow_group, num_calls );
+      exit(1);
+   }
+
+   // later calls don't see the removed route
+   calls = __atomic_load_n( &num_calls, __ATOMIC_SEQ_CST );
+   __atomic_store_n( &slow_running, 0, __ATOMIC_SEQ_CST );
+
+   rc = fskit_stat( core, "/slow/x", 0, 0, &sb );
+   if( rc != 0 || slow_running || num_calls != calls ) {
+      fskit_error("fskit_stat('/slow/x') rc = %d, calls = %d, expected %d\n", rc, num_calls, calls );
+      exit(1);
+   }
+
+   // declare and remove routes while other threads call them
+   for( int i = 0; i < 2; i++ ) {
+      pthread_create( &churn_threads[i], NULL, churn_stat_thread, core );
+   }
+
+   for( int i = 0; i < 500; i++ ) {
+
+      route = fskit_route_stat( core, "/churn/([^/]+)", stat_cb, FSKIT_CONCURRENT );
+      if( route < 0 ) {
+         fskit_error("fskit_route_stat rc = %d\n", route );
+         exit(1);
+      }
+
+      rc = fskit_unroute_stat( core, route );
+      if( rc != 0 ) {
+         fskit_error("fskit_unroute_stat rc = %d\n", rc );
+         exit(1);
+      }
+
+      if( i % 100 == 99 ) {
+
+         rc = fskit_unroute_all( core );
+         if( rc != 0 ) {
+            fskit_error("fskit_unroute_all rc = %d\n", rc );
+            exit(1);
+         }
+      }
+   }
+
+   __atomic_store_n( &churn_done, 1, __ATOMIC_SEQ_CST );
+
+   for( int i = 0; i < 2; i++ ) {
+      pthread_join( churn_threads[i], NULL );
+   }
+
+   printf("calls = %d\n", num_calls );
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,197 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+// create, open, close and unlink files from many threads at once, so inodes,
+// directory entries and handles get recycled through (and between) per-thread caches
+
+#include "test-slab.h"
+
+#define NUM_THREADS 8
+#define NUM_ROUNDS 20
+#define FILES_PER_ROUND 200
+
+struct slab_thread_args {
+
+   struct fskit_core* core;
+   int id;
+   int rc;
+};
+
+static void* slab_thread_main( void* arg ) {
+
+   struct slab_thread_args* args = (struct slab_thread_args*)arg;
+   struct fskit_core* core = args->core;
+   struct fskit_file_handle* fh = NULL;
+   char path[PATH_MAX];
+   int rc = 0;
+
+   for( int round = 0; round < NUM_ROUNDS; round++ ) {
+
+      for( int i = 0; i < FILES_PER_ROUND; i++ ) {
+
+         // use long names half the time, so some names don't fit inline
+         snprintf( path, PATH_MAX, "/t%d/%s-%d", args->id, (i % 2 == 0 ? "f" : "a-file-with-a-name-too-long-to-store-inline"), i );
+
+         fh = fskit_create( core, path, 0, 0, 0644, &rc );
+         if( fh == NULL ) {
+            fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+            args->rc = rc;
+            return NULL;
+         }
+
+         fskit_close( core, fh );
+      }
+
+      for( int i = 0; i < FILES_PER_ROUND; i++ ) {
+
+         snprintf( path, PATH_MAX, "/t%d/%s-%d", args->id, (i % 2 == 0 ? "f" : "a-file-with-a-name-too-long-to-store-inline"), i );
+
+         fh = fskit_open( core, path, 0, 0, O_RDONLY, 0, &rc );
+         if( fh == NULL ) {
+            fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+            args->rc = rc;
+            return NULL;
+         }
+
+         // unlink while open; the inode goes away on close
+         rc = fskit_unlink( core, path, 0, 0 );
+         if( rc != 0 ) {
+            fskit_error("fskit_unlink('%s') rc = %d\n", path, rc );
+            args->rc = rc;
+            return NULL;
+         }
+
+         fskit_close( core, fh );
+      }
+
+      if( fskit_entry_set_count( fskit_entry_get_children( fskit_core_get_root( core ) ) ) != NUM_THREADS + 2 ) {
+         fskit_error("%s", "root directory changed\n");
+         args->rc = -EIO;
+         return NULL;
+      }
+   }
+
+   return NULL;
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   char path[PATH_MAX];
+   pthread_t threads[NUM_THREADS];
+   struct slab_thread_args args[NUM_THREADS];
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   fskit_set_debug_level( 0 );
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/t%d", i );
+
+      rc = fskit_mkdir( core, path, 0755, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_mkdir('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+
+      args[i].core = core;
+      args[i].id = i;
+      args[i].rc = 0;
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      rc = pthread_create( &threads[i], NULL, slab_thread_main, &args[i] );
+      if( rc != 0 ) {
+         fskit_error("pthread_create rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      pthread_join( threads[i], NULL );
+      if( args[i].rc != 0 ) {
+         fskit_error("thread %d rc = %d\n", i, args[i].rc );
+         exit(1);
+      }
+   }
+
+   // entries made with the heap-allocating API still work alongside slab-allocated ones
+   for( int i = 0; i < 2; i++ ) {
+
+      struct fskit_entry* root = fskit_core_resolve_root( core, true );
+      struct fskit_entry* heap_ent = fskit_entry_new();
+
+      if( heap_ent == NULL ) {
+         fskit_error("%s", "fskit_entry_new() returned NULL\n");
+         exit(1);
+      }
+
+      if( i == 0 ) {
+         rc = fskit_entry_init_dir( heap_ent, root, 12345, 0, 0, 0755 );
+      }
+      else {
+         rc = fskit_entry_init_file( heap_ent, 12346, 0, 0, 0644 );
+      }
+
+      if( rc != 0 ) {
+         fskit_error("fskit_entry_init rc = %d\n", rc );
+         exit(1);
+      }
+
+      rc = fskit_entry_attach_lowlevel( root, heap_ent, "heap" );
+      fskit_entry_unlock( root );
+
+      if( rc != 0 ) {
+         fskit_error("fskit_entry_attach_lowlevel rc = %d\n", rc );
+         exit(1);
+      }
+
+      rc = (i == 0 ? fskit_rmdir( core, "/heap", 0, 0 ) : fskit_unlink( core, "/heap", 0, 0 ));
+      if( rc != 0 ) {
+         fskit_error("removing '/heap' rc = %d\n", rc );
+         exit(1);
+      }
+   }
+
+   // everything should be empty again
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      snprintf( path, PATH_MAX, "/t%d", i );
+
+      rc = fskit_rmdir( core, path, 0, 0 );
+      if( rc != 0 ) {
+         fskit_error("fskit_rmdir('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
@@ -0,0 +1,316 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-stripe.h"
+
+#define NUM_THREADS 4
+#define NUM_WRITES 200
+
+// number of write route calls running, and the most that ever ran at once
+static int in_flight = 0;
+static int max_in_flight = 0;
+
+// set by the blocking route once it is running, and by main to let it return
+static volatile int blocked = 0;
+static volatile int unblock = 0;
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   int n = __atomic_add_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   int max = __atomic_load_n( &max_in_flight, __ATOMIC_SEQ_CST );
+
+   while( n > max && !__atomic_compare_exchange_n( &max_in_flight, &max, n, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+   // give the other writers a chance to overlap
+   sched_yield();
+   usleep( 10 );
+
+   __atomic_sub_fetch( &in_flight, 1, __ATOMIC_SEQ_CST );
+   return buflen;
+}
+
+static int blocking_write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_store_n( &blocked, 1, __ATOMIC_SEQ_CST );
+
+   while( !__atomic_load_n( &unblock, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   return buflen;
+}
+
+// handles to every file under /reenter, and how deep the calling thread is in reenter_write_cb
+#define NUM_REENTER_FILES 512
+static struct fskit_file_handle* reenter_handles[NUM_REENTER_FILES];
+static __thread int reenter_depth = 0;
+
+// write to every file under /reenter (including this one) from inside the route.
+// with 512 inodes and 256 stripes, some of these calls land on the stripe this call holds.
+static int reenter_write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   if( reenter_depth > 0 ) {
+      return buflen;
+   }
+
+   reenter_depth++;
+
+   for( int i = 0; i < NUM_REENTER_FILES; i++ ) {
+
+      ssize_t rc = fskit_write( core, reenter_handles[i], buf, buflen, offset );
+      if( rc != (signed)buflen ) {
+         fskit_error("nested fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+
+   reenter_depth--;
+   return buflen;
+}
+
+struct writer_args {
+   struct fskit_core* core;
+   struct fskit_file_handle* fh;
+};
+
+static void* writer_main( void* arg ) {
+
+   struct writer_args* args = (struct writer_args*)arg;
+   char buf[16];
+
+   memset( buf, 0, sizeof(buf) );
+
+   for( int i = 0; i < NUM_WRITES; i++ ) {
+
+      ssize_t rc = fskit_write( args->core, args->fh, buf, sizeof(buf), i * sizeof(buf) );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_write rc = %zd\n", rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+// write one file from NUM_THREADS threads, through one handle each or one shared handle,
+// and return the most write route calls that ever ran at once
+static int concurrent_writes( struct fskit_core* core, char const* path, bool shared_handle ) {
+
+   pthread_t threads[NUM_THREADS];
+   struct writer_args args[NUM_THREADS];
+   int rc = 0;
+
+   __atomic_store_n( &max_in_flight, 0, __ATOMIC_SEQ_CST );
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      args[i].core = core;
+
+      if( i == 0 || !shared_handle ) {
+
+         args[i].fh = fskit_open( core, path, 0, 0, O_WRONLY, 0, &rc );
+         if( args[i].fh == NULL ) {
+            fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+            exit(1);
+         }
+      }
+      else {
+
+         args[i].fh = args[0].fh;
+      }
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_create( &threads[i], NULL, writer_main, &args[i] );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( threads[i], NULL );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      if( i == 0 || !shared_handle ) {
+         fskit_close( core, args[i].fh );
+      }
+   }
+
+   return __atomic_load_n( &max_in_flight, __ATOMIC_SEQ_CST );
+}
+
+static void* blocked_writer_main( void* arg ) {
+
+   struct writer_args* args = (struct writer_args*)arg;
+   char buf[16];
+
+   memset( buf, 0, sizeof(buf) );
+
+   ssize_t rc = fskit_write( args->core, args->fh, buf, sizeof(buf), 0 );
+   if( rc != (signed)sizeof(buf) ) {
+      fskit_error("fskit_write rc = %zd\n", rc );
+      exit(1);
+   }
+
+   return NULL;
+}
+
+static void create_file( struct fskit_core* core, char const* path ) {
+
+   int rc = 0;
+   struct fskit_file_handle* fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   int rc;
+   int max = 0;
+   pthread_t blocked_thread;
+   struct writer_args blocked_args;
+   struct stat sb;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/striped/([^/]+)", write_cb, FSKIT_INODE_STRIPED );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/handle/([^/]+)", write_cb, FSKIT_HANDLE_SEQUENTIAL );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/blocking/([^/]+)", blocking_write_cb, FSKIT_INODE_STRIPED );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_route_write( core, "/reenter/([^/]+)", reenter_write_cb, FSKIT_INODE_STRIPED );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_mkdir( core, "/striped", 0755, 0, 0 );
+   fskit_mkdir( core, "/handle", 0755, 0, 0 );
+   fskit_mkdir( core, "/blocking", 0755, 0, 0 );
+   fskit_mkdir( core, "/reenter", 0755, 0, 0 );
+
+   create_file( core, "/striped/f" );
+   create_file( core, "/handle/f" );
+   create_file( core, "/blocking/f" );
+
+   // writes to the same inode are serialized, whichever handle they go through
+   max = concurrent_writes( core, "/striped/f", false );
+   if( max != 1 ) {
+      fskit_error("FSKIT_INODE_STRIPED: %d writes ran at once\n", max );
+      exit(1);
+   }
+
+   // writes through the same handle are serialized
+   max = concurrent_writes( core, "/handle/f", true );
+   if( max != 1 ) {
+      fskit_error("FSKIT_HANDLE_SEQUENTIAL: %d writes ran at once through one handle\n", max );
+      exit(1);
+   }
+
+   max = concurrent_writes( core, "/handle/f", false );
+   printf("FSKIT_HANDLE_SEQUENTIAL: at most %d writes at once through %d handles\n", max, NUM_THREADS );
+
+   // a running route doesn't lock its inode, so it can still be stat'ed
+   blocked_args.core = core;
+   blocked_args.fh = fskit_open( core, "/blocking/f", 0, 0, O_WRONLY, 0, &rc );
+   if( blocked_args.fh == NULL ) {
+      fskit_error("fskit_open('/blocking/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   pthread_create( &blocked_thread, NULL, blocked_writer_main, &blocked_args );
+
+   while( !__atomic_load_n( &blocked, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   rc = fskit_stat( core, "/blocking/f", 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat('/blocking/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   __atomic_store_n( &unblock, 1, __ATOMIC_SEQ_CST );
+   pthread_join( blocked_thread, NULL );
+
+   // the write's size update still happened
+   rc = fskit_stat( core, "/blocking/f", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != 16 ) {
+      fskit_error("fskit_stat('/blocking/f') rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   fskit_close( core, blocked_args.fh );
+
+   // a striped callback can call back into fskit, even on inodes that share its stripe
+   for( int i = 0; i < NUM_REENTER_FILES; i++ ) {
+
+      char path[PATH_MAX];
+      snprintf( path, PATH_MAX, "/reenter/f-%d", i );
+
+      reenter_handles[i] = fskit_create( core, path, 0, 0, 0644, &rc );
+      if( reenter_handles[i] == NULL ) {
+         fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+         exit(1);
+      }
+   }
+
+   for( int i = 0; i < NUM_REENTER_FILES; i += 64 ) {
+
+      char buf[16];
+      memset( buf, 0, sizeof(buf) );
+
+      ssize_t nw = fskit_write( core, reenter_handles[i], buf, sizeof(buf), 0 );
+      if( nw != (signed)sizeof(buf) ) {
+         fskit_error("fskit_write rc = %zd\n", nw );
+         exit(1);
+      }
+   }
+
+   for( int i = 0; i < NUM_REENTER_FILES; i++ ) {
+      fskit_close( core, reenter_handles[i] );
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}
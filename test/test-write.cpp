@@ -21,6 +21,114 @@
 
 #include "test-write.h"
 
+#define NUM_THREADS 4
+#define NUM_WRITES 500
+#define WRITE_SIZE 16
+
+static struct fskit_core* core = NULL;
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   // give the other writers a chance to overlap
+   sched_yield();
+   return buflen;
+}
+
+struct writer {
+
+   struct fskit_file_handle* fh;
+   int id;
+   pthread_t thread;
+};
+
+// interleave this writer's blocks with the others', so every write grows the file
+static void* writer_main( void* arg ) {
+
+   struct writer* w = (struct writer*)arg;
+   char buf[WRITE_SIZE];
+
+   memset( buf, w->id, sizeof(buf) );
+
+   for( int i = 0; i < NUM_WRITES; i++ ) {
+
+      off_t offset = (off_t)(i * NUM_THREADS + w->id) * WRITE_SIZE;
+
+      ssize_t rc = fskit_write( core, w->fh, buf, sizeof(buf), offset );
+      if( rc != (signed)sizeof(buf) ) {
+         fskit_error("fskit_write(%jd) rc = %zd\n", (intmax_t)offset, rc );
+         exit(1);
+      }
+   }
+
+   return NULL;
+}
+
+// race writers through a write route with the given consistency discipline, and check that the file ends up exactly as big as the furthest write
+static void check_concurrent_writes( char const* path, int discipline ) {
+
+   int rc = 0;
+   struct writer writers[NUM_THREADS];
+   struct fskit_file_handle* fh = NULL;
+   struct stat sb;
+
+   rc = fskit_route_write( core, path, write_cb, discipline );
+   if( rc < 0 ) {
+      fskit_error("fskit_route_write('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fh = fskit_create( core, path, 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, path, 0, 0, O_WRONLY, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('%s') rc = %d\n", path, rc );
+      exit(1);
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+
+      writers[i].fh = fh;
+      writers[i].id = i;
+      pthread_create( &writers[i].thread, NULL, writer_main, &writers[i] );
+   }
+
+   for( int i = 0; i < NUM_THREADS; i++ ) {
+      pthread_join( writers[i].thread, NULL );
+   }
+
+   fskit_close( core, fh );
+
+   rc = fskit_stat( core, path, 0, 0, &sb );
+   if( rc != 0 || sb.st_size != NUM_THREADS * NUM_WRITES * WRITE_SIZE ) {
+      fskit_error("fskit_stat('%s') rc = %d, size = %jd, expected %d\n", path, rc, (intmax_t)sb.st_size, NUM_THREADS * NUM_WRITES * WRITE_SIZE );
+      exit(1);
+   }
+
+   printf("%s: size = %jd\n", path, (intmax_t)sb.st_size );
+}
+
 int main( int argc, char** argv ) {
+
+   int rc = 0;
+   void* output;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   check_concurrent_writes( "/concurrent", FSKIT_CONCURRENT );
+   check_concurrent_writes( "/sequential", FSKIT_SEQUENTIAL );
+   check_concurrent_writes( "/inode-concurrent", FSKIT_INODE_CONCURRENT );
+   check_concurrent_writes( "/inode-sequential", FSKIT_INODE_SEQUENTIAL );
+
+   fskit_test_end( core, &output );
+
    return 0;
 }
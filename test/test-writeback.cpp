@@ -0,0 +1,348 @@
+/*
+   fskit: a library for creating multi-threaded in-RAM filesystems
+   Copyright (C) 2014  Jude Nelson
+
+   This program is dual-licensed: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License version 3 or later as
+   published by the Free Software Foundation. For the terms of this
+   license, see LICENSE.LGPLv3+ or <http://www.gnu.org/licenses/>.
+
+   You are free to use this program under the terms of the GNU Lesser General
+   Public License, but WITHOUT ANY WARRANTY; without even the implied
+   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   See the GNU Lesser General Public License for more details.
+
+   Alternatively, you are free to use this program under the terms of the
+   Internet Software Consortium License, but WITHOUT ANY WARRANTY; without
+   even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+   For the terms of this license, see LICENSE.ISC or
+   <http://www.isc.org/downloads/software-support-policy/isc-license/>.
+*/
+
+#include "test-writeback.h"
+
+#define MAX_BYTES 64
+#define FLUSH_MS 50
+
+// the "backend": one file's bytes
+static char backing[ 4096 ];
+static size_t backing_size = 0;
+
+// write route calls, the last one's extent, and whether to fail the next one
+static int num_writes = 0;
+static off_t last_offset = 0;
+static size_t last_len = 0;
+static bool fail_next = false;
+
+static int read_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   size_t len = 0;
+
+   if( (size_t)offset < backing_size ) {
+      len = MIN( buflen, backing_size - offset );
+      memcpy( buf, backing + offset, len );
+   }
+
+   return len;
+}
+
+static int write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_fetch_add( &num_writes, 1, __ATOMIC_SEQ_CST );
+   last_offset = offset;
+   last_len = buflen;
+
+   if( fail_next ) {
+      fail_next = false;
+      return -EIO;
+   }
+
+   memcpy( backing + offset, buf, buflen );
+
+   if( offset + buflen > backing_size ) {
+      backing_size = offset + buflen;
+   }
+
+   return buflen;
+}
+
+// set by slow_write_cb once the flusher is in it, and by main to let it return
+static volatile int slow_running = 0;
+static volatile int slow_release = 0;
+
+static int slow_write_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buflen, off_t offset, void* handle_data ) {
+
+   __atomic_store_n( &slow_running, 1, __ATOMIC_SEQ_CST );
+
+   while( !__atomic_load_n( &slow_release, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   return buflen;
+}
+
+static int trunc_cb( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, off_t new_size, void* handle_data ) {
+
+   backing_size = new_size;
+   return 0;
+}
+
+static void do_write( struct fskit_core* core, struct fskit_file_handle* fh, char c, size_t len, off_t offset ) {
+
+   char buf[ 4096 ];
+   ssize_t rc = 0;
+
+   memset( buf, c, len );
+
+   rc = fskit_write( core, fh, buf, len, offset );
+   if( rc != (signed)len ) {
+      fskit_error("fskit_write(%zu @ %jd) rc = %zd\n", len, (intmax_t)offset, rc );
+      exit(1);
+   }
+}
+
+static void check_writes( int expected, char const* what ) {
+
+   int n = __atomic_load_n( &num_writes, __ATOMIC_SEQ_CST );
+
+   if( n != expected ) {
+      fskit_error("%s: %d write route calls, expected %d\n", what, n, expected );
+      exit(1);
+   }
+}
+
+static void check_extent( off_t offset, size_t len, char const* what ) {
+
+   if( last_offset != offset || last_len != len ) {
+      fskit_error("%s: last write route call was %zu @ %jd, expected %zu @ %jd\n", what, last_len, (intmax_t)last_offset, len, (intmax_t)offset );
+      exit(1);
+   }
+}
+
+int main( int argc, char** argv ) {
+
+   struct fskit_core* core = NULL;
+   struct fskit_file_handle* fh = NULL;
+   struct stat sb;
+   struct timespec mtime;
+   char buf[ 4096 ];
+   void* output;
+   int rc;
+
+   rc = fskit_test_begin( &core, NULL );
+   if( rc != 0 ) {
+      exit(1);
+   }
+
+   rc = fskit_core_writeback_enable( core, MAX_BYTES, FLUSH_MS );
+   if( rc != 0 ) {
+      fskit_error("fskit_core_writeback_enable rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_core_writeback_enable( core, 0, 0 );
+   if( rc != -EEXIST ) {
+      fskit_error("fskit_core_writeback_enable(again) rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_route_read( core, "/f", read_cb, FSKIT_CONCURRENT );
+   fskit_route_write( core, "/f", write_cb, FSKIT_CONCURRENT );
+   fskit_route_trunc( core, "/f", trunc_cb, FSKIT_CONCURRENT );
+   fskit_route_write( core, "/slow", slow_write_cb, FSKIT_CONCURRENT );
+
+   fh = fskit_create( core, "/f", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_close( core, fh );
+
+   fh = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   // sequential small writes coalesce, and go out once the buffer fills
+   for( int i = 0; i < 4; i++ ) {
+      do_write( core, fh, 'a' + i, 16, i * 16 );
+   }
+
+   check_writes( 1, "filled" );
+   check_extent( 0, MAX_BYTES, "filled" );
+
+   // buffered writes are visible in the size and mtime right away
+   rc = fskit_stat( core, "/f", 0, 0, &sb );
+   if( rc != 0 ) {
+      fskit_error("fskit_stat rc = %d\n", rc );
+      exit(1);
+   }
+
+   mtime = sb.st_mtim;
+   usleep( 10000 );
+
+   do_write( core, fh, 'e', 8, 64 );
+   check_writes( 1, "buffered" );
+
+   rc = fskit_stat( core, "/f", 0, 0, &sb );
+   if( rc != 0 || sb.st_size != 72 ) {
+      fskit_error("fskit_stat rc = %d, size = %jd\n", rc, (intmax_t)sb.st_size );
+      exit(1);
+   }
+
+   if( sb.st_mtim.tv_sec == mtime.tv_sec && sb.st_mtim.tv_nsec == mtime.tv_nsec ) {
+      fskit_error("%s\n", "mtime did not move on a buffered write" );
+      exit(1);
+   }
+
+   // reads that don't overlap buffered data don't flush it
+   rc = fskit_read( core, fh, buf, 16, 0 );
+   if( rc != 16 ) {
+      fskit_error("fskit_read rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 1, "read elsewhere" );
+
+   // reads that do, do
+   rc = fskit_read( core, fh, buf, 16, 60 );
+   if( rc != 12 || memcmp( buf, "dddd", 4 ) != 0 || memcmp( buf + 4, "eeeeeeee", 8 ) != 0 ) {
+      fskit_error("fskit_read(overlap) rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 2, "read overlap" );
+   check_extent( 64, 8, "read overlap" );
+
+   // overlapping and backwards-adjacent writes merge
+   do_write( core, fh, 'x', 8, 100 );
+   do_write( core, fh, 'y', 8, 104 );
+   do_write( core, fh, 'z', 4, 96 );
+   check_writes( 2, "merge" );
+
+   // a write that doesn't touch the buffered extent flushes it
+   do_write( core, fh, 'q', 4, 200 );
+   check_writes( 3, "discontiguous" );
+   check_extent( 96, 16, "discontiguous" );
+
+   if( memcmp( backing + 96, "zzzzxxxxyyyyyyyy", 16 ) != 0 ) {
+      fskit_error("%s", "merged extent has the wrong data\n");
+      exit(1);
+   }
+
+   // fsync flushes
+   rc = fskit_fsync( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_fsync rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 4, "fsync" );
+   check_extent( 200, 4, "fsync" );
+
+   // writes bigger than the buffer go straight through
+   do_write( core, fh, 'B', MAX_BYTES + 1, 300 );
+   check_writes( 5, "oversized" );
+   check_extent( 300, MAX_BYTES + 1, "oversized" );
+
+   // the timer flushes
+   do_write( core, fh, 't', 4, 400 );
+   check_writes( 5, "before timer" );
+
+   usleep( FLUSH_MS * 4 * 1000 );
+
+   check_writes( 6, "timer" );
+   check_extent( 400, 4, "timer" );
+
+   // errors from background flushes are reported by fsync, once
+   do_write( core, fh, 'e', 4, 500 );
+   fail_next = true;
+
+   usleep( FLUSH_MS * 4 * 1000 );
+
+   check_writes( 7, "failed timer" );
+
+   rc = fskit_fsync( core, fh );
+   if( rc != -EIO ) {
+      fskit_error("fskit_fsync(after failure) rc = %d\n", rc );
+      exit(1);
+   }
+
+   rc = fskit_fsync( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_fsync(after reporting) rc = %d\n", rc );
+      exit(1);
+   }
+
+   // truncates flush first
+   do_write( core, fh, 'T', 4, 600 );
+
+   rc = fskit_ftrunc( core, fh, 602 );
+   if( rc != 0 ) {
+      fskit_error("fskit_ftrunc rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 8, "truncate" );
+
+   if( backing_size != 602 ) {
+      fskit_error("backing size is %zu after truncate\n", backing_size );
+      exit(1);
+   }
+
+   // close flushes
+   do_write( core, fh, 'c', 4, 700 );
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 9, "close" );
+   check_extent( 700, 4, "close" );
+
+   // a slow write route in the flusher doesn't hold up other handles
+   fh = fskit_create( core, "/slow", 0, 0, 0644, &rc );
+   if( fh == NULL ) {
+      fskit_error("fskit_create('/slow') rc = %d\n", rc );
+      exit(1);
+   }
+
+   do_write( core, fh, 's', 4, 0 );
+
+   while( !__atomic_load_n( &slow_running, __ATOMIC_SEQ_CST ) ) {
+      usleep( 1000 );
+   }
+
+   struct fskit_file_handle* fh2 = fskit_open( core, "/f", 0, 0, O_RDWR, 0, &rc );
+   if( fh2 == NULL ) {
+      fskit_error("fskit_open('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   do_write( core, fh2, 'o', 4, 800 );
+
+   rc = fskit_close( core, fh2 );
+   if( rc != 0 ) {
+      fskit_error("fskit_close('/f') rc = %d\n", rc );
+      exit(1);
+   }
+
+   check_writes( 10, "while the flusher is busy" );
+   check_extent( 800, 4, "while the flusher is busy" );
+
+   __atomic_store_n( &slow_release, 1, __ATOMIC_SEQ_CST );
+
+   rc = fskit_close( core, fh );
+   if( rc != 0 ) {
+      fskit_error("fskit_close('/slow') rc = %d\n", rc );
+      exit(1);
+   }
+
+   fskit_test_end( core, &output );
+
+   return 0;
+}